@@ -0,0 +1,1867 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+#include "xxhash_file.hpp"
+#include "xxhash_uring.hpp"
+#include "xxhash_manifest.hpp"
+#include "xxhash_blocks.hpp"
+#include "xxhash_page.hpp"
+#include "xxhash_cdc.hpp"
+#include "xxhash_delta.hpp"
+#include "xxhash_merkle.hpp"
+#include "xxhash_flat_map.hpp"
+#include "xxhash_concurrent_map.hpp"
+#include "xxhash_interner.hpp"
+#include "xxhash_hashed_string.hpp"
+#include "xxhash_bloom.hpp"
+#include "xxhash_cuckoo.hpp"
+#include "xxhash_fuse.hpp"
+#include "xxhash_mphf.hpp"
+#include "xxhash_hyperloglog.hpp"
+#include "xxhash_count_min.hpp"
+
+/* Benchmarks for xxhash_cpp.
+* Run without arguments to execute every benchmark, or pass a substring to select benchmarks by name.
+* Build in Release mode, timings of unoptimized builds are meaningless.
+*/
+
+namespace bench
+{
+	using clock = std::chrono::steady_clock;
+
+	/* Sink for results, keeps the optimizer from discarding the work being measured. */
+	volatile uint64_t sink = 0;
+
+	inline void consume(uint64_t v)
+	{
+		sink = sink + v;
+	}
+
+	inline void consume(xxh::uint128_t v)
+	{
+		sink = sink + v.low64 + v.high64;
+	}
+
+	/* Best time in seconds out of the given number of runs. */
+	template <typename F>
+	double measure(F&& f, size_t runs = 5)
+	{
+		double best = 1e300;
+
+		for (size_t i = 0; i < runs; i++)
+		{
+			auto const start = clock::now();
+			f();
+			std::chrono::duration<double> const elapsed = clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+
+		return best;
+	}
+
+	inline void report(const std::string& name, double bytes, double seconds)
+	{
+		std::cout << std::left << std::setw(56) << name << std::right << std::setw(10) << std::fixed << std::setprecision(2) << (bytes / seconds / 1e9) << " GB/s\n";
+	}
+
+	inline void report_rate(const std::string& name, double items, double seconds, const std::string& unit)
+	{
+		std::cout << std::left << std::setw(56) << name << std::right << std::setw(10) << std::fixed << std::setprecision(2) << (items / seconds / 1e6) << " M" << unit << "/s\n";
+	}
+
+	inline std::vector<uint8_t> random_bytes(size_t size, uint32_t seed = 1)
+	{
+		std::vector<uint8_t> out(size);
+		std::mt19937 rng(seed);
+		std::generate(out.begin(), out.end(), [&rng]() { return static_cast<uint8_t>(rng()); });
+		return out;
+	}
+}
+
+
+/* *************************************
+*  Stream arena
+***************************************/
+
+void bench_stream_arena()
+{
+	for (size_t stream_count : { size_t(1000), size_t(10000), size_t(100000) })
+	{
+		constexpr size_t update_len = 64;
+		constexpr size_t ticks = 8;
+		std::vector<uint8_t> const payload = bench::random_bytes(1 << 24);
+		std::vector<xxh::hash_state_arena64_t::update_t> batch(stream_count);
+
+		for (size_t id = 0; id < stream_count; id++)
+		{
+			batch[id] = { id, payload.data() + (id * update_len * 7) % (payload.size() - update_len), update_len };
+		}
+
+		/* packets of different streams arrive interleaved */
+		std::shuffle(batch.begin(), batch.end(), std::mt19937(1));
+
+		double const bytes = static_cast<double>(stream_count * update_len * ticks);
+
+		std::vector<xxh::hash_state64_t> states(stream_count);
+		double const t_states = bench::measure([&]() {
+			for (size_t tick = 0; tick < ticks; tick++)
+			{
+				for (const auto& u : batch)
+				{
+					states[u.stream_id].update(u.input, u.length);
+				}
+			}
+			bench::consume(states[stream_count / 2].digest());
+		});
+
+		xxh::hash_state_arena64_t arena(stream_count);
+		double const t_arena = bench::measure([&]() {
+			for (size_t tick = 0; tick < ticks; tick++)
+			{
+				arena.update(batch);
+			}
+			bench::consume(arena.digest(stream_count / 2));
+		});
+
+		bench::report("hash_state64_t x " + std::to_string(stream_count), bytes, t_states);
+		bench::report("hash_state_arena64_t x " + std::to_string(stream_count), bytes, t_arena);
+	}
+}
+
+
+/* *************************************
+*  Fused copy and hash
+***************************************/
+
+void bench_copy_and_hash()
+{
+	for (size_t size : { size_t(64 * 1024), size_t(1024 * 1024), size_t(64 * 1024 * 1024) })
+	{
+		std::vector<uint8_t> const src = bench::random_bytes(size);
+		std::vector<uint8_t> dest_storage(size + 64);
+		uint8_t* const dest = dest_storage.data() + (64 - reinterpret_cast<uintptr_t>(dest_storage.data()) % 64) % 64;
+		size_t const runs = std::max<size_t>(1, (256 * 1024 * 1024) / size);
+		double const bytes = static_cast<double>(size * runs);
+		std::string const suffix = " " + std::to_string(size / 1024) + " KB";
+
+		double const t_separate = bench::measure([&]() {
+			for (size_t i = 0; i < runs; i++)
+			{
+				memcpy(dest, src.data(), size);
+				bench::consume(xxh::xxhash3<128>(dest, size));
+			}
+		});
+
+		double const t_fused = bench::measure([&]() {
+			for (size_t i = 0; i < runs; i++)
+			{
+				bench::consume(xxh::copy_and_hash3<128>(dest, src.data(), size, 0, xxh::store_hint::temporal));
+			}
+		});
+
+		double const t_fused_nt = bench::measure([&]() {
+			for (size_t i = 0; i < runs; i++)
+			{
+				bench::consume(xxh::copy_and_hash3<128>(dest, src.data(), size, 0, xxh::store_hint::non_temporal));
+			}
+		});
+
+		double const t_stream = bench::measure([&]() {
+			for (size_t i = 0; i < runs; i++)
+			{
+				xxh::hash3_state128_t state;
+				state.update_copy(dest, src.data(), size);
+				bench::consume(state.digest());
+			}
+		});
+
+		bench::report("memcpy + xxhash3<128>" + suffix, bytes, t_separate);
+		bench::report("copy_and_hash3<128> temporal" + suffix, bytes, t_fused);
+		bench::report("copy_and_hash3<128> non-temporal" + suffix, bytes, t_fused_nt);
+		bench::report("hash3_state128_t::update_copy" + suffix, bytes, t_stream);
+	}
+}
+
+
+/* *************************************
+*  Tree hash
+***************************************/
+
+void bench_tree_hash()
+{
+	size_t const size = 512 * 1024 * 1024;
+	std::vector<uint8_t> const input = bench::random_bytes(size);
+	double const bytes = static_cast<double>(size);
+
+	double const t_plain = bench::measure([&]() { bench::consume(xxh::xxhash3<128>(input)); });
+	bench::report("xxhash3<128>", bytes, t_plain);
+
+	for (size_t threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+	{
+		xxh::thread_pool pool(threads);
+		double const t_tree = bench::measure([&]() { bench::consume(xxh::tree_hash(input, pool)); });
+		bench::report("tree_hash x " + std::to_string(threads) + " threads", bytes, t_tree);
+	}
+}
+
+
+/* *************************************
+*  Batch hashing
+***************************************/
+
+void bench_parallel_hash3()
+{
+	std::mt19937_64 rng(42);
+	std::vector<std::pair<std::string, std::vector<size_t>>> distributions;
+
+	{
+		std::vector<size_t> sizes(4 * 1024 * 1024);
+		std::uniform_int_distribution<size_t> dist(1, 16);
+		std::generate(sizes.begin(), sizes.end(), [&]() { return dist(rng); });
+		distributions.emplace_back("uniform 1-16 B", std::move(sizes));
+	}
+
+	{	/* heavy tail: most inputs are tiny, a few are several megabytes */
+		std::vector<size_t> sizes(1024 * 1024);
+		std::lognormal_distribution<double> dist(4.0, 2.5);
+		std::generate(sizes.begin(), sizes.end(), [&]() { return std::min<size_t>(static_cast<size_t>(dist(rng)), 16 * 1024 * 1024); });
+		distributions.emplace_back("lognormal", std::move(sizes));
+	}
+
+	for (const auto& [name, sizes] : distributions)
+	{
+		size_t total = 0;
+
+		for (size_t size : sizes)
+		{
+			total += size;
+		}
+
+		std::vector<uint8_t> const storage = bench::random_bytes(std::min<size_t>(total, 256 * 1024 * 1024));
+		std::vector<xxh::byte_range> ranges;
+		size_t offset = 0;
+
+		for (size_t size : sizes)
+		{
+			if (offset + size > storage.size())
+			{
+				offset = 0;
+			}
+
+			ranges.emplace_back(storage.data() + offset, size);
+			offset += size;
+		}
+
+		std::vector<xxh::hash64_t> out(ranges.size());
+		double const bytes = static_cast<double>(total);
+		std::string const suffix = " (" + name + ")";
+
+		double const t_loop = bench::measure([&]() {
+			for (size_t i = 0; i < ranges.size(); i++)
+			{
+				out[i] = xxh::xxhash3<64>(ranges[i].data, ranges[i].size);
+			}
+			bench::consume(out[ranges.size() / 2]);
+		});
+
+		bench::report("xxhash3<64> loop" + suffix, bytes, t_loop);
+		bench::report_rate("xxhash3<64> loop" + suffix, static_cast<double>(ranges.size()), t_loop, "inputs");
+
+		for (size_t threads = 1; threads <= std::max(1u, std::thread::hardware_concurrency()); threads *= 2)
+		{
+			xxh::thread_pool pool(threads);
+			double const t_batch = bench::measure([&]() {
+				xxh::parallel_hash3<64>(ranges.data(), ranges.size(), out.data(), pool);
+				bench::consume(out[ranges.size() / 2]);
+			});
+
+			bench::report("parallel_hash3<64> x " + std::to_string(threads) + " threads" + suffix, bytes, t_batch);
+			bench::report_rate("parallel_hash3<64> x " + std::to_string(threads) + " threads" + suffix, static_cast<double>(ranges.size()), t_batch, "inputs");
+		}
+	}
+}
+
+
+/* *************************************
+*  File hashing
+***************************************/
+
+#if XXH_CPP_POSIX_FILES
+/* Drops the file from the page cache, so the next pass has to go to the device. */
+void evict_from_page_cache(const std::string& path)
+{
+	int const fd = ::open(path.c_str(), O_RDONLY);
+	::fdatasync(fd);
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	::close(fd);
+}
+
+/* The usual hand-written version: read() into a buffer and stream it into the state. */
+xxh::hash64_t read_and_stream(const std::string& path)
+{
+	int const fd = ::open(path.c_str(), O_RDONLY);
+	std::vector<uint8_t> buffer(1024 * 1024);
+	xxh::hash3_state64_t state;
+	ssize_t n;
+
+	while ((n = ::read(fd, buffer.data(), buffer.size())) > 0)
+	{
+		state.update(buffer.data(), static_cast<size_t>(n));
+	}
+
+	::close(fd);
+	return state.digest();
+}
+
+void bench_hash_file()
+{
+	size_t const size = 1024 * 1024 * 1024;
+	std::string const path = (std::filesystem::temp_directory_path() / "xxh_cpp_bench_file.bin").string();
+
+	{
+		std::vector<uint8_t> const block = bench::random_bytes(64 * 1024 * 1024);
+		std::ofstream out(path, std::ios::binary);
+
+		for (size_t written = 0; written < size; written += block.size())
+		{
+			out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+		}
+	}
+
+	xxh::file_hash_options read_options;
+	read_options.access = xxh::file_access::read;
+	double const bytes = static_cast<double>(size);
+
+	for (bool cold : { false, true })
+	{
+		std::string const suffix = cold ? " (cold cache)" : " (warm cache)";
+		size_t const runs = cold ? 3 : 5;
+
+		double const t_read = bench::measure([&]() {
+			if (cold)
+			{
+				evict_from_page_cache(path);
+			}
+			bench::consume(read_and_stream(path));
+		}, runs);
+
+		double const t_file_read = bench::measure([&]() {
+			if (cold)
+			{
+				evict_from_page_cache(path);
+			}
+			bench::consume(xxh::hash_file<64>(path, read_options).hash);
+		}, runs);
+
+		double const t_file_map = bench::measure([&]() {
+			if (cold)
+			{
+				evict_from_page_cache(path);
+			}
+			bench::consume(xxh::hash_file<64>(path).hash);
+		}, runs);
+
+		bench::report("read() + hash3_state64_t" + suffix, bytes, t_read);
+		bench::report("hash_file<64> read" + suffix, bytes, t_file_read);
+		bench::report("hash_file<64> mmap" + suffix, bytes, t_file_map);
+	}
+
+	std::filesystem::remove(path);
+}
+#endif
+
+
+/* *************************************
+*  Pipelined file hashing
+***************************************/
+
+#if defined(__linux__)
+void bench_pipelined()
+{
+	size_t const size = 1024 * 1024 * 1024;
+	std::string const path = (std::filesystem::temp_directory_path() / "xxh_cpp_bench_pipelined.bin").string();
+
+	{
+		std::vector<uint8_t> const block = bench::random_bytes(64 * 1024 * 1024);
+		std::ofstream out(path, std::ios::binary);
+
+		for (size_t written = 0; written < size; written += block.size())
+		{
+			out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+		}
+	}
+
+	double const bytes = static_cast<double>(size);
+
+	/* device bound: cold cache, or O_DIRECT which never hits the cache. cpu bound: everything already in the page cache. */
+	for (bool cold : { true, false })
+	{
+		std::string const suffix = cold ? " (device bound)" : " (cpu bound)";
+		size_t const runs = cold ? 3 : 5;
+
+		xxh::file_hash_options read_options;
+		read_options.access = xxh::file_access::read;
+
+		double const t_sync = bench::measure([&]() {
+			if (cold)
+			{
+				evict_from_page_cache(path);
+			}
+			bench::consume(xxh::hash_file<64>(path, read_options).hash);
+		}, runs);
+
+		bench::report("synchronous read + hash" + suffix, bytes, t_sync);
+
+		for (xxh::pipeline_engine engine : { xxh::pipeline_engine::io_uring, xxh::pipeline_engine::pread_thread })
+		{
+			for (bool direct : { false, true })
+			{
+				if (!cold && direct)
+				{
+					continue;
+				}
+
+				xxh::pipeline_options options;
+				options.engine = engine;
+				options.direct = direct;
+				xxh::pipelined_hash_result<64> last;
+
+				double const t = bench::measure([&]() {
+					if (cold)
+					{
+						evict_from_page_cache(path);
+					}
+					last = xxh::hash_file_pipelined<64>(path, options);
+					bench::consume(last.hash);
+				}, runs);
+
+				std::string const name = std::string(last.used_io_uring ? "io_uring" : "pread thread") + (last.direct ? " O_DIRECT" : "") + suffix;
+				bench::report(name, bytes, t);
+				bench::report("  hashing only, " + name, static_cast<double>(last.bytes), last.hash_seconds);
+				std::cout << "  hasher waiting for I/O " << std::fixed << std::setprecision(0) << (100 * last.wait_seconds / last.seconds) << "% of the time\n";
+			}
+		}
+	}
+
+	std::filesystem::remove(path);
+}
+#endif
+
+
+/* *************************************
+*  Directory tree hashing
+***************************************/
+
+void bench_hash_tree()
+{
+	namespace fs = std::filesystem;
+
+	/* a source-tree-like layout: 100 directories of 200 small files each */
+	fs::path const root = fs::temp_directory_path() / "xxh_cpp_bench_tree";
+	std::vector<uint8_t> const data = bench::random_bytes(64 * 1024);
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<size_t> sizes(100, 16 * 1024);
+	size_t const dirs = 100, files_per_dir = 200;
+
+	fs::remove_all(root);
+
+	for (size_t d = 0; d < dirs; d++)
+	{
+		fs::create_directories(root / std::to_string(d));
+
+		for (size_t f = 0; f < files_per_dir; f++)
+		{
+			std::ofstream(root / std::to_string(d) / (std::to_string(f) + ".src"), std::ios::binary).write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(sizes(rng)));
+		}
+	}
+
+	double const files = static_cast<double>(dirs * files_per_dir);
+	xxh::manifest previous;
+
+	for (size_t threads : { size_t(1), size_t(4), size_t(16), size_t(64) })
+	{
+		xxh::tree_hash_options options;
+		options.threads = threads;
+
+		double const t = bench::measure([&]() {
+			xxh::tree_hash_result r = xxh::hash_tree(root, options);
+			bench::consume(r.manifest.root);
+			previous = std::move(r.manifest);
+		}, 3);
+
+		bench::report_rate("hash_tree x " + std::to_string(threads) + " workers", files, t, "files");
+	}
+
+	xxh::tree_hash_options incremental;
+	incremental.previous = &previous;
+
+	double const t_incremental = bench::measure([&]() { bench::consume(xxh::hash_tree(root, incremental).manifest.root); }, 3);
+	bench::report_rate("hash_tree incremental, nothing changed", files, t_incremental, "files");
+
+	fs::remove_all(root);
+}
+
+
+/* *************************************
+*  Block checksums
+***************************************/
+
+void bench_blocks()
+{
+	size_t const size = 256 * 1024 * 1024;
+	std::vector<uint8_t> const input = bench::random_bytes(size);
+	double const bytes = static_cast<double>(size);
+	xxh::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()));
+
+	for (size_t block_size : { size_t(4096), size_t(64 * 1024), size_t(1024 * 1024) })
+	{
+		xxh::block_options options;
+		options.block_size = block_size;
+		std::string const suffix = ", " + std::to_string(block_size / 1024) + " KB blocks";
+		xxh::block_index index;
+
+		double const t_build = bench::measure([&]() { index = xxh::build_block_index(input.data(), size, pool, options); bench::consume(index.object_digest); });
+		bench::report("build_block_index" + suffix, bytes, t_build);
+
+		double const t_full = bench::measure([&]() { bench::consume(xxh::verify_block_range(index, input.data(), 0, size, pool).blocks_checked); });
+		bench::report("verify whole object" + suffix, bytes, t_full);
+
+		/* random 4 KB reads, as a database or object store would verify them */
+		std::mt19937_64 rng(3);
+		size_t const reads = 100000;
+		std::vector<uint64_t> offsets(reads);
+		std::generate(offsets.begin(), offsets.end(), [&]() { return rng() % (size - 4096); });
+
+		double const t_range = bench::measure([&]() {
+			for (uint64_t offset : offsets)
+			{
+				bench::consume(xxh::verify_block_range(index, input.data(), offset, 4096).blocks_checked);
+			}
+		}, 3);
+		bench::report_rate("verify random 4 KB ranges" + suffix, static_cast<double>(reads), t_range, "reads");
+	}
+}
+
+
+/* *************************************
+*  Page checksums
+***************************************/
+
+template <size_t page_size>
+void bench_pages_of_size()
+{
+	xxh::page_checksum<page_size, 8> const checksum(0x5eed);
+	std::string const suffix = ", " + std::to_string(page_size / 1024) + " KB pages";
+
+	/* a cache resident working set, and a buffer pool far larger than the caches */
+	for (size_t pool_size : { size_t(256 * 1024), size_t(512 * 1024 * 1024) })
+	{
+		size_t const count = pool_size / page_size;
+		std::vector<uint8_t> pool = bench::random_bytes(pool_size);
+		std::vector<const void*> pages(count);
+		std::mt19937 rng(11);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			checksum.seal(pool.data() + i * page_size);
+			pages[i] = pool.data() + i * page_size;
+		}
+
+		/* pages come back from disk in no particular order */
+		std::shuffle(pages.begin(), pages.end(), rng);
+
+		size_t const rounds = std::max<size_t>(1, (64 * 1024 * 1024) / pool_size);
+		double const items = static_cast<double>(count * rounds);
+		std::string const where = (pool_size < 1024 * 1024) ? " (cached)" : " (uncached)";
+
+		double const t_generic = bench::measure([&]() {
+			for (size_t r = 0; r < rounds; r++)
+			{
+				for (const void* page : pages)
+				{
+					bench::consume(xxh::xxhash3<64>(page, page_size, 0x5eed));
+				}
+			}
+		});
+		bench::report_rate("xxhash3<64> per page" + suffix + where, items, t_generic, "pages");
+
+		double const t_single = bench::measure([&]() {
+			for (size_t r = 0; r < rounds; r++)
+			{
+				for (const void* page : pages)
+				{
+					bench::consume(checksum.verify(page));
+				}
+			}
+		});
+		bench::report_rate("page_checksum::verify" + suffix + where, items, t_single, "pages");
+
+		double const t_batch = bench::measure([&]() {
+			for (size_t r = 0; r < rounds; r++)
+			{
+				bench::consume(checksum.verify_pages(pages.data(), pages.size()));
+			}
+		});
+		bench::report_rate("page_checksum::verify_pages" + suffix + where, items, t_batch, "pages");
+	}
+}
+
+void bench_pages()
+{
+	bench_pages_of_size<4096>();
+	bench_pages_of_size<8192>();
+}
+
+
+/* *************************************
+*  Content-defined chunking
+***************************************/
+
+void bench_cdc()
+{
+	size_t const size = 256 * 1024 * 1024;
+	std::vector<uint8_t> const input = bench::random_bytes(size);
+	double const bytes = static_cast<double>(size);
+	xxh::cdc_options const options;
+	size_t count = 0;
+
+	/* the two pass baseline: a byte at a time gear chunker, then xxhash3<128> over each chunk */
+	uint64_t const small = ~0ULL << (64 - 15), large = ~0ULL << (64 - 11);
+
+	double const t_two_pass = bench::measure([&]() {
+		size_t start = 0;
+		count = 0;
+
+		while (start < size)
+		{
+			size_t const limit = std::min(size - start, options.max_size);
+			size_t len = std::min(limit, options.min_size - 64);
+			uint64_t fp = 0;
+
+			for (; len < limit; len++)
+			{
+				fp = (fp << 1) + xxh::detail_cdc::gear[input[start + len]];
+
+				if (len >= options.min_size && (fp & (len < options.avg_size ? small : large)) == 0)
+				{
+					len++;
+					break;
+				}
+			}
+
+			bench::consume(xxh::xxhash3<128>(input.data() + start, len, options.seed));
+			start += len;
+			count++;
+		}
+	}, 3);
+	bench::report("gear chunker, then xxhash3<128> per chunk", bytes, t_two_pass);
+
+	double const t_cdc = bench::measure([&]() {
+		xxh::cdc_chunker chunker(options);
+		auto const sink = [&](const xxh::cdc_chunk& chunk) { bench::consume(chunk.fingerprint); };
+
+		chunker.update(input.data(), size, sink);
+		chunker.finish(sink);
+	}, 3);
+	bench::report("cdc_chunker (" + std::to_string(size / count) + " B average chunk)", bytes, t_cdc);
+
+	double const t_hash = bench::measure([&]() { bench::consume(xxh::xxhash3<128>(input)); }, 3);
+	bench::report("xxhash3<128> alone, for reference", bytes, t_hash);
+}
+
+
+/* *************************************
+*  Delta encoding
+***************************************/
+
+void bench_delta()
+{
+	size_t const size = 128 * 1024 * 1024;
+	std::vector<uint8_t> const basis = bench::random_bytes(size);
+	double const bytes = static_cast<double>(size);
+	xxh::delta_options const options;
+
+	double const t_plain = bench::measure([&]() {
+		for (size_t offset = 0; offset < size; offset += options.block_size)
+		{
+			bench::consume(xxh::xxhash3<64>(basis.data() + offset, std::min(options.block_size, size - offset)));
+		}
+	}, 3);
+	bench::report("xxhash3<64> per block, one at a time", bytes, t_plain);
+
+	xxh::delta_signature sig;
+	double const t_sig = bench::measure([&]() { sig = xxh::make_signature(basis.data(), size, options); bench::consume(sig.strong.back()); }, 3);
+	bench::report("make_signature", bytes, t_sig);
+
+	double const t_same = bench::measure([&]() { bench::consume(xxh::make_delta(sig, basis.data(), size).ops.size()); }, 3);
+	bench::report("make_delta, unchanged target", bytes, t_same);
+
+	/* a 10 byte insertion every 256 KB: each costs a rolling search over about one block */
+	std::vector<uint8_t> edited;
+	edited.reserve(size + size / 1024);
+
+	for (size_t offset = 0; offset < size; offset += 256 * 1024)
+	{
+		edited.insert(edited.end(), basis.begin() + static_cast<std::ptrdiff_t>(offset), basis.begin() + static_cast<std::ptrdiff_t>(std::min(size, offset + 256 * 1024)));
+		edited.insert(edited.end(), 10, 0x55);
+	}
+
+	double const t_edited = bench::measure([&]() { bench::consume(xxh::make_delta(sig, edited.data(), edited.size()).ops.size()); }, 3);
+	bench::report("make_delta, insertion every 256 KB", static_cast<double>(edited.size()), t_edited);
+
+	std::vector<uint8_t> const unrelated = bench::random_bytes(size / 8, 2);
+	double const t_unrelated = bench::measure([&]() { bench::consume(xxh::make_delta(sig, unrelated.data(), unrelated.size()).ops.size()); }, 3);
+	bench::report("make_delta, no match (rolling all the way)", static_cast<double>(unrelated.size()), t_unrelated);
+}
+
+
+/* *************************************
+*  Merkle trees
+***************************************/
+
+void bench_merkle()
+{
+	size_t const count = 1000000;
+	std::vector<std::pair<std::string, std::string>> records(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		records[i] = { "user:" + std::to_string(i), std::string(100, static_cast<char>('a' + i % 26)) };
+	}
+
+	xxh::merkle_tree a(16);
+	xxh::merkle_tree b(16);
+
+	double const t_assign = bench::measure([&]() { a.assign(records.begin(), records.end()); bench::consume(a.root().low64); }, 3);
+	bench::report_rate("assign, 1M records, 64K leaves", static_cast<double>(count), t_assign, "records");
+
+	b.assign(records.begin(), records.end());
+
+	/* a batch of 1000 updates: their paths share the top levels */
+	size_t const batch = 1000;
+	size_t hashed = 0;
+	size_t round = 0;
+
+	double const t_batch = bench::measure([&]() {
+		for (size_t i = 0; i < batch; i++)
+		{
+			const auto& r = records[(i * 997 + round) % count];
+			b.update(r.first, r.second, (round % 2 == 0) ? "x" : r.second);
+		}
+
+		hashed = b.rehash();
+		round++;
+	}, 3);
+	bench::report_rate("1000 updates and rehash", static_cast<double>(batch), t_batch, "updates");
+	std::cout << "  " << hashed << " nodes rehashed, " << batch * a.depth() << " for one path per update\n";
+
+	double const t_full = bench::measure([&]() { b.assign(records.begin(), records.end()); bench::consume(b.root().low64); }, 3);
+	bench::report_rate("full rebuild instead", static_cast<double>(batch), t_full, "updates");
+
+	b.update(records[12345].first, records[12345].second, "changed");
+	double const t_diff = bench::measure([&]() { bench::consume(xxh::merkle_diff(a, b).size()); }, 3);
+	bench::report_rate("merkle_diff, one leaf differs", 1, t_diff, "diffs");
+}
+
+
+/* *************************************
+*  Flat hash map
+***************************************/
+
+template <typename Map, typename Key>
+void bench_map_ops(const std::string& name, const std::vector<Key>& keys, const std::vector<Key>& lookups, const std::vector<Key>& misses)
+{
+	double const count = static_cast<double>(keys.size());
+	Map map;
+
+	double const t_insert = bench::measure([&]() {
+		Map fresh;
+
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			fresh.try_emplace(keys[i], i);
+		}
+
+		bench::consume(fresh.size());
+		map = std::move(fresh);
+	}, 3);
+	bench::report_rate(name + ", insert", count, t_insert, "ops");
+
+	double const t_hit = bench::measure([&]() {
+		uint64_t sum = 0;
+
+		for (const Key& key : lookups)
+		{
+			sum += map.find(key)->second;
+		}
+
+		bench::consume(sum);
+	}, 3);
+	bench::report_rate(name + ", successful find", count, t_hit, "ops");
+
+	double const t_miss = bench::measure([&]() {
+		uint64_t found = 0;
+
+		for (const Key& key : misses)
+		{
+			found += (map.find(key) != map.end());
+		}
+
+		bench::consume(found);
+	}, 3);
+	bench::report_rate(name + ", failed find", count, t_miss, "ops");
+}
+
+void bench_flat_map()
+{
+	size_t const count = 4 * 1024 * 1024;
+	std::mt19937_64 rng(7);
+
+	std::vector<uint64_t> keys(count);
+	std::generate(keys.begin(), keys.end(), [&rng]() { return rng(); });
+	std::vector<uint64_t> lookups = keys;
+	std::shuffle(lookups.begin(), lookups.end(), rng);
+	std::vector<uint64_t> misses(count);
+	std::generate(misses.begin(), misses.end(), [&rng]() { return rng(); });
+
+	bench_map_ops<std::unordered_map<uint64_t, uint64_t>>("std::unordered_map, std::hash, 4M uint64", keys, lookups, misses);
+	bench_map_ops<std::unordered_map<uint64_t, uint64_t, xxh::flat_hash<uint64_t>>>("std::unordered_map, flat_hash", keys, lookups, misses);
+	bench_map_ops<xxh::flat_map<uint64_t, uint64_t>>("xxh::flat_map", keys, lookups, misses);
+
+	xxh::flat_map<uint64_t, uint64_t> map;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		map.try_emplace(keys[i], i);
+	}
+
+	std::vector<xxh::flat_map<uint64_t, uint64_t>::const_iterator> found(count);
+	double const t_many = bench::measure([&]() {
+		static_cast<const xxh::flat_map<uint64_t, uint64_t>&>(map).find_many(lookups.data(), count, found.data());
+		bench::consume(found[count / 2]->second);
+	}, 3);
+	bench::report_rate("xxh::flat_map, find_many", static_cast<double>(count), t_many, "ops");
+
+	size_t const string_count = 1024 * 1024;
+	std::vector<std::string> strings(string_count);
+
+	for (size_t i = 0; i < string_count; i++)
+	{
+		strings[i] = "user:" + std::to_string(rng()) + ":profile";
+	}
+
+	std::vector<std::string> string_lookups = strings;
+	std::shuffle(string_lookups.begin(), string_lookups.end(), rng);
+	std::vector<std::string> string_misses(string_count);
+
+	for (size_t i = 0; i < string_count; i++)
+	{
+		string_misses[i] = "user:" + std::to_string(rng()) + ":missing";
+	}
+
+	bench_map_ops<std::unordered_map<std::string, uint64_t>>("std::unordered_map, std::hash, 1M strings", strings, string_lookups, string_misses);
+	bench_map_ops<xxh::flat_map<std::string, uint64_t>>("xxh::flat_map", strings, string_lookups, string_misses);
+}
+
+
+/* *************************************
+*  Concurrent hash map
+***************************************/
+
+/* The usual alternative: std::unordered_map shards, each behind a mutex, picked by std::hash. */
+class sharded_mutex_map
+{
+	struct alignas(64) shard
+	{
+		std::mutex mutex;
+		std::unordered_map<std::string, uint64_t> map;
+	};
+
+	std::vector<shard> shards = std::vector<shard>(64);
+
+	shard& shard_of(const std::string& key)
+	{
+		return shards[std::hash<std::string>()(key) % shards.size()];
+	}
+
+public:
+
+	void add(const std::string& key, uint64_t v)
+	{
+		shard& s = shard_of(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		s.map[key] += v;
+	}
+
+	bool add_if_present(const std::string& key, uint64_t v)
+	{
+		shard& s = shard_of(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		auto const it = s.map.find(key);
+
+		if (it == s.map.end())
+		{
+			return false;
+		}
+
+		it->second += v;
+		return true;
+	}
+};
+
+/* Seconds taken by threads threads running body(thread index), once. */
+template <typename F>
+double run_threads(size_t threads, F&& body)
+{
+	return bench::measure([&]() {
+		std::vector<std::thread> workers;
+
+		for (size_t t = 0; t < threads; t++)
+		{
+			workers.emplace_back(body, t);
+		}
+
+		for (std::thread& w : workers)
+		{
+			w.join();
+		}
+	}, 1);
+}
+
+void bench_concurrent_map()
+{
+	size_t const key_count = 1024 * 1024;
+	size_t const hot_keys = 64 * 1024;
+	size_t const ops_per_thread = 256 * 1024;
+	std::vector<std::string> keys(key_count);
+
+	for (size_t i = 0; i < key_count; i++)
+	{
+		keys[i] = "requests.host" + std::to_string(i % 997) + ".path" + std::to_string(i);
+	}
+
+	for (size_t threads : { size_t(std::max(1u, std::thread::hardware_concurrency())), size_t(32) })
+	{
+		double const ops = static_cast<double>(threads * ops_per_thread);
+		std::string const suffix = " x " + std::to_string(threads) + " threads";
+
+		/* read-heavy: counters of a fixed set of hot keys are bumped, 1 operation in 32 adds a key */
+		{
+			sharded_mutex_map sharded;
+			xxh::concurrent_map<std::string, std::atomic<uint64_t>> map;
+
+			for (size_t i = 0; i < hot_keys; i++)
+			{
+				sharded.add(keys[i], 0);
+				map.try_emplace(keys[i], 0);
+			}
+
+			auto const pick = [&](size_t t, size_t i) -> const std::string& {
+				return (i % 32 == 0) ? keys[hot_keys + (t * ops_per_thread / 32 + i / 32) % (key_count - hot_keys)] : keys[(i * 7919 + t * 104729) % hot_keys];
+			};
+
+			double best_sharded = 1e300;
+			double best_concurrent = 1e300;
+
+			for (size_t run = 0; run < 3; run++)
+			{
+				best_sharded = std::min(best_sharded, run_threads(threads, [&](size_t t) {
+					for (size_t i = 0; i < ops_per_thread; i++)
+					{
+						if (!sharded.add_if_present(pick(t, i), 1))
+						{
+							sharded.add(pick(t, i), 1);
+						}
+					}
+				}));
+
+				best_concurrent = std::min(best_concurrent, run_threads(threads, [&](size_t t) {
+					for (size_t i = 0; i < ops_per_thread; i++)
+					{
+						if (std::atomic<uint64_t>* const v = map.find(pick(t, i)))
+						{
+							v->fetch_add(1, std::memory_order_relaxed);
+						}
+						else
+						{
+							map.try_emplace(pick(t, i), 0).first->fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+				}));
+			}
+
+			bench::report_rate("sharded mutex map, read-heavy" + suffix, ops, best_sharded, "ops");
+			bench::report_rate("xxh::concurrent_map, read-heavy" + suffix, ops, best_concurrent, "ops");
+		}
+
+		/* write-heavy: from an empty map, most operations add a key, and the tables grow all along */
+		{
+			auto const key_of = [&](size_t t, size_t i) -> const std::string& {
+				return keys[(t * 7 * ops_per_thread / 8 + i) % key_count];
+			};
+
+			double best_sharded = 1e300;
+			double best_concurrent = 1e300;
+
+			for (size_t run = 0; run < 3; run++)
+			{
+				sharded_mutex_map sharded;
+				best_sharded = std::min(best_sharded, run_threads(threads, [&](size_t t) {
+					for (size_t i = 0; i < ops_per_thread; i++)
+					{
+						sharded.add(key_of(t, i), 1);
+					}
+				}));
+
+				xxh::concurrent_map<std::string, std::atomic<uint64_t>> map;
+				best_concurrent = std::min(best_concurrent, run_threads(threads, [&](size_t t) {
+					for (size_t i = 0; i < ops_per_thread; i++)
+					{
+						map.try_emplace(key_of(t, i), 0).first->fetch_add(1, std::memory_order_relaxed);
+					}
+				}));
+			}
+
+			bench::report_rate("sharded mutex map, write-heavy" + suffix, ops, best_sharded, "ops");
+			bench::report_rate("xxh::concurrent_map, write-heavy" + suffix, ops, best_concurrent, "ops");
+		}
+	}
+}
+
+
+/* *************************************
+*  String interning
+***************************************/
+
+void bench_interner()
+{
+	size_t const vocabulary = 1024 * 1024;
+	size_t const stream_length = 8 * 1024 * 1024;
+	std::mt19937_64 rng(11);
+	std::vector<std::string> words(vocabulary);
+
+	for (size_t i = 0; i < vocabulary; i++)
+	{
+		words[i] = ((i % 3 == 0) ? "m_" : "get") + std::to_string(rng() % 100000000) + "_" + std::to_string(i);
+	}
+
+	/* a skewed token stream, as identifiers in source code: a few are very common, most are rare */
+	std::vector<std::string_view> stream(stream_length);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	for (std::string_view& token : stream)
+	{
+		double const u = uniform(rng);
+		token = words[static_cast<size_t>(u * u * u * u * (vocabulary - 1))];
+	}
+
+	std::vector<std::string_view> unique(words.begin(), words.end());
+	double const n_unique = static_cast<double>(vocabulary);
+	double const n_stream = static_cast<double>(stream_length);
+
+	double const t_set_unique = bench::measure([&]() {
+		std::unordered_set<std::string> set;
+
+		for (std::string_view w : unique)
+		{
+			bench::consume(set.emplace(w).first->size());
+		}
+	}, 3);
+	bench::report_rate("std::unordered_set<std::string>, 1M new strings", n_unique, t_set_unique, "strings");
+
+	double const t_unique = bench::measure([&]() {
+		xxh::interner pool;
+
+		for (std::string_view w : unique)
+		{
+			bench::consume(pool.intern(w).size());
+		}
+	}, 3);
+	bench::report_rate("interner::intern, 1M new strings", n_unique, t_unique, "strings");
+
+	std::vector<std::string_view> out(stream_length);
+	double const t_many_unique = bench::measure([&]() {
+		xxh::interner pool;
+		pool.intern_many(unique.data(), unique.size(), out.data());
+		bench::consume(out.back().size());
+	}, 3);
+	bench::report_rate("interner::intern_many, 1M new strings", n_unique, t_many_unique, "strings");
+
+	std::unordered_set<std::string> set;
+	xxh::interner pool;
+
+	double const t_set_stream = bench::measure([&]() {
+		for (std::string_view w : stream)
+		{
+			bench::consume(set.emplace(w).first->size());
+		}
+	}, 3);
+	bench::report_rate("std::unordered_set<std::string>, 8M skewed tokens", n_stream, t_set_stream, "tokens");
+
+	double const t_stream = bench::measure([&]() {
+		for (std::string_view w : stream)
+		{
+			bench::consume(pool.intern(w).size());
+		}
+	}, 3);
+	bench::report_rate("interner::intern, 8M skewed tokens", n_stream, t_stream, "tokens");
+
+	double const t_many_stream = bench::measure([&]() {
+		pool.intern_many(stream.data(), stream.size(), out.data());
+		bench::consume(out.back().size());
+	}, 3);
+	bench::report_rate("interner::intern_many, 8M skewed tokens", n_stream, t_many_stream, "tokens");
+
+	xxh::interner full;
+	size_t string_bytes = 0;
+
+	for (std::string_view w : unique)
+	{
+		full.intern(w);
+		string_bytes += w.size();
+	}
+
+	std::cout << "  interner memory per entry: " << std::fixed << std::setprecision(1) << static_cast<double>(full.memory_usage()) / n_unique << " bytes, of which "
+		<< static_cast<double>(string_bytes) / n_unique << " bytes of characters\n";
+}
+
+
+/* *************************************
+*  Hashed strings
+***************************************/
+
+void bench_hashed_string()
+{
+	size_t const count = 256 * 1024;
+	size_t const lookups = 4 * 1024 * 1024;
+	std::mt19937_64 rng(13);
+	std::vector<std::string> words(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		words[i] = "tenant/" + std::to_string(rng() % 1000) + "/object/" + std::to_string(rng()) + "/" + std::to_string(i);
+	}
+
+	std::vector<xxh::hashed_string> hashed(words.begin(), words.end());
+	std::vector<size_t> order(lookups);
+
+	for (size_t& k : order)
+	{
+		k = rng() % count;
+	}
+
+	/* one request path: the same key looked up in three maps */
+	xxh::flat_map<std::string, uint64_t> plain[3];
+	xxh::flat_map<xxh::hashed_string, uint64_t> keyed[3];
+
+	for (size_t m = 0; m < 3; m++)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			plain[m].try_emplace(words[i], i + m);
+			keyed[m].try_emplace(hashed[i], i + m);
+		}
+	}
+
+	double const n = static_cast<double>(lookups);
+
+	double const t_plain = bench::measure([&]() {
+		uint64_t sum = 0;
+
+		for (size_t k : order)
+		{
+			for (size_t m = 0; m < 3; m++)
+			{
+				sum += plain[m].find(words[k])->second;
+			}
+		}
+
+		bench::consume(sum);
+	}, 3);
+	bench::report_rate("flat_map<std::string>, key looked up in 3 maps", n, t_plain, "keys");
+
+	double const t_keyed = bench::measure([&]() {
+		uint64_t sum = 0;
+
+		for (size_t k : order)
+		{
+			for (size_t m = 0; m < 3; m++)
+			{
+				sum += keyed[m].find(hashed[k])->second;
+			}
+		}
+
+		bench::consume(sum);
+	}, 3);
+	bench::report_rate("flat_map<hashed_string>, key looked up in 3 maps", n, t_keyed, "keys");
+
+	double const t_once = bench::measure([&]() {
+		uint64_t sum = 0;
+
+		for (size_t k : order)
+		{
+			xxh::hashed_string_view const key(words[k]);
+
+			for (size_t m = 0; m < 3; m++)
+			{
+				sum += plain[m].find(key)->second;
+			}
+		}
+
+		bench::consume(sum);
+	}, 3);
+	bench::report_rate("flat_map<std::string>, hashed once per path", n, t_once, "keys");
+}
+
+
+/* *************************************
+*  Bloom filters
+***************************************/
+
+/* The usual layout for comparison: one bit array, and k seeded hashes of the key, each probing anywhere in it. */
+struct classic_bloom
+{
+	std::vector<uint64_t> bits;
+	size_t k;
+
+	classic_bloom(size_t keys, double bits_per_key, size_t k_) : bits(static_cast<size_t>(keys * bits_per_key) / 64 + 1), k(k_)
+	{
+	}
+
+	size_t bit(std::string_view key, size_t i) const
+	{
+		return static_cast<size_t>(xxh::xxhash3<64>(key.data(), key.size(), i) % (64 * bits.size()));
+	}
+
+	void insert(std::string_view key)
+	{
+		for (size_t i = 0; i < k; i++)
+		{
+			size_t const b = bit(key, i);
+			bits[b / 64] |= 1ULL << (b % 64);
+		}
+	}
+
+	bool contains(std::string_view key) const
+	{
+		for (size_t i = 0; i < k; i++)
+		{
+			size_t const b = bit(key, i);
+
+			if ((bits[b / 64] & (1ULL << (b % 64))) == 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+void bench_bloom()
+{
+	/* 24 MB of filter at 12 bits per key: larger than the caches, as in front of a disk index */
+	size_t const keys = 16 * 1024 * 1024;
+	size_t const queries = 4 * 1024 * 1024;
+	std::vector<std::string> words(keys);
+	std::vector<std::string> probes(queries);
+
+	for (size_t i = 0; i < keys; i++)
+	{
+		words[i] = "key:" + std::to_string(i);
+	}
+
+	for (size_t i = 0; i < queries; i++)
+	{
+		probes[i] = "other:" + std::to_string(i);
+	}
+
+	std::vector<std::string_view> word_views(words.begin(), words.end());
+	std::vector<std::string_view> probe_views(probes.begin(), probes.end());
+	std::unique_ptr<bool[]> out(new bool[queries]);
+	double const n = static_cast<double>(queries);
+
+	for (double bits_per_key : { 8.0, 12.0, 16.0 })
+	{
+		xxh::blocked_bloom filter(keys, bits_per_key);
+		classic_bloom classic(keys, bits_per_key, static_cast<size_t>(bits_per_key * 0.69 + 0.5));
+
+		filter.insert_many(word_views.data(), word_views.size());
+
+		for (std::string_view w : word_views)
+		{
+			classic.insert(w);
+		}
+
+		size_t blocked_fp = 0;
+		size_t classic_fp = 0;
+
+		for (std::string_view p : probe_views)
+		{
+			blocked_fp += filter.contains(p) ? 1 : 0;
+			classic_fp += classic.contains(p) ? 1 : 0;
+		}
+
+		std::cout << "  " << static_cast<int>(bits_per_key) << " bits per key, false positives: blocked_bloom " << std::fixed << std::setprecision(3)
+			<< 100.0 * static_cast<double>(blocked_fp) / n << "%, classic with k = " << classic.k << " " << 100.0 * static_cast<double>(classic_fp) / n << "%\n";
+
+		if (bits_per_key != 12.0)
+		{
+			continue;
+		}
+
+		double const t_classic = bench::measure([&]() {
+			size_t hits = 0;
+
+			for (std::string_view p : probe_views)
+			{
+				hits += classic.contains(p) ? 1 : 0;
+			}
+
+			bench::consume(hits);
+		}, 3);
+		bench::report_rate("classic Bloom filter, k hashes, 4M queries", n, t_classic, "queries");
+
+		double const t_single = bench::measure([&]() {
+			size_t hits = 0;
+
+			for (std::string_view p : probe_views)
+			{
+				hits += filter.contains(p) ? 1 : 0;
+			}
+
+			bench::consume(hits);
+		}, 3);
+		bench::report_rate("blocked_bloom::contains, 4M queries", n, t_single, "queries");
+
+		double const t_many = bench::measure([&]() {
+			filter.contains_many(probe_views.data(), probe_views.size(), out.get());
+			bench::consume(out[queries - 1]);
+		}, 3);
+		bench::report_rate("blocked_bloom::contains_many, 4M queries", n, t_many, "queries");
+
+		double const t_insert = bench::measure([&]() {
+			xxh::blocked_bloom fresh(keys, bits_per_key);
+			fresh.insert_many(word_views.data(), word_views.size());
+			bench::consume(fresh.data()[0]);
+		}, 1);
+		bench::report_rate("blocked_bloom::insert_many, 16M keys", static_cast<double>(keys), t_insert, "keys");
+	}
+}
+
+
+/* *************************************
+*  Cuckoo filters
+***************************************/
+
+template <size_t Bits>
+void bench_cuckoo_filter(const std::vector<std::string_view>& keys, const std::vector<std::string_view>& probes)
+{
+	/* 2M buckets, about 90% full */
+	xxh::cuckoo_filter<Bits> filter(keys.size());
+
+	for (std::string_view k : keys)
+	{
+		filter.insert(k);
+	}
+
+	/* a blocked Bloom filter of the same size */
+	double const bits_per_key = 8.0 * static_cast<double>(filter.size_bytes()) / static_cast<double>(keys.size());
+	xxh::blocked_bloom bloom(keys.size(), bits_per_key - 0.01);
+
+	bloom.insert_many(keys.data(), keys.size());
+
+	size_t cuckoo_fp = 0;
+	size_t bloom_fp = 0;
+
+	for (std::string_view p : probes)
+	{
+		cuckoo_fp += filter.contains(p) ? 1 : 0;
+		bloom_fp += bloom.contains(p) ? 1 : 0;
+	}
+
+	double const n = static_cast<double>(probes.size());
+	std::string const name = "cuckoo_filter<" + std::to_string(Bits) + ">";
+
+	std::cout << "  " << name << ", " << std::fixed << std::setprecision(2) << static_cast<double>(filter.size_bytes()) / (1024 * 1024) << " MB, load "
+		<< filter.load_factor() << ": false positives " << std::setprecision(4) << 100.0 * static_cast<double>(cuckoo_fp) / n << "%, blocked_bloom of "
+		<< std::setprecision(2) << static_cast<double>(bloom.size_bytes()) / (1024 * 1024) << " MB " << std::setprecision(4) << 100.0 * static_cast<double>(bloom_fp) / n << "%\n";
+
+	std::unique_ptr<bool[]> out(new bool[probes.size()]);
+
+	double const t_bloom = bench::measure([&]() {
+		bloom.contains_many(probes.data(), probes.size(), out.get());
+		bench::consume(out[probes.size() - 1]);
+	}, 3);
+	bench::report_rate("blocked_bloom::contains_many, same memory", n, t_bloom, "queries");
+
+	double const t_single = bench::measure([&]() {
+		size_t hits = 0;
+
+		for (std::string_view p : probes)
+		{
+			hits += filter.contains(p) ? 1 : 0;
+		}
+
+		bench::consume(hits);
+	}, 3);
+	bench::report_rate(name + "::contains", n, t_single, "queries");
+
+	double const t_many = bench::measure([&]() {
+		filter.contains_many(probes.data(), probes.size(), out.get());
+		bench::consume(out[probes.size() - 1]);
+	}, 3);
+	bench::report_rate(name + "::contains_many", n, t_many, "queries");
+
+	size_t const removals = std::min(keys.size(), probes.size());
+	double const t_remove = bench::measure([&]() {
+		size_t removed = 0;
+
+		for (size_t i = 0; i < removals; i++)
+		{
+			removed += filter.remove(keys[i]) ? 1 : 0;
+		}
+
+		bench::consume(removed);
+	}, 1);
+	bench::report_rate(name + "::remove", static_cast<double>(removals), t_remove, "keys");
+}
+
+void bench_cuckoo()
+{
+	size_t const keys = 7500 * 1000;
+	size_t const queries = 4 * 1024 * 1024;
+	std::vector<std::string> words(keys);
+	std::vector<std::string> probes(queries);
+
+	for (size_t i = 0; i < keys; i++)
+	{
+		words[i] = "key:" + std::to_string(i);
+	}
+
+	for (size_t i = 0; i < queries; i++)
+	{
+		probes[i] = "other:" + std::to_string(i);
+	}
+
+	std::vector<std::string_view> word_views(words.begin(), words.end());
+	std::vector<std::string_view> probe_views(probes.begin(), probes.end());
+
+	bench_cuckoo_filter<8>(word_views, probe_views);
+	bench_cuckoo_filter<16>(word_views, probe_views);
+}
+
+
+/* *************************************
+*  Binary fuse filters
+***************************************/
+
+template <size_t Bits>
+void bench_fuse_filter(const std::vector<uint64_t>& ids, const std::vector<uint64_t>& probes)
+{
+	std::string const name = "fuse_filter" + std::to_string(Bits);
+	xxh::fuse_filter<Bits> filter;
+	bool built = false;
+
+	double const t_build = bench::measure([&]() { built = filter.build(ids.data(), ids.size()); }, 1);
+
+	if (!built)
+	{
+		std::cout << "  " << name << ": build failed\n";
+		return;
+	}
+
+	bench::report_rate(name + "::build, 100M ids", static_cast<double>(ids.size()), t_build, "keys");
+
+	size_t false_positives = 0;
+
+	for (uint64_t p : probes)
+	{
+		false_positives += filter.contains(p) ? 1 : 0;
+	}
+
+	double const n = static_cast<double>(probes.size());
+
+	std::cout << "  " << name << ": " << std::fixed << std::setprecision(2) << filter.bits_per_key(ids.size()) << " bits per key, false positives "
+		<< std::setprecision(4) << 100.0 * static_cast<double>(false_positives) / n << "%\n";
+
+	double const t_single = bench::measure([&]() {
+		size_t hits = 0;
+
+		for (uint64_t p : probes)
+		{
+			hits += filter.contains(p) ? 1 : 0;
+		}
+
+		bench::consume(hits);
+	}, 3);
+	bench::report_rate(name + "::contains", n, t_single, "queries");
+
+	std::unique_ptr<bool[]> out(new bool[probes.size()]);
+	double const t_many = bench::measure([&]() {
+		filter.contains_many(probes.data(), probes.size(), out.get());
+		bench::consume(out[probes.size() - 1]);
+	}, 3);
+	bench::report_rate(name + "::contains_many", n, t_many, "queries");
+}
+
+void bench_fuse()
+{
+	std::vector<uint64_t> ids(100 * 1000 * 1000);
+	std::vector<uint64_t> probes(8 * 1024 * 1024);
+	std::mt19937_64 rng(23);
+
+	for (uint64_t& id : ids)
+	{
+		id = rng();
+	}
+
+	for (uint64_t& p : probes)
+	{
+		p = rng();
+	}
+
+	bench_fuse_filter<8>(ids, probes);
+	bench_fuse_filter<16>(ids, probes);
+}
+
+
+/* *************************************
+*  Minimal perfect hashing
+***************************************/
+
+void bench_mphf()
+{
+	/* keys are computed rather than loaded, so lookups only touch the function */
+	size_t const n = 50 * 1000 * 1000;
+	auto key = [](uint64_t i) { return i * 0x9E3779B97F4A7C15ULL; };
+	std::vector<uint64_t> ids(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		ids[i] = key(i);
+	}
+
+	xxh::mphf f;
+	bool built = false;
+
+	double const t_build = bench::measure([&]() { built = f.build(ids.data(), n); }, 1);
+
+	if (!built)
+	{
+		std::cout << "  mphf: build failed\n";
+		return;
+	}
+
+	bench::report_rate("mphf::build, 50M keys, " + std::to_string(std::thread::hardware_concurrency()) + " threads", static_cast<double>(n), t_build, "keys");
+	std::cout << "  mphf: " << std::fixed << std::setprecision(2) << f.bits_per_key() << " bits per key, " << f.size_bytes() / (1024 * 1024) << " MB\n";
+
+	size_t const probes = 8 * 1024 * 1024;
+
+	/* each key depends on the index of the previous one, so lookups do not overlap */
+	double const t_chained = bench::measure([&]() {
+		uint64_t index = 0;
+
+		for (size_t i = 0; i < probes; i++)
+		{
+			index = f.lookup(key((index + i * 104729) % n));
+		}
+
+		bench::consume(index);
+	}, 3);
+	std::cout << "  mphf::lookup latency: " << std::setprecision(1) << 1e9 * t_chained / static_cast<double>(probes) << " ns\n";
+
+	double const t_single = bench::measure([&]() {
+		uint64_t sum = 0;
+
+		for (size_t i = 0; i < probes; i++)
+		{
+			sum += f.lookup(key((i * 104729) % n));
+		}
+
+		bench::consume(sum);
+	}, 3);
+	bench::report_rate("mphf::lookup", static_cast<double>(probes), t_single, "queries");
+
+	std::vector<uint64_t> batch(probes);
+	std::vector<uint64_t> out(probes);
+
+	for (size_t i = 0; i < probes; i++)
+	{
+		batch[i] = key((i * 104729) % n);
+	}
+
+	double const t_many = bench::measure([&]() {
+		f.lookup_many(batch.data(), probes, out.data());
+		bench::consume(out[probes - 1]);
+	}, 3);
+	bench::report_rate("mphf::lookup_many", static_cast<double>(probes), t_many, "queries");
+}
+
+
+/* *************************************
+*  HyperLogLog
+***************************************/
+
+void bench_hyperloglog()
+{
+	size_t const n = 16 * 1024 * 1024;
+	std::vector<std::string> keys(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		keys[i] = "user:" + std::to_string(i);
+	}
+
+	std::vector<std::string_view> views(keys.begin(), keys.end());
+	std::vector<uint64_t> hashes(n);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		hashes[i] = xxh::xxhash3<64>(views[i].data(), views[i].size());
+	}
+
+	double const t_insert = bench::measure([&]() {
+		xxh::hyperloglog<16> sketch;
+
+		for (std::string_view k : views)
+		{
+			sketch.insert(k);
+		}
+
+		bench::consume(static_cast<uint64_t>(sketch.estimate()));
+	}, 3);
+	bench::report_rate("hyperloglog<16>::insert", static_cast<double>(n), t_insert, "keys");
+
+	double const t_keys = bench::measure([&]() {
+		xxh::hyperloglog<16> sketch;
+		sketch.insert_many(views.data(), n);
+		bench::consume(static_cast<uint64_t>(sketch.estimate()));
+	}, 3);
+	bench::report_rate("hyperloglog<16>::insert_many, keys", static_cast<double>(n), t_keys, "keys");
+
+	double const t_hashes = bench::measure([&]() {
+		xxh::hyperloglog<16> sketch;
+		sketch.insert_many(hashes.data(), n);
+		bench::consume(static_cast<uint64_t>(sketch.estimate()));
+	}, 3);
+	bench::report_rate("hyperloglog<16>::insert_many, hashes", static_cast<double>(n), t_hashes, "keys");
+
+	/* accuracy and serialized size along the way from sparse to dense */
+	xxh::hyperloglog<16> sketch;
+	size_t inserted = 0;
+
+	for (size_t count : { size_t(1000), size_t(10000), size_t(100000), size_t(1000000), n })
+	{
+		sketch.insert_many(hashes.data() + inserted, count - inserted);
+		inserted = count;
+		std::cout << "  hyperloglog<16> at " << count << " keys: error " << std::fixed << std::setprecision(3)
+			<< 100.0 * (sketch.estimate() / static_cast<double>(count) - 1.0) << "%, " << xxh::serialize_hyperloglog(sketch).size() << " bytes"
+			<< (sketch.is_sparse() ? " sparse\n" : " dense\n");
+	}
+
+	/* register merge and estimate, the per sketch cost of combining many nodes */
+	std::vector<uint8_t> a(size_t(1) << 16), b(size_t(1) << 16);
+	std::mt19937 rng(3);
+	std::generate(a.begin(), a.end(), [&]() { return static_cast<uint8_t>(rng() % 24); });
+	std::generate(b.begin(), b.end(), [&]() { return static_cast<uint8_t>(rng() % 24); });
+
+	size_t const rounds = 2000;
+	double const registers = static_cast<double>(rounds * a.size());
+
+	double const t_max_scalar = bench::measure([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			xxh::detail_hll::max_registers<64>(a.data(), b.data(), a.size());
+			bench::consume(a[r]);
+		}
+	}, 3);
+	double const t_max = bench::measure([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			xxh::detail_hll::max_registers<xxh::detail_hll::lane_bits>(a.data(), b.data(), a.size());
+			bench::consume(a[r]);
+		}
+	}, 3);
+	double const t_sum_scalar = bench::measure([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			bench::consume(static_cast<uint64_t>(xxh::detail_hll::sum_registers<64>(a.data(), a.size()).harmonic));
+		}
+	}, 3);
+	double const t_sum = bench::measure([&]() {
+		for (size_t r = 0; r < rounds; r++)
+		{
+			bench::consume(static_cast<uint64_t>(xxh::detail_hll::sum_registers<xxh::detail_hll::lane_bits>(a.data(), a.size()).harmonic));
+		}
+	}, 3);
+
+	bench::report_rate("hyperloglog merge, scalar", registers, t_max_scalar, "registers");
+	bench::report_rate("hyperloglog merge, " + std::to_string(xxh::detail_hll::lane_bits) + " bit", registers, t_max, "registers");
+	bench::report_rate("hyperloglog estimate, scalar", registers, t_sum_scalar, "registers");
+	bench::report_rate("hyperloglog estimate, " + std::to_string(xxh::detail_hll::lane_bits) + " bit", registers, t_sum, "registers");
+}
+
+
+/* *************************************
+*  Count-Min sketches
+***************************************/
+
+/* The textbook layout for comparison: D separate rows, indexed low64 + i * high64, so an update touches D cache lines. */
+template <size_t W, size_t D>
+struct row_count_min
+{
+	std::vector<uint32_t> counters = std::vector<uint32_t>(W * D, 0);
+
+	void add_hash(xxh::hash128_t h)
+	{
+		for (size_t r = 0; r < D; r++)
+		{
+			counters[r * W + xxh::bit_ops::mul64to128(h.low64 + r * h.high64, W).high64]++;
+		}
+	}
+};
+
+template <size_t W, size_t D>
+void bench_count_min_shape(const std::vector<std::string_view>& stream, const std::vector<xxh::hash128_t>& hashes, const std::string& shape)
+{
+	double const n = static_cast<double>(stream.size());
+
+	for (bool conservative : { false, true })
+	{
+		std::string const name = "count_min<" + shape + ">" + (conservative ? " conservative" : " plain");
+
+		double const t_single = bench::measure([&]() {
+			xxh::count_min<W, D> sketch(0, conservative);
+
+			for (std::string_view k : stream)
+			{
+				sketch.add(k);
+			}
+
+			bench::consume(sketch.estimate(stream[0]));
+		}, 3);
+		double const t_keys = bench::measure([&]() {
+			xxh::count_min<W, D> sketch(0, conservative);
+			sketch.add_many(stream.data(), stream.size());
+			bench::consume(sketch.estimate(stream[0]));
+		}, 3);
+		double const t_hashes = bench::measure([&]() {
+			xxh::count_min<W, D> sketch(0, conservative);
+			sketch.add_many(hashes.data(), hashes.size());
+			bench::consume(sketch.estimate(stream[0]));
+		}, 3);
+
+		bench::report_rate(name + "::add", n, t_single, "updates");
+		bench::report_rate(name + "::add_many, keys", n, t_keys, "updates");
+		bench::report_rate(name + "::add_many, hashes", n, t_hashes, "updates");
+	}
+
+	double const t_rows = bench::measure([&]() {
+		auto sketch = std::make_unique<row_count_min<W, D>>();
+
+		for (const xxh::hash128_t& h : hashes)
+		{
+			sketch->add_hash(h);
+		}
+
+		bench::consume(sketch->counters[W]);
+	}, 3);
+	bench::report_rate("separate rows <" + shape + "> plain, hashes", n, t_rows, "updates");
+}
+
+void bench_count_min()
+{
+	/* 16M requests over 1M paths, zipfian: path i is requested about 1 / (i + 1) as often as path 0 */
+	size_t const paths = 1024 * 1024;
+	size_t const n = 16 * 1024 * 1024;
+	std::vector<std::string> names(paths);
+
+	for (size_t i = 0; i < paths; i++)
+	{
+		names[i] = "/api/v2/items/" + std::to_string(i);
+	}
+
+	std::vector<std::string_view> stream(n);
+	std::vector<xxh::hash128_t> hashes(n);
+	std::mt19937_64 rng(11);
+	std::uniform_real_distribution<double> u(0.0, std::log(static_cast<double>(paths)));
+
+	for (size_t i = 0; i < n; i++)
+	{
+		stream[i] = names[std::min(paths - 1, static_cast<size_t>(std::exp(u(rng))) - 1)];
+		hashes[i] = xxh::xxhash3<128>(stream[i].data(), stream[i].size());
+	}
+
+	bench_count_min_shape<16 * 1024, 4>(stream, hashes, "16K, 4");
+	bench_count_min_shape<1024 * 1024, 4>(stream, hashes, "1M, 4");
+
+	xxh::count_min<1024 * 1024, 4> a, b;
+	a.add_many(hashes.data(), n / 2);
+	b.add_many(hashes.data() + n / 2, n - n / 2);
+	double const t_merge = bench::measure([&]() { a.merge(b); bench::consume(a.total()); }, 3);
+	bench::report("count_min<1M, 4>::merge", a.size_bytes(), t_merge);
+}
+
+
+/* *************************************
+*  Driver
+***************************************/
+
+int main(int argc, char** argv)
+{
+	const std::vector<std::pair<std::string, void(*)()>> benchmarks = {
+		{ "stream_arena", bench_stream_arena },
+		{ "copy_and_hash", bench_copy_and_hash },
+		{ "tree_hash", bench_tree_hash },
+		{ "parallel_hash3", bench_parallel_hash3 },
+#if XXH_CPP_POSIX_FILES
+		{ "hash_file", bench_hash_file },
+#endif
+#if defined(__linux__)
+		{ "pipelined", bench_pipelined },
+#endif
+		{ "hash_tree", bench_hash_tree },
+		{ "blocks", bench_blocks },
+		{ "pages", bench_pages },
+		{ "cdc", bench_cdc },
+		{ "delta", bench_delta },
+		{ "merkle", bench_merkle },
+		{ "flat_map", bench_flat_map },
+		{ "concurrent_map", bench_concurrent_map },
+		{ "interner", bench_interner },
+		{ "hashed_string", bench_hashed_string },
+		{ "bloom", bench_bloom },
+		{ "cuckoo", bench_cuckoo },
+		{ "fuse", bench_fuse },
+		{ "mphf", bench_mphf },
+		{ "hyperloglog", bench_hyperloglog },
+		{ "count_min", bench_count_min },
+	};
+
+	for (const auto& [name, run] : benchmarks)
+	{
+		if (argc < 2 || name.find(argv[1]) != std::string::npos)
+		{
+			std::cout << "== " << name << "\n";
+			run();
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+# Checks xxh_cpp_sum against known xxhsum output and round-trips every format through -c.
+# Invoked by ctest with XXH_CPP_SUM (the executable) and WORK_DIR defined.
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+file(WRITE "${WORK_DIR}/empty" "")
+file(WRITE "${WORK_DIR}/abc" "abc")
+
+function(run_sum output_var)
+  execute_process(COMMAND "${XXH_CPP_SUM}" ${ARGN}
+    WORKING_DIRECTORY "${WORK_DIR}"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error)
+  set(${output_var} "${output}" PARENT_SCOPE)
+  set(${output_var}_RESULT "${result}" PARENT_SCOPE)
+  set(${output_var}_ERROR "${error}" PARENT_SCOPE)
+endfunction()
+
+function(expect_output expected)
+  run_sum(out ${ARGN})
+  if(NOT out_RESULT EQUAL 0 OR NOT out STREQUAL "${expected}")
+    message(FATAL_ERROR "xxh_cpp_sum ${ARGN}\nexpected:\n${expected}\ngot (exit ${out_RESULT}):\n${out}${out_ERROR}")
+  endif()
+endfunction()
+
+# Reference values as printed by xxhsum 0.8.
+expect_output("02cc5d05  empty\n" -H0 empty)
+expect_output("ef46db3751d8e999  empty\n" empty)
+expect_output("99aa06d3014798d86001c324468d497f  empty\n" -H2 empty)
+expect_output("XXH3_2d06800538d394c2  empty\n" -H3 empty)
+expect_output("XXH64 (empty) = ef46db3751d8e999\n" --tag empty)
+expect_output("XXH64_LE (empty) = 99e9d85137db46ef\n" --tag --little-endian empty)
+expect_output("32d153ff  abc\n" -H0 abc)
+expect_output("44bc2cf5ad770999  abc\n" -H1 abc)
+
+foreach(algo 0 1 2 3)
+  foreach(format "" "--tag")
+    run_sum(sums -H${algo} ${format} empty abc)
+    file(WRITE "${WORK_DIR}/sums" "${sums}")
+    expect_output("empty: OK\nabc: OK\n" -c sums)
+  endforeach()
+endforeach()
+
+file(WRITE "${WORK_DIR}/abc" "abd")
+run_sum(check -c sums)
+if(check_RESULT EQUAL 0 OR NOT check MATCHES "abc: FAILED")
+  message(FATAL_ERROR "a modified file was not reported:\n${check}${check_ERROR}")
+endif()
@@ -0,0 +1,766 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+#include "xxhash_file.hpp"
+
+/* xxh_cpp_sum - prints or checks xxHash checksums.
+* Output and check files are compatible with xxhsum: the GNU format ("<hash>  <file>", XXH3 hashes prefixed with "XXH3_"),
+* the BSD format selected by --tag ("<ALGO> (<file>) = <hash>") and the _LE little endian variants.
+* Files are hashed concurrently on all cores, regular files through memory mapping.
+*/
+
+#ifndef XXH_CPP_SUM_VERSION
+#	define XXH_CPP_SUM_VERSION "unknown"
+#endif
+
+namespace sum
+{
+	/* *************************************
+	*  Algorithms and digests
+	***************************************/
+
+	/* Same numbering as xxhsum -H. */
+	enum class algorithm : uint8_t { xxh32 = 0, xxh64 = 1, xxh128 = 2, xxh3 = 3 };
+
+	constexpr size_t algorithm_count = 4;
+	const char* const algorithm_names[algorithm_count] = { "XXH32", "XXH64", "XXH128", "XXH3" };
+	const size_t digest_sizes[algorithm_count] = { 4, 8, 16, 8 };
+
+	inline size_t digest_size(algorithm algo)
+	{
+		return digest_sizes[static_cast<size_t>(algo)];
+	}
+
+	/* A hash in canonical (big endian) byte order, or the reason it could not be computed. */
+	struct digest_t
+	{
+		std::array<uint8_t, 16> bytes{};
+		size_t size = 0;
+		std::string error;
+	};
+
+	template <size_t bit_mode>
+	void store(digest_t& digest, const xxh::file_hash_result<bit_mode>& result)
+	{
+		if (!result.ok())
+		{
+			digest.error = result.error.message();
+			return;
+		}
+
+		xxh::canonical_t<bit_mode> const canonical(result.hash);
+		std::copy(canonical.digest.begin(), canonical.digest.end(), digest.bytes.begin());
+		digest.size = canonical.digest.size();
+	}
+
+	template <size_t bit_mode, typename state_t>
+	xxh::file_hash_result<bit_mode> hash_input(const std::string& path, const xxh::file_hash_options& options)
+	{
+		if (path == "-")
+		{
+#if XXH_CPP_POSIX_FILES
+			return xxh::hash_file<bit_mode, state_t>(0, options);
+#else
+			xxh::file_hash_result<bit_mode> result;
+			state_t state(options.seed);
+			std::vector<char> buffer(options.buffer_size);
+
+			while (std::cin)
+			{
+				std::cin.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+				state.update(buffer.data(), static_cast<size_t>(std::cin.gcount()));
+				result.bytes += static_cast<uint64_t>(std::cin.gcount());
+			}
+
+			result.hash = state.digest();
+			return result;
+#endif
+		}
+
+		return xxh::hash_file<bit_mode, state_t>(path, options);
+	}
+
+	digest_t hash_path(const std::string& path, algorithm algo)
+	{
+		xxh::file_hash_options const options;
+		digest_t digest;
+
+		switch (algo)
+		{
+		case algorithm::xxh32: store(digest, hash_input<32, xxh::hash_state32_t>(path, options)); break;
+		case algorithm::xxh64: store(digest, hash_input<64, xxh::hash_state64_t>(path, options)); break;
+		case algorithm::xxh128: store(digest, hash_input<128, xxh::hash3_state128_t>(path, options)); break;
+		case algorithm::xxh3: store(digest, hash_input<64, xxh::hash3_state64_t>(path, options)); break;
+		}
+
+		return digest;
+	}
+
+	std::string to_hex(const uint8_t* bytes, size_t size, bool little_endian)
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string hex;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			uint8_t const b = bytes[little_endian ? size - 1 - i : i];
+			hex += digits[b >> 4];
+			hex += digits[b & 15];
+		}
+
+		return hex;
+	}
+
+	bool from_hex(const std::string& hex, uint8_t* bytes, bool little_endian)
+	{
+		size_t const size = hex.size() / 2;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			int value = 0;
+
+			for (size_t k = 0; k < 2; k++)
+			{
+				char const c = hex[2 * i + k];
+				int const nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+
+				if (nibble < 0)
+				{
+					return false;
+				}
+
+				value = value * 16 + nibble;
+			}
+
+			bytes[little_endian ? size - 1 - i : i] = static_cast<uint8_t>(value);
+		}
+
+		return true;
+	}
+
+
+	/* *************************************
+	*  Options
+	***************************************/
+
+	struct options_t
+	{
+		algorithm algo = algorithm::xxh64;
+		bool tag = false;
+		bool little_endian = false;
+		bool check = false;
+		bool quiet = false;
+		bool status = false;
+		bool strict = false;
+		bool warn = false;
+		bool benchmark = false;
+		size_t bench_iterations = 3;
+		size_t bench_size = 100 * 1024;
+		size_t threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::string> files;
+	};
+
+	/* Files are hashed in batches so results are printed while the rest is still being processed. */
+	constexpr size_t batch_size = 256;
+
+	void usage(const char* program)
+	{
+		std::cout
+			<< "Usage: " << program << " [options] [files]\n"
+			<< "Prints or checks xxHash checksums. With no file, or when file is -, reads standard input.\n\n"
+			<< "  -H#            algorithm: 0 = XXH32, 1 = XXH64 (default), 2 = XXH128, 3 = XXH3 (64 bits); also -H32, -H64, -H128\n"
+			<< "  -c, --check    read checksums from the files and check them\n"
+			<< "      --tag      produce BSD-style checksum lines\n"
+			<< "      --little-endian  print hashes in little endian byte order\n"
+			<< "  -T#            number of threads (default: all cores)\n"
+			<< "  -b             benchmark the hash kernels\n"
+			<< "  -i#            benchmark iterations (default 3)\n"
+			<< "  -B#            benchmark sample size in bytes, K and M suffixes allowed (default 100K)\n"
+			<< "  -h, --help     display this help and exit\n"
+			<< "  -V, --version  display the version and exit\n\n"
+			<< "Check mode:\n"
+			<< "  -q, --quiet    do not print OK for each successfully verified file\n"
+			<< "      --status   do not output anything, the exit code shows success\n"
+			<< "      --strict   exit non-zero on improperly formatted checksum lines\n"
+			<< "  -w, --warn     warn about improperly formatted checksum lines\n";
+	}
+
+	bool parse_number(const char* text, size_t& value)
+	{
+		char* end = nullptr;
+		unsigned long long const n = std::strtoull(text, &end, 10);
+
+		if (end == text)
+		{
+			return false;
+		}
+
+		value = static_cast<size_t>(n);
+
+		if (*end == 'K' || *end == 'k')
+		{
+			value <<= 10;
+			end++;
+		}
+		else if (*end == 'M' || *end == 'm')
+		{
+			value <<= 20;
+			end++;
+		}
+
+		return *end == '\0' || ((end[0] == 'B' || end[0] == 'b') && end[1] == '\0');
+	}
+
+	/* Returns -1 when the program should go on, the exit code otherwise. */
+	int parse_options(int argc, char** argv, options_t& options)
+	{
+		bool only_files = false;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string const arg = argv[i];
+
+			if (only_files || arg == "-" || arg[0] != '-')
+			{
+				options.files.push_back(arg);
+			}
+			else if (arg == "--")
+			{
+				only_files = true;
+			}
+			else if (arg == "-h" || arg == "--help")
+			{
+				usage(argv[0]);
+				return 0;
+			}
+			else if (arg == "-V" || arg == "--version")
+			{
+				std::cout << "xxh_cpp_sum " << XXH_CPP_SUM_VERSION << "\n";
+				return 0;
+			}
+			else if (arg == "-c" || arg == "--check")
+			{
+				options.check = true;
+			}
+			else if (arg == "--tag")
+			{
+				options.tag = true;
+			}
+			else if (arg == "--little-endian")
+			{
+				options.little_endian = true;
+			}
+			else if (arg == "-q" || arg == "--quiet")
+			{
+				options.quiet = true;
+			}
+			else if (arg == "--status")
+			{
+				options.status = true;
+			}
+			else if (arg == "--strict")
+			{
+				options.strict = true;
+			}
+			else if (arg == "-w" || arg == "--warn")
+			{
+				options.warn = true;
+			}
+			else if (arg == "-b")
+			{
+				options.benchmark = true;
+			}
+			else if (arg.compare(0, 2, "-H") == 0)
+			{
+				std::string const id = arg.substr(2);
+
+				if (id == "0" || id == "32")
+				{
+					options.algo = algorithm::xxh32;
+				}
+				else if (id == "1" || id == "64")
+				{
+					options.algo = algorithm::xxh64;
+				}
+				else if (id == "2" || id == "128")
+				{
+					options.algo = algorithm::xxh128;
+				}
+				else if (id == "3")
+				{
+					options.algo = algorithm::xxh3;
+				}
+				else
+				{
+					std::cerr << "Error: unknown algorithm " << arg << "\n";
+					return 1;
+				}
+			}
+			else if ((arg.compare(0, 2, "-i") == 0 && parse_number(arg.c_str() + 2, options.bench_iterations))
+				|| (arg.compare(0, 2, "-B") == 0 && parse_number(arg.c_str() + 2, options.bench_size))
+				|| (arg.compare(0, 2, "-T") == 0 && parse_number(arg.c_str() + 2, options.threads)))
+			{
+				continue;
+			}
+			else
+			{
+				std::cerr << "Error: unknown option " << arg << "\n";
+				usage(argv[0]);
+				return 1;
+			}
+		}
+
+		options.bench_iterations = std::max<size_t>(options.bench_iterations, 1);
+		options.bench_size = std::max<size_t>(options.bench_size, 1);
+		options.threads = std::max<size_t>(options.threads, 1);
+
+		if (options.files.empty())
+		{
+			options.files.push_back("-");
+		}
+
+		return -1;
+	}
+
+
+	/* *************************************
+	*  Hash mode
+	***************************************/
+
+	/* File names containing a backslash or a newline are escaped, and the line is then prefixed with a backslash. */
+	std::string escape_filename(const std::string& name, bool& escaped)
+	{
+		std::string out;
+		escaped = false;
+
+		for (char c : name)
+		{
+			if (c == '\\' || c == '\n')
+			{
+				out += '\\';
+				out += (c == '\n') ? 'n' : '\\';
+				escaped = true;
+			}
+			else
+			{
+				out += c;
+			}
+		}
+
+		return out;
+	}
+
+	std::string unescape_filename(const std::string& name)
+	{
+		std::string out;
+
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			if (name[i] == '\\' && i + 1 < name.size())
+			{
+				out += (name[++i] == 'n') ? '\n' : name[i];
+			}
+			else
+			{
+				out += name[i];
+			}
+		}
+
+		return out;
+	}
+
+	std::string format_line(const std::string& path, const digest_t& digest, const options_t& options)
+	{
+		bool escaped;
+		std::string const name = escape_filename((path == "-") ? "stdin" : path, escaped);
+		std::string const hex = to_hex(digest.bytes.data(), digest.size, options.little_endian);
+		std::string line = escaped ? "\\" : "";
+
+		if (options.tag)
+		{
+			line += std::string(algorithm_names[static_cast<size_t>(options.algo)]) + (options.little_endian ? "_LE" : "") + " (" + name + ") = " + hex;
+		}
+		else
+		{
+			line += ((options.algo == algorithm::xxh3) ? "XXH3_" : "") + hex + "  " + name;
+		}
+
+		return line + "\n";
+	}
+
+	int hash_files(const options_t& options, xxh::thread_pool& pool)
+	{
+		int exit_code = 0;
+
+		for (size_t first = 0; first < options.files.size(); first += batch_size)
+		{
+			size_t const count = std::min(batch_size, options.files.size() - first);
+			std::vector<digest_t> digests(count);
+
+			pool.parallel_for(count, [&](size_t i) {
+				digests[i] = hash_path(options.files[first + i], options.algo);
+			});
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const std::string& path = options.files[first + i];
+
+				if (!digests[i].error.empty())
+				{
+					std::cerr << "Error: Could not open '" << path << "': " << digests[i].error << ".\n";
+					exit_code = 1;
+					continue;
+				}
+
+				std::cout << format_line(path, digests[i], options);
+			}
+
+			std::cout.flush();
+		}
+
+		return exit_code;
+	}
+
+
+	/* *************************************
+	*  Check mode
+	***************************************/
+
+	struct check_entry
+	{
+		std::string path;
+		algorithm algo = algorithm::xxh64;
+		std::array<uint8_t, 16> expected{};
+	};
+
+	/* Parses one line of either format into entry. */
+	bool parse_check_line(std::string line, bool little_endian, check_entry& entry)
+	{
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		bool const escaped = !line.empty() && line[0] == '\\';
+
+		if (escaped)
+		{
+			line.erase(0, 1);
+		}
+
+		std::string hex;
+		bool line_little_endian = little_endian;
+
+		size_t const paren = line.find(" (");
+		size_t const equals = line.rfind(") = ");
+
+		if (paren != std::string::npos && equals != std::string::npos && equals > paren)
+		{	/* BSD: ALGO[_LE] (file) = hash */
+			std::string name = line.substr(0, paren);
+			line_little_endian = (name.size() > 3 && name.compare(name.size() - 3, 3, "_LE") == 0);
+
+			if (line_little_endian)
+			{
+				name.resize(name.size() - 3);
+			}
+
+			auto const found = std::find_if(std::begin(algorithm_names), std::end(algorithm_names), [&](const char* algo_name) { return name == algo_name; });
+
+			if (found == std::end(algorithm_names))
+			{
+				return false;
+			}
+
+			entry.algo = static_cast<algorithm>(found - std::begin(algorithm_names));
+			entry.path = line.substr(paren + 2, equals - paren - 2);
+			hex = line.substr(equals + 4);
+		}
+		else
+		{	/* GNU: [XXH3_]hash  file, the algorithm follows from the length of the hash */
+			size_t const separator = line.find("  ");
+
+			if (separator == std::string::npos)
+			{
+				return false;
+			}
+
+			hex = line.substr(0, separator);
+			entry.path = line.substr(separator + 2);
+
+			if (hex.compare(0, 5, "XXH3_") == 0)
+			{
+				hex.erase(0, 5);
+				entry.algo = algorithm::xxh3;
+			}
+			else
+			{
+				switch (hex.size())
+				{
+				case 8: entry.algo = algorithm::xxh32; break;
+				case 16: entry.algo = algorithm::xxh64; break;
+				case 32: entry.algo = algorithm::xxh128; break;
+				default: return false;
+				}
+			}
+		}
+
+		if (escaped)
+		{
+			entry.path = unescape_filename(entry.path);
+		}
+
+		if (entry.path == "stdin")
+		{
+			entry.path = "-";
+		}
+
+		return hex.size() == 2 * digest_size(entry.algo) && !entry.path.empty() && from_hex(hex, entry.expected.data(), line_little_endian);
+	}
+
+	int check_file(const std::string& check_path, const options_t& options, xxh::thread_pool& pool)
+	{
+		std::ifstream file;
+		std::istream* in = &std::cin;
+		std::string const display_name = (check_path == "-") ? "stdin" : check_path;
+
+		if (check_path != "-")
+		{
+			file.open(check_path, std::ios::binary);
+
+			if (!file)
+			{
+				std::cerr << "Error: Could not open '" << check_path << "': " << std::strerror(errno) << ".\n";
+				return 1;
+			}
+
+			in = &file;
+		}
+
+		size_t improperly_formatted = 0;
+		size_t unreadable = 0;
+		size_t mismatched = 0;
+		size_t properly_formatted = 0;
+		size_t line_number = 0;
+		std::string line;
+		std::vector<check_entry> entries;
+
+		auto flush = [&]() {
+			std::vector<digest_t> digests(entries.size());
+
+			pool.parallel_for(entries.size(), [&](size_t i) {
+				digests[i] = hash_path(entries[i].path, entries[i].algo);
+			});
+
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				const check_entry& entry = entries[i];
+				std::string const name = (entry.path == "-") ? "stdin" : entry.path;
+				const char* verdict;
+
+				if (!digests[i].error.empty())
+				{
+					unreadable++;
+					verdict = "FAILED open or read";
+				}
+				else if (!std::equal(digests[i].bytes.begin(), digests[i].bytes.begin() + digests[i].size, entry.expected.begin()))
+				{
+					mismatched++;
+					verdict = "FAILED";
+				}
+				else
+				{
+					verdict = options.quiet ? nullptr : "OK";
+				}
+
+				if (verdict && !options.status)
+				{
+					std::cout << name << ": " << verdict << "\n";
+				}
+			}
+
+			entries.clear();
+		};
+
+		while (std::getline(*in, line))
+		{
+			line_number++;
+			check_entry entry;
+
+			if (!parse_check_line(line, options.little_endian, entry))
+			{
+				improperly_formatted++;
+
+				if (options.warn && !options.status)
+				{
+					std::cerr << display_name << ":" << line_number << ": Error: Improperly formatted checksum line.\n";
+				}
+
+				continue;
+			}
+
+			properly_formatted++;
+			entries.push_back(entry);
+
+			if (entries.size() == batch_size)
+			{
+				flush();
+			}
+		}
+
+		flush();
+		std::cout.flush();
+
+		if (properly_formatted == 0)
+		{
+			if (!options.status)
+			{
+				std::cerr << display_name << ": no properly formatted xxHash checksum lines found\n";
+			}
+
+			return 1;
+		}
+
+		if (!options.status)
+		{
+			if (improperly_formatted)
+			{
+				std::cerr << display_name << ": " << improperly_formatted << " line" << ((improperly_formatted == 1) ? " is" : "s are") << " improperly formatted\n";
+			}
+
+			if (unreadable)
+			{
+				std::cerr << display_name << ": " << unreadable << " listed file" << ((unreadable == 1) ? "" : "s") << " could not be read\n";
+			}
+
+			if (mismatched)
+			{
+				std::cerr << display_name << ": " << mismatched << " computed checksum" << ((mismatched == 1) ? "" : "s") << " did NOT match\n";
+			}
+		}
+
+		return (unreadable || mismatched || (options.strict && improperly_formatted)) ? 1 : 0;
+	}
+
+
+	/* *************************************
+	*  Benchmark mode
+	***************************************/
+
+	/* Best iterations per second of f over the configured number of runs, each lasting about half a second. */
+	template <typename F>
+	double iterations_per_second(const options_t& options, F&& f)
+	{
+		using clock = std::chrono::steady_clock;
+		double best = 0;
+
+		for (size_t run = 0; run < options.bench_iterations; run++)
+		{
+			size_t iterations = 0;
+			clock::time_point const start = clock::now();
+			double elapsed = 0;
+
+			do
+			{
+				f();
+				iterations++;
+				elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			} while (elapsed < 0.5);
+
+			best = std::max(best, static_cast<double>(iterations) / elapsed);
+		}
+
+		return best;
+	}
+
+	volatile uint64_t sink = 0;
+
+	int benchmark(const options_t& options, xxh::thread_pool& pool)
+	{
+		size_t const size = options.bench_size;
+		std::vector<uint8_t> buffer(size + 1);
+
+		for (size_t i = 0; i < buffer.size(); i++)
+		{
+			buffer[i] = static_cast<uint8_t>(xxh::xxhash<32>(&i, sizeof(i)));
+		}
+
+		std::printf("xxh_cpp_sum %s\n", XXH_CPP_SUM_VERSION);
+		std::printf("Sample of %.1f KB...\n", static_cast<double>(size) / 1024);
+
+		int id = 1;
+
+		auto report = [&](const char* name, double rate) {
+			std::printf("%2i#%-29s : %10zu -> %8.0f it/s (%7.1f MB/s)\n", id++, name, size, rate, rate * static_cast<double>(size) / (1 << 20));
+			std::fflush(stdout);
+		};
+
+		for (size_t offset : { size_t(0), size_t(1) })
+		{
+			const uint8_t* const p = buffer.data() + offset;
+			std::string const suffix = offset ? " unaligned" : "";
+
+			report(("XXH32" + suffix).c_str(), iterations_per_second(options, [&]() { sink = sink + xxh::xxhash<32>(p, size); }));
+			report(("XXH64" + suffix).c_str(), iterations_per_second(options, [&]() { sink = sink + xxh::xxhash<64>(p, size); }));
+			report(("XXH3_64b" + suffix).c_str(), iterations_per_second(options, [&]() { sink = sink + xxh::xxhash3<64>(p, size); }));
+			report(("XXH128" + suffix).c_str(), iterations_per_second(options, [&]() { sink = sink + xxh::xxhash3<128>(p, size).low64; }));
+		}
+
+		if (pool.size() > 1)
+		{	/* one independent sample per thread, rated per sample so it compares with the lines above */
+			std::vector<xxh::byte_range> samples(pool.size() * 4, xxh::byte_range(buffer.data(), size));
+			std::vector<xxh::hash64_t> out(samples.size());
+			std::string const name = "XXH3_64b x " + std::to_string(pool.size()) + " threads";
+
+			report(name.c_str(), iterations_per_second(options, [&]() {
+				xxh::parallel_hash3<64>(samples.data(), samples.size(), out.data(), pool);
+				sink = sink + out[0];
+			}) * static_cast<double>(samples.size()));
+		}
+
+		return 0;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	sum::options_t options;
+	int const parsed = sum::parse_options(argc, argv, options);
+
+	if (parsed >= 0)
+	{
+		return parsed;
+	}
+
+	xxh::thread_pool pool(options.threads);
+
+	if (options.benchmark)
+	{
+		return sum::benchmark(options, pool);
+	}
+
+	if (options.check)
+	{
+		int exit_code = 0;
+
+		for (const std::string& path : options.files)
+		{
+			exit_code |= sum::check_file(path, options, pool);
+		}
+
+		return exit_code;
+	}
+
+	return sum::hash_files(options, pool);
+}
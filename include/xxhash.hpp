@@ -5,6 +5,8 @@
 #include <type_traits>
 #include <vector>
 #include <string>
+#include <tuple>
+#include <utility>
 
 /*
 xxHash - Extremely Fast Hash algorithm
@@ -78,32 +80,32 @@ namespace xxh
 			uint64_t low64 = 0;
 			uint64_t high64 = 0;
 
-			bool operator==(const uint128_t & other)
+			bool operator==(const uint128_t & other) const
 			{
 				return (low64 == other.low64 && high64 == other.high64);
 			}
 
-			bool operator>(const uint128_t & other)
+			bool operator>(const uint128_t & other) const
 			{
 				return (high64 > other.high64 || low64 > other.low64);
 			}
 
-			bool operator>=(const uint128_t & other)
+			bool operator>=(const uint128_t & other) const
 			{
 				return (*this > other || *this == other);
 			}
 
-			bool operator<(const uint128_t & other)
+			bool operator<(const uint128_t & other) const
 			{
 				return !(*this >= other);
 			}
 
-			bool operator<=(const uint128_t & other)
+			bool operator<=(const uint128_t & other) const
 			{
 				return !(*this > other);
 			}
 
-			bool operator!=(const uint128_t & other)
+			bool operator!=(const uint128_t & other) const
 			{
 				return !(*this == other);
 			}
@@ -805,6 +807,61 @@ namespace xxh
 		}
 
 
+		template <size_t N>
+		XXH_FORCE_INLINE void storeu(vec_t<N>* output, vec_t<N> a)
+		{
+			static_assert(!(N != 128 && N != 256 && N != 64 && N != 512), "Invalid template argument passed to xxh::vec_ops::storeu");
+
+			if constexpr (N == 128)
+			{
+				_mm_storeu_si128(output, a);
+			}
+
+			if constexpr (N == 256)
+			{
+				_mm256_storeu_si256(output, a);
+			}
+
+			if constexpr (N == 512)
+			{
+				_mm512_storeu_si512(output, a);
+			}
+
+			if constexpr (N == 64)
+			{
+				mem_ops::writeLE<64>(output, a);
+			}
+		}
+
+
+		/* Non-temporal store, output has to be aligned to the vector width. The scalar version is an ordinary store. */
+		template <size_t N>
+		XXH_FORCE_INLINE void stream(vec_t<N>* output, vec_t<N> a)
+		{
+			static_assert(!(N != 128 && N != 256 && N != 64 && N != 512), "Invalid template argument passed to xxh::vec_ops::stream");
+
+			if constexpr (N == 128)
+			{
+				_mm_stream_si128(output, a);
+			}
+
+			if constexpr (N == 256)
+			{
+				_mm256_stream_si256(output, a);
+			}
+
+			if constexpr (N == 512)
+			{
+				_mm512_stream_si512(output, a);
+			}
+
+			if constexpr (N == 64)
+			{
+				mem_ops::writeLE<64>(output, a);
+			}
+		}
+
+
 		template <size_t N>
 		XXH_FORCE_INLINE vec_t<N> slli(vec_t<N> n, int a)
 		{
@@ -1120,6 +1177,7 @@ namespace xxh
 		constexpr uint64_t midsize_max = 240;
 		constexpr uint64_t midsize_startoffset = 3;
 		constexpr uint64_t midsize_lastoffset = 17;
+		constexpr uint64_t non_temporal_threshold = 4 * 1024 * 1024;
 
 		constexpr vec_mode vector_mode = static_cast<vec_mode>(intrin::vector_mode);
 		constexpr uint64_t acc_align = intrin::acc_align;
@@ -1280,6 +1338,74 @@ namespace xxh
 			accumulate_512(acc, p, secret + secretSize - stripe_len - secret_lastacc_start);
 		}
 
+		template <bool non_temporal>
+		XXH_FORCE_INLINE void copy_stripe(uint8_t* XXH_RESTRICT dest, const uint8_t* XXH_RESTRICT input)
+		{
+			constexpr uint64_t bits = vector_bit_width[static_cast<uint8_t>(vector_mode)];
+
+			using vec_t = vec_t<bits>;
+
+			vec_t* const xdest = reinterpret_cast<vec_t*>(dest);
+			const vec_t* const xinput = reinterpret_cast<const vec_t*>(input);
+
+			for (size_t i = 0; i < stripe_len / sizeof(vec_t); i++)
+			{
+				if constexpr (non_temporal)
+				{
+					vec_ops::stream<bits>(xdest + i, loadu<bits>(xinput + i));
+				}
+				else
+				{
+					vec_ops::storeu<bits>(xdest + i, loadu<bits>(xinput + i));
+				}
+			}
+		}
+
+		/* Each stripe is stored to dest right after it has been accumulated, while it is still in L1. */
+		template <bool non_temporal>
+		XXH_FORCE_INLINE void accumulate_copy(uint64_t* XXH_RESTRICT acc, uint8_t* XXH_RESTRICT dest, const uint8_t* XXH_RESTRICT input, const uint8_t* XXH_RESTRICT secret, size_t nbStripes)
+		{
+			for (size_t n = 0; n < nbStripes; n++)
+			{
+				const uint8_t* const in = input + n * stripe_len;
+
+				intrin::prefetch(in + prefetch_distance);
+				accumulate_512(acc, in, secret + n * secret_consume_rate);
+				copy_stripe<non_temporal>(dest + n * stripe_len, in);
+			}
+		}
+
+		template <bool non_temporal>
+		XXH_FORCE_INLINE void hash_long_internal_loop_copy(uint64_t* XXH_RESTRICT acc, uint8_t* XXH_RESTRICT dest, const uint8_t* XXH_RESTRICT input, size_t len, const uint8_t* XXH_RESTRICT secret, size_t secretSize)
+		{
+			size_t const nb_rounds = (secretSize - stripe_len) / secret_consume_rate;
+			size_t const block_len = stripe_len * nb_rounds;
+			size_t const nb_blocks = (len - 1) / block_len;
+
+			for (size_t n = 0; n < nb_blocks; n++)
+			{
+				accumulate_copy<non_temporal>(acc, dest + n * block_len, input + n * block_len, secret, nb_rounds);
+				scramble_acc(acc, secret + secretSize - stripe_len);
+			}
+
+			/* last partial block */
+			size_t const nbStripes = ((len - 1) - (block_len * nb_blocks)) / stripe_len;
+			size_t const copied = nb_blocks * block_len + nbStripes * stripe_len;
+
+			accumulate_copy<non_temporal>(acc, dest + nb_blocks * block_len, input + nb_blocks * block_len, secret, nbStripes);
+
+			/* last stripe, of which only the bytes not yet stored are copied */
+			const uint8_t* const p = input + len - stripe_len;
+
+			accumulate_512(acc, p, secret + secretSize - stripe_len - secret_lastacc_start);
+			memcpy(dest + copied, input + copied, len - copied);
+
+			if constexpr (non_temporal && vector_mode != vec_mode::scalar)
+			{
+				_mm_sfence();
+			}
+		}
+
 		XXH_FORCE_INLINE uint64_t mix_2_accs(const uint64_t* XXH_RESTRICT acc, const uint8_t* XXH_RESTRICT secret)
 		{
 			return mul128fold64(acc[0] ^ readLE<64>(secret), acc[1] ^ readLE<64>(secret + 8));
@@ -1450,21 +1576,15 @@ namespace xxh
 		}
 
 		template <size_t N>
-		XXH_FORCE_INLINE hash_t<N> hash_long_internal(const uint8_t* XXH_RESTRICT input, size_t len, const uint8_t* XXH_RESTRICT secret = default_secret, size_t secretSize = sizeof(default_secret))
+		XXH_FORCE_INLINE hash_t<N> hash_long_merge(const std::array<uint64_t, acc_nb>& acc, size_t len, const uint8_t* XXH_RESTRICT secret, size_t secretSize)
 		{
-			alignas(acc_align) std::array<uint64_t, acc_nb> acc = init_acc;
-
 			if constexpr (N == 64)
-			{				
-				hash_long_internal_loop(acc.data(), input, len, secret, secretSize);
-
+			{
 				/* converge into final hash */
 				return merge_accs(acc.data(), secret + secret_mergeaccs_start, (uint64_t)len * PRIME<64>(1));
 			}
 			else
 			{
-				hash_long_internal_loop(acc.data(), input, len, secret, secretSize);
-
 				/* converge into final hash */
 				uint64_t const low64 = merge_accs(acc.data(), secret + secret_mergeaccs_start, (uint64_t)len * PRIME<64>(1));
 				uint64_t const high64 = merge_accs(acc.data(), secret + secretSize - sizeof(acc) - secret_mergeaccs_start, ~((uint64_t)len * PRIME<64>(2)));
@@ -1473,6 +1593,26 @@ namespace xxh
 			}
 		}
 
+		template <size_t N>
+		XXH_FORCE_INLINE hash_t<N> hash_long_internal(const uint8_t* XXH_RESTRICT input, size_t len, const uint8_t* XXH_RESTRICT secret = default_secret, size_t secretSize = sizeof(default_secret))
+		{
+			alignas(acc_align) std::array<uint64_t, acc_nb> acc = init_acc;
+
+			hash_long_internal_loop(acc.data(), input, len, secret, secretSize);
+
+			return hash_long_merge<N>(acc, len, secret, secretSize);
+		}
+
+		template <size_t N, bool non_temporal>
+		XXH_FORCE_INLINE hash_t<N> hash_long_internal_copy(uint8_t* XXH_RESTRICT dest, const uint8_t* XXH_RESTRICT input, size_t len, const uint8_t* XXH_RESTRICT secret, size_t secretSize)
+		{
+			alignas(acc_align) std::array<uint64_t, acc_nb> acc = init_acc;
+
+			hash_long_internal_loop_copy<non_temporal>(acc.data(), dest, input, len, secret, secretSize);
+
+			return hash_long_merge<N>(acc, len, secret, secretSize);
+		}
+
 		XXH_FORCE_INLINE uint64_t mix_16b(const uint8_t* XXH_RESTRICT input, const uint8_t* XXH_RESTRICT secret, uint64_t seed)
 		{
 			uint64_t const input_lo = readLE<64>(input);
@@ -1638,6 +1778,32 @@ namespace xxh
 			}
 		}
 
+		template <size_t N>
+		XXH_NO_INLINE hash_t<N> xxhash3_copy_impl(void* XXH_RESTRICT dest, const void* XXH_RESTRICT input, size_t len, hash64_t seed, bool non_temporal, const void* XXH_RESTRICT secret = default_secret, size_t secretSize = secret_default_size)
+		{
+			if (len <= midsize_max)
+			{	/* short inputs are hashed straight out of L1 anyway */
+				memcpy(dest, input, len);
+				return xxhash3_impl<N>(input, len, seed, secret, secretSize);
+			}
+
+			alignas(64) uint8_t custom_secret[secret_default_size];
+
+			if (seed != 0 && secret == default_secret)
+			{
+				init_custom_secret(custom_secret, seed);
+				secret = custom_secret;
+			}
+
+			/* streaming stores need the destination aligned to the vector width, stripes are a multiple of it */
+			if (non_temporal && (reinterpret_cast<uintptr_t>(dest) % sizeof(vec_t<vector_bit_width[static_cast<uint8_t>(vector_mode)]>)) == 0)
+			{
+				return hash_long_internal_copy<N, true>(static_cast<uint8_t*>(dest), static_cast<const uint8_t*>(input), len, static_cast<const uint8_t*>(secret), secretSize);
+			}
+
+			return hash_long_internal_copy<N, false>(static_cast<uint8_t*>(dest), static_cast<const uint8_t*>(input), len, static_cast<const uint8_t*>(secret), secretSize);
+		}
+
 		XXH_NO_INLINE void generate_secret(void* secret_buffer, size_t secret_size, const void* custom_seed, size_t seed_size)
 		{
 			if (seed_size == 0)
@@ -1806,6 +1972,40 @@ namespace xxh
 	}
 
 
+	/* *************************************
+	*  Public Access Point - copy_and_hash3
+	***************************************/
+
+	/* Controls the stores of copy_and_hash3.
+	* automatic uses non-temporal stores from detail3::non_temporal_threshold bytes on, which keeps large copies from evicting the cache.
+	* Non-temporal stores are only used when dest is aligned to the vector width.
+	*/
+	enum class store_hint : uint8_t { automatic = 0, temporal = 1, non_temporal = 2 };
+
+	namespace detail3
+	{
+		inline bool use_non_temporal(store_hint hint, size_t len)
+		{
+			return (hint == store_hint::non_temporal) || (hint == store_hint::automatic && len >= non_temporal_threshold);
+		}
+	}
+
+	/* Copies len bytes from src to dest and returns xxhash3 of them, reading src only once. The ranges must not overlap. */
+	template <size_t bit_mode>
+	inline hash_t<bit_mode> copy_and_hash3(void* dest, const void* src, size_t len, uint64_t seed = 0, store_hint hint = store_hint::automatic)
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "copy_and_hash3 can only be used in 64 and 128 bit modes.");
+		return detail3::xxhash3_copy_impl<bit_mode>(dest, src, len, seed, detail3::use_non_temporal(hint, len));
+	}
+
+	template <size_t bit_mode>
+	inline hash_t<bit_mode> copy_and_hash3(void* dest, const void* src, size_t len, const void* secret, size_t secretSize, uint64_t seed = 0, store_hint hint = store_hint::automatic)
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "copy_and_hash3 can only be used in 64 and 128 bit modes.");
+		return detail3::xxhash3_copy_impl<bit_mode>(dest, src, len, seed, detail3::use_non_temporal(hint, len), secret, secretSize);
+	}
+
+
 	/* *************************************
 	*  Secret Generation Functions
 	***************************************/
@@ -2008,6 +2208,233 @@ namespace xxh
 	using hash_state64_t = hash_state_t<64>;
 
 
+	/* *************************************
+	*  Hash streaming - xxhash, stream arena
+	***************************************/
+
+	/* Holds the states of many concurrent xxhash streams laid out as a structure of arrays.
+	* Batched updates prefetch the state and input of the stream prefetch_distance updates ahead,
+	* so the cache misses of a large arena overlap with hashing instead of stalling it.
+	* Digests are bit-identical to those of individual hash_state_t objects fed the same data.
+	*/
+	template <size_t bit_mode>
+	class hash_state_arena_t
+	{
+	public:
+
+		struct update_t
+		{
+			size_t stream_id;
+			const void* input;
+			size_t length;
+		};
+
+	private:
+
+		constexpr static size_t stripe_len = bit_mode / 2;
+		constexpr static size_t word_len = bit_mode / 8;
+		constexpr static size_t prefetch_distance = 8;
+
+		std::vector<uint64_t> total_len;
+		std::vector<uint_t<bit_mode>> v1, v2, v3, v4;
+		std::vector<uint8_t> mem;
+		std::vector<uint32_t> memsize;
+
+		/* Buffers short input and completes a partially filled stripe. Returns false if the whole input ended up in the buffer. */
+		inline bool update_head(size_t id, const uint8_t*& p, const uint8_t* const bEnd)
+		{
+			size_t const length = static_cast<size_t>(bEnd - p);
+			uint8_t* const stream_mem = mem.data() + id * stripe_len;
+
+			total_len[id] += length;
+
+			if (memsize[id] + length < stripe_len)
+			{	/* fill in tmp buffer */
+				memcpy(stream_mem + memsize[id], p, length);
+				memsize[id] += static_cast<uint32_t>(length);
+				return false;
+			}
+
+			if (memsize[id] > 0)
+			{	/* some data left from previous update */
+				memcpy(stream_mem + memsize[id], p, stripe_len - memsize[id]);
+
+				v1[id] = detail::round<bit_mode>(v1[id], mem_ops::readLE<bit_mode>(stream_mem));
+				v2[id] = detail::round<bit_mode>(v2[id], mem_ops::readLE<bit_mode>(stream_mem + word_len));
+				v3[id] = detail::round<bit_mode>(v3[id], mem_ops::readLE<bit_mode>(stream_mem + word_len * 2));
+				v4[id] = detail::round<bit_mode>(v4[id], mem_ops::readLE<bit_mode>(stream_mem + word_len * 3));
+
+				p += stripe_len - memsize[id];
+				memsize[id] = 0;
+			}
+
+			return true;
+		}
+
+		inline void update_tail(size_t id, const uint8_t* p, const uint8_t* const bEnd)
+		{
+			if (p < bEnd)
+			{
+				memcpy(mem.data() + id * stripe_len, p, static_cast<size_t>(bEnd - p));
+				memsize[id] = static_cast<uint32_t>(bEnd - p);
+			}
+		}
+
+		inline void update_stripes(size_t id, const uint8_t*& p, const uint8_t* const bEnd)
+		{
+			uint_t<bit_mode> a1 = v1[id], a2 = v2[id], a3 = v3[id], a4 = v4[id];
+
+			while (p + stripe_len <= bEnd)
+			{
+				a1 = detail::round<bit_mode>(a1, mem_ops::readLE<bit_mode>(p));
+				a2 = detail::round<bit_mode>(a2, mem_ops::readLE<bit_mode>(p + word_len));
+				a3 = detail::round<bit_mode>(a3, mem_ops::readLE<bit_mode>(p + word_len * 2));
+				a4 = detail::round<bit_mode>(a4, mem_ops::readLE<bit_mode>(p + word_len * 3));
+				p += stripe_len;
+			}
+
+			v1[id] = a1; 
+			v2[id] = a2; 
+			v3[id] = a3; 
+			v4[id] = a4;
+		}
+
+		inline void update_impl(size_t stream_id, const void* input, size_t length)
+		{
+			const uint8_t* p = static_cast<const uint8_t*>(input);
+			const uint8_t* const bEnd = p + length;
+
+			if (update_head(stream_id, p, bEnd))
+			{
+				update_stripes(stream_id, p, bEnd);
+				update_tail(stream_id, p, bEnd);
+			}
+		}
+
+		inline void prefetch_stream(size_t id) const
+		{
+			intrin::prefetch(&total_len[id]);
+			intrin::prefetch(&v1[id]);
+			intrin::prefetch(&v2[id]);
+			intrin::prefetch(&v3[id]);
+			intrin::prefetch(&v4[id]);
+			intrin::prefetch(&mem[id * stripe_len]);
+			intrin::prefetch(&memsize[id]);
+		}
+
+		inline void update_batch_impl(const update_t* updates, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				if (i + prefetch_distance < count)
+				{
+					prefetch_stream(updates[i + prefetch_distance].stream_id);
+					intrin::prefetch(updates[i + prefetch_distance].input);
+				}
+
+				update_impl(updates[i].stream_id, updates[i].input, updates[i].length);
+			}
+		}
+
+		inline hash_t<bit_mode> digest_impl(size_t id) const
+		{
+			const uint8_t* p = mem.data() + id * stripe_len;
+			const uint8_t* const bEnd = p + memsize[id];
+			hash_t<bit_mode> hash_ret;
+
+			if (total_len[id] >= stripe_len)
+			{
+				hash_ret = bit_ops::rotl<bit_mode>(v1[id], 1) + bit_ops::rotl<bit_mode>(v2[id], 7) + bit_ops::rotl<bit_mode>(v3[id], 12) + bit_ops::rotl<bit_mode>(v4[id], 18);
+
+				if constexpr (bit_mode == 64)
+				{
+					detail::endian_align_sub_mergeround(hash_ret, v1[id], v2[id], v3[id], v4[id]);
+				}
+			}
+			else
+			{
+				hash_ret = v3[id] + detail::PRIME<bit_mode>(5);
+			}
+
+			hash_ret += static_cast<hash_t<bit_mode>>(total_len[id]);
+
+			return detail::endian_align_sub_ending<bit_mode>(hash_ret, p, bEnd);
+		}
+
+	public:
+
+		hash_state_arena_t(size_t stream_count = 0, uint_t<bit_mode> seed = 0)
+		{
+			static_assert(!(bit_mode != 32 && bit_mode != 64), "xxhash stream arenas can only be used in 32 and 64 bit modes.");
+			resize(stream_count, seed);
+		}
+
+		size_t size() const
+		{
+			return total_len.size();
+		}
+
+		/* New streams are initialized with seed, existing streams are left untouched. */
+		void resize(size_t stream_count, uint_t<bit_mode> seed = 0)
+		{
+			size_t const old_count = size();
+
+			total_len.resize(stream_count);
+			v1.resize(stream_count);
+			v2.resize(stream_count);
+			v3.resize(stream_count);
+			v4.resize(stream_count);
+			mem.resize(stream_count * stripe_len);
+			memsize.resize(stream_count);
+
+			for (size_t id = old_count; id < stream_count; id++)
+			{
+				reset(id, seed);
+			}
+		}
+
+		/* Appends a new stream and returns its id. */
+		size_t add_stream(uint_t<bit_mode> seed = 0)
+		{
+			resize(size() + 1, seed);
+			return size() - 1;
+		}
+
+		void reset(size_t stream_id, uint_t<bit_mode> seed = 0)
+		{
+			total_len[stream_id] = 0;
+			v1[stream_id] = seed + detail::PRIME<bit_mode>(1) + detail::PRIME<bit_mode>(2);
+			v2[stream_id] = seed + detail::PRIME<bit_mode>(2);
+			v3[stream_id] = seed + 0;
+			v4[stream_id] = seed - detail::PRIME<bit_mode>(1);
+			memsize[stream_id] = 0;
+		}
+
+		void update(size_t stream_id, const void* input, size_t length)
+		{
+			return update_impl(stream_id, input, length);
+		}
+
+		void update(const update_t* updates, size_t count)
+		{
+			return update_batch_impl(updates, count);
+		}
+
+		void update(const std::vector<update_t>& updates)
+		{
+			return update_batch_impl(updates.data(), updates.size());
+		}
+
+		hash_t<bit_mode> digest(size_t stream_id) const
+		{
+			return digest_impl(stream_id);
+		}
+	};
+
+	using hash_state_arena32_t = hash_state_arena_t<32>;
+	using hash_state_arena64_t = hash_state_arena_t<64>;
+
+
 	/* *************************************
 	*  Hash streaming - xxhash3
 	***************************************/
@@ -2052,7 +2479,9 @@ namespace xxh
 			}
 		}
 
-		void update_impl(const void* input_, size_t len)
+		/* With copy set, every byte consumed is also stored to dest, full buffers right after they have been accumulated. */
+		template <bool copy = false>
+		void update_impl(const void* input_, size_t len, uint8_t* dest = nullptr)
 		{
 			const uint8_t* input = static_cast<const uint8_t*>(input_);
 			const uint8_t* const bEnd = input + len;
@@ -2063,6 +2492,12 @@ namespace xxh
 			{	/* fill in tmp buffer */
 				memcpy(buffer + bufferedSize, input, len);
 				bufferedSize += (uint32_t)len;
+
+				if constexpr (copy)
+				{
+					memcpy(dest, input, len);
+				}
+
 				return;
 			}
 			/* input now > XXH3_INTERNALBUFFER_SIZE */
@@ -2072,19 +2507,37 @@ namespace xxh
 				size_t const loadSize = internal_buffer_size - bufferedSize;
 
 				memcpy(buffer + bufferedSize, input, loadSize);
+
+				if constexpr (copy)
+				{
+					memcpy(dest, input, loadSize);
+					dest += loadSize;
+				}
+
 				input += loadSize;
 				consume_stripes(acc, nbStripesSoFar, internal_buffer_stripes, buffer);
 				bufferedSize = 0;
 			}
 
-			/* consume input by full buffer quantities */
-			if (input + internal_buffer_size <= bEnd) 
+			/* consume input by full buffer quantities, always keeping some in the buffer: the last stripe is only accumulated by digest() */
+			if (input + internal_buffer_size < bEnd) 
 			{
 				const uint8_t* const limit = bEnd - internal_buffer_size;
 
 				do 
 				{
 					consume_stripes(acc, nbStripesSoFar, internal_buffer_stripes, input);
+
+					if constexpr (copy)
+					{
+						for (int i = 0; i < internal_buffer_stripes; i++)
+						{
+							detail3::copy_stripe<false>(dest + i * detail3::stripe_len, input + i * detail3::stripe_len);
+						}
+
+						dest += internal_buffer_size;
+					}
+
 					input += internal_buffer_size;
 				} 
 				while (input < limit);
@@ -2096,6 +2549,11 @@ namespace xxh
 			{	/* some remaining input input : buffer it */
 				memcpy(buffer, input, (size_t)(bEnd - input));
 				bufferedSize = (uint32_t)(bEnd - input);
+
+				if constexpr (copy)
+				{
+					memcpy(dest, input, (size_t)(bEnd - input));
+				}
 			}
 		}
 
@@ -2203,6 +2661,12 @@ namespace xxh
 			return update_impl(static_cast<const void*>(input.begin()), input.size() * sizeof(T));
 		}
 
+		/* Same as update, and additionally copies the input to dest. The ranges must not overlap. */
+		void update_copy(void* dest, const void* input, size_t len)
+		{
+			return update_impl<true>(input, len, static_cast<uint8_t*>(dest));
+		}
+
 		hash_t<bit_mode> digest()
 		{	
 			if (totalLen > detail3::midsize_max) 
@@ -2232,4 +2696,209 @@ namespace xxh
 
 	using hash3_state64_t = hash3_state_t<64>;
 	using hash3_state128_t = hash3_state_t<128>;
+
+
+	/* *************************************
+	*  Hash streaming - multiple algorithms
+	***************************************/
+
+	namespace typedefs
+	{
+		/* Maps a bit width onto the state used by multi_state.
+		* 32 and 64 select the classic xxhash, 128 selects xxhash3.
+		* For XXH3-64 name the state explicitly through multi_state_t.
+		*/
+		template <size_t N>
+		struct multi_state_type
+		{
+			using type = void;
+		};
+
+		template <>
+		struct multi_state_type<32>
+		{
+			using type = hash_state_t<32>;
+		};
+
+		template <>
+		struct multi_state_type<64>
+		{
+			using type = hash_state_t<64>;
+		};
+
+		template <>
+		struct multi_state_type<128>
+		{
+			using type = hash3_state_t<128>;
+		};
+	}
+
+	template <typename... states>
+	class multi_state_t
+	{
+		std::tuple<states...> state_tuple;
+
+		/* Every state consumes the same tile before moving on, so the tile is fetched from memory once
+		* and the remaining states read it from L1.
+		*/
+		inline void update_impl(const void* input, size_t length)
+		{
+			const uint8_t* p = static_cast<const uint8_t*>(input);
+			const uint8_t* const bEnd = p + length;
+
+			do
+			{
+				size_t const tile_len = std::min(static_cast<size_t>(bEnd - p), tile_size);
+
+				std::apply([p, tile_len](auto&... state) { (state.update(static_cast<const void*>(p), tile_len), ...); }, state_tuple);
+				p += tile_len;
+			} 
+			while (p < bEnd);
+		}
+
+	public:
+
+		using digest_t = std::tuple<decltype(std::declval<states&>().digest())...>;
+
+		constexpr static size_t tile_size = 16 * 1024;
+
+		multi_state_t(uint64_t seed = 0)
+		{
+			static_assert(sizeof...(states) > 0, "multi_state_t needs at least one hash state.");
+			reset(seed);
+		}
+
+		/* hash3_state_t keeps a pointer into itself, so the states cannot be copied around. */
+		multi_state_t(const multi_state_t&) = delete;
+		multi_state_t& operator=(const multi_state_t&) = delete;
+
+		void reset(uint64_t seed = 0)
+		{
+			std::apply([seed](auto&... state) { (state.reset(seed), ...); }, state_tuple);
+		}
+
+		void update(const void* input, size_t length)
+		{
+			return update_impl(input, length);
+		}
+
+		template <typename T>
+		void update(const std::basic_string<T>& input)
+		{
+			return update_impl(static_cast<const void*>(input.data()), input.length() * sizeof(T));
+		}
+
+		template <typename ContiguousIterator>
+		void update(ContiguousIterator begin, ContiguousIterator end)
+		{
+			using T = typename std::decay_t<decltype(*end)>;
+			return update_impl(static_cast<const void*>(&*begin), (end - begin) * sizeof(T));
+		}
+
+		template <typename T>
+		void update(const std::vector<T>& input)
+		{
+			return update_impl(static_cast<const void*>(input.data()), input.size() * sizeof(T));
+		}
+
+		template <typename T, size_t AN>
+		void update(const std::array<T, AN>& input)
+		{
+			return update_impl(static_cast<const void*>(input.data()), AN * sizeof(T));
+		}
+
+		template <typename T>
+		void update(const std::initializer_list<T>& input)
+		{
+			return update_impl(static_cast<const void*>(input.begin()), input.size() * sizeof(T));
+		}
+
+		template <size_t I>
+		auto& get()
+		{
+			return std::get<I>(state_tuple);
+		}
+
+		digest_t digest()
+		{
+			return std::apply([](auto&... state) { return digest_t(state.digest()...); }, state_tuple);
+		}
+	};
+
+	template <size_t... bit_modes>
+	using multi_state = multi_state_t<typename typedefs::multi_state_type<bit_modes>::type...>;
+
+	namespace detail
+	{
+		template <size_t N>
+		inline hash_t<N> multi_hash_single(const void* input, size_t len, uint64_t seed)
+		{
+			static_assert(!(N != 32 && N != 64 && N != 128), "multi_hash can only be used in 32, 64 and 128 bit modes.");
+
+			if constexpr (N == 128)
+			{
+				return detail3::xxhash3_impl<128>(input, len, seed);
+			}
+			else
+			{
+				return endian_align<N>(input, len, static_cast<uint_t<N>>(seed));
+			}
+		}
+
+		template <size_t... bit_modes>
+		inline std::tuple<hash_t<bit_modes>...> multi_hash_impl(const void* input, size_t len, uint64_t seed)
+		{
+			/* A single tile stays in cache between the algorithms anyway, and the one-shot paths skip the state setup. */
+			if (len <= multi_state<bit_modes...>::tile_size)
+			{
+				return std::tuple<hash_t<bit_modes>...>(multi_hash_single<bit_modes>(input, len, seed)...);
+			}
+
+			multi_state<bit_modes...> state(seed);
+			state.update(input, len);
+			return state.digest();
+		}
+	}
+
+
+	/* *************************************
+	*  Public Access Point - multi_hash
+	***************************************/
+
+	template <size_t... bit_modes>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(const void* input, size_t len, uint64_t seed = 0)
+	{
+		return detail::multi_hash_impl<bit_modes...>(input, len, seed);
+	}
+
+	template <size_t... bit_modes, typename T>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(const std::basic_string<T>& input, uint64_t seed = 0)
+	{
+		return detail::multi_hash_impl<bit_modes...>(static_cast<const void*>(input.data()), input.length() * sizeof(T), seed);
+	}
+
+	template <size_t... bit_modes, typename ContiguousIterator>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(ContiguousIterator begin, ContiguousIterator end, uint64_t seed = 0)
+	{
+		using T = typename std::decay_t<decltype(*end)>;
+		return detail::multi_hash_impl<bit_modes...>(static_cast<const void*>(&*begin), (end - begin) * sizeof(T), seed);
+	}
+
+	template <size_t... bit_modes, typename T>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(const std::vector<T>& input, uint64_t seed = 0)
+	{
+		return detail::multi_hash_impl<bit_modes...>(static_cast<const void*>(input.data()), input.size() * sizeof(T), seed);
+	}
+
+	template <size_t... bit_modes, typename T, size_t AN>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(const std::array<T, AN>& input, uint64_t seed = 0)
+	{
+		return detail::multi_hash_impl<bit_modes...>(static_cast<const void*>(input.data()), AN * sizeof(T), seed);
+	}
+
+	template <size_t... bit_modes, typename T>
+	inline std::tuple<hash_t<bit_modes>...> multi_hash(const std::initializer_list<T>& input, uint64_t seed = 0)
+	{
+		return detail::multi_hash_impl<bit_modes...>(static_cast<const void*>(input.begin()), input.size() * sizeof(T), seed);
+	}
 }
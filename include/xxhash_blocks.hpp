@@ -0,0 +1,449 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Block checksum sidecars for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Block Checksums
+	***************************************/
+
+	/* Sidecar format, version 1, all integers little endian:
+	* header (32 bytes):  "XXHB" | u32 version | u64 block_size | u64 seed | u64 secret_id
+	* checksums:          u64 xxhash3<64> of each block, in order; every block is block_size bytes except the last one
+	* footer (32 bytes):  u64 block_count | u64 data_length | u64 object_digest | u64 xxhash3<64> of all preceding sidecar bytes
+	* Blocks and the object digest (xxhash3<64> of the whole object) use the seed, or the custom secret whose xxhash3<64> is secret_id.
+	* secret_id is 0 when the default secret is used. An empty object has no blocks.
+	* The footer comes last so that the format can be written in one pass, without knowing the object size up front.
+	*/
+
+	constexpr uint32_t block_format_version = 1;
+	constexpr size_t block_header_size = 32;
+	constexpr size_t block_footer_size = 32;
+
+	struct block_options
+	{
+		size_t block_size = 64 * 1024;
+		uint64_t seed = 0;
+		/* Custom secret, at least detail3::secret_size_min bytes. The seed is ignored when a secret is given. */
+		const void* secret = nullptr;
+		size_t secret_size = 0;
+	};
+
+	/* The parsed or freshly built contents of a sidecar. */
+	struct block_index
+	{
+		uint64_t block_size = 0;
+		uint64_t seed = 0;
+		uint64_t secret_id = 0;
+		uint64_t data_length = 0;
+		hash64_t object_digest = 0;
+		std::vector<hash64_t> checksums;
+
+		uint64_t block_count() const
+		{
+			return checksums.size();
+		}
+
+		/* Indices [first, last) of the blocks overlapping the byte range [offset, offset + length), clamped to the object. */
+		std::pair<uint64_t, uint64_t> blocks_for(uint64_t offset, uint64_t length) const
+		{
+			uint64_t const end = std::min(data_length, offset + std::min(length, data_length));
+
+			if (block_size == 0 || offset >= end)
+			{
+				return { 0, 0 };
+			}
+
+			return { offset / block_size, (end - 1) / block_size + 1 };
+		}
+	};
+
+	struct block_verify_result
+	{
+		/* Indices of the blocks whose contents do not match their checksum, or could not be read. */
+		std::vector<uint64_t> bad_blocks;
+		uint64_t blocks_checked = 0;
+		/* The requested range extends past the end of the object. */
+		bool out_of_range = false;
+		/* The secret passed in is not the one the sidecar was written with. Nothing was checked. */
+		bool wrong_secret = false;
+
+		bool ok() const
+		{
+			return bad_blocks.empty() && !out_of_range && !wrong_secret;
+		}
+	};
+
+	namespace detail_blocks
+	{
+		constexpr uint8_t magic[4] = { 'X', 'X', 'H', 'B' };
+
+		inline uint64_t secret_id(const void* secret, size_t secret_size)
+		{
+			return (secret == nullptr) ? 0 : xxhash3<64>(secret, secret_size);
+		}
+
+		inline hash64_t block_checksum(const void* data, size_t len, uint64_t seed, const void* secret, size_t secret_size)
+		{
+			return (secret == nullptr) ? xxhash3<64>(data, len, seed) : xxhash3<64>(data, len, secret, secret_size);
+		}
+
+		inline std::array<uint8_t, block_header_size> header(uint64_t block_size, uint64_t seed, uint64_t id)
+		{
+			std::array<uint8_t, block_header_size> out;
+
+			memcpy(out.data(), magic, sizeof(magic));
+			mem_ops::writeLE<32>(out.data() + 4, block_format_version);
+			mem_ops::writeLE<64>(out.data() + 8, block_size);
+			mem_ops::writeLE<64>(out.data() + 16, seed);
+			mem_ops::writeLE<64>(out.data() + 24, id);
+			return out;
+		}
+
+		/* Writes the sidecar through sink(const uint8_t*, size_t), hashing it on the way for the footer checksum. */
+		template <typename Sink>
+		inline void write_checksums(hash3_state64_t& sidecar_state, const hash64_t* checksums, size_t count, Sink&& sink)
+		{
+			uint8_t buffer[8 * 512];
+
+			for (size_t i = 0; i < count; i += 512)
+			{
+				size_t const n = std::min<size_t>(512, count - i);
+
+				for (size_t k = 0; k < n; k++)
+				{
+					mem_ops::writeLE<64>(buffer + 8 * k, checksums[i + k]);
+				}
+
+				sidecar_state.update(buffer, 8 * n);
+				sink(buffer, 8 * n);
+			}
+		}
+
+		inline std::array<uint8_t, block_footer_size> footer(hash3_state64_t& sidecar_state, const block_index& index)
+		{
+			std::array<uint8_t, block_footer_size> out;
+
+			mem_ops::writeLE<64>(out.data(), index.block_count());
+			mem_ops::writeLE<64>(out.data() + 8, index.data_length);
+			mem_ops::writeLE<64>(out.data() + 16, index.object_digest);
+			sidecar_state.update(out.data(), 24);
+			mem_ops::writeLE<64>(out.data() + 24, sidecar_state.digest());
+			return out;
+		}
+
+		inline bool uses_secret(const block_index& index, const void* secret, size_t secret_size)
+		{
+			return secret_id(secret, secret_size) == index.secret_id;
+		}
+
+		inline void build(block_index& index, const uint8_t* data, size_t len, const block_options& options, thread_pool* pool)
+		{
+			size_t const block_size = std::max<size_t>(options.block_size, 1);
+
+			index.block_size = block_size;
+			index.seed = (options.secret == nullptr) ? options.seed : 0;
+			index.secret_id = secret_id(options.secret, options.secret_size);
+			index.data_length = len;
+			index.checksums.resize((len + block_size - 1) / block_size);
+
+			auto hash_block = [&](size_t i) {
+				size_t const offset = i * block_size;
+				index.checksums[i] = block_checksum(data + offset, std::min(block_size, len - offset), index.seed, options.secret, options.secret_size);
+			};
+
+			if (pool)
+			{
+				pool->parallel_for(index.checksums.size(), hash_block);
+			}
+			else
+			{
+				for (size_t i = 0; i < index.checksums.size(); i++)
+				{
+					hash_block(i);
+				}
+			}
+
+			index.object_digest = (options.secret == nullptr) ? xxhash3<64>(data, len, index.seed) : xxhash3<64>(data, len, options.secret, options.secret_size);
+		}
+
+		template <typename Check>
+		inline block_verify_result verify(const block_index& index, uint64_t offset, uint64_t length, const void* secret, size_t secret_size, thread_pool* pool, Check&& check)
+		{
+			block_verify_result result;
+
+			if (!uses_secret(index, secret, secret_size))
+			{
+				result.wrong_secret = true;
+				return result;
+			}
+
+			result.out_of_range = (offset > index.data_length || length > index.data_length - offset);
+
+			auto const [first, last] = index.blocks_for(offset, length);
+			std::vector<uint8_t> bad(static_cast<size_t>(last - first), 0);
+
+			auto check_block = [&](size_t i) {
+				bad[i] = !check(first + i);
+			};
+
+			if (pool)
+			{
+				pool->parallel_for(bad.size(), check_block);
+			}
+			else
+			{
+				for (size_t i = 0; i < bad.size(); i++)
+				{
+					check_block(i);
+				}
+			}
+
+			for (size_t i = 0; i < bad.size(); i++)
+			{
+				if (bad[i])
+				{
+					result.bad_blocks.push_back(first + i);
+				}
+			}
+
+			result.blocks_checked = last - first;
+			return result;
+		}
+	}
+
+	/* Serialized sidecar of an index. */
+	inline std::vector<uint8_t> serialize_block_index(const block_index& index)
+	{
+		std::vector<uint8_t> out;
+		hash3_state64_t sidecar_state;
+		auto const head = detail_blocks::header(index.block_size, index.seed, index.secret_id);
+
+		out.reserve(block_header_size + 8 * index.checksums.size() + block_footer_size);
+		out.insert(out.end(), head.begin(), head.end());
+		sidecar_state.update(head.data(), head.size());
+		detail_blocks::write_checksums(sidecar_state, index.checksums.data(), index.checksums.size(), [&](const uint8_t* p, size_t n) { out.insert(out.end(), p, p + n); });
+
+		auto const foot = detail_blocks::footer(sidecar_state, index);
+		out.insert(out.end(), foot.begin(), foot.end());
+		return out;
+	}
+
+	/* Parses and validates a sidecar. Returns false if it is truncated, corrupted or of an unknown version. */
+	inline bool parse_block_index(const void* data, size_t size, block_index& index)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (size < block_header_size + block_footer_size || memcmp(p, detail_blocks::magic, sizeof(detail_blocks::magic)) != 0 || mem_ops::readLE<32>(p + 4) != block_format_version)
+		{
+			return false;
+		}
+
+		const uint8_t* const foot = p + size - block_footer_size;
+		uint64_t const count = mem_ops::readLE<64>(foot);
+
+		if ((size - block_header_size - block_footer_size) / 8 != count || (size - block_header_size - block_footer_size) % 8 != 0
+			|| xxhash3<64>(p, size - 8) != mem_ops::readLE<64>(foot + 24))
+		{
+			return false;
+		}
+
+		index.block_size = mem_ops::readLE<64>(p + 8);
+		index.seed = mem_ops::readLE<64>(p + 16);
+		index.secret_id = mem_ops::readLE<64>(p + 24);
+		index.data_length = mem_ops::readLE<64>(foot + 8);
+		index.object_digest = mem_ops::readLE<64>(foot + 16);
+
+		if (index.block_size == 0 || (index.data_length + index.block_size - 1) / index.block_size != count)
+		{
+			return false;
+		}
+
+		index.checksums.resize(static_cast<size_t>(count));
+
+		for (size_t i = 0; i < index.checksums.size(); i++)
+		{
+			index.checksums[i] = mem_ops::readLE<64>(p + block_header_size + 8 * i);
+		}
+
+		return true;
+	}
+
+	/* Builds the index of an object held in memory. The object digest takes a second, sequential pass over the data. */
+	inline block_index build_block_index(const void* data, size_t len, const block_options& options = block_options())
+	{
+		block_index index;
+		detail_blocks::build(index, static_cast<const uint8_t*>(data), len, options, nullptr);
+		return index;
+	}
+
+	/* Same, with the blocks hashed concurrently on pool. */
+	inline block_index build_block_index(const void* data, size_t len, thread_pool& pool, const block_options& options = block_options())
+	{
+		block_index index;
+		detail_blocks::build(index, static_cast<const uint8_t*>(data), len, options, &pool);
+		return index;
+	}
+
+	/* Verifies the bytes [offset, offset + length) of an object held in memory (or memory mapped), reading only the blocks that overlap the range. */
+	inline block_verify_result verify_block_range(const block_index& index, const void* object, uint64_t offset, uint64_t length, const void* secret = nullptr, size_t secret_size = 0)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(object);
+
+		return detail_blocks::verify(index, offset, length, secret, secret_size, nullptr, [&](uint64_t block) {
+			uint64_t const start = block * index.block_size;
+			size_t const len = static_cast<size_t>(std::min(index.block_size, index.data_length - start));
+			return detail_blocks::block_checksum(p + start, len, index.seed, secret, secret_size) == index.checksums[block];
+		});
+	}
+
+	/* Same, with the overlapping blocks checked concurrently on pool. */
+	inline block_verify_result verify_block_range(const block_index& index, const void* object, uint64_t offset, uint64_t length, thread_pool& pool, const void* secret = nullptr, size_t secret_size = 0)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(object);
+
+		return detail_blocks::verify(index, offset, length, secret, secret_size, &pool, [&](uint64_t block) {
+			uint64_t const start = block * index.block_size;
+			size_t const len = static_cast<size_t>(std::min(index.block_size, index.data_length - start));
+			return detail_blocks::block_checksum(p + start, len, index.seed, secret, secret_size) == index.checksums[block];
+		});
+	}
+
+	/* Verifies a range of an object that is not in memory. read(offset, dest, len) must fill dest with len bytes of the object starting at offset
+	* and return false on failure; it is called once per overlapping block, so only those are fetched.
+	*/
+	inline block_verify_result verify_block_range(const block_index& index, const std::function<bool(uint64_t, void*, size_t)>& read, uint64_t offset, uint64_t length, const void* secret = nullptr, size_t secret_size = 0)
+	{
+		std::vector<uint8_t> buffer(static_cast<size_t>(std::min(index.block_size, index.data_length)));
+
+		return detail_blocks::verify(index, offset, length, secret, secret_size, nullptr, [&](uint64_t block) {
+			uint64_t const start = block * index.block_size;
+			size_t const len = static_cast<size_t>(std::min(index.block_size, index.data_length - start));
+			return read(start, buffer.data(), len) && detail_blocks::block_checksum(buffer.data(), len, index.seed, secret, secret_size) == index.checksums[block];
+		});
+	}
+
+	/* Writes a sidecar while the object streams through update(). Whole blocks passed to update are hashed in place, partial ones are staged.
+	* The header is written on construction, each checksum as soon as its block is complete and the footer by finish().
+	*/
+	class block_index_writer
+	{
+		std::ostream& out;
+		block_options options;
+		block_index index;
+		hash3_state64_t object_state;
+		hash3_state64_t sidecar_state;
+		std::vector<uint8_t> pending;
+		bool finished = false;
+
+		void emit(const uint8_t* p, size_t n)
+		{
+			out.write(reinterpret_cast<const char*>(p), static_cast<std::streamsize>(n));
+		}
+
+		void add_block(const uint8_t* p, size_t n)
+		{
+			hash64_t const checksum = detail_blocks::block_checksum(p, n, index.seed, options.secret, options.secret_size);
+
+			index.checksums.push_back(checksum);
+			detail_blocks::write_checksums(sidecar_state, &checksum, 1, [&](const uint8_t* b, size_t len) { emit(b, len); });
+		}
+
+	public:
+
+		explicit block_index_writer(std::ostream& sidecar, const block_options& options_ = block_options()) : out(sidecar), options(options_)
+		{
+			options.block_size = std::max<size_t>(options.block_size, 1);
+			index.block_size = options.block_size;
+			index.seed = (options.secret == nullptr) ? options.seed : 0;
+			index.secret_id = detail_blocks::secret_id(options.secret, options.secret_size);
+
+			if (options.secret == nullptr)
+			{
+				object_state.reset(index.seed);
+			}
+			else
+			{
+				object_state.reset(options.secret, options.secret_size);
+			}
+
+			auto const head = detail_blocks::header(index.block_size, index.seed, index.secret_id);
+			sidecar_state.update(head.data(), head.size());
+			emit(head.data(), head.size());
+			pending.reserve(options.block_size);
+		}
+
+		block_index_writer(const block_index_writer&) = delete;
+		block_index_writer& operator=(const block_index_writer&) = delete;
+
+		void update(const void* input, size_t len)
+		{
+			const uint8_t* p = static_cast<const uint8_t*>(input);
+			const uint8_t* const end = p + len;
+
+			object_state.update(p, len);
+			index.data_length += len;
+
+			if (!pending.empty())
+			{
+				size_t const take = std::min(len, options.block_size - pending.size());
+
+				pending.insert(pending.end(), p, p + take);
+				p += take;
+
+				if (pending.size() < options.block_size)
+				{
+					return;
+				}
+
+				add_block(pending.data(), pending.size());
+				pending.clear();
+			}
+
+			for (; static_cast<size_t>(end - p) >= options.block_size; p += options.block_size)
+			{
+				add_block(p, options.block_size);
+			}
+
+			pending.insert(pending.end(), p, end);
+		}
+
+		/* Hashes the last partial block, writes the footer and returns the complete index. Further updates are not allowed. */
+		const block_index& finish()
+		{
+			if (!finished)
+			{
+				if (!pending.empty())
+				{
+					add_block(pending.data(), pending.size());
+					pending.clear();
+				}
+
+				index.object_digest = object_state.digest();
+
+				auto const foot = detail_blocks::footer(sidecar_state, index);
+				emit(foot.data(), foot.size());
+				out.flush();
+				finished = true;
+			}
+
+			return index;
+		}
+	};
+}
@@ -0,0 +1,447 @@
+#pragma once
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Blocked Bloom filters for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Blocked Bloom Filters
+	***************************************/
+
+	namespace detail_bloom
+	{
+		constexpr uint8_t magic[4] = { 'X', 'X', 'H', 'B' };
+		constexpr uint32_t format_version = 1;
+
+		/* The header is a cache line, so that the blocks of a serialized filter keep the alignment of the buffer holding it. */
+		constexpr size_t header_size = 64;
+
+		/* A block is one cache line: 8 words of 64 bits, and a key sets one bit in each. */
+		constexpr size_t block_size = 64;
+		constexpr size_t block_words = 8;
+
+		/* Keys hashed, and blocks prefetched, ahead of the batch functions probing them. */
+		constexpr size_t batch = 16;
+
+		/* Bits set per key is the number of words of a block, so the filter is sized for it: 8 bits is optimal near 11.5 bits per key. */
+		constexpr double default_bits_per_key = 12.0;
+
+		/* Odd multipliers spreading 32 bits of hash over the 8 words, as in the split block filters of Parquet. */
+		constexpr uint32_t salt[block_words] = { 0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu, 0xA2B7289Du, 0x705495C7u, 0x2DF1424Bu, 0x9EFC4947u, 0x5C6BFB31u };
+
+		/* Words are processed 4 at a time with AVX2, one at a time otherwise. */
+		constexpr size_t lane_bits = (intrin::vector_mode >= 2) ? 256 : 64;
+
+		struct alignas(block_size) block
+		{
+			uint8_t bytes[block_size];
+		};
+
+		/* low64 picks the block by multiply and shift, so any block count works, not only powers of 2. */
+		inline size_t block_of(hash128_t h, size_t blocks)
+		{
+			return static_cast<size_t>(bit_ops::mul64to128(h.low64, blocks).high64);
+		}
+
+		/* Bit of word i: the top 6 bits of a 32 bit product, from the low half of high64 for words 0-3 and the high half for words 4-7. */
+		inline uint32_t bit_of(hash128_t h, size_t i)
+		{
+			uint32_t const x = static_cast<uint32_t>((i < 4) ? h.high64 : (h.high64 >> 32));
+			return (x * salt[i]) >> 26;
+		}
+
+		template <size_t N>
+		XXH_FORCE_INLINE void set_bits(uint8_t* b, hash128_t h)
+		{
+			static_assert(!(N != 256 && N != 64), "Invalid template argument passed to xxh::detail_bloom::set_bits");
+
+			if constexpr (N == 256)
+			{
+				int const lo = static_cast<int>(static_cast<uint32_t>(h.high64));
+				int const hi = static_cast<int>(static_cast<uint32_t>(h.high64 >> 32));
+				__m256i const salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salt));
+				__m256i const bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_setr_epi32(lo, lo, lo, lo, hi, hi, hi, hi), salts), 26);
+				__m256i const one = _mm256_set1_epi64x(1);
+				__m256i const mask_lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+				__m256i const mask_hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+				__m256i* const words = reinterpret_cast<__m256i*>(b);
+
+				_mm256_storeu_si256(words, _mm256_or_si256(_mm256_loadu_si256(words), mask_lo));
+				_mm256_storeu_si256(words + 1, _mm256_or_si256(_mm256_loadu_si256(words + 1), mask_hi));
+			}
+
+			if constexpr (N == 64)
+			{
+				for (size_t i = 0; i < block_words; i++)
+				{
+					mem_ops::writeLE<64>(b + 8 * i, mem_ops::readLE<64>(b + 8 * i) | (1ULL << bit_of(h, i)));
+				}
+			}
+		}
+
+		template <size_t N>
+		XXH_FORCE_INLINE bool test_bits(const uint8_t* b, hash128_t h)
+		{
+			static_assert(!(N != 256 && N != 64), "Invalid template argument passed to xxh::detail_bloom::test_bits");
+
+			if constexpr (N == 256)
+			{
+				int const lo = static_cast<int>(static_cast<uint32_t>(h.high64));
+				int const hi = static_cast<int>(static_cast<uint32_t>(h.high64 >> 32));
+				__m256i const salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salt));
+				__m256i const bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_setr_epi32(lo, lo, lo, lo, hi, hi, hi, hi), salts), 26);
+				__m256i const one = _mm256_set1_epi64x(1);
+				__m256i const mask_lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+				__m256i const mask_hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+				const __m256i* const words = reinterpret_cast<const __m256i*>(b);
+
+				/* testc is 1 when every bit of the mask is set in the block */
+				return (_mm256_testc_si256(_mm256_loadu_si256(words), mask_lo) & _mm256_testc_si256(_mm256_loadu_si256(words + 1), mask_hi)) != 0;
+			}
+
+			if constexpr (N == 64)
+			{
+				uint64_t missing = 0;
+
+				for (size_t i = 0; i < block_words; i++)
+				{
+					missing |= ~mem_ops::readLE<64>(b + 8 * i) & (1ULL << bit_of(h, i));
+				}
+
+				return missing == 0;
+			}
+		}
+
+		/* Queries count hashes, writing out[k]. Shared by the filter and by views of serialized filters. */
+		inline void contains_hashes(const uint8_t* blocks, size_t block_count, const hash128_t* hashes, size_t count, bool* out)
+		{
+			for (size_t first = 0; first < count; first += batch)
+			{
+				size_t const n = std::min(batch, count - first);
+				const uint8_t* at[batch];
+
+				for (size_t k = 0; k < n; k++)
+				{
+					at[k] = blocks + block_size * block_of(hashes[first + k], block_count);
+					intrin::prefetch(at[k]);
+				}
+
+				for (size_t k = 0; k < n; k++)
+				{
+					out[first + k] = test_bits<lane_bits>(at[k], hashes[first + k]);
+				}
+			}
+		}
+
+		/* Hashes a batch of keys at a time, with no dependency between them, then hands their hashes to f(first, hashes, n). */
+		template <typename F>
+		void hash_batches(const std::string_view* keys, size_t count, uint64_t seed, F&& f)
+		{
+			hash128_t h[batch];
+
+			for (size_t first = 0; first < count; first += batch)
+			{
+				size_t const n = std::min(batch, count - first);
+
+				for (size_t k = 0; k < n; k++)
+				{
+					h[k] = xxhash3<128>(keys[first + k].data(), keys[first + k].size(), seed);
+				}
+
+				f(first, h, n);
+			}
+		}
+	}
+
+	/* A read-only filter over serialized bytes, such as a mapped file, without copying them. See parse_blocked_bloom. */
+	class blocked_bloom_view
+	{
+		const uint8_t* blocks = nullptr;
+		size_t count = 0;
+		uint64_t seed_ = 0;
+
+		friend class blocked_bloom;
+		friend bool parse_blocked_bloom(const void* data, size_t size, blocked_bloom_view& view);
+
+		blocked_bloom_view(const uint8_t* blocks_, size_t count_, uint64_t seed) : blocks(blocks_), count(count_), seed_(seed)
+		{
+		}
+
+	public:
+
+		blocked_bloom_view() = default;
+
+		bool contains_hash(hash128_t h) const
+		{
+			return count != 0 && detail_bloom::test_bits<detail_bloom::lane_bits>(blocks + detail_bloom::block_size * detail_bloom::block_of(h, count), h);
+		}
+
+		bool contains(const void* key, size_t len) const
+		{
+			return contains_hash(xxhash3<128>(key, len, seed_));
+		}
+
+		bool contains(std::string_view key) const
+		{
+			return contains(key.data(), key.size());
+		}
+
+		void contains_many(const hash128_t* hashes, size_t n, bool* out) const
+		{
+			if (count == 0)
+			{
+				std::fill(out, out + n, false);
+				return;
+			}
+
+			detail_bloom::contains_hashes(blocks, count, hashes, n, out);
+		}
+
+		void contains_many(const std::string_view* keys, size_t n, bool* out) const
+		{
+			detail_bloom::hash_batches(keys, n, seed_, [&](size_t first, const hash128_t* h, size_t batch) { contains_many(h, batch, out + first); });
+		}
+
+		size_t block_count() const
+		{
+			return count;
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+	};
+
+	/* A Bloom filter whose probes for a key all fall in one 64 byte block, so a query costs one cache miss instead of one per bit.
+	* A key is hashed once, with xxhash3<128>(key, seed): low64 picks the block, and the two halves of high64 place one bit in each of the
+	* 8 words of the block. With AVX2 the 8 bit positions are computed, set and tested in two 256 bit registers; elsewhere word by word,
+	* with the same results, so filters built on one machine answer the same on another.
+	* The batch functions hash a batch of keys and prefetch their blocks before touching any of them, so their cache misses overlap.
+	* Blocks are stored as little endian words, and serialize_blocked_bloom writes them after a 64 byte header, so a serialized filter can be
+	* mapped from a file and queried in place through a blocked_bloom_view.
+	*/
+	class blocked_bloom
+	{
+		std::vector<detail_bloom::block> blocks;
+		uint64_t seed_;
+
+		friend bool parse_blocked_bloom(const void* data, size_t size, blocked_bloom& filter);
+
+		uint8_t* block_for(hash128_t h)
+		{
+			return blocks[detail_bloom::block_of(h, blocks.size())].bytes;
+		}
+
+	public:
+
+		/* Sized for expected_keys at bits_per_key: about 0.5% false positives at 12 bits per key, 0.1% at 16. */
+		explicit blocked_bloom(size_t expected_keys = 0, double bits_per_key = detail_bloom::default_bits_per_key, uint64_t seed = 0) : seed_(seed)
+		{
+			double const bits = std::ceil(static_cast<double>(expected_keys) * std::max(bits_per_key, 1.0));
+			blocks.resize(std::max<size_t>(1, static_cast<size_t>(bits / (8 * detail_bloom::block_size)) + 1));
+		}
+
+		void insert_hash(hash128_t h)
+		{
+			detail_bloom::set_bits<detail_bloom::lane_bits>(block_for(h), h);
+		}
+
+		void insert(const void* key, size_t len)
+		{
+			insert_hash(xxhash3<128>(key, len, seed_));
+		}
+
+		void insert(std::string_view key)
+		{
+			insert(key.data(), key.size());
+		}
+
+		void insert_many(const hash128_t* hashes, size_t count)
+		{
+			for (size_t first = 0; first < count; first += detail_bloom::batch)
+			{
+				size_t const n = std::min(detail_bloom::batch, count - first);
+				uint8_t* at[detail_bloom::batch];
+
+				for (size_t k = 0; k < n; k++)
+				{
+					at[k] = block_for(hashes[first + k]);
+					intrin::prefetch(at[k]);
+				}
+
+				for (size_t k = 0; k < n; k++)
+				{
+					detail_bloom::set_bits<detail_bloom::lane_bits>(at[k], hashes[first + k]);
+				}
+			}
+		}
+
+		void insert_many(const std::string_view* keys, size_t count)
+		{
+			detail_bloom::hash_batches(keys, count, seed_, [&](size_t, const hash128_t* h, size_t n) { insert_many(h, n); });
+		}
+
+		bool contains_hash(hash128_t h) const
+		{
+			return view().contains_hash(h);
+		}
+
+		bool contains(const void* key, size_t len) const
+		{
+			return view().contains(key, len);
+		}
+
+		bool contains(std::string_view key) const
+		{
+			return view().contains(key);
+		}
+
+		void contains_many(const hash128_t* hashes, size_t count, bool* out) const
+		{
+			view().contains_many(hashes, count, out);
+		}
+
+		void contains_many(const std::string_view* keys, size_t count, bool* out) const
+		{
+			view().contains_many(keys, count, out);
+		}
+
+		/* Adds the keys of other, which must have the same block count and seed. Returns false, changing nothing, if it does not. */
+		bool merge(const blocked_bloom& other)
+		{
+			if (other.blocks.size() != blocks.size() || other.seed_ != seed_)
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < blocks.size(); i++)
+			{
+				for (size_t j = 0; j < detail_bloom::block_size; j++)
+				{
+					blocks[i].bytes[j] |= other.blocks[i].bytes[j];
+				}
+			}
+
+			return true;
+		}
+
+		void clear()
+		{
+			std::fill(blocks.begin(), blocks.end(), detail_bloom::block{});
+		}
+
+		/* Share of set bits. The false positive rate is about its 8th power. */
+		double fill_ratio() const
+		{
+			size_t set = 0;
+
+			for (const detail_bloom::block& b : blocks)
+			{
+				for (size_t i = 0; i < detail_bloom::block_words; i++)
+				{
+					set += std::bitset<64>(mem_ops::readLE<64>(b.bytes + 8 * i)).count();
+				}
+			}
+
+			return static_cast<double>(set) / static_cast<double>(8 * size_bytes());
+		}
+
+		/* Valid until the filter is destroyed or assigned. */
+		blocked_bloom_view view() const
+		{
+			return blocked_bloom_view(blocks.front().bytes, blocks.size(), seed_);
+		}
+
+		size_t block_count() const
+		{
+			return blocks.size();
+		}
+
+		size_t size_bytes() const
+		{
+			return blocks.size() * detail_bloom::block_size;
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+
+		const uint8_t* data() const
+		{
+			return blocks.front().bytes;
+		}
+	};
+
+	/* Serialized form, little endian: "XXHB" | u32 version | u64 block count | u64 seed | zeros to 64 bytes | 64 bytes per block. */
+	inline std::vector<uint8_t> serialize_blocked_bloom(const blocked_bloom& filter)
+	{
+		std::vector<uint8_t> out(detail_bloom::header_size + filter.size_bytes(), 0);
+
+		memcpy(out.data(), detail_bloom::magic, 4);
+		mem_ops::writeLE<32>(out.data() + 4, detail_bloom::format_version);
+		mem_ops::writeLE<64>(out.data() + 8, filter.block_count());
+		mem_ops::writeLE<64>(out.data() + 16, filter.seed());
+		memcpy(out.data() + detail_bloom::header_size, filter.data(), filter.size_bytes());
+		return out;
+	}
+
+	/* Points view at the blocks inside data, which must outlive it. Queries are fastest when data is 64 byte aligned, as mapped files are.
+	* Returns false, leaving view unchanged, if data is not a serialized filter.
+	*/
+	inline bool parse_blocked_bloom(const void* data, size_t size, blocked_bloom_view& view)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (size < detail_bloom::header_size || memcmp(p, detail_bloom::magic, 4) != 0 || mem_ops::readLE<32>(p + 4) != detail_bloom::format_version)
+		{
+			return false;
+		}
+
+		uint64_t const count = mem_ops::readLE<64>(p + 8);
+
+		if (count == 0 || count != (size - detail_bloom::header_size) / detail_bloom::block_size || (size - detail_bloom::header_size) % detail_bloom::block_size != 0)
+		{
+			return false;
+		}
+
+		view = blocked_bloom_view(p + detail_bloom::header_size, static_cast<size_t>(count), mem_ops::readLE<64>(p + 16));
+		return true;
+	}
+
+	/* Copies a serialized filter. Returns false, leaving filter unchanged, if data is not one. */
+	inline bool parse_blocked_bloom(const void* data, size_t size, blocked_bloom& filter)
+	{
+		blocked_bloom_view view;
+
+		if (!parse_blocked_bloom(data, size, view))
+		{
+			return false;
+		}
+
+		blocked_bloom parsed(0, 1.0, view.seed());
+
+		parsed.blocks.resize(view.block_count());
+		memcpy(parsed.blocks.data(), static_cast<const uint8_t*>(data) + detail_bloom::header_size, parsed.size_bytes());
+		filter = std::move(parsed);
+		return true;
+	}
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Content-defined chunking for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Content-Defined Chunking
+	***************************************/
+
+	/* FastCDC style chunking: a gear hash, fp = (fp << 1) + gear[byte], rolls over the data from the start of each chunk, and the chunk ends
+	* after the first byte where the masked fingerprint is zero. Normalized chunking makes cuts harder before avg_size (mask of log2(avg) + normalization
+	* bits) and easier after it (log2(avg) - normalization bits), which narrows the size distribution. The masks take the top bits of fp,
+	* which depend on the last 64 bytes, so boundaries move with the content: an insertion only changes the chunks around it.
+	*/
+	struct cdc_options
+	{
+		/* min_size is at least 64, avg_size is rounded to a power of 2 and max_size is at least avg_size. */
+		size_t min_size = 2 * 1024;
+		size_t avg_size = 8 * 1024;
+		size_t max_size = 64 * 1024;
+		uint32_t normalization = 2;
+		/* seed of the chunk fingerprints; the boundaries do not depend on it */
+		uint64_t seed = 0;
+	};
+
+	struct cdc_chunk
+	{
+		uint64_t offset = 0;
+		size_t size = 0;
+		/* xxhash3<128>(chunk, size, seed) */
+		hash128_t fingerprint = {};
+	};
+
+	namespace detail_cdc
+	{
+		constexpr uint64_t splitmix64(uint64_t& state)
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+
+		constexpr std::array<uint64_t, 256> make_gear()
+		{
+			std::array<uint64_t, 256> table = {};
+			uint64_t state = 0x6765617220786868ULL;
+
+			for (size_t i = 0; i < table.size(); i++)
+			{
+				table[i] = splitmix64(state);
+			}
+
+			return table;
+		}
+
+		alignas(64) constexpr std::array<uint64_t, 256> gear = make_gear();
+
+		/* Bytes before the start of this window in a chunk are not rolled: fp only depends on the last 64 bytes. */
+		constexpr size_t warmup = 64;
+
+		/* Bytes scanned before they are fed to the chunk's hash state, small enough to still be in L1 by then. */
+		constexpr size_t window = 4096;
+
+		inline uint64_t top_mask(uint32_t bits)
+		{
+			return (bits == 0) ? 0 : (~0ULL << (64 - std::min<uint32_t>(bits, 64)));
+		}
+
+		inline uint32_t log2_rounded(size_t v)
+		{
+			uint32_t bits = 0;
+
+			while ((size_t(2) << bits) <= v)
+			{
+				bits++;
+			}
+
+			/* round to the nearer power of 2 */
+			return (bits < 63 && v - (size_t(1) << bits) >= (size_t(1) << bits) / 2) ? bits + 1 : bits;
+		}
+
+		XXH_FORCE_INLINE void roll(uint64_t& fp, const uint8_t* p, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				fp = (fp << 1) + gear[p[i]];
+			}
+		}
+
+		/* Rolls fp over up to n bytes and stops after the first one whose fingerprint has no bit of mask set. Returns the number of bytes consumed,
+		* and sets found. Four positions are tested per step: their fingerprints follow from the one before the step in closed form,
+		* fp_k = (fp << k) + sum_j gear[p_j] << (k - 1 - j), so the chain from step to step is a single shift and add
+		* and the rest of the work is independent.
+		*/
+		XXH_FORCE_INLINE size_t search(uint64_t& fp, const uint8_t* p, size_t n, uint64_t mask, bool& found)
+		{
+			size_t i = 0;
+
+			for (; i + 4 <= n; i += 4)
+			{
+				uint64_t const g0 = gear[p[i]];
+				uint64_t const g1 = gear[p[i + 1]];
+				uint64_t const g2 = gear[p[i + 2]];
+				uint64_t const g3 = gear[p[i + 3]];
+
+				uint64_t const h1 = (fp << 1) + g0;
+				uint64_t const h2 = (fp << 2) + (g0 << 1) + g1;
+				uint64_t const h3 = (fp << 3) + (g0 << 2) + (g1 << 1) + g2;
+				uint64_t const h4 = (fp << 4) + (g0 << 3) + (g1 << 2) + (g2 << 1) + g3;
+
+				if (((h1 & mask) == 0) | ((h2 & mask) == 0) | ((h3 & mask) == 0) | ((h4 & mask) == 0))
+				{
+					found = true;
+
+					if ((h1 & mask) == 0) { fp = h1; return i + 1; }
+					if ((h2 & mask) == 0) { fp = h2; return i + 2; }
+					if ((h3 & mask) == 0) { fp = h3; return i + 3; }
+					fp = h4;
+					return i + 4;
+				}
+
+				fp = h4;
+			}
+
+			for (; i < n; i++)
+			{
+				fp = (fp << 1) + gear[p[i]];
+
+				if ((fp & mask) == 0)
+				{
+					found = true;
+					return i + 1;
+				}
+			}
+
+			found = false;
+			return n;
+		}
+	}
+
+	/* Splits a byte stream into content-defined chunks and fingerprints each with xxhash3<128> in the same pass: the bytes of a window are
+	* scanned for a boundary, then fed to the chunk's hash state while still in L1, so memory is read once.
+	* Data can be passed in pieces of any size, chunk boundaries and fingerprints do not depend on how the stream is split.
+	*/
+	class cdc_chunker
+	{
+		size_t min_size;
+		size_t avg_size;
+		size_t max_size;
+		uint64_t seed;
+		uint64_t mask_small;
+		uint64_t mask_large;
+
+		hash3_state128_t state;
+		uint64_t fp = 0;
+		uint64_t chunk_offset = 0;
+		size_t chunk_size = 0;
+
+		template <typename F>
+		void emit(F& on_chunk)
+		{
+			cdc_chunk chunk;
+			chunk.offset = chunk_offset;
+			chunk.size = chunk_size;
+			chunk.fingerprint = state.digest();
+			on_chunk(static_cast<const cdc_chunk&>(chunk));
+
+			chunk_offset += chunk_size;
+			chunk_size = 0;
+			fp = 0;
+			state.reset(seed);
+		}
+
+	public:
+
+		explicit cdc_chunker(const cdc_options& options = cdc_options()) : seed(options.seed), state(options.seed)
+		{
+			uint32_t const bits = detail_cdc::log2_rounded(std::max<size_t>(options.avg_size, 1));
+
+			min_size = std::max(options.min_size, detail_cdc::warmup);
+			avg_size = std::max(size_t(1) << bits, min_size);
+			max_size = std::max(options.max_size, avg_size);
+			mask_small = detail_cdc::top_mask(bits + options.normalization);
+			mask_large = detail_cdc::top_mask(bits > options.normalization ? bits - options.normalization : 0);
+		}
+
+		/* Consumes len bytes and calls on_chunk(const cdc_chunk&) for each chunk completed by them. */
+		template <typename F>
+		void update(const void* input, size_t len, F&& on_chunk)
+		{
+			const uint8_t* p = static_cast<const uint8_t*>(input);
+			const uint8_t* const end = p + len;
+
+			while (p < end)
+			{
+				size_t const available = static_cast<size_t>(end - p);
+				size_t step;
+				bool cut = false;
+
+				if (chunk_size < min_size - detail_cdc::warmup)
+				{
+					/* no boundary possible yet, and too far from the first candidate for fp to matter: only hashed */
+					step = std::min(available, min_size - detail_cdc::warmup - chunk_size);
+				}
+				else if (chunk_size < min_size)
+				{
+					step = std::min(available, min_size - chunk_size);
+					detail_cdc::roll(fp, p, step);
+				}
+				else
+				{
+					uint64_t const mask = (chunk_size < avg_size) ? mask_small : mask_large;
+					size_t const limit = (chunk_size < avg_size) ? avg_size : max_size;
+
+					step = detail_cdc::search(fp, p, std::min({ available, limit - chunk_size, detail_cdc::window }), mask, cut);
+				}
+
+				state.update(p, step);
+				p += step;
+				chunk_size += step;
+
+				if (cut || chunk_size == max_size)
+				{
+					emit(on_chunk);
+				}
+			}
+		}
+
+		/* Ends the stream: the bytes since the last boundary, if any, form the last chunk. The chunker can then be reused for a new stream. */
+		template <typename F>
+		void finish(F&& on_chunk)
+		{
+			if (chunk_size > 0)
+			{
+				emit(on_chunk);
+			}
+
+			chunk_offset = 0;
+		}
+	};
+
+	/* Chunks and fingerprints a buffer in one call. */
+	inline std::vector<cdc_chunk> cdc_chunks(const void* data, size_t len, const cdc_options& options = cdc_options())
+	{
+		std::vector<cdc_chunk> chunks;
+		cdc_chunker chunker(options);
+		auto const collect = [&chunks](const cdc_chunk& chunk) { chunks.push_back(chunk); };
+
+		chunker.update(data, len, collect);
+		chunker.finish(collect);
+		return chunks;
+	}
+}
@@ -0,0 +1,519 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_flat_map.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Concurrent hash map for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Concurrent Hash Map
+	***************************************/
+
+	namespace detail_concurrent
+	{
+		/* Low bit of a slot: the slot has been migrated to the next table and takes no more insertions. */
+		constexpr uintptr_t moved = 1;
+
+		/* Slots migrated by a thread at a time, in between its own operations. */
+		constexpr size_t copy_chunk = 256;
+
+		constexpr size_t min_capacity = 64;
+	}
+
+	/* A hash map for many threads inserting and looking up at once, e.g. counters shared by the threads of a metrics aggregator.
+	* The map is split into segments, picked by the high bits of xxhash3<64> of the key, each a linear probing table of node pointers.
+	* Lookups take no lock and write nothing. An insertion claims an empty slot with a single compare-and-swap.
+	* Elements are nodes that never move: values are updated in place through the returned pointers, e.g. as std::atomic counters, and stay
+	* valid while tables grow. There is no erase: nodes are only freed by clear() or the destructor, which is what makes lock-free lookups
+	* safe without hazard pointers or epochs. Retired tables are kept until then as well, at most doubling the memory of the slots.
+	* Growing is cooperative and incremental: once a table is 3/4 full a table twice as large is linked behind it, and every insertion then
+	* moves one chunk of 256 slots before doing its own work. A migrated slot keeps its node, marked, so probes still walk past it,
+	* while insertions that reach a migrated empty slot continue in the next table. No thread ever copies a whole table.
+	*/
+	template <typename K, typename V, typename Hash = flat_hash<K>, typename KeyEqual = std::equal_to<>>
+	class concurrent_map
+	{
+	public:
+
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<const K, V>;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+
+	private:
+
+		struct node
+		{
+			uint64_t hash;
+			value_type value;
+
+			template <typename... Args>
+			node(uint64_t hash_, Args&&... args) : hash(hash_), value(std::forward<Args>(args)...) {}
+		};
+
+		struct slot
+		{
+			/* node pointer, with the moved bit */
+			std::atomic<uintptr_t> ptr{ 0 };
+			/* hash of the node, 0 until written: a filter that saves dereferencing most nodes of other keys */
+			std::atomic<uint64_t> hash{ 0 };
+		};
+
+		struct table
+		{
+			size_t const capacity;
+			std::unique_ptr<slot[]> slots;
+			std::atomic<table*> next{ nullptr };
+			std::atomic<bool> growing{ false };
+			/* first slot not claimed for migration yet, and slots migrated so far */
+			std::atomic<size_t> copy_cursor{ 0 };
+			std::atomic<size_t> copied{ 0 };
+
+			explicit table(size_t capacity_) : capacity(capacity_), slots(new slot[capacity_]) {}
+		};
+
+		struct alignas(64) segment
+		{
+			std::atomic<table*> current{ nullptr };
+			std::atomic<size_t> elements{ 0 };
+			/* every table of the segment, retired ones included; only locked when a table is created */
+			std::mutex tables_mutex;
+			std::vector<std::unique_ptr<table>> tables;
+		};
+
+		uint32_t segment_bits;
+		std::unique_ptr<segment[]> segments;
+		Hash hash_fn;
+		KeyEqual eq_fn;
+
+		static node* node_of(uintptr_t p)
+		{
+			return reinterpret_cast<node*>(p & ~detail_concurrent::moved);
+		}
+
+		segment& segment_of(uint64_t h) const
+		{
+			return segments[static_cast<size_t>(h >> (64 - segment_bits))];
+		}
+
+		size_t segment_count() const
+		{
+			return size_t(1) << segment_bits;
+		}
+
+		static table* add_table(segment& seg, size_t capacity)
+		{
+			std::lock_guard<std::mutex> lock(seg.tables_mutex);
+			seg.tables.push_back(std::make_unique<table>(capacity));
+			return seg.tables.back().get();
+		}
+
+		/* Links a larger table behind t, unless another thread does. */
+		static void start_growing(segment& seg, table* t)
+		{
+			if (!t->growing.exchange(true, std::memory_order_acq_rel))
+			{
+				t->next.store(add_table(seg, 2 * t->capacity), std::memory_order_release);
+			}
+		}
+
+		/* The table after t, waiting for it if another thread is creating it. Only needed when t is full. */
+		static table* next_table(segment& seg, table* t)
+		{
+			start_growing(seg, t);
+
+			table* next;
+
+			while ((next = t->next.load(std::memory_order_acquire)) == nullptr)
+			{
+				std::this_thread::yield();
+			}
+
+			return next;
+		}
+
+		/* Makes the first table that still has slots to migrate current. */
+		static void advance_current(segment& seg)
+		{
+			table* t = seg.current.load(std::memory_order_acquire);
+
+			while (t->copied.load(std::memory_order_acquire) == t->capacity)
+			{
+				table* const next = t->next.load(std::memory_order_acquire);
+
+				seg.current.compare_exchange_strong(t, next, std::memory_order_acq_rel);
+				t = seg.current.load(std::memory_order_acquire);
+			}
+		}
+
+		/* Inserts a node taken from an older table. Its key cannot be in u under another node: any insertion of that key would have found it first. */
+		static void copy_node(segment& seg, table* u, node* n)
+		{
+			while (true)
+			{
+				size_t const mask = u->capacity - 1;
+				size_t i = static_cast<size_t>(n->hash) & mask;
+				size_t probes = 0;
+				uintptr_t p = 0;
+
+				for (; probes < u->capacity; probes++, i = (i + 1) & mask)
+				{
+					slot& s = u->slots[i];
+					p = s.ptr.load(std::memory_order_acquire);
+
+					if (p == 0 && s.ptr.compare_exchange_strong(p, reinterpret_cast<uintptr_t>(n), std::memory_order_acq_rel))
+					{
+						s.hash.store(n->hash, std::memory_order_relaxed);
+						return;
+					}
+
+					/* p holds what the slot has now */
+					if (p == detail_concurrent::moved)
+					{
+						break;
+					}
+
+					if (node_of(p) == n)
+					{
+						return;
+					}
+				}
+
+				u = (p == detail_concurrent::moved) ? u->next.load(std::memory_order_acquire) : next_table(seg, u);
+			}
+		}
+
+		/* Migrates one chunk of t, and makes the next table current once all of t has been. */
+		static void help_migrate(segment& seg, table* t)
+		{
+			size_t const first = t->copy_cursor.fetch_add(detail_concurrent::copy_chunk, std::memory_order_relaxed);
+
+			if (first >= t->capacity)
+			{
+				return;
+			}
+
+			table* const next = t->next.load(std::memory_order_acquire);
+			size_t const last = std::min(first + detail_concurrent::copy_chunk, t->capacity);
+
+			for (size_t i = first; i < last; i++)
+			{
+				uintptr_t p = t->slots[i].ptr.load(std::memory_order_acquire);
+
+				while (!t->slots[i].ptr.compare_exchange_weak(p, p | detail_concurrent::moved, std::memory_order_acq_rel))
+				{
+				}
+
+				if (p != 0)
+				{
+					copy_node(seg, next, node_of(p));
+				}
+			}
+
+			if (t->copied.fetch_add(last - first, std::memory_order_acq_rel) + (last - first) == t->capacity)
+			{
+				advance_current(seg);
+			}
+		}
+
+		template <typename Q>
+		node* find_node(const Q& key, uint64_t h) const
+		{
+			table* t = segment_of(h).current.load(std::memory_order_acquire);
+
+			while (t != nullptr)
+			{
+				size_t const mask = t->capacity - 1;
+				size_t i = static_cast<size_t>(h) & mask;
+				size_t probes = 0;
+
+				for (; probes < t->capacity; probes++, i = (i + 1) & mask)
+				{
+					const slot& s = t->slots[i];
+					uintptr_t const p = s.ptr.load(std::memory_order_acquire);
+
+					if (p == 0)
+					{
+						return nullptr;
+					}
+
+					if (p == detail_concurrent::moved)
+					{
+						break;
+					}
+
+					uint64_t const sh = s.hash.load(std::memory_order_relaxed);
+
+					if (sh != 0 && sh != h)
+					{
+						continue;
+					}
+
+					node* const n = node_of(p);
+
+					if (n->hash == h && eq_fn(n->value.first, key))
+					{
+						return n;
+					}
+				}
+
+				/* a migrated empty slot, or a full table: the key can only have been inserted further on */
+				t = t->next.load(std::memory_order_acquire);
+			}
+
+			return nullptr;
+		}
+
+		template <typename KeyArg, typename... Args>
+		std::pair<V*, bool> emplace_key(KeyArg&& key, Args&&... args)
+		{
+			uint64_t const h = hash_fn(key);
+			segment& seg = segment_of(h);
+			table* t = seg.current.load(std::memory_order_acquire);
+			/* built at the first empty slot, and freed if another thread inserts the key first */
+			node* fresh = nullptr;
+
+			auto matches = [&](const node* n) {
+				return n->hash == h && (fresh ? eq_fn(n->value.first, fresh->value.first) : eq_fn(n->value.first, key));
+			};
+
+			while (true)
+			{
+				if (t->next.load(std::memory_order_acquire) != nullptr)
+				{
+					help_migrate(seg, t);
+				}
+
+				size_t const mask = t->capacity - 1;
+				size_t i = static_cast<size_t>(h) & mask;
+				size_t probes = 0;
+				uintptr_t p = 0;
+
+				while (probes < t->capacity)
+				{
+					slot& s = t->slots[i];
+					p = s.ptr.load(std::memory_order_acquire);
+
+					if (p == 0)
+					{
+						if (!fresh)
+						{
+							fresh = new node(h, std::piecewise_construct, std::forward_as_tuple(std::forward<KeyArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+						}
+
+						if (s.ptr.compare_exchange_strong(p, reinterpret_cast<uintptr_t>(fresh), std::memory_order_acq_rel))
+						{
+							s.hash.store(h, std::memory_order_relaxed);
+
+							if (4 * (seg.elements.fetch_add(1, std::memory_order_relaxed) + 1) > 3 * t->capacity)
+							{
+								start_growing(seg, t);
+							}
+
+							return { &fresh->value.second, true };
+						}
+					}
+
+					/* p holds what the slot has now */
+					if (p == detail_concurrent::moved)
+					{
+						break;
+					}
+
+					if (p != 0)
+					{
+						uint64_t const sh = s.hash.load(std::memory_order_relaxed);
+
+						if ((sh == 0 || sh == h) && matches(node_of(p)))
+						{
+							delete fresh;
+							return { &node_of(p)->value.second, false };
+						}
+
+						i = (i + 1) & mask;
+						probes++;
+					}
+				}
+
+				t = (p == detail_concurrent::moved) ? t->next.load(std::memory_order_acquire) : next_table(seg, t);
+			}
+		}
+
+		/* Completes every migration. Only with no other thread using the map. */
+		void settle()
+		{
+			for (size_t k = 0; k < segment_count(); k++)
+			{
+				segment& seg = segments[k];
+				table* t;
+
+				while ((t = seg.current.load(std::memory_order_acquire))->next.load(std::memory_order_acquire) != nullptr)
+				{
+					help_migrate(seg, t);
+				}
+			}
+		}
+
+		void free_all()
+		{
+			settle();
+
+			for (size_t k = 0; k < segment_count(); k++)
+			{
+				table* const t = segments[k].current.load(std::memory_order_relaxed);
+
+				for (size_t i = 0; i < t->capacity; i++)
+				{
+					delete node_of(t->slots[i].ptr.load(std::memory_order_relaxed));
+				}
+
+				segments[k].tables.clear();
+			}
+		}
+
+		void init_segments(size_t expected)
+		{
+			size_t capacity = detail_concurrent::min_capacity;
+
+			while (4 * expected > 3 * capacity * segment_count())
+			{
+				capacity *= 2;
+			}
+
+			for (size_t k = 0; k < segment_count(); k++)
+			{
+				segments[k].elements.store(0, std::memory_order_relaxed);
+				segments[k].current.store(add_table(segments[k], capacity), std::memory_order_release);
+			}
+		}
+
+	public:
+
+		/* segments is rounded up to a power of 2, from 2 to 65536. More segments spread the element counters and growing work further. */
+		explicit concurrent_map(size_t expected = 0, size_t segments_ = 64, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual())
+			: segment_bits(1), hash_fn(hash), eq_fn(equal)
+		{
+			while (segment_bits < 16 && (size_t(1) << segment_bits) < segments_)
+			{
+				segment_bits++;
+			}
+
+			segments.reset(new segment[segment_count()]);
+			init_segments(expected);
+		}
+
+		concurrent_map(const concurrent_map&) = delete;
+		concurrent_map& operator=(const concurrent_map&) = delete;
+
+		~concurrent_map()
+		{
+			free_all();
+		}
+
+		/* Pointer to the value of key, or nullptr. Lock-free, and wait-free while no table of the segment is growing. */
+		V* find(const K& key) const
+		{
+			node* const n = find_node(key, hash_fn(key));
+			return n ? &n->value.second : nullptr;
+		}
+
+		/* Heterogeneous lookup, e.g. by std::string_view in a map of std::string. */
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		V* find(const Q& key) const
+		{
+			node* const n = find_node(key, hash_fn(key));
+			return n ? &n->value.second : nullptr;
+		}
+
+		bool contains(const K& key) const
+		{
+			return find(key) != nullptr;
+		}
+
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		bool contains(const Q& key) const
+		{
+			return find(key) != nullptr;
+		}
+
+		/* Inserts key with a value built from args, unless it is present. Returns the value either way, and whether it was inserted.
+		* If another thread inserts the same key at the same time, exactly one of them inserts and both get the same value.
+		*/
+		template <typename... Args>
+		std::pair<V*, bool> try_emplace(const K& key, Args&&... args)
+		{
+			return emplace_key(key, std::forward<Args>(args)...);
+		}
+
+		template <typename... Args>
+		std::pair<V*, bool> try_emplace(K&& key, Args&&... args)
+		{
+			return emplace_key(std::move(key), std::forward<Args>(args)...);
+		}
+
+		/* Number of elements. Exact once insertions have returned, approximate while they run. */
+		size_t size() const
+		{
+			size_t total = 0;
+
+			for (size_t k = 0; k < segment_count(); k++)
+			{
+				total += segments[k].elements.load(std::memory_order_relaxed);
+			}
+
+			return total;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		/* Calls f(const K&, V&) for every element. Not concurrent with insertions: it finishes pending migrations first. */
+		template <typename F>
+		void for_each(F&& f)
+		{
+			settle();
+
+			for (size_t k = 0; k < segment_count(); k++)
+			{
+				table* const t = segments[k].current.load(std::memory_order_acquire);
+
+				for (size_t i = 0; i < t->capacity; i++)
+				{
+					if (node* const n = node_of(t->slots[i].ptr.load(std::memory_order_acquire)))
+					{
+						f(static_cast<const K&>(n->value.first), n->value.second);
+					}
+				}
+			}
+		}
+
+		/* Frees every element and retired table. Not concurrent with any other use of the map. */
+		void clear()
+		{
+			free_all();
+			init_segments(0);
+		}
+	};
+}
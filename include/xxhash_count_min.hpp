@@ -0,0 +1,271 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Count-Min sketches for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Count-Min Sketches
+	***************************************/
+
+	namespace detail_count_min
+	{
+		/* 32 bit counters per cache line, which holds the counters of every row for the keys mapped to it. */
+		constexpr size_t line_counters = 16;
+
+		/* Keys hashed, and lines prefetched, ahead of the batch functions using them. */
+		constexpr size_t batch = 16;
+
+		struct alignas(64) line
+		{
+			uint32_t counters[line_counters];
+		};
+
+		inline uint32_t saturating_add(uint32_t a, uint32_t b)
+		{
+			uint32_t const sum = a + b;
+			return (sum < a) ? std::numeric_limits<uint32_t>::max() : sum;
+		}
+	}
+
+	/* A Count-Min sketch: estimates how often each key was added, never below the true count, in D rows of W 32 bit counters.
+	* A key is hashed once with xxhash3<128>(key, seed). low64 picks a cache line, and high64 gives the key one counter of each row
+	* inside it: a line holds 16 / D consecutive counters of every row, so an update or a query touches one line instead of D.
+	* Each row overestimates a key by about N / W on average for N adds in total, as with separate rows, but rows sharing a line
+	* are not independent, so the worst case bounds are weaker than the usual e N / W with probability 1 - e^-D.
+	* Conservative update only raises the counters of a key that are below its new minimum, which keeps the estimates of rare keys
+	* much closer in skewed streams. Sketches with the same shape and seed, one per thread, add up into the sketch of all their updates.
+	*/
+	template <size_t W, size_t D>
+	class count_min
+	{
+		static_assert(D >= 1 && detail_count_min::line_counters % D == 0, "count_min depth must divide 16: 1, 2, 4, 8 or 16 rows");
+
+		static constexpr size_t row_slots = detail_count_min::line_counters / D;
+		static constexpr uint32_t slot_bits = (row_slots >= 16) ? 4 : (row_slots >= 8) ? 3 : (row_slots >= 4) ? 2 : (row_slots >= 2) ? 1 : 0;
+
+		static_assert(W >= row_slots && W % row_slots == 0, "count_min width must be a multiple of 16 / D");
+
+		static constexpr size_t line_count = W / row_slots;
+
+		std::vector<detail_count_min::line> lines;
+		uint64_t seed_;
+		uint64_t total_ = 0;
+		bool conservative_;
+
+		uint32_t* line_for(hash128_t h)
+		{
+			return lines[static_cast<size_t>(bit_ops::mul64to128(h.low64, line_count).high64)].counters;
+		}
+
+		const uint32_t* line_for(hash128_t h) const
+		{
+			return lines[static_cast<size_t>(bit_ops::mul64to128(h.low64, line_count).high64)].counters;
+		}
+
+		static size_t slot(hash128_t h, size_t row)
+		{
+			return row * row_slots + static_cast<size_t>((h.high64 >> (row * slot_bits)) & (row_slots - 1));
+		}
+
+		void update(uint32_t* c, hash128_t h, uint32_t count)
+		{
+			if (!conservative_)
+			{
+				for (size_t r = 0; r < D; r++)
+				{
+					uint32_t& counter = c[slot(h, r)];
+					counter = detail_count_min::saturating_add(counter, count);
+				}
+
+				return;
+			}
+
+			uint32_t const target = detail_count_min::saturating_add(min_of(c, h), count);
+
+			for (size_t r = 0; r < D; r++)
+			{
+				uint32_t& counter = c[slot(h, r)];
+				counter = std::max(counter, target);
+			}
+		}
+
+		static uint32_t min_of(const uint32_t* c, hash128_t h)
+		{
+			uint32_t m = c[slot(h, 0)];
+
+			for (size_t r = 1; r < D; r++)
+			{
+				m = std::min(m, c[slot(h, r)]);
+			}
+
+			return m;
+		}
+
+	public:
+
+		static constexpr size_t width = W;
+		static constexpr size_t depth = D;
+
+		explicit count_min(uint64_t seed = 0, bool conservative = true) : lines(line_count, detail_count_min::line{}), seed_(seed), conservative_(conservative)
+		{
+		}
+
+		void add_hash(hash128_t h, uint32_t count = 1)
+		{
+			update(line_for(h), h, count);
+			total_ += count;
+		}
+
+		/* count has no default here, so that add("key", n) is the string overload. */
+		void add(const void* key, size_t len, uint32_t count)
+		{
+			add_hash(xxhash3<128>(key, len, seed_), count);
+		}
+
+		void add(std::string_view key, uint32_t count = 1)
+		{
+			add(key.data(), key.size(), count);
+		}
+
+		/* Adds 1 for every hash, prefetching the lines of a batch before updating any of them. */
+		void add_many(const hash128_t* hashes, size_t n)
+		{
+			uint32_t* at[detail_count_min::batch];
+
+			for (size_t first = 0; first < n; first += detail_count_min::batch)
+			{
+				size_t const m = std::min(detail_count_min::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					at[k] = line_for(hashes[first + k]);
+					intrin::prefetch(at[k]);
+				}
+
+				for (size_t k = 0; k < m; k++)
+				{
+					update(at[k], hashes[first + k], 1);
+				}
+			}
+
+			total_ += n;
+		}
+
+		void add_many(const std::string_view* keys, size_t n)
+		{
+			hash128_t h[detail_count_min::batch];
+
+			for (size_t first = 0; first < n; first += detail_count_min::batch)
+			{
+				size_t const m = std::min(detail_count_min::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					h[k] = xxhash3<128>(keys[first + k].data(), keys[first + k].size(), seed_);
+				}
+
+				add_many(h, m);
+			}
+		}
+
+		uint32_t estimate_hash(hash128_t h) const
+		{
+			return min_of(line_for(h), h);
+		}
+
+		uint32_t estimate(const void* key, size_t len) const
+		{
+			return estimate_hash(xxhash3<128>(key, len, seed_));
+		}
+
+		uint32_t estimate(std::string_view key) const
+		{
+			return estimate(key.data(), key.size());
+		}
+
+		void estimate_many(const std::string_view* keys, size_t n, uint32_t* out) const
+		{
+			hash128_t h[detail_count_min::batch];
+
+			for (size_t first = 0; first < n; first += detail_count_min::batch)
+			{
+				size_t const m = std::min(detail_count_min::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					h[k] = xxhash3<128>(keys[first + k].data(), keys[first + k].size(), seed_);
+					intrin::prefetch(line_for(h[k]));
+				}
+
+				for (size_t k = 0; k < m; k++)
+				{
+					out[first + k] = estimate_hash(h[k]);
+				}
+			}
+		}
+
+		/* Adds the counters of other, as if its updates had been made here. Returns false, changing nothing, if the seeds differ.
+		* Merged conservative sketches still never underestimate, though they are less tight than one sketch fed both streams.
+		*/
+		bool merge(const count_min& other)
+		{
+			if (other.seed_ != seed_)
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < line_count; i++)
+			{
+				for (size_t k = 0; k < detail_count_min::line_counters; k++)
+				{
+					lines[i].counters[k] = detail_count_min::saturating_add(lines[i].counters[k], other.lines[i].counters[k]);
+				}
+			}
+
+			total_ += other.total_;
+			return true;
+		}
+
+		void clear()
+		{
+			std::fill(lines.begin(), lines.end(), detail_count_min::line{});
+			total_ = 0;
+		}
+
+		/* Sum of all counts added, the N of the error bounds. */
+		uint64_t total() const
+		{
+			return total_;
+		}
+
+		bool conservative() const
+		{
+			return conservative_;
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+
+		size_t size_bytes() const
+		{
+			return lines.size() * sizeof(detail_count_min::line);
+		}
+	};
+}
@@ -0,0 +1,391 @@
+#pragma once
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Cuckoo filters for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Cuckoo Filters
+	***************************************/
+
+	namespace detail_cuckoo
+	{
+		/* Fingerprints per bucket. */
+		constexpr size_t bucket_slots = 4;
+
+		/* Buckets are filled to this share of their slots when sizing for a capacity; 4 way buckets reach about 95% before inserts fail. */
+		constexpr double target_load = 0.94;
+
+		/* Evictions tried by an insert before it gives up. */
+		constexpr size_t max_kicks = 500;
+
+		/* Keys hashed, and buckets prefetched, ahead of the batch lookups probing them. */
+		constexpr size_t batch = 16;
+
+		/* Both candidate buckets of a key are compared in one SSE2 register when there is one, in 64 bit words otherwise. */
+		constexpr size_t lane_bits = (intrin::vector_mode >= 1) ? 128 : 64;
+
+		/* The partial key step: the other bucket of a fingerprint is found from the fingerprint alone, so entries move without their keys. */
+		inline size_t alternate(size_t bucket, uint64_t fingerprint, size_t mask)
+		{
+			return (bucket ^ static_cast<size_t>(fingerprint * 0x5BD1E995u)) & mask;
+		}
+
+		/* Lanes of x equal to zero, as the usual test on a 64 bit word of Bits wide lanes. Exact as a yes or no. */
+		template <size_t Bits>
+		inline bool has_zero(uint64_t x)
+		{
+			constexpr uint64_t lsbs = (Bits == 8) ? 0x0101010101010101ULL : 0x0001000100010001ULL;
+			return ((x - lsbs) & ~x & (lsbs << (Bits - 1))) != 0;
+		}
+
+		/* Whether either bucket holds fp. A bucket is 4 little endian fingerprints of Bits bits. */
+		template <size_t N, size_t Bits>
+		XXH_FORCE_INLINE bool match2(const uint8_t* b1, const uint8_t* b2, uint64_t fp)
+		{
+			static_assert(!(N != 128 && N != 64), "Invalid template argument passed to xxh::detail_cuckoo::match2");
+
+			if constexpr (Bits == 8)
+			{
+				/* both buckets fit one word */
+				uint64_t const x = mem_ops::readLE<32>(b1) | (static_cast<uint64_t>(mem_ops::readLE<32>(b2)) << 32);
+				return has_zero<8>(x ^ (fp * 0x0101010101010101ULL));
+			}
+			else if constexpr (N == 128)
+			{
+				__m128i const buckets = _mm_set_epi64x(static_cast<long long>(mem_ops::readLE<64>(b2)), static_cast<long long>(mem_ops::readLE<64>(b1)));
+				return _mm_movemask_epi8(_mm_cmpeq_epi16(buckets, _mm_set1_epi16(static_cast<short>(fp)))) != 0;
+			}
+			else
+			{
+				uint64_t const pattern = fp * 0x0001000100010001ULL;
+				return has_zero<16>(mem_ops::readLE<64>(b1) ^ pattern) || has_zero<16>(mem_ops::readLE<64>(b2) ^ pattern);
+			}
+		}
+	}
+
+	/* A cuckoo filter: approximate set membership, like a Bloom filter, that also supports deletion.
+	* A key is hashed once with xxhash3<64>(key, seed): the top Bits bits give its fingerprint (0 is kept for empty slots), the low bits its
+	* first bucket, and the second bucket is the first xor a hash of the fingerprint. Each bucket has 4 slots of Bits = 8 or 16 bits. A lookup
+	* compares the fingerprint with the 8 slots of both buckets at once; an insert that finds both full evicts a fingerprint to its own other
+	* bucket, and so on, up to 500 times. When that fails too the last evicted fingerprint is kept aside and further inserts return false.
+	* False positives are about 8 / 2^Bits: 3% with 8 bits, 0.012% with 16. A key inserted more than once must be removed as many times,
+	* and removing a key never inserted may remove another key sharing its fingerprint and buckets.
+	*/
+	template <size_t Bits = 16>
+	class cuckoo_filter
+	{
+		static_assert(Bits == 8 || Bits == 16, "cuckoo_filter fingerprints are 8 or 16 bits");
+
+		static constexpr size_t fp_bytes = Bits / 8;
+		static constexpr size_t bucket_bytes = detail_cuckoo::bucket_slots * fp_bytes;
+
+		std::vector<uint8_t> table;
+		size_t mask;
+		size_t count = 0;
+		uint64_t seed_;
+		uint64_t rng;
+
+		/* a fingerprint that found no slot, kept aside with one of its buckets */
+		bool has_victim = false;
+		uint64_t victim_fp = 0;
+		size_t victim_bucket = 0;
+
+		struct position
+		{
+			uint64_t fp;
+			size_t b1;
+			size_t b2;
+		};
+
+		position locate(uint64_t h) const
+		{
+			uint64_t fp = h >> (64 - Bits);
+			fp += (fp == 0) ? 1 : 0;
+
+			size_t const b1 = static_cast<size_t>(h) & mask;
+			return { fp, b1, detail_cuckoo::alternate(b1, fp, mask) };
+		}
+
+		uint8_t* bucket(size_t b)
+		{
+			return table.data() + b * bucket_bytes;
+		}
+
+		const uint8_t* bucket(size_t b) const
+		{
+			return table.data() + b * bucket_bytes;
+		}
+
+		static uint64_t read_slot(const uint8_t* p, size_t slot)
+		{
+			return (Bits == 8) ? p[slot] : (p[2 * slot] | (static_cast<uint64_t>(p[2 * slot + 1]) << 8));
+		}
+
+		static void write_slot(uint8_t* p, size_t slot, uint64_t fp)
+		{
+			for (size_t i = 0; i < fp_bytes; i++)
+			{
+				p[fp_bytes * slot + i] = static_cast<uint8_t>(fp >> (8 * i));
+			}
+		}
+
+		bool place(size_t b, uint64_t fp)
+		{
+			uint8_t* const p = bucket(b);
+
+			for (size_t s = 0; s < detail_cuckoo::bucket_slots; s++)
+			{
+				if (read_slot(p, s) == 0)
+				{
+					write_slot(p, s, fp);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool unplace(size_t b, uint64_t fp)
+		{
+			uint8_t* const p = bucket(b);
+
+			for (size_t s = 0; s < detail_cuckoo::bucket_slots; s++)
+			{
+				if (read_slot(p, s) == fp)
+				{
+					write_slot(p, s, 0);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		uint64_t next_random()
+		{
+			rng ^= rng << 13;
+			rng ^= rng >> 7;
+			rng ^= rng << 17;
+			return rng;
+		}
+
+		/* Evicts fingerprints along a random walk until one finds a free slot; the last one that did not is kept as the victim. */
+		void relocate(size_t b, uint64_t fp)
+		{
+			for (size_t kick = 0; kick < detail_cuckoo::max_kicks; kick++)
+			{
+				size_t const s = static_cast<size_t>(next_random() % detail_cuckoo::bucket_slots);
+				uint8_t* const p = bucket(b);
+				uint64_t const evicted = read_slot(p, s);
+
+				write_slot(p, s, fp);
+				fp = evicted;
+				b = detail_cuckoo::alternate(b, fp, mask);
+
+				if (place(b, fp))
+				{
+					return;
+				}
+			}
+
+			has_victim = true;
+			victim_fp = fp;
+			victim_bucket = b;
+		}
+
+		bool victim_matches(const position& at) const
+		{
+			return has_victim && victim_fp == at.fp && (victim_bucket == at.b1 || victim_bucket == at.b2);
+		}
+
+	public:
+
+		/* Room for about capacity keys, in a power of 2 buckets. */
+		explicit cuckoo_filter(size_t capacity = 0, uint64_t seed = 0) : seed_(seed), rng(seed ^ 0x9E3779B97F4A7C15ULL)
+		{
+			size_t const wanted = static_cast<size_t>(static_cast<double>(capacity) / (detail_cuckoo::bucket_slots * detail_cuckoo::target_load)) + 1;
+			size_t buckets = 1;
+
+			while (buckets < wanted)
+			{
+				buckets *= 2;
+			}
+
+			table.assign(buckets * bucket_bytes, 0);
+			mask = buckets - 1;
+		}
+
+		/* Returns false, changing nothing, when the filter is full. */
+		bool insert_hash(uint64_t h)
+		{
+			if (has_victim)
+			{
+				return false;
+			}
+
+			position const at = locate(h);
+			count++;
+
+			if (place(at.b1, at.fp) || place(at.b2, at.fp))
+			{
+				return true;
+			}
+
+			relocate((next_random() & 1) ? at.b1 : at.b2, at.fp);
+			return true;
+		}
+
+		bool insert(const void* key, size_t len)
+		{
+			return insert_hash(xxhash3<64>(key, len, seed_));
+		}
+
+		bool insert(std::string_view key)
+		{
+			return insert(key.data(), key.size());
+		}
+
+		bool contains_hash(uint64_t h) const
+		{
+			position const at = locate(h);
+			return detail_cuckoo::match2<detail_cuckoo::lane_bits, Bits>(bucket(at.b1), bucket(at.b2), at.fp) || victim_matches(at);
+		}
+
+		bool contains(const void* key, size_t len) const
+		{
+			return contains_hash(xxhash3<64>(key, len, seed_));
+		}
+
+		bool contains(std::string_view key) const
+		{
+			return contains(key.data(), key.size());
+		}
+
+		/* Removes one copy of the fingerprint of the key. Returns false if there was none. */
+		bool remove_hash(uint64_t h)
+		{
+			position const at = locate(h);
+
+			if (victim_matches(at))
+			{
+				has_victim = false;
+				count--;
+				return true;
+			}
+
+			if (!unplace(at.b1, at.fp) && !unplace(at.b2, at.fp))
+			{
+				return false;
+			}
+
+			count--;
+
+			/* the freed slot may be the one the victim was missing */
+			if (has_victim)
+			{
+				has_victim = false;
+				count--;
+				insert_hash(static_cast<uint64_t>(victim_bucket) | (victim_fp << (64 - Bits)));
+			}
+
+			return true;
+		}
+
+		bool remove(const void* key, size_t len)
+		{
+			return remove_hash(xxhash3<64>(key, len, seed_));
+		}
+
+		bool remove(std::string_view key)
+		{
+			return remove(key.data(), key.size());
+		}
+
+		void contains_many(const uint64_t* hashes, size_t n, bool* out) const
+		{
+			position at[detail_cuckoo::batch];
+
+			for (size_t first = 0; first < n; first += detail_cuckoo::batch)
+			{
+				size_t const m = std::min(detail_cuckoo::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					at[k] = locate(hashes[first + k]);
+					intrin::prefetch(bucket(at[k].b1));
+					intrin::prefetch(bucket(at[k].b2));
+				}
+
+				for (size_t k = 0; k < m; k++)
+				{
+					out[first + k] = detail_cuckoo::match2<detail_cuckoo::lane_bits, Bits>(bucket(at[k].b1), bucket(at[k].b2), at[k].fp) || victim_matches(at[k]);
+				}
+			}
+		}
+
+		/* Hashes a batch of keys, with no dependency from one to the next, then looks the batch up with its buckets prefetched. */
+		void contains_many(const std::string_view* keys, size_t n, bool* out) const
+		{
+			uint64_t h[detail_cuckoo::batch];
+
+			for (size_t first = 0; first < n; first += detail_cuckoo::batch)
+			{
+				size_t const m = std::min(detail_cuckoo::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					h[k] = xxhash3<64>(keys[first + k].data(), keys[first + k].size(), seed_);
+				}
+
+				contains_many(h, m, out + first);
+			}
+		}
+
+		void clear()
+		{
+			std::fill(table.begin(), table.end(), static_cast<uint8_t>(0));
+			count = 0;
+			has_victim = false;
+		}
+
+		size_t size() const
+		{
+			return count;
+		}
+
+		/* Slots in the table: inserts start failing somewhat before all of them are used. */
+		size_t slot_count() const
+		{
+			return (mask + 1) * detail_cuckoo::bucket_slots;
+		}
+
+		double load_factor() const
+		{
+			return static_cast<double>(count) / static_cast<double>(slot_count());
+		}
+
+		size_t size_bytes() const
+		{
+			return table.size();
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+	};
+}
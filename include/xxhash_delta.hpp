@@ -0,0 +1,657 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+rsync-style deltas for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Delta Encoding
+	***************************************/
+
+	/* The receiver, which holds the old version (the basis), sends a signature: a weak rolling checksum and an xxhash3<64> of every block.
+	* The sender looks for those blocks at every offset of the new version (the target) and answers with a delta: copies of basis blocks
+	* and literal bytes. Weak checksums, rsync's, are updated in constant time per byte; only weak matches are confirmed with xxhash3.
+	*/
+	struct delta_options
+	{
+		size_t block_size = 2048;
+		uint64_t seed = 0;
+	};
+
+	struct delta_signature
+	{
+		uint64_t block_size = 0;
+		uint64_t seed = 0;
+		/* length of the basis; its last block may be shorter than block_size */
+		uint64_t length = 0;
+		std::vector<uint32_t> weak;
+		std::vector<hash64_t> strong;
+
+		uint64_t block_count() const
+		{
+			return strong.size();
+		}
+	};
+
+	/* Copies length bytes of the basis from offset, or takes length bytes of the delta's literals from offset. */
+	struct delta_op
+	{
+		bool copy = false;
+		uint64_t offset = 0;
+		uint64_t length = 0;
+	};
+
+	struct delta
+	{
+		uint64_t target_length = 0;
+		std::vector<delta_op> ops;
+		std::vector<uint8_t> literals;
+
+		/* bytes of the target that are sent as is */
+		uint64_t literal_bytes() const
+		{
+			return literals.size();
+		}
+	};
+
+	namespace detail_delta
+	{
+		constexpr uint8_t signature_magic[4] = { 'X', 'X', 'H', 'S' };
+		constexpr uint8_t delta_magic[4] = { 'X', 'X', 'H', 'D' };
+		constexpr uint32_t format_version = 1;
+
+		/* Windows confirmed together with xxhash3 when a run of blocks matches, with interleaved accumulators. */
+		constexpr size_t batch = 4;
+
+		/* rsync's checksum: a is the sum of the bytes, b the sum of the running sums, each kept to 16 bits in the result. */
+		struct weak_checksum
+		{
+			uint32_t a = 0;
+			uint32_t b = 0;
+			uint32_t len = 0;
+
+			/* b = sum (n - i) * p[i] = n * a - sum i * p[i], as sums without a loop-carried chain, which vectorize */
+			void init(const uint8_t* p, size_t n)
+			{
+				uint32_t sum = 0;
+				uint32_t weighted = 0;
+
+				for (size_t i = 0; i < n; i++)
+				{
+					sum += p[i];
+					weighted += static_cast<uint32_t>(i) * p[i];
+				}
+
+				len = static_cast<uint32_t>(n);
+				a = sum;
+				b = len * sum - weighted;
+			}
+
+			void roll(uint8_t out, uint8_t in)
+			{
+				a += static_cast<uint32_t>(in) - out;
+				b += a - len * static_cast<uint32_t>(out);
+			}
+
+			uint32_t value() const
+			{
+				return (a & 0xFFFF) | (b << 16);
+			}
+		};
+
+		inline uint32_t weak_of(const uint8_t* p, size_t n)
+		{
+			weak_checksum w;
+			w.init(p, n);
+			return w.value();
+		}
+
+		/* xxhash3<64> of count windows of len bytes, hashed in lock-step so their accumulator chains overlap. secret is derived from the seed. */
+		template <size_t count>
+		inline void hash_lanes(const uint8_t* const* in, size_t len, const uint8_t* secret, hash64_t* out)
+		{
+			constexpr size_t nb_rounds = (detail3::secret_default_size - detail3::stripe_len) / detail3::secret_consume_rate;
+			constexpr size_t block_len = nb_rounds * detail3::stripe_len;
+
+			alignas(detail3::acc_align) std::array<uint64_t, detail3::acc_nb> acc[count];
+
+			for (size_t k = 0; k < count; k++)
+			{
+				acc[k] = detail3::init_acc;
+			}
+
+			auto stripes = [&](size_t from, size_t n) {
+				for (size_t s = 0; s < n; s++)
+				{
+					for (size_t k = 0; k < count; k++)
+					{
+						detail3::accumulate_512(acc[k].data(), in[k] + from + s * detail3::stripe_len, secret + s * detail3::secret_consume_rate);
+					}
+				}
+			};
+
+			size_t const nb_blocks = (len - 1) / block_len;
+
+			for (size_t b = 0; b < nb_blocks; b++)
+			{
+				stripes(b * block_len, nb_rounds);
+
+				for (size_t k = 0; k < count; k++)
+				{
+					detail3::scramble_acc(acc[k].data(), secret + detail3::secret_default_size - detail3::stripe_len);
+				}
+			}
+
+			stripes(nb_blocks * block_len, ((len - 1) - nb_blocks * block_len) / detail3::stripe_len);
+
+			for (size_t k = 0; k < count; k++)
+			{
+				detail3::accumulate_512(acc[k].data(), in[k] + len - detail3::stripe_len, secret + detail3::secret_default_size - detail3::stripe_len - detail3::secret_lastacc_start);
+				out[k] = detail3::hash_long_merge<64>(acc[k], len, secret, detail3::secret_default_size);
+			}
+		}
+
+		/* Equal to xxhash3<64>(in[k], len, seed) for each of the count (at most batch) windows. */
+		inline void strong_hashes(const uint8_t* const* in, size_t count, size_t len, uint64_t seed, const uint8_t* secret, hash64_t* out)
+		{
+			if (len <= detail3::midsize_max)
+			{
+				for (size_t k = 0; k < count; k++)
+				{
+					out[k] = xxhash3<64>(in[k], len, seed);
+				}
+
+				return;
+			}
+
+			switch (count)
+			{
+			case 4: hash_lanes<4>(in, len, secret, out); break;
+			case 3: hash_lanes<3>(in, len, secret, out); break;
+			case 2: hash_lanes<2>(in, len, secret, out); break;
+			default: hash_lanes<1>(in, len, secret, out); break;
+			}
+		}
+
+		/* Full blocks of a signature by weak checksum: chains of block indices from power of 2 buckets.
+		* The target is looked up at every byte where it does not match, and most lookups find nothing. A blocked Bloom filter, 32 bits
+		* per block with both probes in one word, answers those from cache, instead of a miss on the chain heads for one byte in a few.
+		*/
+		class block_table
+		{
+			std::vector<uint32_t> head;
+			std::vector<uint32_t> next;
+			std::vector<uint64_t> filter;
+			uint32_t shift = 32;
+			uint32_t filter_shift = 31;
+
+			size_t filter_word(uint32_t weak) const
+			{
+				return (weak * 0x85EBCA77u) >> filter_shift;
+			}
+
+			/* the low bits of each half of the checksum, a and b, are well mixed already */
+			static uint64_t filter_bits(uint32_t weak)
+			{
+				return (1ULL << (weak & 63)) | (1ULL << ((weak >> 16) & 63));
+			}
+
+		public:
+
+			static constexpr uint32_t none = ~0u;
+
+			explicit block_table(const delta_signature& sig, size_t full_blocks) : next(full_blocks, none)
+			{
+				size_t buckets = 16;
+
+				while (buckets < 2 * full_blocks)
+				{
+					buckets *= 2;
+					shift--;
+				}
+
+				shift -= 4;
+				head.assign(buckets, none);
+
+				size_t words = 2;
+
+				while (words < full_blocks / 2)
+				{
+					words *= 2;
+					filter_shift--;
+				}
+
+				filter.assign(words, 0);
+
+				/* inserted backwards so that chains list the earliest block first */
+				for (size_t i = full_blocks; i-- > 0;)
+				{
+					uint32_t const bucket = bucket_of(sig.weak[i]);
+					next[i] = head[bucket];
+					head[bucket] = static_cast<uint32_t>(i);
+					filter[filter_word(sig.weak[i])] |= filter_bits(sig.weak[i]);
+				}
+			}
+
+			/* false if no block has this weak checksum, true if one may */
+			bool may_contain(uint32_t weak) const
+			{
+				uint64_t const bits = filter_bits(weak);
+				return (filter[filter_word(weak)] & bits) == bits;
+			}
+
+			uint32_t bucket_of(uint32_t weak) const
+			{
+				return (weak * 0x9E3779B1u) >> shift;
+			}
+
+			uint32_t first(uint32_t weak) const
+			{
+				return head[bucket_of(weak)];
+			}
+
+			uint32_t after(uint32_t block) const
+			{
+				return next[block];
+			}
+		};
+
+		inline void put_op(delta& d, bool copy, uint64_t offset, uint64_t length)
+		{
+			if (length == 0)
+			{
+				return;
+			}
+
+			if (!d.ops.empty() && d.ops.back().copy == copy && d.ops.back().offset + d.ops.back().length == offset)
+			{
+				d.ops.back().length += length;
+				return;
+			}
+
+			d.ops.push_back(delta_op{ copy, offset, length });
+		}
+
+		inline void put_literal(delta& d, const uint8_t* p, size_t n)
+		{
+			put_op(d, false, d.literals.size(), n);
+			d.literals.insert(d.literals.end(), p, p + n);
+		}
+
+		inline void build_signature(delta_signature& sig, const uint8_t* data, size_t len, const delta_options& options, thread_pool* pool)
+		{
+			size_t const block_size = std::max<size_t>(options.block_size, 16);
+			size_t const count = (len + block_size - 1) / block_size;
+			alignas(64) uint8_t secret[detail3::secret_default_size];
+
+			detail3::init_custom_secret(secret, options.seed);
+			sig.block_size = block_size;
+			sig.seed = options.seed;
+			sig.length = len;
+			sig.weak.resize(count);
+			sig.strong.resize(count);
+
+			/* groups of batch full blocks, the short last block on its own */
+			size_t const full = len / block_size;
+			size_t const groups = (full + batch - 1) / batch;
+
+			auto group = [&](size_t g) {
+				const uint8_t* in[batch];
+				size_t const first = g * batch;
+				size_t const n = std::min(batch, full - first);
+
+				for (size_t k = 0; k < n; k++)
+				{
+					in[k] = data + (first + k) * block_size;
+					sig.weak[first + k] = weak_of(in[k], block_size);
+				}
+
+				strong_hashes(in, n, block_size, options.seed, secret, sig.strong.data() + first);
+			};
+
+			if (pool)
+			{
+				pool->parallel_for(groups, group);
+			}
+			else
+			{
+				for (size_t g = 0; g < groups; g++)
+				{
+					group(g);
+				}
+			}
+
+			if (count > full)
+			{
+				sig.weak[full] = weak_of(data + full * block_size, len - full * block_size);
+				sig.strong[full] = xxhash3<64>(data + full * block_size, len - full * block_size, options.seed);
+			}
+		}
+
+		template <typename Sink>
+		inline void write_checked(std::vector<uint8_t>& out, Sink&& fill)
+		{
+			fill(out);
+
+			uint8_t checksum[8];
+			mem_ops::writeLE<64>(checksum, xxhash3<64>(out.data(), out.size()));
+			out.insert(out.end(), checksum, checksum + 8);
+		}
+
+		inline bool check_header(const uint8_t* p, size_t size, const uint8_t* magic, size_t header_size)
+		{
+			return size >= header_size + 8 && memcmp(p, magic, 4) == 0 && mem_ops::readLE<32>(p + 4) == format_version
+				&& xxhash3<64>(p, size - 8) == mem_ops::readLE<64>(p + size - 8);
+		}
+	}
+
+	/* Signature of a basis held in memory. */
+	inline delta_signature make_signature(const void* basis, size_t len, const delta_options& options = delta_options())
+	{
+		delta_signature sig;
+		detail_delta::build_signature(sig, static_cast<const uint8_t*>(basis), len, options, nullptr);
+		return sig;
+	}
+
+	/* Same, with the blocks checksummed concurrently on pool. */
+	inline delta_signature make_signature(const void* basis, size_t len, thread_pool& pool, const delta_options& options = delta_options())
+	{
+		delta_signature sig;
+		detail_delta::build_signature(sig, static_cast<const uint8_t*>(basis), len, options, &pool);
+		return sig;
+	}
+
+	/* Delta turning the basis described by sig into target. The weak checksum rolls one byte at a time through unmatched data.
+	* Once a block matches, the following basis blocks are expected next: up to 4 target windows are then confirmed at once with interleaved
+	* xxhash3<64>, without weak checksums, and the rolling search only resumes where that run of blocks ends.
+	*/
+	inline delta make_delta(const delta_signature& sig, const void* target, size_t len)
+	{
+		const uint8_t* const data = static_cast<const uint8_t*>(target);
+		size_t const bs = static_cast<size_t>(sig.block_size);
+		size_t const full_blocks = (bs == 0) ? 0 : static_cast<size_t>(sig.length / bs);
+		alignas(64) uint8_t secret[detail3::secret_default_size];
+		delta d;
+
+		d.target_length = len;
+		detail3::init_custom_secret(secret, sig.seed);
+
+		detail_delta::block_table const table(sig, full_blocks);
+		detail_delta::weak_checksum weak;
+		bool rolling = false;
+		size_t literal_start = 0;
+		size_t expected = detail_delta::block_table::none;
+		size_t p = 0;
+
+		auto copy_blocks = [&](size_t block, size_t count) {
+			detail_delta::put_literal(d, data + literal_start, p - literal_start);
+			detail_delta::put_op(d, true, static_cast<uint64_t>(block) * bs, static_cast<uint64_t>(count) * bs);
+			p += count * bs;
+			literal_start = p;
+			rolling = false;
+		};
+
+		while (full_blocks > 0 && p + bs <= len)
+		{
+			if (expected != detail_delta::block_table::none)
+			{
+				/* the run of blocks continues as long as each window hashes like the next basis block */
+				size_t run = 0;
+				bool matching = true;
+
+				while (matching)
+				{
+					size_t const n = std::min({ detail_delta::batch, full_blocks - (expected + run), (len - p) / bs - run });
+					const uint8_t* in[detail_delta::batch];
+					hash64_t h[detail_delta::batch];
+
+					if (n == 0)
+					{
+						break;
+					}
+
+					for (size_t k = 0; k < n; k++)
+					{
+						in[k] = data + p + (run + k) * bs;
+					}
+
+					detail_delta::strong_hashes(in, n, bs, sig.seed, secret, h);
+
+					for (size_t k = 0; k < n && matching; k++)
+					{
+						matching = (h[k] == sig.strong[expected + run]);
+						run += matching;
+					}
+				}
+
+				/* the run ended on a mismatch, or on the end of the basis or target: back to rolling either way */
+				size_t const block = expected;
+				expected = detail_delta::block_table::none;
+
+				if (run > 0)
+				{
+					copy_blocks(block, run);
+					continue;
+				}
+			}
+
+			if (!rolling)
+			{
+				weak.init(data + p, bs);
+				rolling = true;
+			}
+
+			uint32_t const w = weak.value();
+			uint32_t found = detail_delta::block_table::none;
+			bool hashed = false;
+			hash64_t h = 0;
+
+			for (uint32_t b = table.may_contain(w) ? table.first(w) : detail_delta::block_table::none; b != detail_delta::block_table::none; b = table.after(b))
+			{
+				if (sig.weak[b] != w)
+				{
+					continue;
+				}
+
+				if (!hashed)
+				{
+					const uint8_t* const in = data + p;
+					detail_delta::strong_hashes(&in, 1, bs, sig.seed, secret, &h);
+					hashed = true;
+				}
+
+				if (sig.strong[b] == h)
+				{
+					found = b;
+					break;
+				}
+			}
+
+			if (found != detail_delta::block_table::none)
+			{
+				expected = (found + 1 < full_blocks) ? found + 1 : detail_delta::block_table::none;
+				copy_blocks(found, 1);
+				continue;
+			}
+
+			if (p + bs == len)
+			{
+				break;
+			}
+
+			weak.roll(data[p], data[p + bs]);
+			p++;
+		}
+
+		/* a short last basis block can only match the very end of the target */
+		size_t const tail = static_cast<size_t>(sig.length - full_blocks * bs);
+
+		if (tail > 0 && len - literal_start >= tail && xxhash3<64>(data + len - tail, tail, sig.seed) == sig.strong.back())
+		{
+			p = len - tail;
+			detail_delta::put_literal(d, data + literal_start, p - literal_start);
+			detail_delta::put_op(d, true, full_blocks * bs, tail);
+			literal_start = len;
+		}
+
+		detail_delta::put_literal(d, data + literal_start, len - literal_start);
+		return d;
+	}
+
+	/* Rebuilds the target from the basis and a delta. Returns false, leaving out unspecified, if the delta does not fit the basis. */
+	inline bool apply_delta(const void* basis, size_t basis_len, const delta& d, std::vector<uint8_t>& out)
+	{
+		const uint8_t* const base = static_cast<const uint8_t*>(basis);
+
+		out.clear();
+		out.reserve(static_cast<size_t>(d.target_length));
+
+		for (const delta_op& op : d.ops)
+		{
+			uint64_t const limit = op.copy ? basis_len : d.literals.size();
+
+			if (op.offset > limit || op.length > limit - op.offset)
+			{
+				return false;
+			}
+
+			const uint8_t* const from = (op.copy ? base : d.literals.data()) + op.offset;
+			out.insert(out.end(), from, from + op.length);
+		}
+
+		return out.size() == d.target_length;
+	}
+
+	/* Serialized forms, little endian, each ending with an xxhash3<64> of the preceding bytes:
+	* signature: "XXHS" | u32 version | u64 block_size | u64 seed | u64 length | (u32 weak, u64 strong) per block
+	* delta:     "XXHD" | u32 version | u64 target_length | u64 op count | u64 literal bytes | (u64 offset, u64 length with the top bit set for copies) per op | literals
+	*/
+	inline std::vector<uint8_t> serialize_signature(const delta_signature& sig)
+	{
+		std::vector<uint8_t> out;
+
+		detail_delta::write_checked(out, [&](std::vector<uint8_t>& o) {
+			o.resize(32 + 12 * sig.strong.size());
+			memcpy(o.data(), detail_delta::signature_magic, 4);
+			mem_ops::writeLE<32>(o.data() + 4, detail_delta::format_version);
+			mem_ops::writeLE<64>(o.data() + 8, sig.block_size);
+			mem_ops::writeLE<64>(o.data() + 16, sig.seed);
+			mem_ops::writeLE<64>(o.data() + 24, sig.length);
+
+			for (size_t i = 0; i < sig.strong.size(); i++)
+			{
+				mem_ops::writeLE<32>(o.data() + 32 + 12 * i, sig.weak[i]);
+				mem_ops::writeLE<64>(o.data() + 36 + 12 * i, sig.strong[i]);
+			}
+		});
+
+		return out;
+	}
+
+	/* Returns false if data is not a valid signature. */
+	inline bool parse_signature(const void* data, size_t size, delta_signature& sig)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (!detail_delta::check_header(p, size, detail_delta::signature_magic, 32) || (size - 40) % 12 != 0)
+		{
+			return false;
+		}
+
+		size_t const count = (size - 40) / 12;
+
+		sig.block_size = mem_ops::readLE<64>(p + 8);
+		sig.seed = mem_ops::readLE<64>(p + 16);
+		sig.length = mem_ops::readLE<64>(p + 24);
+
+		if (sig.block_size == 0 || (sig.length + sig.block_size - 1) / sig.block_size != count)
+		{
+			return false;
+		}
+
+		sig.weak.resize(count);
+		sig.strong.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			sig.weak[i] = mem_ops::readLE<32>(p + 32 + 12 * i);
+			sig.strong[i] = mem_ops::readLE<64>(p + 36 + 12 * i);
+		}
+
+		return true;
+	}
+
+	inline std::vector<uint8_t> serialize_delta(const delta& d)
+	{
+		constexpr uint64_t copy_bit = 1ULL << 63;
+		std::vector<uint8_t> out;
+
+		detail_delta::write_checked(out, [&](std::vector<uint8_t>& o) {
+			o.resize(32 + 16 * d.ops.size());
+			memcpy(o.data(), detail_delta::delta_magic, 4);
+			mem_ops::writeLE<32>(o.data() + 4, detail_delta::format_version);
+			mem_ops::writeLE<64>(o.data() + 8, d.target_length);
+			mem_ops::writeLE<64>(o.data() + 16, d.ops.size());
+			mem_ops::writeLE<64>(o.data() + 24, d.literals.size());
+
+			for (size_t i = 0; i < d.ops.size(); i++)
+			{
+				mem_ops::writeLE<64>(o.data() + 32 + 16 * i, d.ops[i].offset);
+				mem_ops::writeLE<64>(o.data() + 40 + 16 * i, d.ops[i].length | (d.ops[i].copy ? copy_bit : 0));
+			}
+
+			o.insert(o.end(), d.literals.begin(), d.literals.end());
+		});
+
+		return out;
+	}
+
+	/* Returns false if data is not a valid delta. */
+	inline bool parse_delta(const void* data, size_t size, delta& d)
+	{
+		constexpr uint64_t copy_bit = 1ULL << 63;
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (!detail_delta::check_header(p, size, detail_delta::delta_magic, 32))
+		{
+			return false;
+		}
+
+		uint64_t const op_count = mem_ops::readLE<64>(p + 16);
+		uint64_t const literal_count = mem_ops::readLE<64>(p + 24);
+
+		if (op_count > (size - 40) / 16 || literal_count != size - 40 - 16 * op_count)
+		{
+			return false;
+		}
+
+		d.target_length = mem_ops::readLE<64>(p + 8);
+		d.ops.resize(static_cast<size_t>(op_count));
+
+		for (size_t i = 0; i < d.ops.size(); i++)
+		{
+			uint64_t const length = mem_ops::readLE<64>(p + 40 + 16 * i);
+
+			d.ops[i].offset = mem_ops::readLE<64>(p + 32 + 16 * i);
+			d.ops[i].length = length & ~copy_bit;
+			d.ops[i].copy = (length & copy_bit) != 0;
+		}
+
+		const uint8_t* const literals = p + 32 + 16 * op_count;
+		d.literals.assign(literals, literals + literal_count);
+		return true;
+	}
+}
@@ -0,0 +1,293 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xxhash.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#	define XXH_CPP_POSIX_FILES 1
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#else
+#	define XXH_CPP_POSIX_FILES 0
+#endif
+
+/*
+xxHash - Extremely Fast Hash algorithm
+File hashing extensions for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  File Hashing
+	***************************************/
+
+	/* automatic maps regular files of at least map_threshold bytes and reads everything else (small files, pipes, character devices, sockets). */
+	enum class file_access : uint8_t { automatic, map, read };
+
+	struct file_hash_options
+	{
+		uint64_t seed = 0;
+		file_access access = file_access::automatic;
+		/* Bytes mapped at a time. Only one window is mapped at any moment, so the resident set stays bounded on huge files. */
+		size_t window_size = 64 * 1024 * 1024;
+		/* Buffer size used when reading. */
+		size_t buffer_size = 1024 * 1024;
+		/* With automatic access, smaller files are read: for them mmap and munmap cost more than the copy they save. */
+		size_t map_threshold = 64 * 1024;
+		/* Ask for transparent huge pages on the mapped windows (Linux, MADV_HUGEPAGE). */
+		bool huge_pages = true;
+	};
+
+	template <size_t bit_mode>
+	struct file_hash_result
+	{
+		hash_t<bit_mode> hash = {};
+		uint64_t bytes = 0;
+		double seconds = 0;
+		bool mapped = false;
+		std::error_code error;
+
+		bool ok() const
+		{
+			return !error;
+		}
+
+		/* Throughput in bytes per second. */
+		double rate() const
+		{
+			return (seconds > 0) ? static_cast<double>(bytes) / seconds : 0;
+		}
+	};
+
+	namespace detail_file
+	{
+		using clock = std::chrono::steady_clock;
+
+		inline double elapsed(clock::time_point start)
+		{
+			return std::chrono::duration<double>(clock::now() - start).count();
+		}
+
+#if XXH_CPP_POSIX_FILES
+		inline std::error_code last_error()
+		{
+			return std::error_code(errno, std::generic_category());
+		}
+
+		/* Hashes what read(2) returns until end of file. Works on anything, including pipes and sockets. */
+		template <typename state_t>
+		inline std::error_code hash_read(int fd, state_t& state, uint64_t& bytes, size_t buffer_size)
+		{
+			std::vector<uint8_t> buffer(std::max<size_t>(buffer_size, 4096));
+
+			while (true)
+			{
+				ssize_t const n = ::read(fd, buffer.data(), buffer.size());
+
+				if (n < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return last_error();
+				}
+
+				if (n == 0)
+				{
+					return std::error_code();
+				}
+
+				state.update(buffer.data(), static_cast<size_t>(n));
+				bytes += static_cast<uint64_t>(n);
+			}
+		}
+
+		/* Hashes a regular file of the given size one mapped window at a time.
+		* Returns false, with bytes left at the amount already hashed, if a window cannot be mapped so the caller can read the rest.
+		*/
+		template <typename state_t>
+		inline bool hash_mapped(int fd, uint64_t size, state_t& state, uint64_t& bytes, const file_hash_options& options)
+		{
+			size_t const page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+			size_t const window = std::max(page_size, (options.window_size + page_size - 1) / page_size * page_size);
+
+			while (bytes < size)
+			{
+				size_t const len = static_cast<size_t>(std::min<uint64_t>(window, size - bytes));
+				void* const map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(bytes));
+
+				if (map == MAP_FAILED)
+				{
+					return false;
+				}
+
+				::madvise(map, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+				if (options.huge_pages)
+				{
+					::madvise(map, len, MADV_HUGEPAGE);
+				}
+#endif
+#if defined(POSIX_FADV_WILLNEED)
+				if (bytes + len < size)
+				{	/* start reading the next window while this one is hashed */
+					::posix_fadvise(fd, static_cast<off_t>(bytes + len), static_cast<off_t>(std::min<uint64_t>(window, size - bytes - len)), POSIX_FADV_WILLNEED);
+				}
+#endif
+
+				state.update(map, len);
+				::munmap(map, len);
+				bytes += len;
+			}
+
+			return true;
+		}
+
+		template <size_t N, typename state_t>
+		inline file_hash_result<N> hash_fd(int fd, const file_hash_options& options)
+		{
+			clock::time_point const start = clock::now();
+			file_hash_result<N> result;
+			state_t state(options.seed);
+			size_t buffer_size = options.buffer_size;
+			struct stat st;
+
+			if (::fstat(fd, &st) != 0)
+			{
+				result.error = last_error();
+				return result;
+			}
+
+			if (S_ISREG(st.st_mode))
+			{
+				uint64_t const size = static_cast<uint64_t>(st.st_size);
+
+				if (size > 0 && (options.access == file_access::map || (options.access == file_access::automatic && size >= options.map_threshold)))
+				{
+					result.mapped = hash_mapped(fd, size, state, result.bytes, options);
+
+					if (result.mapped)
+					{
+						result.hash = state.digest();
+						result.seconds = elapsed(start);
+						return result;
+					}
+				}
+
+				if (::lseek(fd, static_cast<off_t>(result.bytes), SEEK_SET) < 0)
+				{
+					result.error = last_error();
+					return result;
+				}
+
+				/* no point in allocating a large buffer for a small file; one more byte lets the first read see the end */
+				buffer_size = static_cast<size_t>(std::min<uint64_t>(buffer_size, size - result.bytes + 1));
+			}
+
+			result.error = hash_read(fd, state, result.bytes, buffer_size);
+			result.hash = state.digest();
+			result.seconds = elapsed(start);
+			return result;
+		}
+#else
+		template <size_t N, typename state_t>
+		inline file_hash_result<N> hash_stream(std::istream& in, const file_hash_options& options)
+		{
+			clock::time_point const start = clock::now();
+			file_hash_result<N> result;
+			state_t state(options.seed);
+			std::vector<char> buffer(std::max<size_t>(options.buffer_size, 4096));
+
+			while (in)
+			{
+				in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+				size_t const n = static_cast<size_t>(in.gcount());
+				state.update(buffer.data(), n);
+				result.bytes += n;
+			}
+
+			if (in.bad())
+			{
+				result.error = std::make_error_code(std::errc::io_error);
+			}
+
+			result.hash = state.digest();
+			result.seconds = elapsed(start);
+			return result;
+		}
+#endif
+	}
+
+	/* Hashes the contents of the file at path with xxhash3<bit_mode>, without loading it whole into memory.
+	* Another streaming state can be given as state_t, for example hash_state64_t to compute XXH64.
+	* Regular files are memory mapped window by window; if mapping is not possible they are read instead.
+	* The file must not be truncated while it is being hashed, as accessing a mapping past the end of a file raises SIGBUS.
+	*/
+	template <size_t bit_mode, typename state_t = hash3_state_t<bit_mode>>
+	inline file_hash_result<bit_mode> hash_file(const std::string& path, const file_hash_options& options = file_hash_options())
+	{
+		static_assert(std::is_same<decltype(std::declval<state_t&>().digest()), hash_t<bit_mode>>::value, "state_t must produce a hash_t<bit_mode>.");
+
+#if XXH_CPP_POSIX_FILES
+		int fd;
+
+		do
+		{
+			fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		} while (fd < 0 && errno == EINTR);
+
+		if (fd < 0)
+		{
+			file_hash_result<bit_mode> result;
+			result.error = detail_file::last_error();
+			return result;
+		}
+
+		file_hash_result<bit_mode> const result = detail_file::hash_fd<bit_mode, state_t>(fd, options);
+		::close(fd);
+		return result;
+#else
+		std::ifstream in(path, std::ios::binary);
+
+		if (!in)
+		{
+			file_hash_result<bit_mode> result;
+			result.error = std::make_error_code(std::errc::no_such_file_or_directory);
+			return result;
+		}
+
+		return detail_file::hash_stream<bit_mode, state_t>(in, options);
+#endif
+	}
+
+#if XXH_CPP_POSIX_FILES
+	/* Hashes an open descriptor, for example standard input. Regular files are hashed from their beginning, anything else from its current position.
+	* The descriptor is not closed.
+	*/
+	template <size_t bit_mode, typename state_t = hash3_state_t<bit_mode>>
+	inline file_hash_result<bit_mode> hash_file(int fd, const file_hash_options& options = file_hash_options())
+	{
+		static_assert(std::is_same<decltype(std::declval<state_t&>().digest()), hash_t<bit_mode>>::value, "state_t must produce a hash_t<bit_mode>.");
+
+		return detail_file::hash_fd<bit_mode, state_t>(fd, options);
+	}
+#endif
+}
@@ -0,0 +1,858 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "xxhash.hpp"
+#include "xxhash_hashed_string.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Open-addressing hash map for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Key Hashing
+	***************************************/
+
+	/* xxhash3<64> of the bytes of a key. Only for types whose value is their object representation: no padding, no indirection,
+	* no floating point (0.0 and -0.0 compare equal).
+	*/
+	template <typename K>
+	struct flat_hash
+	{
+		static_assert(std::has_unique_object_representations_v<K>, "flat_hash hashes the bytes of keys: pass another hasher for keys with padding, pointers to their data or floating point values.");
+
+		uint64_t seed = 0;
+
+		uint64_t operator()(const K& key) const
+		{
+			return xxhash3<64>(&key, sizeof(K), seed);
+		}
+	};
+
+	/* Strings hash their characters. Views and C strings hash the same, so they can look up string keys without a temporary. */
+	template <typename CharT, typename Traits, typename Alloc>
+	struct flat_hash<std::basic_string<CharT, Traits, Alloc>>
+	{
+		using is_transparent = void;
+
+		uint64_t seed = 0;
+
+		uint64_t operator()(std::basic_string_view<CharT, Traits> key) const
+		{
+			return xxhash3<64>(key.data(), key.size() * sizeof(CharT), seed);
+		}
+
+		/* Hashed strings hash the same as their bytes: the stored hash is used as is with seed 0. */
+		template <typename H, detail_hashed::enable_hashed<H> = 0>
+		uint64_t operator()(const H& key) const
+		{
+			return (seed == 0) ? key.hash() : xxhash3<64>(key.data(), key.size(), seed);
+		}
+	};
+
+	template <typename CharT, typename Traits>
+	struct flat_hash<std::basic_string_view<CharT, Traits>> : flat_hash<std::basic_string<CharT, Traits>>
+	{
+	};
+
+	template <>
+	struct flat_hash<hashed_string> : flat_hash<std::string>
+	{
+	};
+
+	template <>
+	struct flat_hash<hashed_string_view> : flat_hash<std::string>
+	{
+	};
+
+
+	/* *************************************
+	*  Control Byte Groups
+	***************************************/
+
+	namespace detail_flat
+	{
+		/* A control byte per slot: the 7 bit tag of a full slot, or one of these, both with the top bit set. */
+		constexpr uint8_t ctrl_empty = 0x80;
+		constexpr uint8_t ctrl_deleted = 0xFE;
+
+		/* Slots probed at once: a vector register of control bytes, or a 64 bit word of them for the portable version. */
+		constexpr size_t group_bits = (intrin::vector_mode >= 2) ? 256 : ((intrin::vector_mode == 1) ? 128 : 64);
+		constexpr size_t group_width = group_bits / 8;
+
+		/* Matching slots of a group as a bit mask: bit i for slot i with vectors, bit 8i + 7 for the portable version. */
+		using mask_t = uint64_t;
+		constexpr uint32_t mask_shift = (group_bits == 64) ? 3 : 0;
+
+		static inline size_t lowest(mask_t mask)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, mask);
+			return static_cast<size_t>(index) >> mask_shift;
+#elif defined(__GNUC__)
+			return static_cast<size_t>(__builtin_ctzll(mask)) >> mask_shift;
+#else
+			size_t index = 0;
+
+			while ((mask & 1) == 0)
+			{
+				mask >>= 1;
+				index++;
+			}
+
+			return index >> mask_shift;
+#endif
+		}
+
+		template <size_t N>
+		XXH_FORCE_INLINE mask_t match(const uint8_t* ctrl, uint8_t tag)
+		{
+			static_assert(!(N != 256 && N != 128 && N != 64), "Invalid template argument passed to xxh::detail_flat::match");
+
+			if constexpr (N == 256)
+			{
+				__m256i const group = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ctrl));
+				return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(static_cast<char>(tag)))));
+			}
+
+			if constexpr (N == 128)
+			{
+				__m128i const group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+				return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+			}
+
+			if constexpr (N == 64)
+			{
+				/* bytes equal to tag become zero, then the usual zero byte test; it may also flag a byte above a true match,
+				* which costs a key comparison and nothing else
+				*/
+				constexpr uint64_t lsbs = 0x0101010101010101ULL;
+				uint64_t const x = mem_ops::readLE<64>(ctrl) ^ (lsbs * tag);
+				return (x - lsbs) & ~x & (lsbs << 7);
+			}
+		}
+
+		template <size_t N>
+		XXH_FORCE_INLINE mask_t match_empty(const uint8_t* ctrl)
+		{
+			static_assert(!(N != 256 && N != 128 && N != 64), "Invalid template argument passed to xxh::detail_flat::match_empty");
+
+			if constexpr (N == 64)
+			{
+				/* empty is the only control byte with the top bit set and bit 6 clear */
+				uint64_t const x = mem_ops::readLE<64>(ctrl);
+				return x & ~(x << 1) & 0x8080808080808080ULL;
+			}
+			else
+			{
+				return match<N>(ctrl, ctrl_empty);
+			}
+		}
+
+		/* empty or deleted slots */
+		template <size_t N>
+		XXH_FORCE_INLINE mask_t match_free(const uint8_t* ctrl)
+		{
+			static_assert(!(N != 256 && N != 128 && N != 64), "Invalid template argument passed to xxh::detail_flat::match_free");
+
+			if constexpr (N == 256)
+			{
+				return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ctrl))));
+			}
+
+			if constexpr (N == 128)
+			{
+				return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))));
+			}
+
+			if constexpr (N == 64)
+			{
+				return mem_ops::readLE<64>(ctrl) & 0x8080808080808080ULL;
+			}
+		}
+
+		template <typename T, typename = void>
+		struct is_transparent : std::false_type {};
+
+		template <typename T>
+		struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+		/* Key types other than K can be looked up when both the hasher and the comparison accept them. Q keeps the test dependent. */
+		template <typename Hash, typename KeyEqual, typename Q>
+		using enable_lookup = std::enable_if_t<is_transparent<Hash>::value && is_transparent<KeyEqual>::value && sizeof(Q) != 0, int>;
+	}
+
+
+	/* *************************************
+	*  Flat Hash Map
+	***************************************/
+
+	/* An open-addressing hash map in the style of Swiss tables. Slots form groups of 16 or 32 (one SSE2 or AVX2 register of control bytes,
+	* 8 in the portable version), and a lookup compares a 7 bit tag against a whole group at once: the 64 bit hash selects the first group with
+	* bits 7 and up, and the tag with its low 7 bits. Only slots whose tag matches have their keys compared, and a probe sequence ends at the
+	* first group holding an empty slot, so most lookups read one group of control bytes and one slot.
+	* Elements live in the table itself: no allocation per element, but an insertion that grows the table moves every element and invalidates
+	* iterators and references. Erasing only invalidates the erased element. The hash of every element is kept beside it, so growing never
+	* calls the hasher.
+	* Groups are probed quadratically, and the table grows once 7/8 of its slots are taken.
+	*/
+	template <typename K, typename V, typename Hash = flat_hash<K>, typename KeyEqual = std::equal_to<>>
+	class flat_map
+	{
+	public:
+
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<const K, V>;
+		using size_type = size_t;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+
+	private:
+
+		static constexpr size_t width = detail_flat::group_width;
+		static constexpr size_t npos = ~size_t(0);
+
+		/* Elements are constructed as value_type and moved through the non-const view on rehash, as node based maps commonly do. */
+		union slot_t
+		{
+			value_type value;
+			std::pair<K, V> mutable_value;
+
+			slot_t() {}
+			~slot_t() {}
+		};
+
+		size_t groups = 0;
+		size_t elements = 0;
+		/* insertions into empty slots left before growing; deleted slots do not give any back */
+		size_t growth_left = 0;
+		std::unique_ptr<uint8_t[]> ctrl;
+		std::unique_ptr<uint64_t[]> hashes;
+		std::unique_ptr<slot_t[]> slots;
+		Hash hash_fn;
+		KeyEqual eq_fn;
+
+		static size_t max_load(size_t capacity)
+		{
+			return capacity - capacity / 8;
+		}
+
+		uint8_t* group_ctrl(size_t group) const
+		{
+			return ctrl.get() + group * width;
+		}
+
+		size_t first_group(uint64_t h) const
+		{
+			return static_cast<size_t>(h >> 7) & (groups - 1);
+		}
+
+		static uint8_t tag_of(uint64_t h)
+		{
+			return static_cast<uint8_t>(h & 0x7F);
+		}
+
+		template <typename Q>
+		size_t find_index(const Q& key, uint64_t h) const
+		{
+			if (groups == 0)
+			{
+				return npos;
+			}
+
+			uint8_t const tag = tag_of(h);
+			size_t g = first_group(h);
+
+			for (size_t step = 1;; step++)
+			{
+				const uint8_t* const c = group_ctrl(g);
+
+				for (detail_flat::mask_t m = detail_flat::match<detail_flat::group_bits>(c, tag); m != 0; m &= m - 1)
+				{
+					size_t const i = g * width + detail_flat::lowest(m);
+
+					if (XXH_likely(eq_fn(slots[i].value.first, key)))
+					{
+						return i;
+					}
+				}
+
+				if (XXH_likely(detail_flat::match_empty<detail_flat::group_bits>(c) != 0))
+				{
+					return npos;
+				}
+
+				g = (g + step) & (groups - 1);
+			}
+		}
+
+		/* First empty or deleted slot on the probe sequence of h. */
+		size_t find_free(uint64_t h) const
+		{
+			size_t g = first_group(h);
+
+			for (size_t step = 1;; step++)
+			{
+				detail_flat::mask_t const m = detail_flat::match_free<detail_flat::group_bits>(group_ctrl(g));
+
+				if (m != 0)
+				{
+					return g * width + detail_flat::lowest(m);
+				}
+
+				g = (g + step) & (groups - 1);
+			}
+		}
+
+		void allocate(size_t new_groups)
+		{
+			size_t const capacity = new_groups * width;
+
+			groups = new_groups;
+			ctrl.reset(new uint8_t[capacity]);
+			hashes.reset(new uint64_t[capacity]);
+			slots.reset(new slot_t[capacity]);
+			memset(ctrl.get(), detail_flat::ctrl_empty, capacity);
+			growth_left = max_load(capacity) - elements;
+		}
+
+		/* Moves every element into a table of new_groups groups. Deleted slots are dropped on the way. */
+		void rehash_to(size_t new_groups)
+		{
+			size_t const old_capacity = capacity();
+			std::unique_ptr<uint8_t[]> old_ctrl = std::move(ctrl);
+			std::unique_ptr<uint64_t[]> old_hashes = std::move(hashes);
+			std::unique_ptr<slot_t[]> old_slots = std::move(slots);
+
+			allocate(new_groups);
+
+			for (size_t i = 0; i < old_capacity; i++)
+			{
+				if (old_ctrl[i] < 0x80)
+				{
+					uint64_t const h = old_hashes[i];
+					size_t const j = find_free(h);
+
+					ctrl[j] = tag_of(h);
+					hashes[j] = h;
+					new (&slots[j].value) value_type(std::move(old_slots[i].mutable_value));
+					old_slots[i].value.~value_type();
+				}
+			}
+		}
+
+		void destroy_all()
+		{
+			for (size_t i = 0; i < capacity(); i++)
+			{
+				if (ctrl[i] < 0x80)
+				{
+					slots[i].value.~value_type();
+				}
+			}
+		}
+
+		/* Slot for a new element of hash h, growing the table first if that would take an empty slot past the load limit. */
+		size_t claim(uint64_t h)
+		{
+			size_t i = (groups == 0) ? npos : find_free(h);
+
+			if (i == npos || (growth_left == 0 && ctrl[i] == detail_flat::ctrl_empty))
+			{
+				/* mostly deleted slots: rehash in place, otherwise double */
+				rehash_to((groups != 0 && elements < max_load(capacity()) / 2) ? groups : std::max<size_t>(2 * groups, 1));
+				i = find_free(h);
+			}
+
+			growth_left -= (ctrl[i] == detail_flat::ctrl_empty);
+			ctrl[i] = tag_of(h);
+			hashes[i] = h;
+			elements++;
+			return i;
+		}
+
+		void erase_index(size_t i)
+		{
+			slots[i].value.~value_type();
+			elements--;
+
+			/* A probe sequence only continues past full groups: if this group still has an empty slot, none goes through it
+			* and the slot can be empty again. Otherwise it is marked deleted, which lookups skip and insertions reuse.
+			*/
+			if (detail_flat::match_empty<detail_flat::group_bits>(group_ctrl(i / width)) != 0)
+			{
+				ctrl[i] = detail_flat::ctrl_empty;
+				growth_left++;
+			}
+			else
+			{
+				ctrl[i] = detail_flat::ctrl_deleted;
+			}
+		}
+
+		template <typename KeyArg, typename... Args>
+		std::pair<size_t, bool> emplace_key(KeyArg&& key, Args&&... args)
+		{
+			uint64_t const h = hash_fn(key);
+			size_t const found = find_index(key, h);
+
+			if (found != npos)
+			{
+				return { found, false };
+			}
+
+			size_t const i = claim(h);
+			new (&slots[i].value) value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<KeyArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+			return { i, true };
+		}
+
+		size_t next_full(size_t i) const
+		{
+			while (i < capacity() && ctrl[i] >= 0x80)
+			{
+				i++;
+			}
+
+			return i;
+		}
+
+		/* Hashes a batch of keys, prefetches their first groups, then looks them up. found(k, index) gets end() positions for absent keys. */
+		template <typename Q, typename F>
+		void find_many_impl(const Q* keys, size_t count, F&& found) const
+		{
+			constexpr size_t batch = 16;
+			uint64_t h[batch];
+
+			for (size_t first = 0; first < count; first += batch)
+			{
+				size_t const n = std::min(batch, count - first);
+
+				for (size_t k = 0; k < n; k++)
+				{
+					h[k] = hash_fn(keys[first + k]);
+				}
+
+				if (groups != 0)
+				{
+					for (size_t k = 0; k < n; k++)
+					{
+						intrin::prefetch(group_ctrl(first_group(h[k])));
+					}
+
+					/* the control bytes have arrived, or are on their way, while the rest were requested: prefetch the first candidate slot */
+					for (size_t k = 0; k < n; k++)
+					{
+						size_t const g = first_group(h[k]);
+						detail_flat::mask_t const m = detail_flat::match<detail_flat::group_bits>(group_ctrl(g), tag_of(h[k]));
+
+						if (m != 0)
+						{
+							intrin::prefetch(&slots[g * width + detail_flat::lowest(m)]);
+						}
+					}
+				}
+
+				for (size_t k = 0; k < n; k++)
+				{
+					size_t const i = find_index(keys[first + k], h[k]);
+					found(first + k, (i == npos) ? capacity() : i);
+				}
+			}
+		}
+
+
+		template <bool is_const>
+		class iterator_t
+		{
+			friend class flat_map;
+			template <bool> friend class iterator_t;
+			using map_t = std::conditional_t<is_const, const flat_map, flat_map>;
+
+			map_t* map = nullptr;
+			size_t index = 0;
+
+			iterator_t(map_t* map_, size_t index_) : map(map_), index(index_) {}
+
+		public:
+
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = flat_map::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+			using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+
+			iterator_t() = default;
+
+			/* iterator to const_iterator */
+			template <bool other_const, typename = std::enable_if_t<is_const && !other_const>>
+			iterator_t(const iterator_t<other_const>& other) : map(other.map), index(other.index) {}
+
+			reference operator*() const
+			{
+				return map->slots[index].value;
+			}
+
+			pointer operator->() const
+			{
+				return &map->slots[index].value;
+			}
+
+			iterator_t& operator++()
+			{
+				index = map->next_full(index + 1);
+				return *this;
+			}
+
+			iterator_t operator++(int)
+			{
+				iterator_t const before = *this;
+				++*this;
+				return before;
+			}
+
+			bool operator==(const iterator_t& other) const
+			{
+				return index == other.index;
+			}
+
+			bool operator!=(const iterator_t& other) const
+			{
+				return index != other.index;
+			}
+		};
+
+	public:
+
+		using iterator = iterator_t<false>;
+		using const_iterator = iterator_t<true>;
+
+		flat_map() = default;
+
+		explicit flat_map(size_t bucket_count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) : hash_fn(hash), eq_fn(equal)
+		{
+			reserve(bucket_count);
+		}
+
+		flat_map(std::initializer_list<value_type> init)
+		{
+			reserve(init.size());
+
+			for (const value_type& v : init)
+			{
+				insert(v);
+			}
+		}
+
+		/* Copies keep the layout of the source, hashes included. */
+		flat_map(const flat_map& other) : elements(other.elements), hash_fn(other.hash_fn), eq_fn(other.eq_fn)
+		{
+			if (other.groups != 0)
+			{
+				allocate(other.groups);
+				growth_left = other.growth_left;
+				memcpy(ctrl.get(), other.ctrl.get(), capacity());
+				memcpy(hashes.get(), other.hashes.get(), capacity() * sizeof(uint64_t));
+
+				for (size_t i = 0; i < capacity(); i++)
+				{
+					if (ctrl[i] < 0x80)
+					{
+						new (&slots[i].value) value_type(other.slots[i].value);
+					}
+				}
+			}
+		}
+
+		flat_map(flat_map&& other) noexcept : groups(other.groups), elements(other.elements), growth_left(other.growth_left), ctrl(std::move(other.ctrl)),
+			hashes(std::move(other.hashes)), slots(std::move(other.slots)), hash_fn(std::move(other.hash_fn)), eq_fn(std::move(other.eq_fn))
+		{
+			other.groups = 0;
+			other.elements = 0;
+			other.growth_left = 0;
+		}
+
+		flat_map& operator=(const flat_map& other)
+		{
+			if (this != &other)
+			{
+				flat_map copy(other);
+				swap(copy);
+			}
+
+			return *this;
+		}
+
+		flat_map& operator=(flat_map&& other) noexcept
+		{
+			flat_map moved(std::move(other));
+			swap(moved);
+			return *this;
+		}
+
+		~flat_map()
+		{
+			destroy_all();
+		}
+
+		void swap(flat_map& other) noexcept
+		{
+			std::swap(groups, other.groups);
+			std::swap(elements, other.elements);
+			std::swap(growth_left, other.growth_left);
+			std::swap(ctrl, other.ctrl);
+			std::swap(hashes, other.hashes);
+			std::swap(slots, other.slots);
+			std::swap(hash_fn, other.hash_fn);
+			std::swap(eq_fn, other.eq_fn);
+		}
+
+		iterator begin()
+		{
+			return iterator(this, next_full(0));
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, next_full(0));
+		}
+
+		iterator end()
+		{
+			return iterator(this, capacity());
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, capacity());
+		}
+
+		size_t size() const
+		{
+			return elements;
+		}
+
+		bool empty() const
+		{
+			return elements == 0;
+		}
+
+		size_t capacity() const
+		{
+			return groups * width;
+		}
+
+		const Hash& hash_function() const
+		{
+			return hash_fn;
+		}
+
+		/* Makes room for count elements without growing. */
+		void reserve(size_t count)
+		{
+			size_t new_groups = std::max<size_t>(groups, 1);
+
+			while (max_load(new_groups * width) < count)
+			{
+				new_groups *= 2;
+			}
+
+			if (new_groups != groups)
+			{
+				rehash_to(new_groups);
+			}
+		}
+
+		/* Destroys every element, keeping the capacity. */
+		void clear()
+		{
+			destroy_all();
+
+			if (groups != 0)
+			{
+				memset(ctrl.get(), detail_flat::ctrl_empty, capacity());
+			}
+
+			elements = 0;
+			growth_left = max_load(capacity());
+		}
+
+		/* *** Lookup *** */
+
+		iterator find(const K& key)
+		{
+			size_t const i = find_index(key, hash_fn(key));
+			return iterator(this, (i == npos) ? capacity() : i);
+		}
+
+		const_iterator find(const K& key) const
+		{
+			size_t const i = find_index(key, hash_fn(key));
+			return const_iterator(this, (i == npos) ? capacity() : i);
+		}
+
+		/* Heterogeneous lookup, e.g. by std::string_view or const char* in a map of std::string. */
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		iterator find(const Q& key)
+		{
+			size_t const i = find_index(key, hash_fn(key));
+			return iterator(this, (i == npos) ? capacity() : i);
+		}
+
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		const_iterator find(const Q& key) const
+		{
+			size_t const i = find_index(key, hash_fn(key));
+			return const_iterator(this, (i == npos) ? capacity() : i);
+		}
+
+		bool contains(const K& key) const
+		{
+			return find_index(key, hash_fn(key)) != npos;
+		}
+
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		bool contains(const Q& key) const
+		{
+			return find_index(key, hash_fn(key)) != npos;
+		}
+
+		size_t count(const K& key) const
+		{
+			return contains(key) ? 1 : 0;
+		}
+
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		size_t count(const Q& key) const
+		{
+			return contains(key) ? 1 : 0;
+		}
+
+		/* Looks up count keys, writing an iterator (end() if absent) to out for each. All keys are hashed first and the first group
+		* of each is prefetched, so the cache misses of independent lookups overlap instead of being taken one after the other.
+		*/
+		template <typename Q>
+		void find_many(const Q* keys, size_t count, const_iterator* out) const
+		{
+			find_many_impl(keys, count, [&](size_t k, size_t i) { out[k] = const_iterator(this, i); });
+		}
+
+		template <typename Q>
+		void find_many(const Q* keys, size_t count, iterator* out)
+		{
+			find_many_impl(keys, count, [&](size_t k, size_t i) { out[k] = iterator(this, i); });
+		}
+
+		/* *** Modifiers *** */
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+		{
+			auto const [i, inserted] = emplace_key(key, std::forward<Args>(args)...);
+			return { iterator(this, i), inserted };
+		}
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(K&& key, Args&&... args)
+		{
+			auto const [i, inserted] = emplace_key(std::move(key), std::forward<Args>(args)...);
+			return { iterator(this, i), inserted };
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value)
+		{
+			return try_emplace(value.first, value.second);
+		}
+
+		std::pair<iterator, bool> insert(value_type&& value)
+		{
+			return try_emplace(value.first, std::move(value.second));
+		}
+
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(const K& key, M&& mapped)
+		{
+			auto result = try_emplace(key, std::forward<M>(mapped));
+
+			if (!result.second)
+			{
+				result.first->second = std::forward<M>(mapped);
+			}
+
+			return result;
+		}
+
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(K&& key, M&& mapped)
+		{
+			auto result = try_emplace(std::move(key), std::forward<M>(mapped));
+
+			if (!result.second)
+			{
+				result.first->second = std::forward<M>(mapped);
+			}
+
+			return result;
+		}
+
+		V& operator[](const K& key)
+		{
+			return try_emplace(key).first->second;
+		}
+
+		V& operator[](K&& key)
+		{
+			return try_emplace(std::move(key)).first->second;
+		}
+
+		size_t erase(const K& key)
+		{
+			size_t const i = find_index(key, hash_fn(key));
+
+			if (i == npos)
+			{
+				return 0;
+			}
+
+			erase_index(i);
+			return 1;
+		}
+
+		template <typename Q, detail_flat::enable_lookup<Hash, KeyEqual, Q> = 0>
+		size_t erase(const Q& key)
+		{
+			size_t const i = find_index(key, hash_fn(key));
+
+			if (i == npos)
+			{
+				return 0;
+			}
+
+			erase_index(i);
+			return 1;
+		}
+
+		/* Returns the iterator following pos. Erasing never moves other elements. */
+		iterator erase(const_iterator pos)
+		{
+			erase_index(pos.index);
+			return iterator(this, next_full(pos.index + 1));
+		}
+	};
+}
@@ -0,0 +1,419 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Binary fuse filters for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Binary Fuse Filters
+	***************************************/
+
+	namespace detail_fuse
+	{
+		/* Seeds tried by a build before it gives up. Each try fails with a small probability, lower as the key count grows. */
+		constexpr size_t max_attempts = 100;
+
+		/* Keys hashed, and their fingerprints prefetched, ahead of the batch queries. */
+		constexpr size_t batch = 16;
+
+		struct layout
+		{
+			uint32_t segment_length = 4;
+			uint32_t segment_length_mask = 3;
+			uint32_t segment_count = 1;
+			uint32_t segment_count_length = 4;
+			uint32_t array_length = 12;
+		};
+
+		/* Sizes of Graf and Lemire's 3-wise binary fuse filters: segments of a power of 2 slots, growing with the key count up to 2^18,
+		* and about 1.125 slots per key for large sets, more for small ones.
+		*/
+		inline layout layout_for(size_t keys)
+		{
+			constexpr uint32_t arity = 3;
+			layout l;
+
+			if (keys == 0)
+			{
+				return l;
+			}
+
+			double const n = static_cast<double>(keys);
+			l.segment_length = (keys == 1) ? 4 : (uint32_t(1) << static_cast<int>(std::floor(std::log(n) / std::log(3.33) + 2.25)));
+			l.segment_length = std::min<uint32_t>(l.segment_length, 1u << 18);
+			l.segment_length_mask = l.segment_length - 1;
+
+			double const size_factor = (keys <= 1) ? 0.0 : std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / std::log(n));
+			uint32_t const capacity = static_cast<uint32_t>(std::round(n * size_factor));
+			uint32_t const initial_segments = std::max<uint32_t>((capacity + l.segment_length - 1) / l.segment_length, arity) - (arity - 1);
+			uint32_t const length = (initial_segments + arity - 1) * l.segment_length;
+			uint32_t const segments = (length + l.segment_length - 1) / l.segment_length;
+
+			l.segment_count = (segments <= arity - 1) ? 1 : segments - (arity - 1);
+			l.array_length = (l.segment_count + arity - 1) * l.segment_length;
+			l.segment_count_length = l.segment_count * l.segment_length;
+			return l;
+		}
+
+		/* The 3 slots of a hash: consecutive segments, the first picked by the high bits of the hash times the segment count, the offsets
+		* inside the second and third moved by 18 bit fields of the low bits.
+		*/
+		inline void slots_of(uint64_t h, const layout& l, uint32_t* out)
+		{
+			uint32_t const h0 = static_cast<uint32_t>(bit_ops::mul64to128(h, l.segment_count_length).high64);
+			uint32_t const h1 = h0 + l.segment_length;
+			uint32_t const h2 = h1 + l.segment_length;
+
+			out[0] = h0;
+			out[1] = h1 ^ (static_cast<uint32_t>(h >> 18) & l.segment_length_mask);
+			out[2] = h2 ^ (static_cast<uint32_t>(h) & l.segment_length_mask);
+		}
+
+		inline uint64_t fingerprint(uint64_t h)
+		{
+			return h ^ (h >> 32);
+		}
+
+		inline uint64_t next_seed(uint64_t& state)
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
+	}
+
+	/* A static filter for a fixed set of keys: smaller than a Bloom filter of the same false positive rate and answered with 3 memory reads.
+	* Every key has 3 slots in an array of Bits bit values, and the build sets the array so the 3 values of each key xor to its fingerprint.
+	* A query xors 3 values, with no branch, and compares: keys of the set always match, and other keys with probability 2^-Bits, which is 0.4%
+	* with 8 bits and 0.0015% with 16. Slots are about 1.125 per key for large sets, so 9 or 18 bits per key.
+	* Keys are hashed with xxhash3<64>(key, seed). The build peels keys off slots only they use; when that gets stuck it starts again with
+	* another seed, rehashing the keys. Hashes are first placed by the segment of their first slot, so the build visits the array nearly in order.
+	* Duplicate keys are allowed. Up to about 3.8 billion keys.
+	*/
+	template <size_t Bits>
+	class fuse_filter
+	{
+		static_assert(Bits == 8 || Bits == 16, "fuse_filter fingerprints are 8 or 16 bits");
+
+	public:
+
+		using value_type = std::conditional_t<Bits == 8, uint8_t, uint16_t>;
+
+	private:
+
+		detail_fuse::layout shape;
+		uint64_t seed_ = 0;
+		std::vector<value_type> values;
+
+		template <typename F>
+		bool build_with(size_t count, F&& hash_key)
+		{
+			if (count >= (size_t(1) << 32) / 9 * 8)
+			{
+				return false;
+			}
+
+			detail_fuse::layout const l = detail_fuse::layout_for(count);
+			uint32_t const capacity = l.array_length;
+			size_t size = count;
+
+			std::vector<uint64_t> order(count + 1);
+			std::vector<uint64_t> t2hash(capacity);
+			std::vector<uint8_t> t2count(capacity);
+			std::vector<uint32_t> alone(capacity);
+			std::vector<uint8_t> slot_of(count);
+
+			/* buckets of hashes by their top bits, as many as there are segments, rounded up to a power of 2 */
+			uint32_t block_bits = 1;
+
+			while ((uint32_t(1) << block_bits) < l.segment_count)
+			{
+				block_bits++;
+			}
+
+			uint32_t const blocks = uint32_t(1) << block_bits;
+			std::vector<size_t> start(blocks);
+			uint64_t state = 0x726B2B9D438B9D4DULL ^ count;
+			bool built = false;
+			bool deduplicate = false;
+
+			for (size_t attempt = 0; attempt < detail_fuse::max_attempts && !built; attempt++)
+			{
+				uint64_t const seed = detail_fuse::next_seed(state);
+
+				std::fill(order.begin(), order.end(), 0);
+				std::fill(t2hash.begin(), t2hash.end(), 0);
+				std::fill(t2count.begin(), t2count.end(), static_cast<uint8_t>(0));
+				order[count] = 1;
+
+				for (uint32_t b = 0; b < blocks; b++)
+				{
+					start[b] = static_cast<size_t>((static_cast<uint64_t>(b) * count) >> block_bits);
+				}
+
+				/* 0 marks a free place: a key hashing to 0 would be overwritten, which fails the attempt, and the next seed is tried */
+				for (size_t i = 0; i < count; i++)
+				{
+					uint64_t const h = hash_key(i, seed);
+					uint32_t b = static_cast<uint32_t>(h >> (64 - block_bits));
+
+					while (order[start[b]] != 0)
+					{
+						b = (b + 1) & (blocks - 1);
+					}
+
+					order[start[b]] = h;
+					start[b]++;
+				}
+
+				/* equal keys have equal hashes whatever the seed, so after an attempt failed with duplicates they are removed up front */
+				size = count;
+
+				if (deduplicate)
+				{
+					std::sort(order.begin(), order.begin() + count);
+					size = static_cast<size_t>(std::unique(order.begin(), order.begin() + count) - order.begin());
+				}
+
+				/* each slot counts its keys, times 4, and xors their hashes and their positions (0, 1 or 2) among the key's slots */
+				bool overflow = false;
+				size_t duplicates = 0;
+				uint32_t s[3];
+
+				for (size_t i = 0; i < size; i++)
+				{
+					uint64_t const h = order[i];
+					detail_fuse::slots_of(h, l, s);
+
+					for (uint32_t j = 0; j < 3; j++)
+					{
+						t2count[s[j]] = static_cast<uint8_t>((t2count[s[j]] + 4) ^ j);
+						t2hash[s[j]] ^= h;
+					}
+
+					/* a second copy of a key leaves one of its slots with two keys and a hash of 0: take the copy out again */
+					if ((t2hash[s[0]] & t2hash[s[1]] & t2hash[s[2]]) == 0 && ((t2hash[s[0]] == 0 && t2count[s[0]] == 8)
+						|| (t2hash[s[1]] == 0 && t2count[s[1]] == 8) || (t2hash[s[2]] == 0 && t2count[s[2]] == 8)))
+					{
+						duplicates++;
+
+						for (uint32_t j = 0; j < 3; j++)
+						{
+							t2count[s[j]] = static_cast<uint8_t>((t2count[s[j]] ^ j) - 4);
+							t2hash[s[j]] ^= h;
+						}
+					}
+
+					/* more than 63 keys in a slot wrap the count around */
+					overflow |= t2count[s[0]] < 4 || t2count[s[1]] < 4 || t2count[s[2]] < 4;
+				}
+
+				if (overflow)
+				{
+					continue;
+				}
+
+				/* peel: a slot with one key determines that key's value; removing the key may leave other slots with one */
+				size_t queued = 0;
+				size_t peeled = 0;
+
+				for (uint32_t i = 0; i < capacity; i++)
+				{
+					alone[queued] = i;
+					queued += ((t2count[i] >> 2) == 1) ? 1 : 0;
+				}
+
+				while (queued > 0)
+				{
+					uint32_t const index = alone[--queued];
+
+					if ((t2count[index] >> 2) != 1)
+					{
+						continue;
+					}
+
+					uint64_t const h = t2hash[index];
+					uint8_t const found = t2count[index] & 3;
+					uint32_t slots[5];
+
+					detail_fuse::slots_of(h, l, slots);
+					slots[3] = slots[0];
+					slots[4] = slots[1];
+
+					slot_of[peeled] = found;
+					order[peeled] = h;
+					peeled++;
+
+					for (uint32_t j = 1; j <= 2; j++)
+					{
+						uint32_t const other = slots[found + j];
+
+						alone[queued] = other;
+						queued += ((t2count[other] >> 2) == 2) ? 1 : 0;
+						t2count[other] = static_cast<uint8_t>((t2count[other] - 4) ^ ((found + j) % 3));
+						t2hash[other] ^= h;
+					}
+				}
+
+				if (peeled + duplicates == size)
+				{
+					size = peeled;
+					built = true;
+					seed_ = seed;
+				}
+
+				deduplicate |= duplicates > 0;
+			}
+
+			if (!built)
+			{
+				return false;
+			}
+
+			/* assign in reverse peeling order: each key's own slot is set last, from its other two */
+			std::vector<value_type> v(capacity, 0);
+
+			for (size_t i = size; i-- > 0; )
+			{
+				uint64_t const h = order[i];
+				uint32_t slots[5];
+
+				detail_fuse::slots_of(h, l, slots);
+				slots[3] = slots[0];
+				slots[4] = slots[1];
+
+				uint8_t const found = slot_of[i];
+				v[slots[found]] = static_cast<value_type>(detail_fuse::fingerprint(h) ^ v[slots[found + 1]] ^ v[slots[found + 2]]);
+			}
+
+			shape = l;
+			values = std::move(v);
+			return true;
+		}
+
+	public:
+
+		fuse_filter() = default;
+
+		/* Builds the filter for keys, replacing its contents. Returns false, leaving the filter unchanged, if no seed worked. */
+		bool build(const std::string_view* keys, size_t count)
+		{
+			return build_with(count, [keys](size_t i, uint64_t seed) { return xxhash3<64>(keys[i].data(), keys[i].size(), seed); });
+		}
+
+		/* Integer keys hash as their 8 little endian bytes. */
+		bool build(const uint64_t* keys, size_t count)
+		{
+			return build_with(count, [keys](size_t i, uint64_t seed) { return hash_id(keys[i], seed); });
+		}
+
+		static uint64_t hash_id(uint64_t key, uint64_t seed)
+		{
+			uint8_t bytes[8];
+			mem_ops::writeLE<64>(bytes, key);
+			return xxhash3<64>(bytes, sizeof(bytes), seed);
+		}
+
+		bool contains_hash(uint64_t h) const
+		{
+			uint32_t s[3];
+			detail_fuse::slots_of(h, shape, s);
+			return static_cast<value_type>(detail_fuse::fingerprint(h) ^ values[s[0]] ^ values[s[1]] ^ values[s[2]]) == 0;
+		}
+
+		bool contains(const void* key, size_t len) const
+		{
+			return !values.empty() && contains_hash(xxhash3<64>(key, len, seed_));
+		}
+
+		bool contains(std::string_view key) const
+		{
+			return contains(key.data(), key.size());
+		}
+
+		bool contains(uint64_t key) const
+		{
+			return !values.empty() && contains_hash(hash_id(key, seed_));
+		}
+
+		/* Hashes a batch of keys, prefetches their 3 values each, then answers the batch. */
+		void contains_many(const std::string_view* keys, size_t n, bool* out) const
+		{
+			contains_batches(n, out, [&](size_t i) { return xxhash3<64>(keys[i].data(), keys[i].size(), seed_); });
+		}
+
+		void contains_many(const uint64_t* keys, size_t n, bool* out) const
+		{
+			contains_batches(n, out, [&](size_t i) { return hash_id(keys[i], seed_); });
+		}
+
+		/* Bits per key of the set it was built for: the false positive rate is 2^-Bits whatever this is. */
+		double bits_per_key(size_t keys) const
+		{
+			return static_cast<double>(8 * size_bytes()) / static_cast<double>(std::max<size_t>(keys, 1));
+		}
+
+		size_t size_bytes() const
+		{
+			return values.size() * sizeof(value_type);
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+
+	private:
+
+		template <typename F>
+		void contains_batches(size_t n, bool* out, F&& hash_key) const
+		{
+			if (values.empty())
+			{
+				std::fill(out, out + n, false);
+				return;
+			}
+
+			uint64_t h[detail_fuse::batch];
+			uint32_t s[detail_fuse::batch][3];
+
+			for (size_t first = 0; first < n; first += detail_fuse::batch)
+			{
+				size_t const m = std::min(detail_fuse::batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					h[k] = hash_key(first + k);
+					detail_fuse::slots_of(h[k], shape, s[k]);
+					intrin::prefetch(&values[s[k][0]]);
+					intrin::prefetch(&values[s[k][1]]);
+					intrin::prefetch(&values[s[k][2]]);
+				}
+
+				for (size_t k = 0; k < m; k++)
+				{
+					out[first + k] = static_cast<value_type>(detail_fuse::fingerprint(h[k]) ^ values[s[k][0]] ^ values[s[k][1]] ^ values[s[k][2]]) == 0;
+				}
+			}
+		}
+	};
+
+	using fuse_filter8 = fuse_filter<8>;
+	using fuse_filter16 = fuse_filter<16>;
+}
@@ -0,0 +1,487 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Strings carrying their hash, for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+#if defined(__has_builtin)
+#	if __has_builtin(__builtin_is_constant_evaluated)
+#		define XXH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#	endif
+#endif
+
+namespace xxh
+{
+	/* *************************************
+	*  Compile Time Hashing
+	***************************************/
+
+	namespace detail_hashed
+	{
+		/* xxhash3<64> with seed 0, written for constant evaluation: bytes are read one at a time and products are split in 32 bit halves.
+		* It gives the same results as xxhash3<64> for every length, only much slower, so it is meant for literals.
+		*/
+
+		constexpr uint64_t read64(const char* p)
+		{
+			uint64_t v = 0;
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+			}
+
+			return v;
+		}
+
+		constexpr uint32_t read32(const char* p)
+		{
+			uint32_t v = 0;
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+			}
+
+			return v;
+		}
+
+		constexpr uint64_t secret64(size_t offset)
+		{
+			uint64_t v = 0;
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				v |= static_cast<uint64_t>(detail3::default_secret[offset + i]) << (8 * i);
+			}
+
+			return v;
+		}
+
+		constexpr uint32_t secret32(size_t offset)
+		{
+			return static_cast<uint32_t>(secret64(offset));
+		}
+
+		constexpr uint64_t rotl64(uint64_t x, uint32_t r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		constexpr uint64_t swap64(uint64_t x)
+		{
+			uint64_t v = 0;
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				v = (v << 8) | ((x >> (8 * i)) & 0xFF);
+			}
+
+			return v;
+		}
+
+		constexpr uint64_t mul128fold64(uint64_t x, uint64_t y)
+		{
+			uint64_t const lo_lo = (x & 0xFFFFFFFF) * (y & 0xFFFFFFFF);
+			uint64_t const hi_lo = (x >> 32) * (y & 0xFFFFFFFF);
+			uint64_t const lo_hi = (x & 0xFFFFFFFF) * (y >> 32);
+			uint64_t const hi_hi = (x >> 32) * (y >> 32);
+			uint64_t const cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+			uint64_t const upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+			uint64_t const lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+			return upper ^ lower;
+		}
+
+		constexpr uint64_t avalanche(uint64_t h)
+		{
+			h ^= h >> 37;
+			h *= 0x165667919E3779F9ULL;
+			h ^= h >> 32;
+			return h;
+		}
+
+		constexpr uint64_t xxh64_avalanche(uint64_t h)
+		{
+			h ^= h >> 33;
+			h *= detail::PRIME<64>(2);
+			h ^= h >> 29;
+			h *= detail::PRIME<64>(3);
+			h ^= h >> 32;
+			return h;
+		}
+
+		constexpr uint64_t rrmxmx(uint64_t h, uint64_t len)
+		{
+			h ^= rotl64(h, 49) ^ rotl64(h, 24);
+			h *= 0x9FB21C651E98DF25ULL;
+			h ^= (h >> 35) + len;
+			h *= 0x9FB21C651E98DF25ULL;
+			h ^= (h >> 28);
+			return h;
+		}
+
+		constexpr uint64_t mix_16b(const char* input, size_t secret_offset)
+		{
+			return mul128fold64(read64(input) ^ secret64(secret_offset), read64(input + 8) ^ secret64(secret_offset + 8));
+		}
+
+		constexpr uint64_t len_0to16(const char* input, size_t len)
+		{
+			if (len > 8)
+			{
+				uint64_t const input_lo = read64(input) ^ (secret64(24) ^ secret64(32));
+				uint64_t const input_hi = read64(input + len - 8) ^ (secret64(40) ^ secret64(48));
+
+				return avalanche(len + swap64(input_lo) + input_hi + mul128fold64(input_lo, input_hi));
+			}
+
+			if (len >= 4)
+			{
+				uint64_t const input64 = read32(input + len - 4) + (static_cast<uint64_t>(read32(input)) << 32);
+
+				return rrmxmx(input64 ^ (secret64(8) ^ secret64(16)), len);
+			}
+
+			if (len > 0)
+			{
+				uint32_t const combined = (static_cast<uint32_t>(static_cast<uint8_t>(input[0])) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(input[len >> 1])) << 24)
+					| static_cast<uint32_t>(static_cast<uint8_t>(input[len - 1])) | (static_cast<uint32_t>(len) << 8);
+
+				return xxh64_avalanche(static_cast<uint64_t>(combined) ^ (secret32(0) ^ secret32(4)));
+			}
+
+			return xxh64_avalanche(secret64(56) ^ secret64(64));
+		}
+
+		constexpr uint64_t len_17to240(const char* input, size_t len)
+		{
+			uint64_t acc = len * detail::PRIME<64>(1);
+
+			if (len <= 128)
+			{
+				size_t const pairs = (len - 1) / 32;
+
+				for (size_t i = pairs + 1; i-- > 0; )
+				{
+					acc += mix_16b(input + 16 * i, 32 * i);
+					acc += mix_16b(input + len - 16 * (i + 1), 32 * i + 16);
+				}
+
+				return avalanche(acc);
+			}
+
+			size_t const rounds = len / 16;
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				acc += mix_16b(input + 16 * i, 16 * i);
+			}
+
+			acc = avalanche(acc);
+
+			for (size_t i = 8; i < rounds; i++)
+			{
+				acc += mix_16b(input + 16 * i, 16 * (i - 8) + detail3::midsize_startoffset);
+			}
+
+			acc += mix_16b(input + len - 16, detail3::secret_size_min - detail3::midsize_lastoffset);
+
+			return avalanche(acc);
+		}
+
+		constexpr void accumulate_512(uint64_t* acc, const char* input, size_t secret_offset)
+		{
+			for (size_t i = 0; i < 8; i++)
+			{
+				uint64_t const data = read64(input + 8 * i);
+				uint64_t const key = data ^ secret64(secret_offset + 8 * i);
+
+				acc[i ^ 1] += data;
+				acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+			}
+		}
+
+		constexpr uint64_t hash_long(const char* input, size_t len)
+		{
+			uint64_t acc[8] = { detail::PRIME<32>(3), detail::PRIME<64>(1), detail::PRIME<64>(2), detail::PRIME<64>(3),
+				detail::PRIME<64>(4), detail::PRIME<32>(2), detail::PRIME<64>(5), detail::PRIME<32>(1) };
+
+			size_t const secret_size = detail3::secret_default_size;
+			size_t const stripes_per_block = (secret_size - 64) / 8;
+			size_t const block_len = 64 * stripes_per_block;
+			size_t const blocks = (len - 1) / block_len;
+
+			for (size_t b = 0; b < blocks; b++)
+			{
+				for (size_t s = 0; s < stripes_per_block; s++)
+				{
+					accumulate_512(acc, input + b * block_len + s * 64, s * 8);
+				}
+
+				for (size_t i = 0; i < 8; i++)
+				{
+					acc[i] ^= acc[i] >> 47;
+					acc[i] ^= secret64(secret_size - 64 + 8 * i);
+					acc[i] *= detail::PRIME<32>(1);
+				}
+			}
+
+			size_t const stripes = ((len - 1) - block_len * blocks) / 64;
+
+			for (size_t s = 0; s < stripes; s++)
+			{
+				accumulate_512(acc, input + blocks * block_len + s * 64, s * 8);
+			}
+
+			accumulate_512(acc, input + len - 64, secret_size - 64 - 7);
+
+			uint64_t result = len * detail::PRIME<64>(1);
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				result += mul128fold64(acc[2 * i] ^ secret64(detail3::secret_mergeaccs_start + 16 * i), acc[2 * i + 1] ^ secret64(detail3::secret_mergeaccs_start + 16 * i + 8));
+			}
+
+			return avalanche(result);
+		}
+
+		constexpr uint64_t xxhash3_64(const char* input, size_t len)
+		{
+			if (len <= 16)
+			{
+				return len_0to16(input, len);
+			}
+
+			if (len <= detail3::midsize_max)
+			{
+				return len_17to240(input, len);
+			}
+
+			return hash_long(input, len);
+		}
+
+		/* The constant evaluated version for the compiler, xxhash3<64> at run time where the compiler tells them apart. */
+		constexpr uint64_t hash_literal(const char* input, size_t len)
+		{
+#if defined(XXH_IS_CONSTANT_EVALUATED)
+			if (!XXH_IS_CONSTANT_EVALUATED())
+			{
+				return xxhash3<64>(input, len);
+			}
+#endif
+			return xxhash3_64(input, len);
+		}
+	}
+
+
+	/* *************************************
+	*  Hashed Strings
+	***************************************/
+
+	/* A view of a string together with its xxhash3<64>, seed 0, computed once when the view is made. Views of literals are hashed by the
+	* compiler when they are constant expressions:
+	*
+	*     constexpr xxh::hashed_string_view key("user_id");
+	*     using namespace xxh::literals;
+	*     constexpr auto other = "session"_xxh;
+	*
+	* Equality compares the hashes before the bytes, and flat_hash, and so flat_map, concurrent_map and interner with seed 0, use the stored
+	* hash instead of hashing the key again.
+	*/
+	class hashed_string_view
+	{
+		const char* ptr = "";
+		size_t length = 0;
+		uint64_t digest = detail_hashed::xxhash3_64("", 0);
+
+	public:
+
+		constexpr hashed_string_view() noexcept = default;
+
+		/* A string literal, or any array holding a string followed by its terminator. */
+		template <size_t N>
+		constexpr hashed_string_view(const char (&literal)[N]) noexcept : ptr(literal), length(N - 1), digest(detail_hashed::hash_literal(literal, N - 1))
+		{
+		}
+
+		explicit hashed_string_view(std::string_view s) noexcept : ptr(s.data()), length(s.size()), digest(xxhash3<64>(s.data(), s.size()))
+		{
+		}
+
+		/* A string whose hash is known already: hash must be xxhash3<64>(data, size), seed 0. */
+		constexpr hashed_string_view(const char* data, size_t size, uint64_t hash) noexcept : ptr(data), length(size), digest(hash)
+		{
+		}
+
+		constexpr const char* data() const noexcept
+		{
+			return ptr;
+		}
+
+		constexpr size_t size() const noexcept
+		{
+			return length;
+		}
+
+		constexpr bool empty() const noexcept
+		{
+			return length == 0;
+		}
+
+		constexpr uint64_t hash() const noexcept
+		{
+			return digest;
+		}
+
+		constexpr std::string_view view() const noexcept
+		{
+			return std::string_view(ptr, length);
+		}
+
+		constexpr operator std::string_view() const noexcept
+		{
+			return view();
+		}
+	};
+
+	/* An owning string together with its xxhash3<64>, seed 0. The hash is computed once, when the string is set, and is kept by copies. */
+	class hashed_string
+	{
+		std::string text;
+		uint64_t digest = detail_hashed::xxhash3_64("", 0);
+
+	public:
+
+		hashed_string() = default;
+
+		explicit hashed_string(std::string s) : text(std::move(s)), digest(xxhash3<64>(text.data(), text.size()))
+		{
+		}
+
+		explicit hashed_string(std::string_view s) : text(s), digest(xxhash3<64>(s.data(), s.size()))
+		{
+		}
+
+		explicit hashed_string(const char* s) : hashed_string(std::string_view(s))
+		{
+		}
+
+		/* Copies the bytes and keeps the hash of the view. */
+		explicit hashed_string(hashed_string_view s) : text(s.view()), digest(s.hash())
+		{
+		}
+
+		const std::string& str() const noexcept
+		{
+			return text;
+		}
+
+		/* Gives the string up, leaving this one empty. */
+		std::string release()
+		{
+			std::string out = std::move(text);
+
+			text.clear();
+			digest = detail_hashed::xxhash3_64("", 0);
+			return out;
+		}
+
+		const char* data() const noexcept
+		{
+			return text.data();
+		}
+
+		size_t size() const noexcept
+		{
+			return text.size();
+		}
+
+		bool empty() const noexcept
+		{
+			return text.empty();
+		}
+
+		uint64_t hash() const noexcept
+		{
+			return digest;
+		}
+
+		std::string_view view() const noexcept
+		{
+			return text;
+		}
+
+		operator hashed_string_view() const noexcept
+		{
+			return hashed_string_view(text.data(), text.size(), digest);
+		}
+	};
+
+	/* Strings with different hashes differ, so most unequal pairs are told apart without reading their bytes. */
+	inline bool operator==(hashed_string_view a, hashed_string_view b) noexcept
+	{
+		return a.hash() == b.hash() && a.size() == b.size() && (a.data() == b.data() || memcmp(a.data(), b.data(), a.size()) == 0);
+	}
+
+	inline bool operator!=(hashed_string_view a, hashed_string_view b) noexcept
+	{
+		return !(a == b);
+	}
+
+	namespace detail_hashed
+	{
+		/* For overloads next to a std::string_view one: a template, so that literals still take the plain view and are not hashed twice. */
+		template <typename H>
+		using enable_hashed = std::enable_if_t<std::is_same_v<H, hashed_string_view> || std::is_same_v<H, hashed_string>, int>;
+
+		/* Other strings compare by their bytes, without being hashed. */
+		template <typename S>
+		using enable_plain = std::enable_if_t<std::is_convertible_v<const S&, std::string_view> && !std::is_same_v<S, hashed_string_view> && !std::is_same_v<S, hashed_string>, int>;
+	}
+
+	template <typename S, detail_hashed::enable_plain<S> = 0>
+	bool operator==(hashed_string_view a, const S& b) noexcept
+	{
+		return a.view() == std::string_view(b);
+	}
+
+	template <typename S, detail_hashed::enable_plain<S> = 0>
+	bool operator==(const S& a, hashed_string_view b) noexcept
+	{
+		return std::string_view(a) == b.view();
+	}
+
+	template <typename S, detail_hashed::enable_plain<S> = 0>
+	bool operator!=(hashed_string_view a, const S& b) noexcept
+	{
+		return !(a == b);
+	}
+
+	template <typename S, detail_hashed::enable_plain<S> = 0>
+	bool operator!=(const S& a, hashed_string_view b) noexcept
+	{
+		return !(a == b);
+	}
+
+	namespace literals
+	{
+		constexpr hashed_string_view operator""_xxh(const char* s, size_t n) noexcept
+		{
+			return hashed_string_view(s, n, detail_hashed::hash_literal(s, n));
+		}
+	}
+}
@@ -0,0 +1,646 @@
+#pragma once
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+HyperLogLog sketches for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  HyperLogLog
+	***************************************/
+
+	namespace detail_hll
+	{
+		constexpr uint8_t magic[4] = { 'X', 'X', 'H', 'L' };
+		constexpr uint32_t format_version = 1;
+		constexpr size_t header_size = 24;
+
+		constexpr uint8_t kind_sparse = 0;
+		constexpr uint8_t kind_dense = 1;
+
+		/* Sparse entries keep 25 bits of index, whatever the precision, so small sets are counted almost exactly. */
+		constexpr uint32_t sparse_precision = 25;
+
+		/* Keys hashed at a time by the batch inserts. */
+		constexpr size_t batch = 16;
+
+		/* Registers summed in float lanes before the partial sum is added in double. */
+		constexpr size_t sum_chunk = 256;
+
+		/* Registers are compared and summed 32 at a time with AVX2, 16 with SSE2, one at a time otherwise. */
+		constexpr size_t lane_bits = (intrin::vector_mode >= 2) ? 256 : ((intrin::vector_mode >= 1) ? 128 : 64);
+
+		/* Position of the first 1 after the top p bits of h, from 1 to 65 - p. */
+		inline uint8_t rank(uint64_t h, uint32_t p)
+		{
+			uint64_t const w = (h << p) | (uint64_t(1) << (p - 1));
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, w);
+			return static_cast<uint8_t>(64 - index);
+#elif defined(__GNUC__)
+			return static_cast<uint8_t>(__builtin_clzll(w) + 1);
+#else
+			uint8_t r = 1;
+
+			for (uint64_t bit = uint64_t(1) << 63; !(w & bit); bit >>= 1)
+			{
+				r++;
+			}
+
+			return r;
+#endif
+		}
+
+		/* A sparse entry: the top 25 bits of the hash, then its 6 bit rank after them. Sorted entries group by index. */
+		inline uint32_t sparse_entry(uint64_t h)
+		{
+			return static_cast<uint32_t>((h >> (64 - sparse_precision)) << 6) | rank(h, sparse_precision);
+		}
+
+		/* A hash with the index and rank of an entry, which gives the same register and rank as the hashes it stands for at any lower precision. */
+		inline uint64_t entry_hash(uint32_t e)
+		{
+			uint32_t const r = e & 63;
+			uint64_t const low = (r <= 64 - sparse_precision) ? (uint64_t(1) << (64 - sparse_precision - r)) : 0;
+			return (static_cast<uint64_t>(e >> 6) << (64 - sparse_precision)) | low;
+		}
+
+		/* Sorts entries and keeps the highest rank of every index. */
+		inline void normalize(std::vector<uint32_t>& entries)
+		{
+			std::sort(entries.begin(), entries.end());
+			size_t out = 0;
+
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				if (out > 0 && (entries[out - 1] >> 6) == (entries[i] >> 6))
+				{
+					out--;
+				}
+
+				entries[out++] = entries[i];
+			}
+
+			entries.resize(out);
+		}
+
+		template <size_t N>
+		XXH_FORCE_INLINE void max_registers(uint8_t* dst, const uint8_t* src, size_t m)
+		{
+			static_assert(!(N != 256 && N != 128 && N != 64), "Invalid template argument passed to xxh::detail_hll::max_registers");
+
+			size_t i = 0;
+
+			if constexpr (N == 256)
+			{
+				for (; i + 32 <= m; i += 32)
+				{
+					__m256i const a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+					__m256i const b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_max_epu8(a, b));
+				}
+			}
+			else if constexpr (N == 128)
+			{
+				for (; i + 16 <= m; i += 16)
+				{
+					__m128i const a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+					__m128i const b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_max_epu8(a, b));
+				}
+			}
+
+			for (; i < m; i++)
+			{
+				dst[i] = std::max(dst[i], src[i]);
+			}
+		}
+
+		struct register_sums
+		{
+			double harmonic = 0.0;
+			size_t zeros = 0;
+		};
+
+		/* Sum of 2^-r over registers, and the count of zero registers. A float 2^-r is built from its exponent bits, 127 - r. */
+		template <size_t N>
+		XXH_FORCE_INLINE register_sums sum_registers(const uint8_t* regs, size_t m)
+		{
+			static_assert(!(N != 256 && N != 128 && N != 64), "Invalid template argument passed to xxh::detail_hll::sum_registers");
+
+			register_sums sums;
+			size_t i = 0;
+
+			if constexpr (N == 256)
+			{
+				__m256i const bias = _mm256_set1_epi32(127);
+
+				for (; i + sum_chunk <= m; i += sum_chunk)
+				{
+					__m256 acc = _mm256_setzero_ps();
+
+					for (size_t j = i; j < i + sum_chunk; j += 32)
+					{
+						__m256i const r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(regs + j));
+						sums.zeros += std::bitset<32>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(r, _mm256_setzero_si256())))).count();
+
+						for (size_t k = 0; k < 32; k += 8)
+						{
+							__m256i const r32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(regs + j + k)));
+							acc = _mm256_add_ps(acc, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(bias, r32), 23)));
+						}
+					}
+
+					alignas(32) float lanes[8];
+					_mm256_store_ps(lanes, acc);
+
+					for (float lane : lanes)
+					{
+						sums.harmonic += lane;
+					}
+				}
+			}
+			else if constexpr (N == 128)
+			{
+				__m128i const bias = _mm_set1_epi32(127);
+				__m128i const zero = _mm_setzero_si128();
+
+				for (; i + sum_chunk <= m; i += sum_chunk)
+				{
+					__m128 acc = _mm_setzero_ps();
+
+					for (size_t j = i; j < i + sum_chunk; j += 16)
+					{
+						__m128i const r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(regs + j));
+						sums.zeros += std::bitset<16>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(r, zero)))).count();
+
+						__m128i const r16[2] = { _mm_unpacklo_epi8(r, zero), _mm_unpackhi_epi8(r, zero) };
+
+						for (__m128i const half : r16)
+						{
+							acc = _mm_add_ps(acc, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, _mm_unpacklo_epi16(half, zero)), 23)));
+							acc = _mm_add_ps(acc, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, _mm_unpackhi_epi16(half, zero)), 23)));
+						}
+					}
+
+					alignas(16) float lanes[4];
+					_mm_store_ps(lanes, acc);
+
+					for (float lane : lanes)
+					{
+						sums.harmonic += lane;
+					}
+				}
+			}
+
+			for (; i < m; i++)
+			{
+				sums.harmonic += 1.0 / static_cast<double>(uint64_t(1) << regs[i]);
+				sums.zeros += (regs[i] == 0) ? 1 : 0;
+			}
+
+			return sums;
+		}
+
+		/* sigma(x) = x + sum over k >= 1 of x^(2^k) 2^(k-1), for x the share of empty registers. */
+		inline double sigma(double x)
+		{
+			if (x == 1.0)
+			{
+				return std::numeric_limits<double>::infinity();
+			}
+
+			double y = 1.0;
+			double z = x;
+
+			for (double previous = -1.0; z != previous; y += y)
+			{
+				previous = z;
+				x *= x;
+				z += x * y;
+			}
+
+			return z;
+		}
+
+		/* Ertl's improved raw estimator: empty registers count as m sigma(zeros / m) instead of 1 each, which removes the bias of the
+		* plain estimator at small counts without switching to linear counting. No register saturates with a 64 bit hash.
+		*/
+		inline double estimate_dense(const register_sums& sums, size_t m)
+		{
+			double const dm = static_cast<double>(m);
+			double const zeros = static_cast<double>(sums.zeros);
+			return 0.5 / std::log(2.0) * dm * dm / (sums.harmonic - zeros + dm * sigma(zeros / dm));
+		}
+
+		/* Linear counting over the 2^25 sparse indices. */
+		inline double estimate_sparse(size_t indices)
+		{
+			double const dm = static_cast<double>(uint64_t(1) << sparse_precision);
+			return dm * std::log(dm / (dm - static_cast<double>(indices)));
+		}
+
+		inline size_t write_varint(uint8_t* p, uint32_t x)
+		{
+			size_t n = 0;
+
+			while (x >= 0x80)
+			{
+				p[n++] = static_cast<uint8_t>(x | 0x80);
+				x >>= 7;
+			}
+
+			p[n++] = static_cast<uint8_t>(x);
+			return n;
+		}
+
+		inline bool read_varint(const uint8_t*& p, const uint8_t* end, uint32_t& x)
+		{
+			x = 0;
+
+			for (uint32_t shift = 0; shift < 35 && p < end; shift += 7)
+			{
+				uint8_t const byte = *p++;
+				x |= static_cast<uint32_t>(byte & 0x7F) << shift;
+
+				if (!(byte & 0x80))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+	}
+
+	/* A HyperLogLog sketch: estimates the number of distinct keys inserted, in 2^P registers, with a standard error of 1.04 / sqrt(2^P),
+	* 0.4% at the default P = 16 (64 KB). A key is hashed once with xxhash3<64>(key, seed): the top P bits pick a register, which keeps the
+	* highest rank, the position of the first 1 bit after them. Small sets start sparse: a sorted list of 4 byte entries keeping 25 bits of
+	* index, counted almost exactly, which turns into registers once it would take more space than they do. Registers are merged with byte
+	* max and estimated with a harmonic sum, 32 registers per AVX2 instruction. Sketches with the same P and seed merge into the sketch of
+	* the union, and serialize to a varint list when sparse or 6 bits per register when dense.
+	*/
+	template <size_t P = 16>
+	class hyperloglog
+	{
+		static_assert(P >= 4 && P <= 18, "hyperloglog precision is 4 to 18 bits");
+
+		static constexpr size_t m = size_t(1) << P;
+
+		/* Unsorted entries are added up to this count before being merged into the sorted list. */
+		static constexpr size_t pending_limit = m / 16 + 16;
+
+		uint64_t seed_;
+		bool dense = false;
+		std::vector<uint32_t> sparse;
+		std::vector<uint32_t> pending;
+		std::vector<uint8_t> registers;
+
+		template <size_t Q>
+		friend std::vector<uint8_t> serialize_hyperloglog(const hyperloglog<Q>& sketch);
+		template <size_t Q>
+		friend bool parse_hyperloglog(const void* data, size_t size, hyperloglog<Q>& sketch);
+
+		void insert_dense(uint64_t h)
+		{
+			uint8_t& r = registers[h >> (64 - P)];
+			r = std::max(r, detail_hll::rank(h, P));
+		}
+
+		void to_dense()
+		{
+			registers.assign(m, 0);
+
+			for (uint32_t e : sparse)
+			{
+				insert_dense(detail_hll::entry_hash(e));
+			}
+
+			for (uint32_t e : pending)
+			{
+				insert_dense(detail_hll::entry_hash(e));
+			}
+
+			sparse = std::vector<uint32_t>();
+			pending = std::vector<uint32_t>();
+			dense = true;
+		}
+
+		/* Merges the pending entries in, turning dense once the list outgrows the registers. */
+		void flush()
+		{
+			sparse.insert(sparse.end(), pending.begin(), pending.end());
+			pending.clear();
+			detail_hll::normalize(sparse);
+
+			if (sparse.size() * sizeof(uint32_t) > m)
+			{
+				to_dense();
+			}
+		}
+
+	public:
+
+		static constexpr size_t precision = P;
+		static constexpr size_t register_count = m;
+
+		explicit hyperloglog(uint64_t seed = 0) : seed_(seed)
+		{
+		}
+
+		void insert_hash(uint64_t h)
+		{
+			if (dense)
+			{
+				insert_dense(h);
+				return;
+			}
+
+			pending.push_back(detail_hll::sparse_entry(h));
+
+			if (pending.size() >= pending_limit)
+			{
+				flush();
+			}
+		}
+
+		void insert(const void* key, size_t len)
+		{
+			insert_hash(xxhash3<64>(key, len, seed_));
+		}
+
+		void insert(std::string_view key)
+		{
+			insert(key.data(), key.size());
+		}
+
+		void insert_many(const uint64_t* hashes, size_t n)
+		{
+			size_t i = 0;
+
+			while (i < n && !dense)
+			{
+				insert_hash(hashes[i++]);
+			}
+
+			for (; i < n; i++)
+			{
+				insert_dense(hashes[i]);
+			}
+		}
+
+		/* Hashes a batch of keys, with no dependency from one to the next, then inserts the batch. */
+		void insert_many(const std::string_view* keys, size_t n)
+		{
+			uint64_t h[detail_hll::batch];
+
+			for (size_t first = 0; first < n; first += detail_hll::batch)
+			{
+				size_t const b = std::min(detail_hll::batch, n - first);
+
+				for (size_t k = 0; k < b; k++)
+				{
+					h[k] = xxhash3<64>(keys[first + k].data(), keys[first + k].size(), seed_);
+				}
+
+				insert_many(h, b);
+			}
+		}
+
+		/* Adds the keys of other, making this the sketch of the union. Returns false, changing nothing, if the seeds differ. */
+		bool merge(const hyperloglog& other)
+		{
+			if (other.seed_ != seed_)
+			{
+				return false;
+			}
+
+			if (!other.dense)
+			{
+				for (uint32_t e : other.sparse)
+				{
+					insert_hash(detail_hll::entry_hash(e));
+				}
+
+				for (uint32_t e : other.pending)
+				{
+					insert_hash(detail_hll::entry_hash(e));
+				}
+
+				return true;
+			}
+
+			if (!dense)
+			{
+				to_dense();
+			}
+
+			detail_hll::max_registers<detail_hll::lane_bits>(registers.data(), other.registers.data(), m);
+			return true;
+		}
+
+		/* Estimated count of distinct keys inserted. */
+		double estimate() const
+		{
+			if (dense)
+			{
+				return detail_hll::estimate_dense(detail_hll::sum_registers<detail_hll::lane_bits>(registers.data(), m), m);
+			}
+
+			if (pending.empty())
+			{
+				return detail_hll::estimate_sparse(sparse.size());
+			}
+
+			std::vector<uint32_t> entries(sparse);
+			entries.insert(entries.end(), pending.begin(), pending.end());
+			detail_hll::normalize(entries);
+
+			if (entries.size() * sizeof(uint32_t) > m)
+			{
+				hyperloglog copy(*this);
+				copy.flush();
+				return copy.estimate();
+			}
+
+			return detail_hll::estimate_sparse(entries.size());
+		}
+
+		bool is_sparse() const
+		{
+			return !dense;
+		}
+
+		void clear()
+		{
+			dense = false;
+			sparse.clear();
+			pending.clear();
+			registers = std::vector<uint8_t>();
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+	};
+
+	/* A 24 byte header, then the sorted entries as varint deltas when sparse, or 4 registers per 3 bytes when dense. */
+	template <size_t P>
+	inline std::vector<uint8_t> serialize_hyperloglog(const hyperloglog<P>& sketch)
+	{
+		hyperloglog<P> copy(sketch);
+
+		if (!copy.dense)
+		{
+			copy.flush();
+		}
+
+		std::vector<uint8_t> out(detail_hll::header_size, 0);
+		memcpy(out.data(), detail_hll::magic, 4);
+		mem_ops::writeLE<32>(out.data() + 4, detail_hll::format_version);
+		mem_ops::writeLE<64>(out.data() + 8, sketch.seed());
+		out[16] = static_cast<uint8_t>(P);
+		out[17] = copy.dense ? detail_hll::kind_dense : detail_hll::kind_sparse;
+
+		if (copy.dense)
+		{
+			out.resize(detail_hll::header_size + hyperloglog<P>::register_count / 4 * 3);
+			uint8_t* p = out.data() + detail_hll::header_size;
+
+			for (size_t i = 0; i < hyperloglog<P>::register_count; i += 4, p += 3)
+			{
+				uint32_t const packed = copy.registers[i] | (copy.registers[i + 1] << 6) | (copy.registers[i + 2] << 12) | (copy.registers[i + 3] << 18);
+				p[0] = static_cast<uint8_t>(packed);
+				p[1] = static_cast<uint8_t>(packed >> 8);
+				p[2] = static_cast<uint8_t>(packed >> 16);
+			}
+
+			return out;
+		}
+
+		mem_ops::writeLE<32>(out.data() + 20, static_cast<uint32_t>(copy.sparse.size()));
+		out.resize(detail_hll::header_size + 5 * copy.sparse.size());
+		size_t size = detail_hll::header_size;
+		uint32_t previous = 0;
+
+		for (uint32_t e : copy.sparse)
+		{
+			size += detail_hll::write_varint(out.data() + size, e - previous);
+			previous = e;
+		}
+
+		out.resize(size);
+		return out;
+	}
+
+	/* Replaces sketch with a serialized one. Returns false, leaving it unchanged, if data is not a sketch of the same precision. */
+	template <size_t P>
+	inline bool parse_hyperloglog(const void* data, size_t size, hyperloglog<P>& sketch)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (size < detail_hll::header_size || memcmp(p, detail_hll::magic, 4) != 0 || mem_ops::readLE<32>(p + 4) != detail_hll::format_version || p[16] != P)
+		{
+			return false;
+		}
+
+		hyperloglog<P> parsed(mem_ops::readLE<64>(p + 8));
+
+		if (p[17] == detail_hll::kind_dense)
+		{
+			if (size != detail_hll::header_size + hyperloglog<P>::register_count / 4 * 3)
+			{
+				return false;
+			}
+
+			parsed.registers.resize(hyperloglog<P>::register_count);
+			parsed.dense = true;
+			const uint8_t* q = p + detail_hll::header_size;
+
+			for (size_t i = 0; i < hyperloglog<P>::register_count; i += 4, q += 3)
+			{
+				uint32_t const packed = q[0] | (q[1] << 8) | (q[2] << 16);
+
+				for (size_t k = 0; k < 4; k++)
+				{
+					parsed.registers[i + k] = static_cast<uint8_t>((packed >> (6 * k)) & 63);
+
+					if (parsed.registers[i + k] > 65 - P)
+					{
+						return false;
+					}
+				}
+			}
+		}
+		else if (p[17] == detail_hll::kind_sparse)
+		{
+			uint32_t const count = mem_ops::readLE<32>(p + 20);
+			const uint8_t* q = p + detail_hll::header_size;
+			const uint8_t* const end = p + size;
+			uint32_t e = 0;
+
+			if (count > size)
+			{
+				return false;
+			}
+
+			parsed.sparse.reserve(count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t delta;
+
+				if (!detail_hll::read_varint(q, end, delta) || e + delta < e)
+				{
+					return false;
+				}
+
+				e += delta;
+
+				/* strictly increasing indices, ranks from 1 to 40 */
+				if ((e >> 6) >> detail_hll::sparse_precision || (e & 63) == 0 || (e & 63) > 65 - detail_hll::sparse_precision
+					|| (!parsed.sparse.empty() && (parsed.sparse.back() >> 6) >= (e >> 6)))
+				{
+					return false;
+				}
+
+				parsed.sparse.push_back(e);
+			}
+
+			if (q != end)
+			{
+				return false;
+			}
+
+			if (parsed.sparse.size() * sizeof(uint32_t) > hyperloglog<P>::register_count)
+			{
+				parsed.to_dense();
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		sketch = std::move(parsed);
+		return true;
+	}
+}
@@ -0,0 +1,474 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_hashed_string.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+String interning for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  String Interning
+	***************************************/
+
+	namespace detail_interner
+	{
+		/* Strings are copied into chunks of this size; longer ones than a quarter of it get an allocation of their own. */
+		constexpr size_t chunk_size = 64 * 1024;
+
+		/* Entries of the front cache of each thread, direct mapped by hash: 8 KB, so it stays in L1. */
+		constexpr size_t front_entries = 256;
+
+		/* Strings interned per lock acquisition by the batch functions. */
+		constexpr size_t batch = 32;
+
+		struct front_entry
+		{
+			/* generation of the interner that filled the entry, 0 for none */
+			uint64_t owner = 0;
+			uint64_t hash = 0;
+			const char* data = nullptr;
+			uint32_t size = 0;
+			uint32_t id = 0;
+		};
+
+		/* Every interner, and every clear(), gets a generation of its own. A front cache entry is only used by the generation
+		* that filled it, so it never points into a pool that was freed or cleared, even if a new interner reuses the same address.
+		*/
+		inline uint64_t next_generation()
+		{
+			static std::atomic<uint64_t> generation{ 0 };
+			return generation.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+
+		inline front_entry* front_cache()
+		{
+			static thread_local front_entry entries[front_entries];
+			return entries;
+		}
+	}
+
+	/* A pool of unique strings: interning a string returns the same id and the same std::string_view, pointing into the pool, for equal contents.
+	* Views stay valid until clear() or destruction, so they can be compared by pointer and used as keys. Bytes are copied into 64 KB chunks.
+	* Every entry keeps its xxhash3<64>, so growing the table moves 8 byte slots without hashing any string again; a slot holds the entry id and
+	* the high half of its hash, so probes compare strings only when 32 bits of hash agree as well.
+	* The pool is safe to share between threads: lookups take a shared lock and insertions an exclusive one. In front of it, each thread has
+	* a small cache of the strings it interned last, which answers repeated identifiers without touching the lock or the table.
+	* The batch functions hash a whole batch first, with no dependency from one hash to the next, then resolve its misses under one lock.
+	*/
+	class interner
+	{
+	public:
+
+		using id_type = uint32_t;
+		static constexpr id_type npos = ~id_type(0);
+
+	private:
+
+		struct entry_ref
+		{
+			id_type id;
+			std::string_view view;
+		};
+
+		uint64_t seed;
+		uint64_t generation;
+
+		mutable std::shared_mutex mutex;
+		std::vector<uint64_t> slots;
+		std::vector<std::string_view> views;
+		std::vector<uint64_t> hashes;
+		std::vector<std::unique_ptr<char[]>> chunks;
+		char* chunk_next = nullptr;
+		size_t chunk_left = 0;
+		size_t arena_bytes = 0;
+
+		static uint64_t slot_value(uint64_t h, id_type id)
+		{
+			return (h & 0xFFFFFFFF00000000ULL) | (static_cast<uint64_t>(id) + 1);
+		}
+
+		/* Slot holding s, or the empty slot where it belongs. */
+		size_t probe(uint64_t h, std::string_view s, bool& found) const
+		{
+			size_t const mask = slots.size() - 1;
+			size_t i = static_cast<size_t>(h) & mask;
+
+			while (true)
+			{
+				uint64_t const v = slots[i];
+
+				if (v == 0)
+				{
+					found = false;
+					return i;
+				}
+
+				if ((v >> 32) == (h >> 32) && views[(v & 0xFFFFFFFF) - 1] == s)
+				{
+					found = true;
+					return i;
+				}
+
+				i = (i + 1) & mask;
+			}
+		}
+
+		const char* store(std::string_view s)
+		{
+			if (s.size() > detail_interner::chunk_size / 4)
+			{
+				chunks.emplace_back(new char[s.size()]);
+				arena_bytes += s.size();
+				memcpy(chunks.back().get(), s.data(), s.size());
+				return chunks.back().get();
+			}
+
+			if (chunk_left < s.size())
+			{
+				chunks.emplace_back(new char[detail_interner::chunk_size]);
+				arena_bytes += detail_interner::chunk_size;
+				chunk_next = chunks.back().get();
+				chunk_left = detail_interner::chunk_size;
+			}
+
+			char* const at = chunk_next;
+			memcpy(at, s.data(), s.size());
+			chunk_next += s.size();
+			chunk_left -= s.size();
+			return at;
+		}
+
+		/* Doubles the table. Entries go to their new slots by their stored hashes. */
+		void grow()
+		{
+			std::vector<uint64_t> bigger(std::max<size_t>(2 * slots.size(), 64), 0);
+			size_t const mask = bigger.size() - 1;
+
+			for (id_type id = 0; id < views.size(); id++)
+			{
+				size_t i = static_cast<size_t>(hashes[id]) & mask;
+
+				while (bigger[i] != 0)
+				{
+					i = (i + 1) & mask;
+				}
+
+				bigger[i] = slot_value(hashes[id], id);
+			}
+
+			slots.swap(bigger);
+		}
+
+		/* Under the exclusive lock. */
+		entry_ref insert(uint64_t h, std::string_view s)
+		{
+			if (4 * (views.size() + 1) > 3 * slots.size())
+			{
+				grow();
+			}
+
+			bool found;
+			size_t const i = probe(h, s, found);
+
+			if (found)
+			{
+				id_type const id = static_cast<id_type>((slots[i] & 0xFFFFFFFF) - 1);
+				return { id, views[id] };
+			}
+
+			id_type const id = static_cast<id_type>(views.size());
+			std::string_view const stored(s.empty() ? "" : store(s), s.size());
+
+			views.push_back(stored);
+			hashes.push_back(h);
+			slots[i] = slot_value(h, id);
+			return { id, stored };
+		}
+
+		/* Under a lock, either kind. */
+		bool lookup(uint64_t h, std::string_view s, entry_ref& out) const
+		{
+			if (slots.empty())
+			{
+				return false;
+			}
+
+			bool found;
+			size_t const i = probe(h, s, found);
+
+			if (found)
+			{
+				out.id = static_cast<id_type>((slots[i] & 0xFFFFFFFF) - 1);
+				out.view = views[out.id];
+			}
+
+			return found;
+		}
+
+		detail_interner::front_entry& front_slot(uint64_t h) const
+		{
+			return detail_interner::front_cache()[(h >> 7) & (detail_interner::front_entries - 1)];
+		}
+
+		bool front_lookup(uint64_t h, std::string_view s, entry_ref& out) const
+		{
+			const detail_interner::front_entry& e = front_slot(h);
+
+			if (e.owner == generation && e.hash == h && e.size == s.size() && memcmp(e.data, s.data(), s.size()) == 0)
+			{
+				out = { e.id, std::string_view(e.data, e.size) };
+				return true;
+			}
+
+			return false;
+		}
+
+		void front_fill(uint64_t h, const entry_ref& ref) const
+		{
+			if (ref.view.size() <= 0xFFFFFFFF)
+			{
+				front_slot(h) = { generation, h, ref.view.data(), static_cast<uint32_t>(ref.view.size()), ref.id };
+			}
+		}
+
+		/* Hashed strings carry the hash the pool uses when its seed is 0. */
+		uint64_t hash_of(hashed_string_view s) const
+		{
+			return (seed == 0) ? s.hash() : xxhash3<64>(s.data(), s.size(), seed);
+		}
+
+		entry_ref intern_entry(uint64_t h, std::string_view s)
+		{
+			entry_ref ref;
+
+			if (front_lookup(h, s, ref))
+			{
+				return ref;
+			}
+
+			bool found;
+			{
+				std::shared_lock<std::shared_mutex> lock(mutex);
+				found = lookup(h, s, ref);
+			}
+
+			if (!found)
+			{
+				std::unique_lock<std::shared_mutex> lock(mutex);
+				ref = insert(h, s);
+			}
+
+			front_fill(h, ref);
+			return ref;
+		}
+
+		id_type find_hashed(uint64_t h, std::string_view s) const
+		{
+			entry_ref ref;
+
+			if (front_lookup(h, s, ref))
+			{
+				return ref.id;
+			}
+
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return lookup(h, s, ref) ? ref.id : npos;
+		}
+
+		/* Interns count strings, calling put(k, entry_ref) for each. */
+		template <typename F>
+		void intern_batch(const std::string_view* tokens, size_t count, F&& put)
+		{
+			uint64_t h[detail_interner::batch];
+			size_t missing[detail_interner::batch];
+
+			for (size_t first = 0; first < count; first += detail_interner::batch)
+			{
+				size_t const n = std::min(detail_interner::batch, count - first);
+				size_t misses = 0;
+
+				for (size_t k = 0; k < n; k++)
+				{
+					h[k] = xxhash3<64>(tokens[first + k].data(), tokens[first + k].size(), seed);
+				}
+
+				for (size_t k = 0; k < n; k++)
+				{
+					entry_ref ref;
+
+					if (front_lookup(h[k], tokens[first + k], ref))
+					{
+						put(first + k, ref);
+					}
+					else
+					{
+						missing[misses++] = k;
+					}
+				}
+
+				if (misses == 0)
+				{
+					continue;
+				}
+
+				size_t still_missing = 0;
+				{
+					std::shared_lock<std::shared_mutex> lock(mutex);
+
+					if (!slots.empty())
+					{
+						for (size_t m = 0; m < misses; m++)
+						{
+							intrin::prefetch(&slots[static_cast<size_t>(h[missing[m]]) & (slots.size() - 1)]);
+						}
+					}
+
+					for (size_t m = 0; m < misses; m++)
+					{
+						size_t const k = missing[m];
+						entry_ref ref;
+
+						if (lookup(h[k], tokens[first + k], ref))
+						{
+							front_fill(h[k], ref);
+							put(first + k, ref);
+						}
+						else
+						{
+							missing[still_missing++] = k;
+						}
+					}
+				}
+
+				if (still_missing == 0)
+				{
+					continue;
+				}
+
+				std::unique_lock<std::shared_mutex> lock(mutex);
+
+				for (size_t m = 0; m < still_missing; m++)
+				{
+					size_t const k = missing[m];
+					entry_ref const ref = insert(h[k], tokens[first + k]);
+
+					front_fill(h[k], ref);
+					put(first + k, ref);
+				}
+			}
+		}
+
+	public:
+
+		explicit interner(uint64_t seed_ = 0) : seed(seed_), generation(detail_interner::next_generation())
+		{
+		}
+
+		interner(const interner&) = delete;
+		interner& operator=(const interner&) = delete;
+
+		/* The pooled copy of s. */
+		std::string_view intern(std::string_view s)
+		{
+			return intern_entry(xxhash3<64>(s.data(), s.size(), seed), s).view;
+		}
+
+		template <typename H, detail_hashed::enable_hashed<H> = 0>
+		std::string_view intern(const H& s)
+		{
+			return intern_entry(hash_of(s), s.view()).view;
+		}
+
+		/* Id of s, in order of first interning from 0. */
+		id_type intern_id(std::string_view s)
+		{
+			return intern_entry(xxhash3<64>(s.data(), s.size(), seed), s).id;
+		}
+
+		template <typename H, detail_hashed::enable_hashed<H> = 0>
+		id_type intern_id(const H& s)
+		{
+			return intern_entry(hash_of(s), s.view()).id;
+		}
+
+		void intern_many(const std::string_view* tokens, size_t count, std::string_view* out)
+		{
+			intern_batch(tokens, count, [out](size_t k, const entry_ref& ref) { out[k] = ref.view; });
+		}
+
+		void intern_many(const std::string_view* tokens, size_t count, id_type* out)
+		{
+			intern_batch(tokens, count, [out](size_t k, const entry_ref& ref) { out[k] = ref.id; });
+		}
+
+		/* Id of s if it was interned, npos otherwise. */
+		id_type find(std::string_view s) const
+		{
+			return find_hashed(xxhash3<64>(s.data(), s.size(), seed), s);
+		}
+
+		template <typename H, detail_hashed::enable_hashed<H> = 0>
+		id_type find(const H& s) const
+		{
+			return find_hashed(hash_of(s), s.view());
+		}
+
+		std::string_view view(id_type id) const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return views[id];
+		}
+
+		/* xxhash3<64>(string, seed) of an entry, as stored. */
+		uint64_t hash(id_type id) const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return hashes[id];
+		}
+
+		size_t size() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return views.size();
+		}
+
+		/* Bytes held by the pool: string chunks, table slots, and the view and hash of every entry. */
+		size_t memory_usage() const
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			return arena_bytes + slots.capacity() * sizeof(uint64_t) + views.capacity() * sizeof(std::string_view)
+				+ hashes.capacity() * sizeof(uint64_t) + chunks.capacity() * sizeof(std::unique_ptr<char[]>);
+		}
+
+		/* Forgets every string: views and ids handed out so far become invalid. Not concurrent with other calls. */
+		void clear()
+		{
+			std::unique_lock<std::shared_mutex> lock(mutex);
+
+			slots.clear();
+			views.clear();
+			hashes.clear();
+			chunks.clear();
+			chunk_next = nullptr;
+			chunk_left = 0;
+			arena_bytes = 0;
+			generation = detail_interner::next_generation();
+		}
+	};
+}
@@ -0,0 +1,410 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+#include "xxhash_file.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Directory tree manifests for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Directory Tree Hashing
+	***************************************/
+
+	/* One regular file of a tree. path is relative to the root, with '/' separators on every platform. */
+	struct manifest_entry
+	{
+		std::string path;
+		uint64_t size = 0;
+		/* last write time in nanoseconds, only used to decide whether a file can be skipped next time */
+		int64_t mtime = 0;
+		hash128_t hash = {};
+	};
+
+	/* Entries sorted by path (byte-wise), and the root digest derived from them.
+	* The root digest is xxhash3<128>(seed) over, for each entry in order: LE64(path length) || path || LE64(size) || canonical128(hash).
+	* It depends neither on the traversal order nor on modification times, so identical trees give identical digests.
+	*/
+	struct manifest
+	{
+		std::vector<manifest_entry> entries;
+		hash128_t root = {};
+
+		const manifest_entry* find(const std::string& path) const
+		{
+			auto const it = std::lower_bound(entries.begin(), entries.end(), path, [](const manifest_entry& e, const std::string& p) { return e.path < p; });
+			return (it != entries.end() && it->path == path) ? &*it : nullptr;
+		}
+	};
+
+	struct tree_hash_options
+	{
+		uint64_t seed = 0;
+		/* Workers listing directories and hashing files, at most. Per-file open and read latency dominates on small files, so this may well exceed the core count. */
+		size_t threads = 2 * std::max(1u, std::thread::hardware_concurrency());
+		/* Descend into symlinked directories and hash the targets of symlinked files. Otherwise symlinks are skipped. */
+		bool follow_symlinks = false;
+		/* Incremental mode: files whose size and mtime match their entry here are not read again, the previous hash is reused.
+		* Like every mtime based scheme, this misses a change that keeps both the size and the timestamp.
+		*/
+		const manifest* previous = nullptr;
+	};
+
+	struct tree_hash_result
+	{
+		xxh::manifest manifest;
+		/* Paths that could not be listed or read, relative to the root. They are left out of the manifest. */
+		std::vector<std::pair<std::string, std::error_code>> errors;
+		size_t files_hashed = 0;
+		size_t files_reused = 0;
+
+		bool ok() const
+		{
+			return errors.empty();
+		}
+	};
+
+	namespace detail_manifest
+	{
+		namespace fs = std::filesystem;
+
+		inline int64_t to_nanoseconds(fs::file_time_type time)
+		{
+			return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+		}
+
+		inline std::string join(const std::string& dir, const std::string& name)
+		{
+			return dir.empty() ? name : dir + "/" + name;
+		}
+
+		/* Lists directories with up to options.threads threads. A shared queue holds the directories still to be listed; the walk is over
+		* once the queue is empty and no worker is listing anything, since only a listing can add more directories.
+		*/
+		class walker
+		{
+			const fs::path& root;
+			const tree_hash_options& options;
+
+			std::mutex mutex;
+			std::condition_variable changed;
+			std::vector<std::string> pending;
+			size_t listing = 0;
+
+		public:
+
+			std::vector<manifest_entry> files;
+			std::vector<std::pair<std::string, std::error_code>> errors;
+
+			walker(const fs::path& root_, const tree_hash_options& options_) : root(root_), options(options_)
+			{
+			}
+
+			void list(const std::string& dir, std::vector<std::string>& subdirs, std::vector<manifest_entry>& found, std::vector<std::pair<std::string, std::error_code>>& failed)
+			{
+				std::error_code ec;
+				fs::directory_iterator it(root / fs::u8path(dir), ec);
+
+				if (ec)
+				{
+					failed.emplace_back(dir, ec);
+					return;
+				}
+
+				for (; it != fs::directory_iterator(); it.increment(ec))
+				{
+					std::string const path = join(dir, it->path().filename().u8string());
+					fs::file_status const status = options.follow_symlinks ? it->status(ec) : it->symlink_status(ec);
+
+					if (ec)
+					{
+						failed.emplace_back(path, ec);
+						ec.clear();
+						continue;
+					}
+
+					if (fs::is_directory(status))
+					{
+						subdirs.push_back(path);
+					}
+					else if (fs::is_regular_file(status))
+					{
+						manifest_entry entry;
+						entry.path = path;
+						entry.size = it->file_size(ec);
+
+						if (!ec)
+						{
+							entry.mtime = to_nanoseconds(it->last_write_time(ec));
+						}
+
+						if (ec)
+						{
+							failed.emplace_back(path, ec);
+							ec.clear();
+							continue;
+						}
+
+						found.push_back(std::move(entry));
+					}
+				}
+
+				if (ec)
+				{
+					failed.emplace_back(dir, ec);
+				}
+			}
+
+			void work()
+			{
+				std::vector<std::string> subdirs;
+				std::vector<manifest_entry> found;
+				std::vector<std::pair<std::string, std::error_code>> failed;
+				std::unique_lock<std::mutex> lock(mutex);
+
+				while (true)
+				{
+					changed.wait(lock, [&]() { return !pending.empty() || listing == 0; });
+
+					if (pending.empty())
+					{
+						break;
+					}
+
+					std::string const dir = std::move(pending.back());
+					pending.pop_back();
+					listing++;
+					lock.unlock();
+
+					list(dir, subdirs, found, failed);
+
+					lock.lock();
+					listing--;
+					pending.insert(pending.end(), std::make_move_iterator(subdirs.begin()), std::make_move_iterator(subdirs.end()));
+					subdirs.clear();
+					changed.notify_all();
+				}
+
+				files.insert(files.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+				errors.insert(errors.end(), failed.begin(), failed.end());
+			}
+
+			void run()
+			{
+				pending.push_back(std::string());
+
+				std::vector<std::thread> workers;
+
+				for (size_t i = 1; i < std::max<size_t>(options.threads, 1); i++)
+				{
+					workers.emplace_back([this]() { work(); });
+				}
+
+				work();
+
+				for (auto& worker : workers)
+				{
+					worker.join();
+				}
+			}
+		};
+
+		inline hash128_t root_digest(const std::vector<manifest_entry>& entries, uint64_t seed)
+		{
+			hash3_state128_t state(seed);
+			uint8_t header[8];
+			uint8_t trailer[8 + sizeof(canonical128_t)];
+
+			for (const manifest_entry& entry : entries)
+			{
+				canonical128_t const canonical(entry.hash);
+
+				mem_ops::writeLE<64>(header, static_cast<uint64_t>(entry.path.size()));
+				mem_ops::writeLE<64>(trailer, entry.size);
+				memcpy(trailer + 8, canonical.digest.data(), sizeof(canonical128_t));
+
+				state.update(header, sizeof(header));
+				state.update(entry.path.data(), entry.path.size());
+				state.update(trailer, sizeof(trailer));
+			}
+
+			return state.digest();
+		}
+	}
+
+	/* Hashes every regular file under root with xxhash3<128> and returns the sorted manifest with its root digest.
+	* Directories are listed and files hashed by up to options.threads workers.
+	*/
+	inline tree_hash_result hash_tree(const std::filesystem::path& root, const tree_hash_options& options = tree_hash_options())
+	{
+		tree_hash_result result;
+		detail_manifest::walker walk(root, options);
+
+		walk.run();
+
+		std::vector<manifest_entry>& entries = walk.files;
+		std::sort(entries.begin(), entries.end(), [](const manifest_entry& a, const manifest_entry& b) { return a.path < b.path; });
+
+		std::vector<std::error_code> file_errors(entries.size());
+		std::vector<uint8_t> reused(entries.size(), 0);
+		file_hash_options file_options;
+		file_options.seed = options.seed;
+
+		thread_pool pool(std::max<size_t>(options.threads, 1));
+
+		pool.parallel_for(entries.size(), [&](size_t i) {
+			manifest_entry& entry = entries[i];
+
+			if (options.previous)
+			{
+				const manifest_entry* const before = options.previous->find(entry.path);
+
+				if (before && before->size == entry.size && before->mtime == entry.mtime)
+				{
+					entry.hash = before->hash;
+					reused[i] = 1;
+					return;
+				}
+			}
+
+			file_hash_result<128> const hashed = hash_file<128>((root / std::filesystem::u8path(entry.path)).string(), file_options);
+			entry.hash = hashed.hash;
+			entry.size = hashed.bytes;
+			file_errors[i] = hashed.error;
+		});
+
+		result.errors = std::move(walk.errors);
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (file_errors[i])
+			{
+				result.errors.emplace_back(entries[i].path, file_errors[i]);
+				continue;
+			}
+
+			(reused[i] ? result.files_reused : result.files_hashed)++;
+			result.manifest.entries.push_back(std::move(entries[i]));
+		}
+
+		std::sort(result.errors.begin(), result.errors.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		result.manifest.root = detail_manifest::root_digest(result.manifest.entries, options.seed);
+		return result;
+	}
+
+	/* Text form of a manifest, one "<hash> <size> <mtime> <path>" line per entry, hash in canonical hexadecimal.
+	* Backslashes and newlines in paths are escaped as \\ and \n.
+	*/
+	inline void write_manifest(std::ostream& out, const manifest& m)
+	{
+		static const char digits[] = "0123456789abcdef";
+
+		for (const manifest_entry& entry : m.entries)
+		{
+			canonical128_t const canonical(entry.hash);
+
+			for (uint8_t b : canonical.digest)
+			{
+				out << digits[b >> 4] << digits[b & 15];
+			}
+
+			out << ' ' << entry.size << ' ' << entry.mtime << ' ';
+
+			for (char c : entry.path)
+			{
+				if (c == '\\')
+				{
+					out << "\\\\";
+				}
+				else if (c == '\n')
+				{
+					out << "\\n";
+				}
+				else
+				{
+					out << c;
+				}
+			}
+
+			out << '\n';
+		}
+	}
+
+	/* Reads what write_manifest wrote and recomputes the root digest with the given seed. Returns false on a malformed line. */
+	inline bool read_manifest(std::istream& in, manifest& m, uint64_t seed = 0)
+	{
+		m.entries.clear();
+		std::string line;
+
+		while (std::getline(in, line))
+		{
+			std::istringstream fields(line);
+			std::string hex;
+			manifest_entry entry;
+
+			if (!(fields >> hex >> entry.size >> entry.mtime) || hex.size() != 2 * sizeof(canonical128_t) || fields.get() != ' ')
+			{
+				return false;
+			}
+
+			canonical128_t canonical(hash128_t{ 0, 0 });
+
+			for (size_t i = 0; i < hex.size(); i++)
+			{
+				char const c = hex[i];
+				int const nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+
+				if (nibble < 0)
+				{
+					return false;
+				}
+
+				canonical.digest[i / 2] = static_cast<uint8_t>((canonical.digest[i / 2] << 4) | nibble);
+			}
+
+			entry.hash = canonical.get_hash();
+
+			std::string path;
+			std::getline(fields, path);
+
+			for (size_t i = 0; i < path.size(); i++)
+			{
+				if (path[i] == '\\' && i + 1 < path.size())
+				{
+					entry.path += (path[++i] == 'n') ? '\n' : path[i];
+				}
+				else
+				{
+					entry.path += path[i];
+				}
+			}
+
+			m.entries.push_back(std::move(entry));
+		}
+
+		std::sort(m.entries.begin(), m.entries.end(), [](const manifest_entry& a, const manifest_entry& b) { return a.path < b.path; });
+		m.root = detail_manifest::root_digest(m.entries, seed);
+		return true;
+	}
+}
@@ -0,0 +1,398 @@
+#pragma once
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Merkle trees for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Merkle Trees
+	***************************************/
+
+	/* Leaves [first_leaf, last_leaf) of a tree, and the tokens they cover, first_token to last_token inclusive. */
+	struct merkle_range
+	{
+		size_t first_leaf = 0;
+		size_t last_leaf = 0;
+		uint64_t first_token = 0;
+		uint64_t last_token = 0;
+	};
+
+	namespace detail_merkle
+	{
+		constexpr uint8_t magic[4] = { 'X', 'X', 'H', 'M' };
+		constexpr uint32_t format_version = 1;
+		constexpr uint32_t depth_max = 24;
+		constexpr size_t header_size = 32;
+
+		/* Records whose encoding fits are hashed in one call from the stack, larger ones through a streaming state. */
+		constexpr size_t record_buffer_size = 256;
+
+		/* The sum of a leaf is a multiset hash: records are added and removed in any order, lane by lane modulo 2^64. */
+		inline hash128_t add(hash128_t a, hash128_t b)
+		{
+			return { a.low64 + b.low64, a.high64 + b.high64 };
+		}
+
+		inline hash128_t sub(hash128_t a, hash128_t b)
+		{
+			return { a.low64 - b.low64, a.high64 - b.high64 };
+		}
+
+		inline hash128_t combine(hash128_t left, hash128_t right, uint64_t seed)
+		{
+			uint8_t buffer[32];
+			canonical128_t const l(left);
+			canonical128_t const r(right);
+
+			memcpy(buffer, l.digest.data(), 16);
+			memcpy(buffer + 16, r.digest.data(), 16);
+			return xxhash3<128>(buffer, sizeof(buffer), seed);
+		}
+	}
+
+	/* A Merkle tree over a key/value set, for replicas to find where they differ by exchanging a few digests instead of every record.
+	* Keys are spread over 2^depth leaves by their token, xxhash3<64>(key, seed): the top depth bits of the token select the leaf, so both sides
+	* place a key in the same leaf whatever else they hold, which fixed split points in key order would not guarantee.
+	* A record hashes to xxhash3<128>(LE64(key size) || key || value, seed), and a leaf holds the sum of its records' hashes, so one record is
+	* added or removed in constant time and the leaf does not depend on insertion order. An internal node is xxhash3<128>(seed) of the canonical
+	* digests of its two children.
+	* Updates only touch leaves. Their paths to the root are rehashed on the next rehash(), or the next call that needs internal nodes,
+	* each affected node once however many of its leaves changed.
+	*/
+	class merkle_tree
+	{
+		uint32_t levels;
+		uint64_t seed_;
+		/* heap order: the root is nodes[1], the children of node i are 2i and 2i + 1, and the leaves are the last leaf_count() nodes */
+		mutable std::vector<hash128_t> nodes;
+		/* leaves changed since the last rehash, possibly with duplicates */
+		mutable std::vector<size_t> dirty;
+		mutable std::vector<size_t> parents;
+		size_t records = 0;
+
+		hash128_t record_hash(std::string_view key, std::string_view value) const
+		{
+			if (8 + key.size() + value.size() <= detail_merkle::record_buffer_size)
+			{
+				uint8_t buffer[detail_merkle::record_buffer_size];
+
+				mem_ops::writeLE<64>(buffer, key.size());
+				memcpy(buffer + 8, key.data(), key.size());
+				memcpy(buffer + 8 + key.size(), value.data(), value.size());
+				return xxhash3<128>(buffer, 8 + key.size() + value.size(), seed_);
+			}
+
+			hash3_state128_t state(seed_);
+			uint8_t size[8];
+
+			mem_ops::writeLE<64>(size, key.size());
+			state.update(size, 8);
+			state.update(key.data(), key.size());
+			state.update(value.data(), value.size());
+			return state.digest();
+		}
+
+		void change_leaf(size_t leaf, hash128_t h, bool insert)
+		{
+			hash128_t& node = nodes[leaf_count() + leaf];
+
+			node = insert ? detail_merkle::add(node, h) : detail_merkle::sub(node, h);
+			dirty.push_back(leaf_count() + leaf);
+		}
+
+		size_t rehash_dirty() const
+		{
+			size_t hashed = 0;
+
+			std::sort(dirty.begin(), dirty.end());
+
+			/* level by level: the sorted parents of the sorted nodes below are deduplicated by comparing neighbours */
+			while (!dirty.empty() && dirty.front() > 1)
+			{
+				parents.clear();
+
+				for (size_t const node : dirty)
+				{
+					if (parents.empty() || parents.back() != node / 2)
+					{
+						parents.push_back(node / 2);
+					}
+				}
+
+				for (size_t const parent : parents)
+				{
+					nodes[parent] = detail_merkle::combine(nodes[2 * parent], nodes[2 * parent + 1], seed_);
+				}
+
+				hashed += parents.size();
+				dirty.swap(parents);
+			}
+
+			dirty.clear();
+			return hashed;
+		}
+
+		void rehash_all()
+		{
+			for (size_t i = leaf_count() - 1; i >= 1; i--)
+			{
+				nodes[i] = detail_merkle::combine(nodes[2 * i], nodes[2 * i + 1], seed_);
+			}
+
+			dirty.clear();
+		}
+
+		friend bool parse_merkle_tree(const void* data, size_t size, merkle_tree& tree);
+
+	public:
+
+		/* depth is clamped to [1, 24]: 2 to 16M leaves, 32 bytes of nodes per leaf. */
+		explicit merkle_tree(uint32_t depth = 12, uint64_t seed = 0) : levels(std::clamp<uint32_t>(depth, 1, detail_merkle::depth_max)), seed_(seed)
+		{
+			nodes.assign(size_t(2) << levels, hash128_t{});
+			rehash_all();
+		}
+
+		uint32_t depth() const
+		{
+			return levels;
+		}
+
+		uint64_t seed() const
+		{
+			return seed_;
+		}
+
+		size_t leaf_count() const
+		{
+			return size_t(1) << levels;
+		}
+
+		/* Number of records, counting inserts minus erases. */
+		size_t size() const
+		{
+			return records;
+		}
+
+		uint64_t token(std::string_view key) const
+		{
+			return xxhash3<64>(key.data(), key.size(), seed_);
+		}
+
+		size_t leaf_of(std::string_view key) const
+		{
+			return static_cast<size_t>(token(key) >> (64 - levels));
+		}
+
+		/* Adds a record. Inserting a key twice, or erasing a record that was not inserted, leaves a leaf no replica can match. */
+		void insert(std::string_view key, std::string_view value)
+		{
+			change_leaf(leaf_of(key), record_hash(key, value), true);
+			records++;
+		}
+
+		void erase(std::string_view key, std::string_view value)
+		{
+			change_leaf(leaf_of(key), record_hash(key, value), false);
+			records--;
+		}
+
+		/* Replaces the value of a record: both hashes go to the same leaf, whose path is rehashed once. */
+		void update(std::string_view key, std::string_view old_value, std::string_view new_value)
+		{
+			size_t const leaf = leaf_of(key);
+
+			change_leaf(leaf, detail_merkle::sub(record_hash(key, new_value), record_hash(key, old_value)), true);
+		}
+
+		/* Replaces the content of the tree with records [first, last), whose elements have key and value as first and second,
+		* e.g. a std::map<std::string, std::string>. Every node is hashed once.
+		*/
+		template <typename InputIt>
+		void assign(InputIt first, InputIt last)
+		{
+			std::fill(nodes.begin(), nodes.end(), hash128_t{});
+			records = 0;
+
+			for (; first != last; ++first)
+			{
+				std::string_view const key(first->first);
+				std::string_view const value(first->second);
+				hash128_t& leaf = nodes[leaf_count() + leaf_of(key)];
+
+				leaf = detail_merkle::add(leaf, record_hash(key, value));
+				records++;
+			}
+
+			rehash_all();
+		}
+
+		/* Brings internal nodes up to date with the leaves. Returns the number of nodes hashed. */
+		size_t rehash()
+		{
+			return rehash_dirty();
+		}
+
+		hash128_t root() const
+		{
+			rehash_dirty();
+			return nodes[1];
+		}
+
+		/* Node by heap index, 1 to 2 * leaf_count() - 1. */
+		hash128_t node(size_t index) const
+		{
+			rehash_dirty();
+			return nodes[index];
+		}
+
+		hash128_t leaf(size_t index) const
+		{
+			return nodes[leaf_count() + index];
+		}
+
+		/* First token of a leaf. leaf_token(leaf_count()) wraps around to 0. */
+		uint64_t leaf_token(size_t index) const
+		{
+			return static_cast<uint64_t>(index) << (64 - levels);
+		}
+	};
+
+	/* Ranges of leaves that differ between two trees, in order, adjacent leaves merged. Only subtrees whose roots differ are visited.
+	* Trees of different depths or seeds cannot be compared: the whole token range is returned.
+	*/
+	inline std::vector<merkle_range> merkle_diff(const merkle_tree& a, const merkle_tree& b)
+	{
+		std::vector<merkle_range> ranges;
+		size_t const leaves = a.leaf_count();
+
+		auto add_range = [&](size_t first, size_t last) {
+			if (!ranges.empty() && ranges.back().last_leaf == first)
+			{
+				ranges.back().last_leaf = last;
+			}
+			else
+			{
+				ranges.push_back(merkle_range{ first, last, 0, 0 });
+			}
+		};
+
+		if (a.depth() != b.depth() || a.seed() != b.seed())
+		{
+			add_range(0, leaves);
+		}
+		else
+		{
+			/* depth first, left child on top, so leaves come out in order */
+			std::vector<size_t> stack = { 1 };
+
+			while (!stack.empty())
+			{
+				size_t const node = stack.back();
+				stack.pop_back();
+
+				if (a.node(node) == b.node(node))
+				{
+					continue;
+				}
+
+				if (node >= leaves)
+				{
+					add_range(node - leaves, node - leaves + 1);
+				}
+				else
+				{
+					stack.push_back(2 * node + 1);
+					stack.push_back(2 * node);
+				}
+			}
+		}
+
+		for (merkle_range& range : ranges)
+		{
+			range.first_token = a.leaf_token(range.first_leaf);
+			range.last_token = a.leaf_token(range.last_leaf) - 1;
+		}
+
+		return ranges;
+	}
+
+	/* Serialized form, little endian: "XXHM" | u32 version | u32 depth | u32 reserved | u64 seed | u64 record count | canonical128 root |
+	* canonical128 per leaf. Internal nodes are left out and recomputed on parsing, which also checks them against the root.
+	*/
+	inline std::vector<uint8_t> serialize_merkle_tree(const merkle_tree& tree)
+	{
+		std::vector<uint8_t> out(detail_merkle::header_size + 16 + 16 * tree.leaf_count());
+		canonical128_t const root(tree.root());
+
+		memcpy(out.data(), detail_merkle::magic, 4);
+		mem_ops::writeLE<32>(out.data() + 4, detail_merkle::format_version);
+		mem_ops::writeLE<32>(out.data() + 8, tree.depth());
+		mem_ops::writeLE<32>(out.data() + 12, 0);
+		mem_ops::writeLE<64>(out.data() + 16, tree.seed());
+		mem_ops::writeLE<64>(out.data() + 24, tree.size());
+		memcpy(out.data() + detail_merkle::header_size, root.digest.data(), 16);
+
+		for (size_t i = 0; i < tree.leaf_count(); i++)
+		{
+			canonical128_t const leaf(tree.leaf(i));
+			memcpy(out.data() + detail_merkle::header_size + 16 * (i + 1), leaf.digest.data(), 16);
+		}
+
+		return out;
+	}
+
+	/* Returns false, leaving tree unchanged, if data is not a valid tree or its leaves do not hash to its root. */
+	inline bool parse_merkle_tree(const void* data, size_t size, merkle_tree& tree)
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+
+		if (size < detail_merkle::header_size + 16 || memcmp(p, detail_merkle::magic, 4) != 0 || mem_ops::readLE<32>(p + 4) != detail_merkle::format_version)
+		{
+			return false;
+		}
+
+		uint32_t const depth = mem_ops::readLE<32>(p + 8);
+
+		if (depth < 1 || depth > detail_merkle::depth_max || size != detail_merkle::header_size + 16 + (size_t(16) << depth))
+		{
+			return false;
+		}
+
+		merkle_tree parsed(depth, mem_ops::readLE<64>(p + 16));
+		canonical128_t root(hash128_t{});
+
+		parsed.records = static_cast<size_t>(mem_ops::readLE<64>(p + 24));
+		memcpy(root.digest.data(), p + detail_merkle::header_size, 16);
+
+		for (size_t i = 0; i < parsed.leaf_count(); i++)
+		{
+			canonical128_t leaf(hash128_t{});
+			memcpy(leaf.digest.data(), p + detail_merkle::header_size + 16 * (i + 1), 16);
+			parsed.nodes[parsed.leaf_count() + i] = leaf.get_hash();
+		}
+
+		parsed.rehash_all();
+
+		if (parsed.nodes[1] != root.get_hash())
+		{
+			return false;
+		}
+
+		tree = std::move(parsed);
+		return true;
+	}
+}
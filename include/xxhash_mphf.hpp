@@ -0,0 +1,799 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Minimal perfect hashing for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Minimal Perfect Hashing
+	***************************************/
+
+	/* Build parameters of an mphf. The defaults give about 3 to 4 bits per key. */
+	struct mphf_params
+	{
+		/* Buckets per partition are bucket_factor * keys / log2(keys): fewer buckets take less space and longer to build. */
+		double bucket_factor = 6.0;
+		/* Keys over slots in a partition. The slots past the keys are remapped to the free ones below, at the price of a second access. */
+		double load = 0.99;
+		/* Average keys per partition, the unit of work of a parallel build. At most 2^31. */
+		size_t partition_keys = 256 * 1024;
+	};
+
+	namespace detail_mphf
+	{
+		constexpr char magic[4] = { 'X', 'X', 'H', 'M' };
+		constexpr uint32_t format_version = 1;
+		constexpr size_t header_size = 64;
+
+		/* A partition is 4 little endian words: its first key, slots, first bucket and first remapped slot. One more entry closes the table. */
+		constexpr size_t partition_entry_size = 32;
+
+		/* Seeds tried before a build gives up, which only happens for duplicate keys in practice. */
+		constexpr size_t max_attempts = 4;
+
+		/* Pilots tried for one bucket before the seed is dropped. */
+		constexpr uint32_t max_pilot = 1u << 24;
+
+		/* Keys hashed, and pilots prefetched, ahead of the batch lookups using them. */
+		constexpr size_t batch = 16;
+
+		/* Keys hashed per claim of a parallel build. */
+		constexpr size_t hash_grain = 4096;
+
+		/* Below this many keys a build stays on the calling thread. */
+		constexpr size_t serial_keys = 64 * 1024;
+
+		inline uint64_t mix(uint64_t x)
+		{
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+			return x ^ (x >> 31);
+		}
+
+		inline uint64_t next_seed(uint64_t& state)
+		{
+			return mix(state += 0x9E3779B97F4A7C15ULL);
+		}
+
+		inline uint64_t fastrange(uint64_t h, uint64_t n)
+		{
+			return bit_ops::mul64to128(h, n).high64;
+		}
+
+		/* Skewed bucket choice: 60% of the keys go to the first 5/16 of the buckets, whose pilots are found while the slots are still empty. */
+		inline uint64_t bucket_of(uint64_t h, uint64_t buckets)
+		{
+			uint64_t const m = mix(h);
+			uint64_t const dense = std::max<uint64_t>(1, buckets * 5 / 16);
+
+			if ((m >> 32) < 0x9999999AULL)
+			{
+				return ((m & 0xFFFFFFFFULL) * dense) >> 32;
+			}
+
+			return dense + (((m & 0xFFFFFFFFULL) * (buckets - dense)) >> 32);
+		}
+
+		inline uint64_t slot_of(uint64_t h, uint64_t pilot, uint64_t slots)
+		{
+			return fastrange(mix(h ^ ((pilot + 1) * 0x9E3779B97F4A7C15ULL)), slots);
+		}
+
+		/* Fixed width fields packed from bit 0 of little endian bytes; width is at most 56 and arrays carry 8 bytes of padding. */
+		inline uint64_t read_bits(const uint8_t* p, uint64_t index, uint32_t width)
+		{
+			uint64_t const bit = index * width;
+			return (mem_ops::readLE<64>(p + bit / 8) >> (bit % 8)) & ((uint64_t(1) << width) - 1);
+		}
+
+		inline void write_bits(uint8_t* p, uint64_t index, uint32_t width, uint64_t value)
+		{
+			uint64_t const bit = index * width;
+			mem_ops::writeLE<64>(p + bit / 8, mem_ops::readLE<64>(p + bit / 8) | (value << (bit % 8)));
+		}
+
+		inline uint64_t packed_size(uint64_t count, uint32_t width)
+		{
+			return (count * width + 7) / 8 + 8;
+		}
+
+		inline uint32_t bit_width(uint64_t x)
+		{
+			uint32_t width = 0;
+
+			while (x >> width)
+			{
+				width++;
+			}
+
+			return width;
+		}
+
+		struct partition_result
+		{
+			uint64_t slots = 0;
+			std::vector<uint32_t> pilots;
+			std::vector<uint32_t> remap;
+		};
+
+		/* PTHash on the hashes of one partition. Returns false if a bucket holds equal hashes or runs out of pilots. */
+		inline bool build_partition(const uint64_t* hashes, uint64_t keys, const mphf_params& params, partition_result& out)
+		{
+			double const lg = std::max(1.0, std::log2(static_cast<double>(keys)));
+			uint64_t const buckets = std::max<uint64_t>(2, static_cast<uint64_t>(std::ceil(params.bucket_factor * static_cast<double>(keys) / lg)));
+			uint64_t const slots = std::max<uint64_t>(std::max<uint64_t>(keys, 1), static_cast<uint64_t>(std::ceil(static_cast<double>(keys) / params.load)));
+
+			/* keys sorted by bucket */
+			std::vector<uint32_t> bucket(keys);
+			std::vector<uint32_t> start(buckets + 1, 0);
+
+			for (uint64_t i = 0; i < keys; i++)
+			{
+				bucket[i] = static_cast<uint32_t>(bucket_of(hashes[i], buckets));
+				start[bucket[i] + 1]++;
+			}
+
+			uint32_t largest = 0;
+
+			for (uint64_t b = 0; b < buckets; b++)
+			{
+				largest = std::max(largest, start[b + 1]);
+				start[b + 1] += start[b];
+			}
+
+			std::vector<uint64_t> sorted(keys);
+			{
+				std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+
+				for (uint64_t i = 0; i < keys; i++)
+				{
+					sorted[cursor[bucket[i]]++] = hashes[i];
+				}
+			}
+
+			/* buckets by decreasing size */
+			std::vector<uint32_t> order;
+			{
+				std::vector<uint32_t> by_size(largest + 2, 0);
+
+				for (uint64_t b = 0; b < buckets; b++)
+				{
+					by_size[largest - (start[b + 1] - start[b]) + 1]++;
+				}
+
+				for (uint32_t s = 0; s <= largest; s++)
+				{
+					by_size[s + 1] += by_size[s];
+				}
+
+				order.resize(buckets);
+
+				for (uint64_t b = 0; b < buckets; b++)
+				{
+					order[by_size[largest - (start[b + 1] - start[b])]++] = static_cast<uint32_t>(b);
+				}
+			}
+
+			std::vector<uint64_t> taken((slots + 63) / 64, 0);
+			std::vector<uint64_t> placed(largest);
+			std::vector<uint32_t> pilots(buckets, 0);
+
+			for (uint32_t b : order)
+			{
+				uint64_t* const first = sorted.data() + start[b];
+				uint32_t const size = start[b + 1] - start[b];
+
+				if (size == 0)
+				{
+					break;
+				}
+
+				std::sort(first, first + size);
+
+				if (std::adjacent_find(first, first + size) != first + size)
+				{
+					return false;
+				}
+
+				for (uint32_t pilot = 0;; pilot++)
+				{
+					if (pilot == max_pilot)
+					{
+						return false;
+					}
+
+					uint32_t k = 0;
+
+					for (; k < size; k++)
+					{
+						uint64_t const s = slot_of(first[k], pilot, slots);
+
+						if (taken[s / 64] & (uint64_t(1) << (s % 64)))
+						{
+							break;
+						}
+
+						taken[s / 64] |= uint64_t(1) << (s % 64);
+						placed[k] = s;
+					}
+
+					if (k == size)
+					{
+						pilots[b] = pilot;
+						break;
+					}
+
+					while (k-- > 0)
+					{
+						taken[placed[k] / 64] &= ~(uint64_t(1) << (placed[k] % 64));
+					}
+				}
+			}
+
+			/* the slots past the keys, each pointing at a free slot below */
+			std::vector<uint32_t> remap(slots - keys, 0);
+			uint64_t free = 0;
+
+			for (uint64_t s = keys; s < slots; s++)
+			{
+				if (taken[s / 64] & (uint64_t(1) << (s % 64)))
+				{
+					while (taken[free / 64] & (uint64_t(1) << (free % 64)))
+					{
+						free++;
+					}
+
+					remap[s - keys] = static_cast<uint32_t>(free++);
+				}
+			}
+
+			out.slots = slots;
+			out.pilots = std::move(pilots);
+			out.remap = std::move(remap);
+			return true;
+		}
+
+		/* Pointers into a serialized mphf. */
+		struct tables
+		{
+			const uint8_t* partitions = nullptr;
+			const uint8_t* pilots = nullptr;
+			const uint8_t* remap = nullptr;
+			uint64_t keys = 0;
+			uint64_t seed = 0;
+			uint64_t partition_count = 0;
+			uint32_t pilot_bits = 0;
+			uint32_t remap_bits = 0;
+		};
+
+		/* The partition entry of a key and the index of its pilot. */
+		struct position
+		{
+			const uint8_t* entry;
+			uint64_t pilot;
+		};
+
+		inline position locate(const tables& t, uint64_t h)
+		{
+			const uint8_t* const entry = t.partitions + partition_entry_size * fastrange(h, t.partition_count);
+			uint64_t const first_bucket = mem_ops::readLE<64>(entry + 16);
+			uint64_t const buckets = mem_ops::readLE<64>(entry + partition_entry_size + 16) - first_bucket;
+			return { entry, first_bucket + bucket_of(h, buckets) };
+		}
+
+		inline uint64_t index_at(const tables& t, const position& at, uint64_t h)
+		{
+			uint64_t const first_key = mem_ops::readLE<64>(at.entry);
+			uint64_t const keys = mem_ops::readLE<64>(at.entry + partition_entry_size) - first_key;
+			uint64_t const s = slot_of(h, read_bits(t.pilots, at.pilot, t.pilot_bits), mem_ops::readLE<64>(at.entry + 8));
+
+			if (s < keys)
+			{
+				return first_key + s;
+			}
+
+			return first_key + read_bits(t.remap, mem_ops::readLE<64>(at.entry + 24) + (s - keys), t.remap_bits);
+		}
+
+		inline uint64_t index_of(const tables& t, uint64_t h)
+		{
+			return (t.partition_count == 0) ? 0 : index_at(t, locate(t, h), h);
+		}
+
+		/* Locates and prefetches the pilots of a batch, the accesses lookups wait on, before using any of them. */
+		template <typename F>
+		inline void index_batches(const tables& t, size_t n, uint64_t* out, F&& hash_key)
+		{
+			if (t.partition_count == 0)
+			{
+				std::fill(out, out + n, uint64_t(0));
+				return;
+			}
+
+			uint64_t h[batch];
+			position at[batch];
+
+			for (size_t first = 0; first < n; first += batch)
+			{
+				size_t const m = std::min(batch, n - first);
+
+				for (size_t k = 0; k < m; k++)
+				{
+					h[k] = hash_key(first + k);
+					at[k] = locate(t, h[k]);
+					intrin::prefetch(t.pilots + at[k].pilot * t.pilot_bits / 8);
+				}
+
+				for (size_t k = 0; k < m; k++)
+				{
+					out[first + k] = index_at(t, at[k], h[k]);
+				}
+			}
+		}
+
+		/* Checks the header and that every offset stays inside data. */
+		inline bool parse(const uint8_t* p, size_t size, tables& t)
+		{
+			if (size < header_size || memcmp(p, magic, 4) != 0 || mem_ops::readLE<32>(p + 4) != format_version)
+			{
+				return false;
+			}
+
+			tables parsed;
+			parsed.keys = mem_ops::readLE<64>(p + 8);
+			parsed.seed = mem_ops::readLE<64>(p + 16);
+			parsed.partition_count = mem_ops::readLE<64>(p + 24);
+			uint64_t const buckets = mem_ops::readLE<64>(p + 32);
+			uint64_t const remapped = mem_ops::readLE<64>(p + 40);
+			parsed.pilot_bits = mem_ops::readLE<32>(p + 48);
+			parsed.remap_bits = mem_ops::readLE<32>(p + 52);
+
+			if (parsed.partition_count == 0 || parsed.pilot_bits > 56 || parsed.remap_bits > 56 || buckets > (uint64_t(1) << 58) || remapped > (uint64_t(1) << 58)
+				|| parsed.partition_count > (size - header_size) / partition_entry_size)
+			{
+				return false;
+			}
+
+			uint64_t const table_bytes = (parsed.partition_count + 1) * partition_entry_size;
+			uint64_t const pilot_bytes = packed_size(buckets, parsed.pilot_bits);
+			uint64_t const remap_bytes = packed_size(remapped, parsed.remap_bits);
+
+			if (table_bytes > size - header_size || pilot_bytes > size - header_size - table_bytes || remap_bytes != size - header_size - table_bytes - pilot_bytes)
+			{
+				return false;
+			}
+
+			parsed.partitions = p + header_size;
+			parsed.pilots = parsed.partitions + table_bytes;
+			parsed.remap = parsed.pilots + pilot_bytes;
+
+			for (uint64_t i = 0; i < parsed.partition_count; i++)
+			{
+				const uint8_t* const e = parsed.partitions + i * partition_entry_size;
+				uint64_t const keys = mem_ops::readLE<64>(e + partition_entry_size) - mem_ops::readLE<64>(e);
+				uint64_t const slots = mem_ops::readLE<64>(e + 8);
+				uint64_t const first_bucket = mem_ops::readLE<64>(e + 16);
+				uint64_t const end_bucket = mem_ops::readLE<64>(e + partition_entry_size + 16);
+				uint64_t const first_remap = mem_ops::readLE<64>(e + 24);
+
+				if (mem_ops::readLE<64>(e) > mem_ops::readLE<64>(e + partition_entry_size) || keys > slots || slots == 0 || slots > (uint64_t(1) << 32)
+					|| first_bucket > end_bucket || end_bucket - first_bucket < 2 || end_bucket > buckets || first_remap > remapped || slots - keys > remapped - first_remap)
+				{
+					return false;
+				}
+			}
+
+			if (mem_ops::readLE<64>(parsed.partitions + parsed.partition_count * partition_entry_size) != parsed.keys)
+			{
+				return false;
+			}
+
+			t = parsed;
+			return true;
+		}
+	}
+
+	/* A read-only mphf over serialized bytes, such as a mapped file, without copying or decoding them. See parse_mphf. */
+	class mphf_view
+	{
+		detail_mphf::tables t;
+
+		friend class mphf;
+		friend bool parse_mphf(const void* data, size_t size, mphf_view& view);
+
+		explicit mphf_view(const detail_mphf::tables& tables) : t(tables)
+		{
+		}
+
+	public:
+
+		mphf_view() = default;
+
+		/* The index in [0, size()) of a key of the set. Any other key gets some index in that range too. */
+		uint64_t lookup_hash(uint64_t h) const
+		{
+			return detail_mphf::index_of(t, h);
+		}
+
+		uint64_t lookup(const void* key, size_t len) const
+		{
+			return lookup_hash(xxhash3<64>(key, len, t.seed));
+		}
+
+		uint64_t lookup(std::string_view key) const
+		{
+			return lookup(key.data(), key.size());
+		}
+
+		uint64_t lookup(uint64_t key) const
+		{
+			uint8_t bytes[8];
+			mem_ops::writeLE<64>(bytes, key);
+			return lookup(bytes, sizeof(bytes));
+		}
+
+		/* Hashes a batch of keys and prefetches their pilots before looking any of them up. */
+		void lookup_many(const std::string_view* keys, size_t n, uint64_t* out) const
+		{
+			detail_mphf::index_batches(t, n, out, [&](size_t i) { return xxhash3<64>(keys[i].data(), keys[i].size(), t.seed); });
+		}
+
+		void lookup_many(const uint64_t* keys, size_t n, uint64_t* out) const
+		{
+			detail_mphf::index_batches(t, n, out, [&](size_t i) {
+				uint8_t bytes[8];
+				mem_ops::writeLE<64>(bytes, keys[i]);
+				return xxhash3<64>(bytes, sizeof(bytes), t.seed);
+			});
+		}
+
+		uint64_t size() const
+		{
+			return t.keys;
+		}
+
+		uint64_t seed() const
+		{
+			return t.seed;
+		}
+	};
+
+	/* A minimal perfect hash function: maps each of n distinct keys, fixed at build time, to its own index in [0, n).
+	* PTHash with partitions. A key is hashed once with xxhash3<64>(key, seed), which picks its partition and, remixed, its bucket there.
+	* Every bucket has a pilot, the first value for which the slots of its keys, remixed hashes of the key hash and the pilot, are all free.
+	* Buckets are placed largest first. A partition has 1% more slots than keys, and the slots past the keys hold the free slot below
+	* that the key really gets. A lookup reads the partition table, which stays in cache, then one pilot; 1% of keys read a remap entry too.
+	* Partitions are built independently, in parallel on a thread_pool. Pilots and remap entries are packed at the width of the largest.
+	* The function is kept in its serialized form, so serialize_mphf is a copy and a mapped file is queried in place through an mphf_view.
+	*/
+	class mphf
+	{
+		std::vector<uint8_t> bytes;
+		mphf_view view_;
+
+		friend bool parse_mphf(const void* data, size_t size, mphf& f);
+
+		void attach()
+		{
+			detail_mphf::tables t;
+			view_ = detail_mphf::parse(bytes.data(), bytes.size(), t) ? mphf_view(t) : mphf_view();
+		}
+
+		template <typename F>
+		bool build_with(size_t count, thread_pool& pool, uint64_t seed, const mphf_params& params, F&& hash_key)
+		{
+			size_t const per_partition = std::min<size_t>(std::max<size_t>(params.partition_keys, 1), size_t(1) << 31);
+			size_t const partition_count = std::max<size_t>(1, (count + per_partition - 1) / per_partition);
+			size_t const chunks = std::min(std::max<size_t>(1, count / detail_mphf::hash_grain), pool.size() * 4);
+			uint64_t state = seed;
+
+			for (size_t attempt = 0; attempt < detail_mphf::max_attempts; attempt++)
+			{
+				uint64_t const s = (attempt == 0) ? seed : detail_mphf::next_seed(state);
+
+				std::vector<uint64_t> hashes(count);
+				pool.parallel_for_ranges(count, [](size_t, size_t) { return detail_mphf::hash_grain; }, [&](size_t begin, size_t end) {
+					for (size_t i = begin; i < end; i++)
+					{
+						hashes[i] = hash_key(i, s);
+					}
+				});
+
+				/* hashes grouped by partition, each chunk scattering its share */
+				std::vector<uint64_t> grouped(count);
+				std::vector<size_t> first_key(partition_count + 1, 0);
+				{
+					std::vector<size_t> cursor(chunks * partition_count, 0);
+
+					pool.parallel_for(chunks, [&](size_t c) {
+						for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; i++)
+						{
+							cursor[c * partition_count + detail_mphf::fastrange(hashes[i], partition_count)]++;
+						}
+					});
+
+					size_t offset = 0;
+
+					for (size_t p = 0; p < partition_count; p++)
+					{
+						first_key[p] = offset;
+
+						for (size_t c = 0; c < chunks; c++)
+						{
+							size_t const n = cursor[c * partition_count + p];
+							cursor[c * partition_count + p] = offset;
+							offset += n;
+						}
+					}
+
+					first_key[partition_count] = offset;
+
+					pool.parallel_for(chunks, [&](size_t c) {
+						for (size_t i = count * c / chunks; i < count * (c + 1) / chunks; i++)
+						{
+							grouped[cursor[c * partition_count + detail_mphf::fastrange(hashes[i], partition_count)]++] = hashes[i];
+						}
+					});
+				}
+
+				hashes = std::vector<uint64_t>();
+
+				std::vector<detail_mphf::partition_result> parts(partition_count);
+				std::atomic<bool> failed{ false };
+
+				pool.parallel_for(partition_count, [&](size_t p) {
+					if (!failed.load(std::memory_order_relaxed) && !detail_mphf::build_partition(grouped.data() + first_key[p], first_key[p + 1] - first_key[p], params, parts[p]))
+					{
+						failed.store(true, std::memory_order_relaxed);
+					}
+				});
+
+				if (failed.load())
+				{
+					continue;
+				}
+
+				uint64_t buckets = 0, remapped = 0;
+				uint32_t largest_pilot = 0, largest_remap = 0;
+
+				for (const auto& part : parts)
+				{
+					buckets += part.pilots.size();
+					remapped += part.remap.size();
+					largest_pilot = std::max(largest_pilot, *std::max_element(part.pilots.begin(), part.pilots.end()));
+
+					for (uint32_t r : part.remap)
+					{
+						largest_remap = std::max(largest_remap, r);
+					}
+				}
+
+				uint32_t const pilot_bits = detail_mphf::bit_width(largest_pilot);
+				uint32_t const remap_bits = detail_mphf::bit_width(largest_remap);
+				size_t const table_bytes = (partition_count + 1) * detail_mphf::partition_entry_size;
+				size_t const pilot_bytes = static_cast<size_t>(detail_mphf::packed_size(buckets, pilot_bits));
+				size_t const remap_bytes = static_cast<size_t>(detail_mphf::packed_size(remapped, remap_bits));
+
+				std::vector<uint8_t> out(detail_mphf::header_size + table_bytes + pilot_bytes + remap_bytes, 0);
+				memcpy(out.data(), detail_mphf::magic, 4);
+				mem_ops::writeLE<32>(out.data() + 4, detail_mphf::format_version);
+				mem_ops::writeLE<64>(out.data() + 8, count);
+				mem_ops::writeLE<64>(out.data() + 16, s);
+				mem_ops::writeLE<64>(out.data() + 24, partition_count);
+				mem_ops::writeLE<64>(out.data() + 32, buckets);
+				mem_ops::writeLE<64>(out.data() + 40, remapped);
+				mem_ops::writeLE<32>(out.data() + 48, pilot_bits);
+				mem_ops::writeLE<32>(out.data() + 52, remap_bits);
+
+				uint8_t* const table = out.data() + detail_mphf::header_size;
+				uint8_t* const pilots = table + table_bytes;
+				uint8_t* const remap = pilots + pilot_bytes;
+				uint64_t bucket = 0, remap_entry = 0;
+
+				for (size_t p = 0; p <= partition_count; p++)
+				{
+					uint8_t* const e = table + p * detail_mphf::partition_entry_size;
+					mem_ops::writeLE<64>(e, first_key[p]);
+					mem_ops::writeLE<64>(e + 16, bucket);
+					mem_ops::writeLE<64>(e + 24, remap_entry);
+
+					if (p == partition_count)
+					{
+						break;
+					}
+
+					mem_ops::writeLE<64>(e + 8, parts[p].slots);
+
+					for (uint32_t pilot : parts[p].pilots)
+					{
+						detail_mphf::write_bits(pilots, bucket++, pilot_bits, pilot);
+					}
+
+					for (uint32_t r : parts[p].remap)
+					{
+						detail_mphf::write_bits(remap, remap_entry++, remap_bits, r);
+					}
+				}
+
+				bytes = std::move(out);
+				attach();
+				return true;
+			}
+
+			return false;
+		}
+
+	public:
+
+		mphf() = default;
+
+		mphf(const mphf& other) : bytes(other.bytes)
+		{
+			attach();
+		}
+
+		mphf(mphf&& other) noexcept : bytes(std::move(other.bytes))
+		{
+			attach();
+			other.attach();
+		}
+
+		mphf& operator=(const mphf& other)
+		{
+			bytes = other.bytes;
+			attach();
+			return *this;
+		}
+
+		mphf& operator=(mphf&& other) noexcept
+		{
+			bytes = std::move(other.bytes);
+			attach();
+			other.attach();
+			return *this;
+		}
+
+		/* Builds the function for keys, which must be distinct, replacing the current one. Returns false, leaving it unchanged, if they are not. */
+		bool build(const std::string_view* keys, size_t count, thread_pool& pool, uint64_t seed = 0, const mphf_params& params = mphf_params())
+		{
+			return build_with(count, pool, seed, params, [keys](size_t i, uint64_t s) { return xxhash3<64>(keys[i].data(), keys[i].size(), s); });
+		}
+
+		/* Integer keys hash as their 8 little endian bytes. */
+		bool build(const uint64_t* keys, size_t count, thread_pool& pool, uint64_t seed = 0, const mphf_params& params = mphf_params())
+		{
+			return build_with(count, pool, seed, params, [keys](size_t i, uint64_t s) {
+				uint8_t key[8];
+				mem_ops::writeLE<64>(key, keys[i]);
+				return xxhash3<64>(key, sizeof(key), s);
+			});
+		}
+
+		/* Builds on a pool of all hardware threads, or on the calling thread alone for small sets. */
+		bool build(const std::string_view* keys, size_t count, uint64_t seed = 0, const mphf_params& params = mphf_params())
+		{
+			thread_pool pool(count < detail_mphf::serial_keys ? 1 : std::thread::hardware_concurrency());
+			return build(keys, count, pool, seed, params);
+		}
+
+		bool build(const uint64_t* keys, size_t count, uint64_t seed = 0, const mphf_params& params = mphf_params())
+		{
+			thread_pool pool(count < detail_mphf::serial_keys ? 1 : std::thread::hardware_concurrency());
+			return build(keys, count, pool, seed, params);
+		}
+
+		uint64_t lookup_hash(uint64_t h) const
+		{
+			return view_.lookup_hash(h);
+		}
+
+		uint64_t lookup(const void* key, size_t len) const
+		{
+			return view_.lookup(key, len);
+		}
+
+		uint64_t lookup(std::string_view key) const
+		{
+			return view_.lookup(key);
+		}
+
+		uint64_t lookup(uint64_t key) const
+		{
+			return view_.lookup(key);
+		}
+
+		void lookup_many(const std::string_view* keys, size_t n, uint64_t* out) const
+		{
+			view_.lookup_many(keys, n, out);
+		}
+
+		void lookup_many(const uint64_t* keys, size_t n, uint64_t* out) const
+		{
+			view_.lookup_many(keys, n, out);
+		}
+
+		const mphf_view& view() const
+		{
+			return view_;
+		}
+
+		/* Keys of the set, and the range of the indices. */
+		uint64_t size() const
+		{
+			return view_.size();
+		}
+
+		/* The seed actually used, which differs from the one given if the build had to retry. */
+		uint64_t seed() const
+		{
+			return view_.seed();
+		}
+
+		double bits_per_key() const
+		{
+			return (size() == 0) ? 0.0 : 8.0 * static_cast<double>(bytes.size()) / static_cast<double>(size());
+		}
+
+		size_t size_bytes() const
+		{
+			return bytes.size();
+		}
+
+		const uint8_t* data() const
+		{
+			return bytes.data();
+		}
+	};
+
+	inline std::vector<uint8_t> serialize_mphf(const mphf& f)
+	{
+		return std::vector<uint8_t>(f.data(), f.data() + f.size_bytes());
+	}
+
+	/* Points view at the tables inside data, which must outlive it. Returns false, leaving view unchanged, if data is not a serialized mphf. */
+	inline bool parse_mphf(const void* data, size_t size, mphf_view& view)
+	{
+		detail_mphf::tables t;
+
+		if (!detail_mphf::parse(static_cast<const uint8_t*>(data), size, t))
+		{
+			return false;
+		}
+
+		view = mphf_view(t);
+		return true;
+	}
+
+	/* Copies a serialized mphf. Returns false, leaving f unchanged, if data is not one. */
+	inline bool parse_mphf(const void* data, size_t size, mphf& f)
+	{
+		detail_mphf::tables t;
+
+		if (!detail_mphf::parse(static_cast<const uint8_t*>(data), size, t))
+		{
+			return false;
+		}
+
+		const uint8_t* const p = static_cast<const uint8_t*>(data);
+		f.bytes.assign(p, p + size);
+		f.attach();
+		return true;
+	}
+}
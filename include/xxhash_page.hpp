@@ -0,0 +1,183 @@
+#pragma once
+#include <algorithm>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Fixed-size page checksums for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Page Checksums
+	***************************************/
+
+	/* Checksums of fixed-size storage pages carrying their own checksum: a little endian 64 bit field at checksum_offset.
+	* The checksum is xxhash3<64>(page, page_size, seed) of the page with that field read as zero, so it can be cross-checked with the generic function.
+	* The page size is a template parameter: the block and stripe counts of the long-input loop are constants, the length dispatch is gone,
+	* and the seeded secret is derived once, on construction, instead of on every call.
+	*/
+	template <size_t page_size, size_t checksum_offset = 0>
+	class page_checksum
+	{
+		static_assert(page_size > detail3::midsize_max && page_size % detail3::stripe_len == 0, "page_checksum requires a page size that is a multiple of 64 and larger than 240 bytes.");
+		static_assert(checksum_offset % 8 == 0 && checksum_offset + 8 <= page_size, "The checksum field must be 8 byte aligned and lie within the page.");
+
+		static constexpr size_t stripes_per_block = (detail3::secret_default_size - detail3::stripe_len) / detail3::secret_consume_rate;
+		static constexpr size_t block_len = stripes_per_block * detail3::stripe_len;
+		static constexpr size_t nb_blocks = (page_size - 1) / block_len;
+		static constexpr size_t last_block_stripes = ((page_size - 1) - nb_blocks * block_len) / detail3::stripe_len;
+		static constexpr size_t last_stripe = page_size / detail3::stripe_len - 1;
+		static constexpr size_t field_stripe = checksum_offset / detail3::stripe_len;
+
+		/* Pages hashed side by side by verify_pages. Each has its own accumulators, so their dependency chains and loads overlap. */
+		static constexpr size_t lanes = 2;
+
+		alignas(64) uint8_t secret[detail3::secret_default_size];
+
+		using acc_t = std::array<uint64_t, detail3::acc_nb>;
+
+		/* Hashes count pages in lock-step. With prefetch, each stripe also touches the same stripe of the count next pages, so they are in cache in time. */
+		template <size_t count, bool prefetch>
+		void hash_lanes(const uint8_t* const* pages, const uint8_t* const* next, hash64_t* out) const
+		{
+			alignas(detail3::acc_align) acc_t acc[count];
+			alignas(64) uint8_t patched[count][detail3::stripe_len];
+
+			for (size_t k = 0; k < count; k++)
+			{
+				acc[k] = detail3::init_acc;
+				memcpy(patched[k], pages[k] + field_stripe * detail3::stripe_len, detail3::stripe_len);
+				memset(patched[k] + checksum_offset % detail3::stripe_len, 0, 8);
+			}
+
+			/* n stripes from first on, the field stripe excepted, which is taken from the patched copy */
+			auto run = [&](size_t first, size_t n, const uint8_t* key) {
+				for (size_t s = first; s < first + n; s++)
+				{
+					const uint8_t* const k_secret = key + (s - first) * detail3::secret_consume_rate;
+
+					for (size_t k = 0; k < count; k++)
+					{
+						detail3::accumulate_512(acc[k].data(), (s == field_stripe) ? patched[k] : pages[k] + s * detail3::stripe_len, k_secret);
+					}
+
+					if constexpr (prefetch)
+					{
+						for (size_t k = 0; k < count; k++)
+						{
+							intrin::prefetch(next[k] + s * detail3::stripe_len);
+						}
+					}
+				}
+			};
+
+			for (size_t b = 0; b < nb_blocks; b++)
+			{
+				run(b * stripes_per_block, stripes_per_block, secret);
+
+				for (size_t k = 0; k < count; k++)
+				{
+					detail3::scramble_acc(acc[k].data(), secret + detail3::secret_default_size - detail3::stripe_len);
+				}
+			}
+
+			run(nb_blocks * stripes_per_block, last_block_stripes, secret);
+			run(last_stripe, 1, secret + detail3::secret_default_size - detail3::stripe_len - detail3::secret_lastacc_start);
+
+			for (size_t k = 0; k < count; k++)
+			{
+				out[k] = detail3::hash_long_merge<64>(acc[k], page_size, secret, detail3::secret_default_size);
+			}
+		}
+
+	public:
+
+		static constexpr size_t size = page_size;
+		static constexpr size_t offset = checksum_offset;
+
+		explicit page_checksum(uint64_t seed = 0)
+		{
+			detail3::init_custom_secret(secret, seed);
+		}
+
+		/* Checksum of a page, regardless of what its checksum field holds. */
+		hash64_t compute(const void* page) const
+		{
+			const uint8_t* const p = static_cast<const uint8_t*>(page);
+			hash64_t h;
+
+			hash_lanes<1, false>(&p, nullptr, &h);
+			return h;
+		}
+
+		hash64_t stored(const void* page) const
+		{
+			return mem_ops::readLE<64>(static_cast<const uint8_t*>(page) + checksum_offset);
+		}
+
+		/* Computes the checksum of a page and writes it into its checksum field. */
+		void seal(void* page) const
+		{
+			mem_ops::writeLE<64>(static_cast<uint8_t*>(page) + checksum_offset, compute(page));
+		}
+
+		bool verify(const void* page) const
+		{
+			return compute(page) == stored(page);
+		}
+
+		/* Verifies count pages, which may lie anywhere in memory, several at a time. Returns the number of pages that failed;
+		* if valid is not null, valid[i] tells whether pages[i] passed.
+		*/
+		size_t verify_pages(const void* const* pages, size_t count, bool* valid = nullptr) const
+		{
+			const uint8_t* const* const p = reinterpret_cast<const uint8_t* const*>(pages);
+			size_t failed = 0;
+			hash64_t h[lanes];
+
+			auto check = [&](size_t i, size_t n) {
+				for (size_t k = 0; k < n; k++)
+				{
+					bool const ok = (h[k] == stored(p[i + k]));
+
+					failed += !ok;
+
+					if (valid)
+					{
+						valid[i + k] = ok;
+					}
+				}
+			};
+
+			size_t i = 0;
+
+			for (; i + lanes <= count; i += lanes)
+			{
+				/* the last group prefetches itself, which is harmless */
+				const uint8_t* const* const next = (i + 2 * lanes <= count) ? p + i + lanes : p + i;
+
+				hash_lanes<lanes, true>(p + i, next, h);
+				check(i, lanes);
+			}
+
+			for (; i < count; i++)
+			{
+				hash_lanes<1, false>(p + i, nullptr, h);
+				check(i, 1);
+			}
+
+			return failed;
+		}
+	};
+
+	using page_checksum_4k = page_checksum<4096>;
+	using page_checksum_8k = page_checksum<8192>;
+}
@@ -0,0 +1,698 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Parallel hashing extensions for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Thread Pool
+	***************************************/
+
+	/* A fixed set of worker threads executing one parallel loop at a time.
+	* Every participating thread owns a deque holding a contiguous range of indices. It claims work from the front of its own deque,
+	* and once that is empty it steals the back half of the next non-empty deque, so uneven work balances out.
+	* The calling thread takes part in the work, so a pool of size 1 runs everything on the caller.
+	* The parallel loops must not be called from inside a task of the same pool.
+	*/
+	class thread_pool
+	{
+	public:
+
+		/* Given the unclaimed indices [begin, end) of the own deque, returns how many of them to claim at once (at least 1). */
+		using claim_fn = std::function<size_t(size_t begin, size_t end)>;
+		/* Processes the indices [begin, end). */
+		using range_fn = std::function<void(size_t begin, size_t end)>;
+
+	private:
+
+		struct alignas(64) work_deque
+		{
+			std::mutex mutex;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		struct job_t
+		{
+			const claim_fn* claim;
+			const range_fn* fn;
+		};
+
+		std::vector<std::thread> workers;
+		std::unique_ptr<work_deque[]> deques;
+		std::mutex job_mutex;
+		std::mutex state_mutex;
+		std::condition_variable job_available;
+		std::condition_variable job_finished;
+
+		const job_t* job = nullptr;
+		uint64_t job_generation = 0;
+		size_t busy_workers = 0;
+		bool stopping = false;
+
+		bool pop_own(size_t self, const claim_fn& claim, size_t& begin, size_t& end)
+		{
+			work_deque& own = deques[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+
+			if (own.begin == own.end)
+			{
+				return false;
+			}
+
+			begin = own.begin;
+			own.begin += std::min(std::max<size_t>(claim(own.begin, own.end), 1), own.end - own.begin);
+			end = own.begin;
+			return true;
+		}
+
+		/* Moves the back half of another deque into the own one, which is empty at this point. */
+		bool steal(size_t self)
+		{
+			size_t const participants = size();
+
+			for (size_t offset = 1; offset < participants; offset++)
+			{
+				work_deque& victim = deques[(self + offset) % participants];
+				size_t begin, end;
+
+				{
+					std::lock_guard<std::mutex> lock(victim.mutex);
+
+					if (victim.begin == victim.end)
+					{
+						continue;
+					}
+
+					begin = victim.begin + (victim.end - victim.begin) / 2;
+					end = victim.end;
+					victim.end = begin;
+				}
+
+				work_deque& own = deques[self];
+				std::lock_guard<std::mutex> lock(own.mutex);
+				own.begin = begin;
+				own.end = end;
+				return true;
+			}
+
+			return false;
+		}
+
+		void run_job(const job_t& current, size_t self)
+		{
+			size_t begin, end;
+
+			do
+			{
+				while (pop_own(self, *current.claim, begin, end))
+				{
+					(*current.fn)(begin, end);
+				}
+			} while (steal(self));
+		}
+
+		void worker_loop(size_t self)
+		{
+			uint64_t seen_generation = 0;
+
+			while (true)
+			{
+				const job_t* current;
+
+				{
+					std::unique_lock<std::mutex> lock(state_mutex);
+					job_available.wait(lock, [&]() { return stopping || job_generation != seen_generation; });
+
+					if (stopping)
+					{
+						return;
+					}
+
+					seen_generation = job_generation;
+
+					if (job == nullptr)
+					{	/* woke up after the job had already been completed by the others */
+						continue;
+					}
+
+					current = job;
+					busy_workers++;
+				}
+
+				run_job(*current, self);
+
+				{
+					std::lock_guard<std::mutex> lock(state_mutex);
+
+					if (--busy_workers == 0)
+					{
+						job_finished.notify_all();
+					}
+				}
+			}
+		}
+
+	public:
+
+		explicit thread_pool(size_t thread_count = std::thread::hardware_concurrency())
+		{
+			thread_count = std::max<size_t>(thread_count, 1);
+			deques.reset(new work_deque[thread_count]);
+
+			for (size_t i = 1; i < thread_count; i++)
+			{
+				workers.emplace_back([this, i]() { worker_loop(i); });
+			}
+		}
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(state_mutex);
+				stopping = true;
+			}
+
+			job_available.notify_all();
+
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		/* Number of threads taking part in a parallel loop, including the caller. */
+		size_t size() const
+		{
+			return workers.size() + 1;
+		}
+
+		/* Calls fn on disjoint subranges covering [0, count), sized by claim, and returns once all calls have completed.
+		* With a single thread, fn is called once on the whole range.
+		*/
+		void parallel_for_ranges(size_t count, const claim_fn& claim, const range_fn& fn)
+		{
+			std::lock_guard<std::mutex> job_lock(job_mutex);
+			size_t const participants = size();
+
+			if (count == 0)
+			{
+				return;
+			}
+
+			if (participants == 1)
+			{
+				fn(0, count);
+				return;
+			}
+
+			job_t const current = { &claim, &fn };
+
+			{
+				std::lock_guard<std::mutex> lock(state_mutex);
+
+				for (size_t p = 0; p < participants; p++)
+				{
+					std::lock_guard<std::mutex> deque_lock(deques[p].mutex);
+					deques[p].begin = count * p / participants;
+					deques[p].end = count * (p + 1) / participants;
+				}
+
+				job = &current;
+				job_generation++;
+			}
+
+			job_available.notify_all();
+			run_job(current, 0);
+
+			std::unique_lock<std::mutex> lock(state_mutex);
+			job_finished.wait(lock, [&]() { return busy_workers == 0; });
+			job = nullptr;
+		}
+
+		/* Calls fn(i) for every i in [0, count) and returns once all calls have completed. */
+		void parallel_for(size_t count, const std::function<void(size_t)>& fn)
+		{
+			parallel_for_ranges(count, [](size_t, size_t) { return size_t(1); }, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++)
+				{
+					fn(i);
+				}
+			});
+		}
+	};
+
+
+	/* *************************************
+	*  Tree Hashing
+	***************************************/
+
+	/* Tree hash, version 1
+	* The input is split into chunks of chunk_size bytes, the last one possibly shorter. An empty input is a single empty chunk.
+	* leaf[i] = xxhash3<128>(chunk[i], seed)
+	* Leaves are combined level by level: parent = xxhash3<128>(canonical(left) || canonical(right), seed ^ tree_parent_key).
+	* The last node of a level with an odd node count is carried up unchanged.
+	* root = xxhash3<128>(canonical(top) || LE64(total length) || LE64(chunk_size) || LE32(tree_version), seed ^ tree_root_key)
+	* Digests of different chunk sizes or versions are unrelated, and none of them equals plain xxhash3<128> of the input.
+	*/
+
+	constexpr uint32_t tree_version = 1;
+	constexpr size_t tree_default_chunk_size = 1024 * 1024;
+
+	struct tree_params
+	{
+		size_t chunk_size = tree_default_chunk_size;
+		uint64_t seed = 0;
+	};
+
+	namespace detail_tree
+	{
+		constexpr uint64_t tree_parent_key = 0x9E3779B185EBCA87ULL;
+		constexpr uint64_t tree_root_key = 0xC2B2AE3D27D4EB4FULL;
+
+		inline hash128_t combine(hash128_t left, hash128_t right, uint64_t seed)
+		{
+			uint8_t node[2 * sizeof(canonical128_t)];
+			canonical128_t const left_canon(left);
+			canonical128_t const right_canon(right);
+
+			memcpy(node, &left_canon, sizeof(canonical128_t));
+			memcpy(node + sizeof(canonical128_t), &right_canon, sizeof(canonical128_t));
+
+			return xxhash3<128>(node, sizeof(node), seed ^ tree_parent_key);
+		}
+
+		inline hash128_t finalize(hash128_t top, uint64_t total_len, const tree_params& params)
+		{
+			uint8_t root[sizeof(canonical128_t) + 8 + 8 + 4];
+			canonical128_t const top_canon(top);
+
+			memcpy(root, &top_canon, sizeof(canonical128_t));
+			mem_ops::writeLE<64>(root + 16, total_len);
+			mem_ops::writeLE<64>(root + 24, static_cast<uint64_t>(params.chunk_size));
+			mem_ops::writeLE<32>(root + 32, tree_version);
+
+			return xxhash3<128>(root, sizeof(root), params.seed ^ tree_root_key);
+		}
+
+		inline size_t chunk_count(size_t len, size_t chunk_size)
+		{
+			return (len == 0) ? 1 : (len - 1) / chunk_size + 1;
+		}
+
+		/* Reduces the leaves in place, level by level. */
+		inline hash128_t reduce(std::vector<hash128_t>& nodes, uint64_t seed)
+		{
+			size_t count = nodes.size();
+
+			while (count > 1)
+			{
+				size_t const pairs = count / 2;
+
+				for (size_t i = 0; i < pairs; i++)
+				{
+					nodes[i] = combine(nodes[2 * i], nodes[2 * i + 1], seed);
+				}
+
+				if (count % 2)
+				{
+					nodes[pairs] = nodes[count - 1];
+				}
+
+				count = pairs + (count % 2);
+			}
+
+			return nodes[0];
+		}
+
+		/* Merkle stack of a tree being built left to right: entries hold the root of a complete subtree and its height.
+		* Folding the stack from the right yields the same root as the level-by-level reduction.
+		*/
+		struct tree_stack
+		{
+			std::vector<std::pair<hash128_t, uint32_t>> entries;
+
+			void push(hash128_t leaf, uint64_t seed)
+			{
+				uint32_t height = 0;
+
+				while (!entries.empty() && entries.back().second == height)
+				{
+					leaf = combine(entries.back().first, leaf, seed);
+					entries.pop_back();
+					height++;
+				}
+
+				entries.emplace_back(leaf, height);
+			}
+
+			hash128_t fold(uint64_t seed) const
+			{
+				hash128_t top = entries.back().first;
+
+				for (size_t i = entries.size() - 1; i-- > 0;)
+				{
+					top = combine(entries[i].first, top, seed);
+				}
+
+				return top;
+			}
+		};
+	}
+
+	/* Sequential reference implementation of the tree hash. */
+	inline hash128_t tree_hash_reference(const void* input, size_t len, const tree_params& params = tree_params())
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(input);
+		size_t const count = detail_tree::chunk_count(len, params.chunk_size);
+		std::vector<hash128_t> leaves(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t const offset = i * params.chunk_size;
+			leaves[i] = xxhash3<128>(p + offset, std::min(params.chunk_size, len - offset), params.seed);
+		}
+
+		return detail_tree::finalize(detail_tree::reduce(leaves, params.seed), len, params);
+	}
+
+	/* Tree hash with the leaves hashed concurrently on pool. */
+	inline hash128_t tree_hash(const void* input, size_t len, thread_pool& pool, const tree_params& params = tree_params())
+	{
+		const uint8_t* const p = static_cast<const uint8_t*>(input);
+		size_t const count = detail_tree::chunk_count(len, params.chunk_size);
+		std::vector<hash128_t> leaves(count);
+
+		pool.parallel_for(count, [&](size_t i) {
+			size_t const offset = i * params.chunk_size;
+			leaves[i] = xxhash3<128>(p + offset, std::min(params.chunk_size, len - offset), params.seed);
+		});
+
+		return detail_tree::finalize(detail_tree::reduce(leaves, params.seed), len, params);
+	}
+
+	inline hash128_t tree_hash(const void* input, size_t len, const tree_params& params = tree_params())
+	{
+		if (len <= params.chunk_size)
+		{
+			return tree_hash_reference(input, len, params);
+		}
+
+		thread_pool pool;
+		return tree_hash(input, len, pool, params);
+	}
+
+	template <typename T>
+	inline hash128_t tree_hash(const std::vector<T>& input, const tree_params& params = tree_params())
+	{
+		return tree_hash(static_cast<const void*>(input.data()), input.size() * sizeof(T), params);
+	}
+
+	template <typename T>
+	inline hash128_t tree_hash(const std::vector<T>& input, thread_pool& pool, const tree_params& params = tree_params())
+	{
+		return tree_hash(static_cast<const void*>(input.data()), input.size() * sizeof(T), pool, params);
+	}
+
+	/* Streaming tree hash. Whole chunks passed to update are hashed in one shot, partial chunks go through a hash3_state_t. */
+	class tree_state
+	{
+		tree_params params;
+		hash3_state128_t chunk_state;
+		size_t chunk_fill = 0;
+		uint64_t total_len = 0;
+		uint64_t leaf_count = 0;
+		detail_tree::tree_stack stack;
+
+		void update_impl(const void* input, size_t length)
+		{
+			const uint8_t* p = static_cast<const uint8_t*>(input);
+			const uint8_t* const bEnd = p + length;
+
+			total_len += length;
+
+			while (p < bEnd)
+			{
+				size_t const remaining = static_cast<size_t>(bEnd - p);
+
+				if (chunk_fill == 0 && remaining >= params.chunk_size)
+				{
+					stack.push(xxhash3<128>(p, params.chunk_size, params.seed), params.seed);
+					leaf_count++;
+					p += params.chunk_size;
+					continue;
+				}
+
+				size_t const take = std::min(remaining, params.chunk_size - chunk_fill);
+
+				chunk_state.update(p, take);
+				chunk_fill += take;
+				p += take;
+
+				if (chunk_fill == params.chunk_size)
+				{
+					stack.push(chunk_state.digest(), params.seed);
+					leaf_count++;
+					chunk_state.reset(params.seed);
+					chunk_fill = 0;
+				}
+			}
+		}
+
+	public:
+
+		tree_state(const tree_params& params_ = tree_params()) : params(params_), chunk_state(params_.seed)
+		{
+		}
+
+		tree_state(const tree_state&) = delete;
+		tree_state& operator=(const tree_state&) = delete;
+
+		void reset(const tree_params& params_ = tree_params())
+		{
+			params = params_;
+			chunk_state.reset(params.seed);
+			chunk_fill = 0;
+			total_len = 0;
+			leaf_count = 0;
+			stack.entries.clear();
+		}
+
+		void update(const void* input, size_t length)
+		{
+			return update_impl(input, length);
+		}
+
+		template <typename T>
+		void update(const std::vector<T>& input)
+		{
+			return update_impl(static_cast<const void*>(input.data()), input.size() * sizeof(T));
+		}
+
+		/* The state remains unaltered and can keep ingesting input afterwards. */
+		hash128_t digest()
+		{
+			if (chunk_fill == 0 && leaf_count > 0)
+			{
+				return detail_tree::finalize(stack.fold(params.seed), total_len, params);
+			}
+
+			detail_tree::tree_stack final_stack = stack;
+			final_stack.push(chunk_state.digest(), params.seed);
+
+			return detail_tree::finalize(final_stack.fold(params.seed), total_len, params);
+		}
+	};
+
+
+	/* *************************************
+	*  Batch Hashing
+	***************************************/
+
+	/* One input of a batch. */
+	struct byte_range
+	{
+		const void* data = nullptr;
+		size_t size = 0;
+
+		byte_range() = default;
+		byte_range(const void* data_, size_t size_) : data(data_), size(size_) {}
+	};
+
+	namespace detail_parallel
+	{
+		/* A task covers consecutive inputs worth about task_cost bytes, counting per_input_cost for each input besides its length. */
+		constexpr size_t task_cost = 64 * 1024;
+		constexpr size_t per_input_cost = 32;
+
+		inline byte_range to_range(const byte_range& range)
+		{
+			return range;
+		}
+
+		template <typename T>
+		inline byte_range to_range(const T& input)
+		{
+			return byte_range(static_cast<const void*>(input.data()), input.size() * sizeof(*input.data()));
+		}
+
+		/* Hashes one input of a task. The secret derived from the seed is computed once per task, and only if a long input shows up. */
+		template <size_t N>
+		XXH_FORCE_INLINE hash_t<N> hash_one(const byte_range& range, uint64_t seed, uint8_t* custom_secret, bool& custom_secret_ready)
+		{
+			const uint8_t* const p = static_cast<const uint8_t*>(range.data);
+
+			if (range.size <= 16)
+			{
+				return detail3::len_0to16<N>(p, range.size, detail3::default_secret, seed);
+			}
+			else if (range.size <= 128)
+			{
+				return detail3::len_17to128<N>(p, range.size, detail3::default_secret, seed);
+			}
+			else if (range.size <= detail3::midsize_max)
+			{
+				return detail3::len_129to240<N>(p, range.size, detail3::default_secret, seed);
+			}
+
+			if (seed == 0)
+			{
+				return detail3::hash_long_internal<N>(p, range.size, detail3::default_secret, detail3::secret_default_size);
+			}
+
+			if (!custom_secret_ready)
+			{
+				detail3::init_custom_secret(custom_secret, seed);
+				custom_secret_ready = true;
+			}
+
+			return detail3::hash_long_internal<N>(p, range.size, custom_secret, detail3::secret_default_size);
+		}
+
+		/* Hashes ranges[0, count) in a single pass without going through xxhash3_impl.
+		* Groups of four inputs of up to 16 bytes, the most common case, are hashed side by side so their dependency chains overlap.
+		*/
+		template <size_t N>
+		inline void hash_task(const byte_range* ranges, size_t count, hash_t<N>* out, uint64_t seed)
+		{
+			alignas(64) uint8_t custom_secret[detail3::secret_default_size];
+			bool custom_secret_ready = false;
+			size_t i = 0;
+
+			for (; i + 4 <= count; i += 4)
+			{
+				if ((ranges[i].size | ranges[i + 1].size | ranges[i + 2].size | ranges[i + 3].size) <= 16)
+				{
+					hash_t<N> const h0 = detail3::len_0to16<N>(static_cast<const uint8_t*>(ranges[i].data), ranges[i].size, detail3::default_secret, seed);
+					hash_t<N> const h1 = detail3::len_0to16<N>(static_cast<const uint8_t*>(ranges[i + 1].data), ranges[i + 1].size, detail3::default_secret, seed);
+					hash_t<N> const h2 = detail3::len_0to16<N>(static_cast<const uint8_t*>(ranges[i + 2].data), ranges[i + 2].size, detail3::default_secret, seed);
+					hash_t<N> const h3 = detail3::len_0to16<N>(static_cast<const uint8_t*>(ranges[i + 3].data), ranges[i + 3].size, detail3::default_secret, seed);
+
+					out[i] = h0;
+					out[i + 1] = h1;
+					out[i + 2] = h2;
+					out[i + 3] = h3;
+				}
+				else
+				{
+					for (size_t k = 0; k < 4; k++)
+					{
+						out[i + k] = hash_one<N>(ranges[i + k], seed, custom_secret, custom_secret_ready);
+					}
+				}
+			}
+
+			for (; i < count; i++)
+			{
+				out[i] = hash_one<N>(ranges[i], seed, custom_secret, custom_secret_ready);
+			}
+		}
+
+		/* Claims inputs from begin until about task_cost bytes of work are gathered. */
+		inline size_t claim_inputs(const byte_range* ranges, size_t begin, size_t end)
+		{
+			size_t cost = 0;
+			size_t i = begin;
+
+			while (i < end && cost < task_cost)
+			{
+				cost += ranges[i++].size + per_input_cost;
+			}
+
+			return i - begin;
+		}
+	}
+
+	/* Computes out[i] = xxhash3<bit_mode>(ranges[i], seed) for every input, spreading the inputs over the threads of pool. */
+	template <size_t bit_mode>
+	inline void parallel_hash3(const byte_range* ranges, size_t count, hash_t<bit_mode>* out, thread_pool& pool, uint64_t seed = 0)
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "xxhash3 can only be used in 64 and 128 bit modes.");
+
+		pool.parallel_for_ranges(count, [ranges](size_t begin, size_t end) { return detail_parallel::claim_inputs(ranges, begin, end); }, [&](size_t begin, size_t end) {
+			detail_parallel::hash_task<bit_mode>(ranges + begin, end - begin, out + begin, seed);
+		});
+	}
+
+	template <size_t bit_mode>
+	inline void parallel_hash3(const byte_range* ranges, size_t count, hash_t<bit_mode>* out, uint64_t seed = 0)
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "xxhash3 can only be used in 64 and 128 bit modes.");
+
+		uint64_t total = 0;
+
+		for (size_t i = 0; i < count && total <= 2 * detail_parallel::task_cost; i++)
+		{
+			total += ranges[i].size + detail_parallel::per_input_cost;
+		}
+
+		if (total <= 2 * detail_parallel::task_cost)
+		{	/* not worth starting threads for */
+			detail_parallel::hash_task<bit_mode>(ranges, count, out, seed);
+			return;
+		}
+
+		thread_pool pool;
+		parallel_hash3<bit_mode>(ranges, count, out, pool, seed);
+	}
+
+	/* Container overloads: the elements can be byte_range or anything with data() and size(), such as std::string, std::string_view or std::vector. */
+	template <size_t bit_mode, typename T>
+	inline void parallel_hash3(const std::vector<T>& inputs, std::vector<hash_t<bit_mode>>& out, thread_pool& pool, uint64_t seed = 0)
+	{
+		std::vector<byte_range> ranges(inputs.size());
+		std::transform(inputs.begin(), inputs.end(), ranges.begin(), [](const T& input) { return detail_parallel::to_range(input); });
+		out.resize(inputs.size());
+		parallel_hash3<bit_mode>(ranges.data(), ranges.size(), out.data(), pool, seed);
+	}
+
+	template <size_t bit_mode, typename T>
+	inline void parallel_hash3(const std::vector<T>& inputs, std::vector<hash_t<bit_mode>>& out, uint64_t seed = 0)
+	{
+		std::vector<byte_range> ranges(inputs.size());
+		std::transform(inputs.begin(), inputs.end(), ranges.begin(), [](const T& input) { return detail_parallel::to_range(input); });
+		out.resize(inputs.size());
+		parallel_hash3<bit_mode>(ranges.data(), ranges.size(), out.data(), seed);
+	}
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <ios>
+#include <streambuf>
+#include <vector>
+
+#include "xxhash.hpp"
+
+/*
+xxHash - Extremely Fast Hash algorithm
+iostream integration for the C++ port.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+namespace xxh
+{
+	/* *************************************
+	*  Hashing Stream Buffer
+	***************************************/
+
+	/* A streambuf that forwards to another one and hashes, with xxhash3<bit_mode>, every byte read through it or written through it.
+	* Bytes are hashed in place, straight from the get and put areas, which are sized in whole multiples of the state's internal buffer;
+	* large reads and writes skip the buffer entirely and are hashed in the caller's memory.
+	* Only consumed bytes count: data read ahead from the wrapped buffer but not yet extracted is not part of the digest.
+	* Meant to be used in one direction at a time. Seeking is not supported, and putback does not reach before the last digest().
+	*/
+	template <size_t bit_mode>
+	class hashing_streambuf : public std::streambuf
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "xxhash3 can only be used in 64 and 128 bit modes.");
+
+		/* a multiple of the 256 byte internal buffer of hash3_state_t, so full buffers are hashed without being staged there */
+		static constexpr size_t block_size = 1024;
+
+		std::streambuf* wrapped;
+		hash3_state_t<bit_mode> state;
+		std::vector<char> get_buffer;
+		std::vector<char> put_buffer;
+		/* start of the bytes of the get area that were extracted but not hashed yet */
+		char* get_hashed = nullptr;
+		/* start of the bytes of the put area that were inserted but not hashed yet */
+		char* put_hashed = nullptr;
+
+		void hash_extracted()
+		{
+			if (gptr() > get_hashed)
+			{
+				state.update(get_hashed, static_cast<size_t>(gptr() - get_hashed));
+				get_hashed = gptr();
+			}
+		}
+
+		void hash_inserted()
+		{
+			if (pptr() > put_hashed)
+			{
+				state.update(put_hashed, static_cast<size_t>(pptr() - put_hashed));
+				put_hashed = pptr();
+			}
+		}
+
+		bool flush_put_area()
+		{
+			std::streamsize const pending = pptr() - pbase();
+
+			if (pending == 0)
+			{
+				return true;
+			}
+
+			hash_inserted();
+			bool const written = (wrapped->sputn(pbase(), pending) == pending);
+			setp(put_buffer.data(), put_buffer.data() + put_buffer.size());
+			put_hashed = pbase();
+			return written;
+		}
+
+	protected:
+
+		int_type underflow() override
+		{
+			hash_extracted();
+
+			std::streamsize const got = wrapped->sgetn(get_buffer.data(), static_cast<std::streamsize>(get_buffer.size()));
+
+			setg(get_buffer.data(), get_buffer.data(), get_buffer.data() + std::max<std::streamsize>(got, 0));
+			get_hashed = get_buffer.data();
+
+			return (got > 0) ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+		}
+
+		std::streamsize xsgetn(char* s, std::streamsize count) override
+		{
+			std::streamsize const buffered = std::min<std::streamsize>(egptr() - gptr(), count);
+
+			if (buffered > 0)
+			{
+				memcpy(s, gptr(), static_cast<size_t>(buffered));
+				gbump(static_cast<int>(buffered));
+			}
+
+			if (buffered == count)
+			{
+				return count;
+			}
+
+			hash_extracted();
+
+			if (count - buffered < static_cast<std::streamsize>(get_buffer.size()))
+			{
+				return buffered + std::streambuf::xsgetn(s + buffered, count - buffered);
+			}
+
+			/* large read: straight into the caller's memory */
+			std::streamsize const got = wrapped->sgetn(s + buffered, count - buffered);
+
+			if (got > 0)
+			{
+				state.update(s + buffered, static_cast<size_t>(got));
+			}
+
+			return buffered + std::max<std::streamsize>(got, 0);
+		}
+
+		int_type overflow(int_type ch) override
+		{
+			if (!flush_put_area())
+			{
+				return traits_type::eof();
+			}
+
+			if (!traits_type::eq_int_type(ch, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+			}
+
+			return traits_type::not_eof(ch);
+		}
+
+		std::streamsize xsputn(const char* s, std::streamsize count) override
+		{
+			if (count < static_cast<std::streamsize>(put_buffer.size()))
+			{
+				return std::streambuf::xsputn(s, count);
+			}
+
+			/* large write: hashed in the caller's memory and handed on as is */
+			if (!flush_put_area())
+			{
+				return 0;
+			}
+
+			state.update(s, static_cast<size_t>(count));
+			return wrapped->sputn(s, count);
+		}
+
+		int sync() override
+		{
+			hash_extracted();
+			bool const flushed = flush_put_area();
+			return (flushed && wrapped->pubsync() == 0) ? 0 : -1;
+		}
+
+	public:
+
+		/* buffer_size is rounded up to a multiple of block_size. */
+		explicit hashing_streambuf(std::streambuf* wrapped_, uint64_t seed = 0, size_t buffer_size = 64 * 1024) : wrapped(wrapped_), state(seed)
+		{
+			buffer_size = std::max<size_t>((buffer_size + block_size - 1) / block_size, 1) * block_size;
+			get_buffer.resize(buffer_size);
+			put_buffer.resize(buffer_size);
+			setg(get_buffer.data(), get_buffer.data(), get_buffer.data());
+			get_hashed = get_buffer.data();
+			setp(put_buffer.data(), put_buffer.data() + put_buffer.size());
+			put_hashed = pbase();
+		}
+
+		hashing_streambuf(const hashing_streambuf&) = delete;
+		hashing_streambuf& operator=(const hashing_streambuf&) = delete;
+
+		~hashing_streambuf() override
+		{
+			flush_put_area();
+		}
+
+		std::streambuf* wrapped_buffer() const
+		{
+			return wrapped;
+		}
+
+		/* Digest of every byte extracted or inserted so far. Pending output is hashed, but only forwarded on the next flush. */
+		hash_t<bit_mode> digest()
+		{
+			hash_extracted();
+			hash_inserted();
+			return state.digest();
+		}
+
+		/* Starts a new digest from the current position. Input read ahead but not extracted yet, and pending output, stay where they are. */
+		void reset(uint64_t seed = 0)
+		{
+			hash_extracted();
+			hash_inserted();
+			state.reset(seed);
+		}
+	};
+}
@@ -0,0 +1,606 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xxhash.hpp"
+#include "xxhash_file.hpp"
+
+#if defined(__linux__)
+#	include <linux/fs.h>
+#	include <linux/io_uring.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <sys/uio.h>
+#endif
+
+/*
+xxHash - Extremely Fast Hash algorithm
+Pipelined file hashing for Linux, through io_uring.
+Copyright (C) 2017-2024, Red Gavin.
+All rights reserved.
+
+BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+See xxhash.hpp for the full license text.
+*/
+
+#if defined(__linux__)
+namespace xxh
+{
+	/* *************************************
+	*  Pipelined File Hashing
+	***************************************/
+
+	/* automatic uses io_uring when the kernel provides it and a pread thread otherwise. */
+	enum class pipeline_engine : uint8_t { automatic, io_uring, pread_thread };
+
+	struct pipeline_options
+	{
+		uint64_t seed = 0;
+		pipeline_engine engine = pipeline_engine::automatic;
+		/* Size of each buffer, rounded up to a multiple of pipeline_alignment. */
+		size_t buffer_size = 1024 * 1024;
+		/* Number of buffers being read while one is hashed. */
+		size_t queue_depth = 8;
+		/* Bypass the page cache with O_DIRECT. Ignored, and reported as such, if the file system refuses it. */
+		bool direct = false;
+	};
+
+	/* Buffer address, size and file offset alignment, enough for O_DIRECT on common devices. */
+	constexpr size_t pipeline_alignment = 4096;
+
+	/* rate() is the end to end throughput. hash_seconds is the time spent hashing, so cpu_rate() is what the CPU alone could sustain.
+	* wait_seconds is the time the hasher sat idle waiting for the device; when it is a large part of seconds, the run was device bound.
+	*/
+	template <size_t bit_mode>
+	struct pipelined_hash_result : file_hash_result<bit_mode>
+	{
+		double hash_seconds = 0;
+		double wait_seconds = 0;
+		bool used_io_uring = false;
+		bool direct = false;
+
+		double cpu_rate() const
+		{
+			return (hash_seconds > 0) ? static_cast<double>(this->bytes) / hash_seconds : 0;
+		}
+	};
+
+	namespace detail_uring
+	{
+		using detail_file::clock;
+		using detail_file::elapsed;
+		using detail_file::last_error;
+
+		struct aligned_free
+		{
+			void operator()(uint8_t* p) const
+			{
+				std::free(p);
+			}
+		};
+
+		/* One buffer of the pipeline and the file range it holds. */
+		struct slot_t
+		{
+			struct iovec iov;
+			uint64_t offset = 0;
+			size_t expected = 0;
+			size_t filled = 0;
+			bool done = false;
+		};
+
+		inline size_t round_up(size_t n, size_t alignment)
+		{
+			return (n + alignment - 1) / alignment * alignment;
+		}
+
+		/* Minimal io_uring wrapper over the raw system calls: one submission and one completion ring, read requests only. */
+		class ring_t
+		{
+			int ring_fd = -1;
+			void* sq_ptr = MAP_FAILED;
+			size_t sq_size = 0;
+			void* cq_ptr = MAP_FAILED;
+			size_t cq_size = 0;
+			struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+			size_t sqes_size = 0;
+
+			unsigned* sq_tail = nullptr;
+			unsigned* sq_mask = nullptr;
+			unsigned* sq_array = nullptr;
+			unsigned* cq_head = nullptr;
+			unsigned* cq_tail = nullptr;
+			unsigned* cq_mask = nullptr;
+			struct io_uring_cqe* cqes = nullptr;
+			unsigned unsubmitted = 0;
+
+		public:
+
+			ring_t() = default;
+			ring_t(const ring_t&) = delete;
+			ring_t& operator=(const ring_t&) = delete;
+
+			~ring_t()
+			{
+				if (sqes != MAP_FAILED)
+				{
+					::munmap(sqes, sqes_size);
+				}
+
+				if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+				{
+					::munmap(cq_ptr, cq_size);
+				}
+
+				if (sq_ptr != MAP_FAILED)
+				{
+					::munmap(sq_ptr, sq_size);
+				}
+
+				if (ring_fd >= 0)
+				{
+					::close(ring_fd);
+				}
+			}
+
+			bool open(unsigned entries)
+			{
+				struct io_uring_params params;
+				memset(&params, 0, sizeof(params));
+
+				ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+
+				if (ring_fd < 0)
+				{
+					return false;
+				}
+
+				sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+				if (params.features & IORING_FEAT_SINGLE_MMAP)
+				{
+					sq_size = cq_size = std::max(sq_size, cq_size);
+				}
+
+				sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+
+				if (sq_ptr == MAP_FAILED)
+				{
+					return false;
+				}
+
+				cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ptr : ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+
+				if (cq_ptr == MAP_FAILED)
+				{
+					return false;
+				}
+
+				sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+				sqes = static_cast<struct io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+
+				if (sqes == MAP_FAILED)
+				{
+					return false;
+				}
+
+				uint8_t* const sq = static_cast<uint8_t*>(sq_ptr);
+				uint8_t* const cq = static_cast<uint8_t*>(cq_ptr);
+
+				sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+				sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+				sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+				cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+				cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+				cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+				cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+				return true;
+			}
+
+			/* Queues a vectored read. The caller never has more requests outstanding than the ring has entries. */
+			void queue_read(int fd, const struct iovec* iov, uint64_t offset, uint64_t user_data)
+			{
+				unsigned const tail = *sq_tail;
+				unsigned const index = tail & *sq_mask;
+				struct io_uring_sqe* const sqe = &sqes[index];
+
+				memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode = IORING_OP_READV;
+				sqe->fd = fd;
+				sqe->addr = reinterpret_cast<uint64_t>(iov);
+				sqe->len = 1;
+				sqe->off = offset;
+				sqe->user_data = user_data;
+
+				sq_array[index] = index;
+				__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+				unsubmitted++;
+			}
+
+			/* Submits the queued requests and blocks until at least wait_count completions are available. */
+			int submit(unsigned wait_count)
+			{
+				while (true)
+				{
+					int const ret = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, unsubmitted, wait_count, (wait_count > 0) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+
+					if (ret >= 0)
+					{
+						unsubmitted -= static_cast<unsigned>(ret);
+						return 0;
+					}
+
+					if (errno != EINTR)
+					{
+						return errno;
+					}
+				}
+			}
+
+			bool pop(struct io_uring_cqe& cqe)
+			{
+				unsigned const head = *cq_head;
+
+				if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+				{
+					return false;
+				}
+
+				cqe = cqes[head & *cq_mask];
+				__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+				return true;
+			}
+		};
+
+		/* Size of a file or block device, or false for anything that cannot be read by offset. */
+		inline bool readable_size(int fd, uint64_t& size)
+		{
+			struct stat st;
+
+			if (::fstat(fd, &st) != 0)
+			{
+				return false;
+			}
+
+			if (S_ISREG(st.st_mode))
+			{
+				size = static_cast<uint64_t>(st.st_size);
+				return true;
+			}
+
+			return S_ISBLK(st.st_mode) && ::ioctl(fd, BLKGETSIZE64, &size) == 0;
+		}
+
+		/* The read issued for what is still missing from a slot. O_DIRECT needs aligned lengths; the device stops at the end of the file anyway. */
+		inline void prepare_read(slot_t& slot, uint8_t* buffer, bool direct)
+		{
+			size_t const len = slot.expected - slot.filled;
+
+			slot.iov.iov_base = buffer + slot.filled;
+			slot.iov.iov_len = direct ? round_up(len, pipeline_alignment) : len;
+		}
+
+		template <size_t N>
+		inline std::error_code hash_uring(int fd, uint64_t size, bool direct, ring_t& ring, uint8_t* buffers, size_t buffer_size, size_t depth, hash3_state_t<N>& state, pipelined_hash_result<N>& result)
+		{
+			uint64_t const blocks = (size + buffer_size - 1) / buffer_size;
+			std::vector<slot_t> slots(depth);
+			std::error_code error;
+			size_t in_flight = 0;
+
+			auto start_block = [&](uint64_t block) {
+				slot_t& slot = slots[block % depth];
+
+				slot.offset = block * buffer_size;
+				slot.expected = static_cast<size_t>(std::min<uint64_t>(buffer_size, size - slot.offset));
+				slot.filled = 0;
+				slot.done = false;
+				prepare_read(slot, buffers + (block % depth) * buffer_size, direct);
+				ring.queue_read(fd, &slot.iov, slot.offset, block % depth);
+				in_flight++;
+			};
+
+			auto complete = [&](const struct io_uring_cqe& cqe) {
+				size_t const index = static_cast<size_t>(cqe.user_data);
+				slot_t& slot = slots[index];
+
+				in_flight--;
+
+				if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+				{
+					ring.queue_read(fd, &slot.iov, slot.offset + slot.filled, index);
+					in_flight++;
+					return;
+				}
+
+				if (cqe.res < 0)
+				{
+					error = std::error_code(-cqe.res, std::generic_category());
+					slot.done = true;
+					return;
+				}
+
+				slot.filled += static_cast<size_t>(cqe.res);
+
+				if (cqe.res == 0 || slot.filled >= slot.expected)
+				{	/* a read of 0 bytes means the file shrank under us: hash what there is */
+					slot.filled = std::min(slot.filled, slot.expected);
+					slot.done = true;
+					return;
+				}
+
+				prepare_read(slot, buffers + index * buffer_size, direct);
+				ring.queue_read(fd, &slot.iov, slot.offset + slot.filled, index);
+				in_flight++;
+			};
+
+			for (uint64_t block = 0; block < std::min<uint64_t>(depth, blocks); block++)
+			{
+				start_block(block);
+			}
+
+			for (uint64_t block = 0; block < blocks && !error; block++)
+			{
+				slot_t& slot = slots[block % depth];
+				clock::time_point const wait_start = clock::now();
+
+				while (!slot.done)
+				{
+					if (int const err = ring.submit(1))
+					{
+						error = std::error_code(err, std::generic_category());
+						break;
+					}
+
+					struct io_uring_cqe cqe;
+
+					while (ring.pop(cqe))
+					{
+						complete(cqe);
+					}
+				}
+
+				result.wait_seconds += elapsed(wait_start);
+
+				if (error)
+				{
+					break;
+				}
+
+				clock::time_point const hash_start = clock::now();
+				state.update(buffers + (block % depth) * buffer_size, slot.filled);
+				result.hash_seconds += elapsed(hash_start);
+				result.bytes += slot.filled;
+
+				if (slot.filled < slot.expected)
+				{
+					break;
+				}
+
+				if (block + depth < blocks)
+				{
+					start_block(block + depth);
+					ring.submit(0);
+				}
+			}
+
+			/* the buffers must outlive every read the kernel still owns */
+			while (in_flight > 0)
+			{
+				struct io_uring_cqe cqe;
+
+				if (ring.submit(1) != 0)
+				{
+					break;
+				}
+
+				while (ring.pop(cqe))
+				{
+					in_flight--;
+				}
+			}
+
+			return error;
+		}
+
+		/* Same pipeline without io_uring: a reader thread fills the buffers in order with pread while the caller hashes them. */
+		template <size_t N>
+		inline std::error_code hash_pread_thread(int fd, uint64_t size, bool direct, uint8_t* buffers, size_t buffer_size, size_t depth, hash3_state_t<N>& state, pipelined_hash_result<N>& result)
+		{
+			uint64_t const blocks = (size + buffer_size - 1) / buffer_size;
+			std::vector<slot_t> slots(depth);
+			std::mutex mutex;
+			std::condition_variable changed;
+			std::error_code read_error;
+			bool stop = false;
+
+			std::thread reader([&]() {
+				for (uint64_t block = 0; block < blocks; block++)
+				{
+					size_t const index = static_cast<size_t>(block % depth);
+					slot_t& slot = slots[index];
+
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						changed.wait(lock, [&]() { return stop || !slot.done; });
+
+						if (stop)
+						{
+							return;
+						}
+					}
+
+					slot.offset = block * buffer_size;
+					slot.expected = static_cast<size_t>(std::min<uint64_t>(buffer_size, size - slot.offset));
+					slot.filled = 0;
+
+					std::error_code error;
+					bool end = false;
+
+					while (slot.filled < slot.expected)
+					{
+						prepare_read(slot, buffers + index * buffer_size, direct);
+						ssize_t const n = ::pread(fd, slot.iov.iov_base, slot.iov.iov_len, static_cast<off_t>(slot.offset + slot.filled));
+
+						if (n < 0 && errno == EINTR)
+						{
+							continue;
+						}
+
+						if (n <= 0)
+						{
+							error = (n < 0) ? last_error() : std::error_code();
+							end = true;
+							break;
+						}
+
+						slot.filled = std::min(slot.filled + static_cast<size_t>(n), slot.expected);
+					}
+
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						read_error = error;
+						slot.done = true;
+					}
+
+					changed.notify_all();
+
+					if (end)
+					{
+						return;
+					}
+				}
+			});
+
+			std::error_code error;
+
+			for (uint64_t block = 0; block < blocks; block++)
+			{
+				slot_t& slot = slots[block % depth];
+				clock::time_point const wait_start = clock::now();
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&]() { return slot.done; });
+					error = read_error;
+				}
+
+				result.wait_seconds += elapsed(wait_start);
+
+				if (error)
+				{
+					break;
+				}
+
+				clock::time_point const hash_start = clock::now();
+				state.update(buffers + (block % depth) * buffer_size, slot.filled);
+				result.hash_seconds += elapsed(hash_start);
+				result.bytes += slot.filled;
+
+				bool const short_block = slot.filled < slot.expected;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					slot.done = false;
+				}
+
+				changed.notify_all();
+
+				if (short_block)
+				{
+					break;
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+
+			changed.notify_all();
+			reader.join();
+			return error;
+		}
+	}
+
+	/* Hashes a regular file or block device with xxhash3<bit_mode> while up to queue_depth further buffers are being read,
+	* so the device and the CPU work at the same time. Buffers are hashed strictly in file order through hash3_state_t.
+	* Inputs that cannot be read by offset, such as pipes, are hashed with hash_file instead.
+	*/
+	template <size_t bit_mode>
+	inline pipelined_hash_result<bit_mode> hash_file_pipelined(const std::string& path, const pipeline_options& options = pipeline_options())
+	{
+		static_assert(!(bit_mode != 128 && bit_mode != 64), "xxhash3 can only be used in 64 and 128 bit modes.");
+
+		detail_uring::clock::time_point const start = detail_uring::clock::now();
+		pipelined_hash_result<bit_mode> result;
+		int fd = -1;
+
+		if (options.direct)
+		{
+			fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+			result.direct = (fd >= 0);
+		}
+
+		if (fd < 0)
+		{
+			fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		}
+
+		if (fd < 0)
+		{
+			result.error = detail_uring::last_error();
+			return result;
+		}
+
+		uint64_t size = 0;
+
+		if (!detail_uring::readable_size(fd, size))
+		{
+			file_hash_options file_options;
+			file_options.seed = options.seed;
+			file_options.access = file_access::read;
+
+			static_cast<file_hash_result<bit_mode>&>(result) = detail_file::hash_fd<bit_mode, hash3_state_t<bit_mode>>(fd, file_options);
+			::close(fd);
+			return result;
+		}
+
+		size_t const buffer_size = detail_uring::round_up(std::max<size_t>(options.buffer_size, 1), pipeline_alignment);
+		size_t const depth = std::max<size_t>(options.queue_depth, 1);
+		std::unique_ptr<uint8_t, detail_uring::aligned_free> const buffers(static_cast<uint8_t*>(std::aligned_alloc(pipeline_alignment, buffer_size * depth)));
+		hash3_state_t<bit_mode> state(options.seed);
+
+		if (!buffers)
+		{
+			result.error = std::make_error_code(std::errc::not_enough_memory);
+			::close(fd);
+			return result;
+		}
+
+		detail_uring::ring_t ring;
+
+		if (options.engine != pipeline_engine::pread_thread && ring.open(static_cast<unsigned>(depth)))
+		{
+			result.used_io_uring = true;
+			result.error = detail_uring::hash_uring<bit_mode>(fd, size, result.direct, ring, buffers.get(), buffer_size, depth, state, result);
+		}
+		else
+		{
+			result.error = detail_uring::hash_pread_thread<bit_mode>(fd, size, result.direct, buffers.get(), buffer_size, depth, state, result);
+		}
+
+		::close(fd);
+		result.hash = state.digest();
+		result.seconds = detail_uring::elapsed(start);
+		return result;
+	}
+}
+#endif
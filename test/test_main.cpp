@@ -8,12 +8,38 @@
 #include <cmath>
 #include <stdlib.h>
 #include <string>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 #define XXH_STATIC_LINKING_ONLY
 
 #define XXH_INLINE_ALL
 #include "xxh3.h"	
 #include "xxhash.hpp"
+#include "xxhash_parallel.hpp"
+#include "xxhash_file.hpp"
+#include "xxhash_uring.hpp"
+#include "xxhash_manifest.hpp"
+#include "xxhash_stream.hpp"
+#include "xxhash_blocks.hpp"
+#include "xxhash_page.hpp"
+#include "xxhash_cdc.hpp"
+#include "xxhash_delta.hpp"
+#include "xxhash_merkle.hpp"
+#include "xxhash_flat_map.hpp"
+#include "xxhash_concurrent_map.hpp"
+#include "xxhash_interner.hpp"
+#include "xxhash_hashed_string.hpp"
+#include "xxhash_bloom.hpp"
+#include "xxhash_cuckoo.hpp"
+#include "xxhash_fuse.hpp"
+#include "xxhash_mphf.hpp"
+#include "xxhash_hyperloglog.hpp"
+#include "xxhash_count_min.hpp"
 
 
 #define CATCH_CONFIG_RUNNER
@@ -850,3 +876,2110 @@ TEST_CASE("Checking c++ assignment operator","[c++ compliance]")
 
     REQUIRE(hash_state_cmp_test1.digest() == hash_state_cmp_test2.digest());
 }
+
+TEST_CASE("Multi-algorithm streaming matches the individual algorithms", "[multi]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> input_buffer(3 * xxh::multi_state<32>::tile_size + 77);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { size_t(0), size_t(3), size_t(17), size_t(240), size_t(241), size_t(4096), xxh::multi_state<32>::tile_size, xxh::multi_state<32>::tile_size + 1, input_buffer.size() })
+	{
+		uint32_t seed = dist(rng);
+
+		xxh::multi_state<32, 64, 128> state(seed);
+		size_t split = len / 3;
+		state.update(input_buffer.data(), split);
+		state.update(input_buffer.data() + split, len - split);
+
+		auto [h32, h64, h128] = state.digest();
+		REQUIRE(h32 == xxh::xxhash<32>(input_buffer.data(), len, seed));
+		REQUIRE(h64 == xxh::xxhash<64>(input_buffer.data(), len, seed));
+		REQUIRE(h128 == xxh::xxhash3<128>(input_buffer.data(), len, seed));
+
+		auto [o32, o64, o128] = xxh::multi_hash<32, 64, 128>(input_buffer.data(), len, seed);
+		REQUIRE(o32 == h32);
+		REQUIRE(o64 == h64);
+		REQUIRE(o128 == h128);
+
+		xxh::multi_state_t<xxh::hash3_state64_t, xxh::hash3_state128_t> state3(seed);
+		state3.update(input_buffer.begin(), input_buffer.begin() + len);
+		REQUIRE(std::get<0>(state3.digest()) == xxh::xxhash3<64>(input_buffer.data(), len, seed));
+		REQUIRE(state3.get<1>().digest() == xxh::xxhash3<128>(input_buffer.data(), len, seed));
+	}
+}
+
+template <size_t bit_mode>
+void check_hash_state_arena()
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+	std::uniform_int_distribution<size_t> stream_dist(0, 36);
+	std::uniform_int_distribution<size_t> len_dist(0, 300);
+
+	constexpr size_t stream_count = 37;
+	std::vector<uint8_t> input_buffer(4096);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::hash_state_arena_t<bit_mode> arena(stream_count, 42);
+	std::vector<xxh::hash_state_t<bit_mode>> states(stream_count, xxh::hash_state_t<bit_mode>(42));
+
+	size_t const extra = arena.add_stream(7);
+	states.emplace_back(7);
+
+	for (size_t round = 0; round < 64; round++)
+	{
+		std::vector<typename xxh::hash_state_arena_t<bit_mode>::update_t> batch;
+
+		for (size_t i = 0; i < 24; i++)
+		{
+			size_t const id = (i % 11 == 10) ? extra : stream_dist(rng);
+			size_t const len = (i % 3 == 0) ? len_dist(rng) % 20 : len_dist(rng);
+			size_t const offset = len_dist(rng);
+
+			batch.push_back({ id, input_buffer.data() + offset, len });
+			states[id].update(input_buffer.data() + offset, len);
+		}
+
+		if (round % 2)
+		{
+			arena.update(batch);
+		}
+		else
+		{
+			for (const auto& u : batch)
+			{
+				arena.update(u.stream_id, u.input, u.length);
+			}
+		}
+
+		for (size_t id = 0; id < arena.size(); id++)
+		{
+			REQUIRE(arena.digest(id) == states[id].digest());
+		}
+	}
+
+	arena.reset(3, 5);
+	states[3].reset(5);
+	REQUIRE(arena.digest(3) == states[3].digest());
+}
+
+TEST_CASE("Stream arena digests match individual hash states", "[arena]")
+{
+	check_hash_state_arena<32>();
+	check_hash_state_arena<64>();
+}
+
+TEST_CASE("Fused copy and hash matches memcpy followed by xxhash3", "[copy]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> input_buffer(70000);
+	std::array<uint8_t, 256> secret_plus_size;
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+	std::generate(secret_plus_size.begin(), secret_plus_size.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	alignas(64) static uint8_t output_buffer[70000 + 64];
+
+	for (size_t len : { size_t(0), size_t(1), size_t(16), size_t(129), size_t(240), size_t(241), size_t(1024), size_t(1025), size_t(4099), size_t(70000) })
+	{
+		uint64_t seed = dist(rng);
+
+		for (xxh::store_hint hint : { xxh::store_hint::automatic, xxh::store_hint::temporal, xxh::store_hint::non_temporal })
+		{
+			for (size_t offset : { size_t(0), size_t(3) })
+			{
+				std::fill(std::begin(output_buffer), std::end(output_buffer), uint8_t(0));
+				REQUIRE(xxh::copy_and_hash3<64>(output_buffer + offset, input_buffer.data(), len, seed, hint) == xxh::xxhash3<64>(input_buffer.data(), len, seed));
+				REQUIRE(std::memcmp(output_buffer + offset, input_buffer.data(), len) == 0);
+
+				REQUIRE(xxh::copy_and_hash3<128>(output_buffer + offset, input_buffer.data(), len, secret_plus_size.data(), secret_plus_size.size(), seed, hint) == xxh::xxhash3<128>(input_buffer.data(), len, secret_plus_size.data(), secret_plus_size.size(), seed));
+				REQUIRE(std::memcmp(output_buffer + offset, input_buffer.data(), len) == 0);
+			}
+		}
+
+		std::fill(std::begin(output_buffer), std::end(output_buffer), uint8_t(0));
+		xxh::hash3_state128_t copy_state(seed);
+		size_t done = 0;
+
+		for (size_t step : { size_t(5), size_t(300), size_t(64), size_t(1000), size_t(9000) })
+		{
+			size_t const n = std::min(step, len - done);
+			copy_state.update_copy(output_buffer + done, input_buffer.data() + done, n);
+			done += n;
+		}
+
+		copy_state.update_copy(output_buffer + done, input_buffer.data() + done, len - done);
+
+		REQUIRE(copy_state.digest() == xxh::xxhash3<128>(input_buffer.data(), len, seed));
+		REQUIRE(std::memcmp(output_buffer, input_buffer.data(), len) == 0);
+	}
+}
+
+TEST_CASE("Tree hash is independent of the thread count and of how the input is fed", "[tree]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> input_buffer(20000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::thread_pool pool(3);
+	xxh::tree_params params;
+	params.chunk_size = 1000;
+	params.seed = dist(rng);
+
+	/* three chunks spelled out according to the version 1 definition */
+	{
+		auto canon_concat = [](std::initializer_list<xxh::hash128_t> hashes) {
+			std::vector<uint8_t> out;
+			for (auto h : hashes)
+			{
+				xxh::canonical128_t c(h);
+				out.insert(out.end(), c.digest.begin(), c.digest.end());
+			}
+			return out;
+		};
+
+		xxh::hash128_t const l0 = xxh::xxhash3<128>(input_buffer.data(), 1000, params.seed);
+		xxh::hash128_t const l1 = xxh::xxhash3<128>(input_buffer.data() + 1000, 1000, params.seed);
+		xxh::hash128_t const l2 = xxh::xxhash3<128>(input_buffer.data() + 2000, 500, params.seed);
+		xxh::hash128_t const n01 = xxh::xxhash3<128>(canon_concat({ l0, l1 }), params.seed ^ xxh::detail_tree::tree_parent_key);
+		xxh::hash128_t const top = xxh::xxhash3<128>(canon_concat({ n01, l2 }), params.seed ^ xxh::detail_tree::tree_parent_key);
+		std::vector<uint8_t> root = canon_concat({ top });
+		root.resize(36);
+		xxh::mem_ops::writeLE<64>(root.data() + 16, 2500);
+		xxh::mem_ops::writeLE<64>(root.data() + 24, 1000);
+		xxh::mem_ops::writeLE<32>(root.data() + 32, xxh::tree_version);
+
+		REQUIRE(xxh::tree_hash_reference(input_buffer.data(), 2500, params) == xxh::xxhash3<128>(root, params.seed ^ xxh::detail_tree::tree_root_key));
+	}
+
+	for (size_t len : { size_t(0), size_t(1), size_t(999), size_t(1000), size_t(1001), size_t(2000), size_t(5999), size_t(7000), size_t(15001), size_t(20000) })
+	{
+		xxh::hash128_t const reference = xxh::tree_hash_reference(input_buffer.data(), len, params);
+
+		REQUIRE(xxh::tree_hash(input_buffer.data(), len, pool, params) == reference);
+		REQUIRE(xxh::tree_hash(input_buffer.data(), len, params) == reference);
+
+		xxh::tree_state state(params);
+		size_t done = 0;
+
+		while (done < len)
+		{
+			size_t const n = std::min(len - done, static_cast<size_t>(dist(rng)) * 10);
+			state.update(input_buffer.data() + done, n);
+			done += n;
+		}
+
+		REQUIRE(state.digest() == reference);
+
+		xxh::tree_state whole(params);
+		whole.update(input_buffer.data(), len);
+		REQUIRE(whole.digest() == reference);
+	}
+
+	params.chunk_size = 2000;
+	REQUIRE(!(xxh::tree_hash_reference(input_buffer.data(), input_buffer.size(), params) == xxh::tree_hash(input_buffer.data(), input_buffer.size(), pool, xxh::tree_params{ 1000, params.seed })));
+}
+
+template <size_t bit_mode>
+void check_parallel_hash3(xxh::thread_pool& pool, const std::vector<std::vector<uint8_t>>& inputs, uint64_t seed)
+{
+	std::vector<xxh::hash_t<bit_mode>> out;
+	xxh::parallel_hash3<bit_mode>(inputs, out, pool, seed);
+	REQUIRE(out.size() == inputs.size());
+
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		REQUIRE(out[i] == xxh::xxhash3<bit_mode>(inputs[i], seed));
+	}
+
+	std::vector<xxh::hash_t<bit_mode>> out_internal;
+	xxh::parallel_hash3<bit_mode>(inputs, out_internal, seed);
+	REQUIRE(out_internal == out);
+}
+
+TEST_CASE("Work-stealing pool and batch hashing", "[parallel]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	xxh::thread_pool pool(3);
+
+	SECTION("Every index is visited exactly once, even with uneven tasks")
+	{
+		std::vector<std::atomic<int>> visits(1000);
+
+		for (auto& v : visits)
+		{
+			v = 0;
+		}
+
+		pool.parallel_for(visits.size(), [&](size_t i) {
+			if (i < 10)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+			visits[i]++;
+		});
+
+		REQUIRE(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v == 1; }));
+	}
+
+	SECTION("Batch results match xxhash3")
+	{
+		std::vector<std::vector<uint8_t>> inputs;
+
+		for (size_t i = 0; i < 3000; i++)
+		{
+			size_t const len = (i % 97 == 0) ? dist(rng) * 400 : (i % 3 == 0) ? dist(rng) : dist(rng) % 17;
+			std::vector<uint8_t> input(len);
+			std::generate(input.begin(), input.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+			inputs.push_back(std::move(input));
+		}
+
+		uint64_t const seed = (static_cast<uint64_t>(dist(rng)) << 32) | dist(rng);
+
+		check_parallel_hash3<64>(pool, inputs, 0);
+		check_parallel_hash3<64>(pool, inputs, seed);
+		check_parallel_hash3<128>(pool, inputs, 0);
+		check_parallel_hash3<128>(pool, inputs, seed);
+
+		std::vector<std::string> const strings = { "", "a", "short string", std::string(200, 'x'), std::string(5000, 'y') };
+		std::vector<xxh::hash64_t> out;
+		xxh::parallel_hash3<64>(strings, out, pool);
+
+		for (size_t i = 0; i < strings.size(); i++)
+		{
+			REQUIRE(out[i] == xxh::xxhash3<64>(strings[i]));
+		}
+	}
+}
+
+TEST_CASE("File hashing matches xxhash3 of the file contents", "[file]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::string const path = (std::filesystem::temp_directory_path() / ("xxhash_cpp_test_" + std::to_string(dist(rng)) + ".bin")).string();
+	std::vector<uint8_t> contents(300000 + dist(rng));
+	std::generate(contents.begin(), contents.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+	}
+
+	xxh::file_hash_options options;
+	options.seed = dist(rng);
+	xxh::hash128_t const expected = xxh::xxhash3<128>(contents, options.seed);
+
+	for (xxh::file_access access : { xxh::file_access::automatic, xxh::file_access::map, xxh::file_access::read })
+	{
+		for (size_t window : { size_t(1), size_t(65536), size_t(64 * 1024 * 1024) })
+		{
+			options.access = access;
+			options.window_size = window;
+			options.buffer_size = window;
+
+			xxh::file_hash_result<128> const result = xxh::hash_file<128>(path, options);
+			REQUIRE(result.ok());
+			REQUIRE(result.bytes == contents.size());
+			REQUIRE(result.mapped == (access != xxh::file_access::read));
+			REQUIRE(result.hash == expected);
+		}
+	}
+
+	REQUIRE(xxh::hash_file<64>(path).hash == xxh::xxhash3<64>(contents));
+	REQUIRE(xxh::hash_file<64, xxh::hash_state64_t>(path, options).hash == xxh::xxhash<64>(contents, options.seed));
+	REQUIRE(xxh::hash_file<32, xxh::hash_state32_t>(path, options).hash == xxh::xxhash<32>(contents, static_cast<uint32_t>(options.seed)));
+
+	std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+	REQUIRE(xxh::hash_file<64>(path).hash == xxh::xxhash3<64>(contents.data(), 0));
+
+	std::filesystem::remove(path);
+	REQUIRE(!xxh::hash_file<64>(path).ok());
+
+#if XXH_CPP_POSIX_FILES
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+	REQUIRE(write(fds[1], contents.data(), 4000) == 4000);
+	close(fds[1]);
+
+	xxh::file_hash_result<64> const piped = xxh::hash_file<64>(fds[0]);
+	close(fds[0]);
+	REQUIRE(piped.ok());
+	REQUIRE(!piped.mapped);
+	REQUIRE(piped.hash == xxh::xxhash3<64>(contents.data(), 4000));
+#endif
+}
+
+#if defined(__linux__)
+TEST_CASE("Pipelined file hashing matches xxhash3 with both engines", "[uring]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::string const path = (std::filesystem::temp_directory_path() / ("xxhash_cpp_test_" + std::to_string(dist(rng)) + ".pipe.bin")).string();
+	std::vector<uint8_t> contents(200000 + dist(rng) * 7);
+	std::generate(contents.begin(), contents.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+	}
+
+	xxh::pipeline_options options;
+	options.seed = dist(rng);
+	options.buffer_size = 3 * xxh::pipeline_alignment;
+	options.queue_depth = 4;
+
+	for (xxh::pipeline_engine engine : { xxh::pipeline_engine::automatic, xxh::pipeline_engine::pread_thread })
+	{
+		for (bool direct : { false, true })
+		{
+			options.engine = engine;
+			options.direct = direct;
+
+			xxh::pipelined_hash_result<128> const result = xxh::hash_file_pipelined<128>(path, options);
+			REQUIRE(result.ok());
+			REQUIRE(result.bytes == contents.size());
+			REQUIRE(result.hash == xxh::xxhash3<128>(contents, options.seed));
+
+			if (engine == xxh::pipeline_engine::pread_thread)
+			{
+				REQUIRE(!result.used_io_uring);
+			}
+		}
+	}
+
+	options.queue_depth = 1;
+	options.buffer_size = 1;
+	REQUIRE(xxh::hash_file_pipelined<64>(path, options).hash == xxh::xxhash3<64>(contents, options.seed));
+
+	std::ofstream(path, std::ios::binary | std::ios::trunc).close();
+	REQUIRE(xxh::hash_file_pipelined<64>(path).hash == xxh::xxhash3<64>(contents.data(), 0));
+
+	std::filesystem::remove(path);
+	REQUIRE(!xxh::hash_file_pipelined<64>(path).ok());
+}
+#endif
+
+TEST_CASE("Directory manifests are sorted, stable and incremental", "[manifest]")
+{
+	namespace fs = std::filesystem;
+
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	fs::path const root = fs::temp_directory_path() / ("xxhash_cpp_test_tree_" + std::to_string(dist(rng)));
+	fs::remove_all(root);
+
+	std::vector<std::string> const paths = { "b.txt", "a/z.bin", "a/b/c.txt", "a/b/d e.txt", "c/deep/er/file", "empty" };
+	std::vector<std::vector<uint8_t>> contents;
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		std::vector<uint8_t> data((i == paths.size() - 1) ? 0 : dist(rng) * (i + 1) * 37);
+		std::generate(data.begin(), data.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		fs::create_directories((root / paths[i]).parent_path());
+		std::ofstream(root / paths[i], std::ios::binary).write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		contents.push_back(std::move(data));
+	}
+
+	fs::create_directories(root / "empty_dir");
+
+	xxh::tree_hash_options options;
+	options.threads = 3;
+
+	xxh::tree_hash_result const first = xxh::hash_tree(root, options);
+	REQUIRE(first.ok());
+	REQUIRE(first.files_hashed == paths.size());
+	REQUIRE(first.manifest.entries.size() == paths.size());
+	REQUIRE(std::is_sorted(first.manifest.entries.begin(), first.manifest.entries.end(), [](const xxh::manifest_entry& a, const xxh::manifest_entry& b) { return a.path < b.path; }));
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		const xxh::manifest_entry* const entry = first.manifest.find(paths[i]);
+		REQUIRE(entry != nullptr);
+		REQUIRE(entry->size == contents[i].size());
+		REQUIRE(entry->hash == xxh::xxhash3<128>(contents[i]));
+	}
+
+	options.threads = 1;
+	REQUIRE(xxh::hash_tree(root, options).manifest.root == first.manifest.root);
+
+	std::stringstream text;
+	xxh::write_manifest(text, first.manifest);
+	xxh::manifest loaded;
+	REQUIRE(xxh::read_manifest(text, loaded));
+	REQUIRE(loaded.root == first.manifest.root);
+	REQUIRE(loaded.entries.size() == first.manifest.entries.size());
+
+	options.previous = &loaded;
+	xxh::tree_hash_result const unchanged = xxh::hash_tree(root, options);
+	REQUIRE(unchanged.files_reused == paths.size());
+	REQUIRE(unchanged.files_hashed == 0);
+	REQUIRE(unchanged.manifest.root == first.manifest.root);
+
+	std::ofstream(root / "a/z.bin", std::ios::binary | std::ios::app) << "more";
+	xxh::tree_hash_result const changed = xxh::hash_tree(root, options);
+	REQUIRE(changed.files_hashed == 1);
+	REQUIRE(changed.files_reused == paths.size() - 1);
+	REQUIRE(!(changed.manifest.root == first.manifest.root));
+
+	fs::remove_all(root);
+	REQUIRE(!xxh::hash_tree(root).ok());
+}
+
+TEST_CASE("Hashing streambuf hashes what passes through it", "[stream]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::string contents(200000 + dist(rng), '\0');
+	std::generate(contents.begin(), contents.end(), [&rng, &dist]() {return static_cast<char>(dist(rng)); });
+	uint64_t const seed = dist(rng);
+
+	SECTION("Reading with mixed extraction sizes")
+	{
+		std::stringbuf source(contents);
+		xxh::hashing_streambuf<128> hashing(&source, seed, 1000);
+		std::istream in(&hashing);
+		std::string read_back;
+		std::vector<char> chunk(100000);
+
+		while (in && read_back.size() < contents.size())
+		{
+			size_t const n = (dist(rng) % 4 == 0) ? chunk.size() : dist(rng) * 3;
+
+			if (dist(rng) % 2)
+			{
+				in.read(chunk.data(), static_cast<std::streamsize>(n));
+				read_back.append(chunk.data(), static_cast<size_t>(in.gcount()));
+			}
+			else
+			{
+				for (size_t i = 0; i < n && in.peek() != std::char_traits<char>::eof(); i++)
+				{
+					read_back += static_cast<char>(in.get());
+				}
+			}
+
+			REQUIRE(hashing.digest() == xxh::xxhash3<128>(read_back, seed));
+		}
+
+		REQUIRE(read_back == contents);
+		REQUIRE(hashing.digest() == xxh::xxhash3<128>(contents, seed));
+	}
+
+	SECTION("Writing with mixed insertion sizes")
+	{
+		std::stringbuf sink;
+		{
+			xxh::hashing_streambuf<64> hashing(&sink, seed, 1000);
+			std::ostream out(&hashing);
+			size_t written = 0;
+
+			while (written < contents.size())
+			{
+				size_t const n = std::min(contents.size() - written, static_cast<size_t>((dist(rng) % 4 == 0) ? 100000 : dist(rng) * 3));
+
+				if (dist(rng) % 2)
+				{
+					out.write(contents.data() + written, static_cast<std::streamsize>(n));
+				}
+				else
+				{
+					for (size_t i = 0; i < n; i++)
+					{
+						out.put(contents[written + i]);
+					}
+				}
+
+				written += n;
+				REQUIRE(hashing.digest() == xxh::xxhash3<64>(contents.data(), written, seed));
+			}
+
+			out.flush();
+			REQUIRE(sink.str() == contents);
+
+			hashing.reset(seed);
+			out << "tail";
+			REQUIRE(hashing.digest() == xxh::xxhash3<64>(std::string("tail"), seed));
+		}
+
+		REQUIRE(sink.str() == contents + "tail");
+	}
+}
+
+TEST_CASE("Block sidecars locate corruption to the overlapping blocks", "[blocks]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> data(300000 + dist(rng) * 97);
+	std::generate(data.begin(), data.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::block_options options;
+	options.block_size = 4096;
+	options.seed = dist(rng);
+
+	xxh::thread_pool pool(3);
+	xxh::block_index const index = xxh::build_block_index(data.data(), data.size(), options);
+
+	REQUIRE(index.block_count() == (data.size() + 4095) / 4096);
+	REQUIRE(index.object_digest == xxh::xxhash3<64>(data.data(), data.size(), options.seed));
+	REQUIRE(index.checksums.back() == xxh::xxhash3<64>(data.data() + 4096 * (index.block_count() - 1), data.size() % 4096 ? data.size() % 4096 : 4096, options.seed));
+	REQUIRE(xxh::build_block_index(data.data(), data.size(), pool, options).checksums == index.checksums);
+
+	SECTION("Streaming writer and parser round trip")
+	{
+		std::ostringstream sidecar;
+		xxh::block_index_writer writer(sidecar, options);
+
+		for (size_t written = 0; written < data.size();)
+		{
+			size_t const n = std::min(data.size() - written, static_cast<size_t>((dist(rng) % 4 == 0) ? 10000 : dist(rng) * 7));
+			writer.update(data.data() + written, n);
+			written += n;
+		}
+
+		REQUIRE(writer.finish().checksums == index.checksums);
+
+		std::string const bytes = sidecar.str();
+		std::vector<uint8_t> const serialized = xxh::serialize_block_index(index);
+		REQUIRE(bytes == std::string(serialized.begin(), serialized.end()));
+		REQUIRE(bytes.size() == xxh::block_header_size + 8 * index.block_count() + xxh::block_footer_size);
+
+		xxh::block_index parsed;
+		REQUIRE(xxh::parse_block_index(bytes.data(), bytes.size(), parsed));
+		REQUIRE(parsed.checksums == index.checksums);
+		REQUIRE(parsed.data_length == data.size());
+		REQUIRE(parsed.object_digest == index.object_digest);
+		REQUIRE(parsed.seed == options.seed);
+
+		std::string damaged = bytes;
+		damaged[xxh::block_header_size + 8 * (dist(rng) % index.block_count())] ^= 1;
+		REQUIRE_FALSE(xxh::parse_block_index(damaged.data(), damaged.size(), parsed));
+		REQUIRE_FALSE(xxh::parse_block_index(bytes.data(), bytes.size() - 8, parsed));
+	}
+
+	SECTION("Range verification only reads overlapping blocks")
+	{
+		size_t const flipped = 4096 * 10 + dist(rng);
+		data[flipped] ^= 0x40;
+
+		REQUIRE(xxh::verify_block_range(index, data.data(), 0, 4096 * 10).ok());
+		REQUIRE(xxh::verify_block_range(index, data.data(), 4096 * 11, data.size() - 4096 * 11, pool).ok());
+
+		xxh::block_verify_result const whole = xxh::verify_block_range(index, data.data(), 0, data.size(), pool);
+		REQUIRE(whole.bad_blocks == std::vector<uint64_t>{ 10 });
+		REQUIRE(whole.blocks_checked == index.block_count());
+
+		std::vector<uint64_t> fetched;
+		auto const read = [&](uint64_t offset, void* dest, size_t len) {
+			fetched.push_back(offset / 4096);
+			memcpy(dest, data.data() + offset, len);
+			return true;
+		};
+
+		xxh::block_verify_result const partial = xxh::verify_block_range(index, read, flipped - 5000, 6000);
+		REQUIRE(partial.bad_blocks == std::vector<uint64_t>{ 10 });
+		REQUIRE(fetched == std::vector<uint64_t>{ 8, 9, 10 });
+
+		REQUIRE(xxh::verify_block_range(index, data.data(), data.size() - 10, 20).out_of_range);
+	}
+
+	SECTION("Custom secrets are identified")
+	{
+		std::vector<uint8_t> secret(xxh::detail3::secret_size_min + 32);
+		std::generate(secret.begin(), secret.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		xxh::block_options keyed = options;
+		keyed.secret = secret.data();
+		keyed.secret_size = secret.size();
+
+		std::ostringstream sidecar;
+		xxh::block_index_writer writer(sidecar, keyed);
+		writer.update(data.data(), data.size());
+		xxh::block_index const keyed_index = writer.finish();
+
+		REQUIRE(keyed_index.object_digest == xxh::xxhash3<64>(data.data(), data.size(), secret.data(), secret.size()));
+		REQUIRE(keyed_index.secret_id == xxh::xxhash3<64>(secret.data(), secret.size()));
+		REQUIRE(xxh::verify_block_range(keyed_index, data.data(), 0, data.size(), secret.data(), secret.size()).ok());
+		REQUIRE(xxh::verify_block_range(keyed_index, data.data(), 0, data.size()).wrong_secret);
+	}
+}
+
+template <size_t page_size, size_t offset>
+void check_page_checksum(uint64_t seed, std::minstd_rand& rng)
+{
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+	size_t const count = 11 + dist(rng) % 8;
+	std::vector<uint8_t> pool(page_size * count);
+	std::generate(pool.begin(), pool.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::page_checksum<page_size, offset> const checksum(seed);
+	std::vector<const void*> pages;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t* const page = pool.data() + page_size * i;
+		std::vector<uint8_t> zeroed(page, page + page_size);
+		memset(zeroed.data() + offset, 0, 8);
+
+		REQUIRE(checksum.compute(page) == xxh::xxhash3<64>(zeroed.data(), page_size, seed));
+
+		checksum.seal(page);
+		REQUIRE(checksum.stored(page) == xxh::xxhash3<64>(zeroed.data(), page_size, seed));
+		REQUIRE(checksum.verify(page));
+		pages.push_back(page);
+	}
+
+	/* pages are verified in any order */
+	std::shuffle(pages.begin(), pages.end(), rng);
+	REQUIRE(checksum.verify_pages(pages.data(), pages.size()) == 0);
+
+	size_t const bad = dist(rng) % count;
+	const_cast<uint8_t*>(static_cast<const uint8_t*>(pages[bad]))[dist(rng) * 7 % page_size] ^= 0x10;
+
+	std::unique_ptr<bool[]> valid(new bool[count]);
+	REQUIRE(checksum.verify_pages(pages.data(), pages.size(), valid.get()) == 1);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		REQUIRE(valid[i] == (i != bad));
+	}
+}
+
+TEST_CASE("Page checksums match xxhash3 of the page with the field zeroed", "[page]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	uint64_t const seed = rng();
+
+	check_page_checksum<4096, 0>(seed, rng);
+	check_page_checksum<8192, 200>(seed, rng);
+	check_page_checksum<4096, 4088>(0, rng);
+	check_page_checksum<320, 64>(seed, rng);
+}
+
+TEST_CASE("Content-defined chunks are stable and fingerprinted", "[cdc]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> data(1000000 + dist(rng) * 13);
+	std::generate(data.begin(), data.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::cdc_options options;
+	options.min_size = 1024;
+	options.avg_size = 4096;
+	options.max_size = 16384;
+	options.seed = dist(rng);
+
+	std::vector<xxh::cdc_chunk> const chunks = xxh::cdc_chunks(data.data(), data.size(), options);
+
+	/* a byte at a time reference, rolling from 64 bytes before the first possible cut of each chunk */
+	std::vector<size_t> expected;
+
+	for (size_t start = 0; start < data.size();)
+	{
+		size_t const limit = std::min(data.size() - start, options.max_size);
+		size_t len = std::min(limit, options.min_size - 64);
+		uint64_t fp = 0;
+
+		for (; len < limit; len++)
+		{
+			fp = (fp << 1) + xxh::detail_cdc::gear[data[start + len]];
+
+			if (len >= options.min_size && (fp & (~0ULL << (64 - (len < options.avg_size ? 14 : 10)))) == 0)
+			{
+				len++;
+				break;
+			}
+		}
+
+		expected.push_back(len);
+		start += len;
+	}
+
+	REQUIRE(chunks.size() == expected.size());
+
+	uint64_t offset = 0;
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		REQUIRE(chunks[i].size == expected[i]);
+		REQUIRE(chunks[i].offset == offset);
+		REQUIRE(chunks[i].fingerprint == xxh::xxhash3<128>(data.data() + offset, chunks[i].size, options.seed));
+		REQUIRE(chunks[i].size <= options.max_size);
+		REQUIRE((chunks[i].size > options.min_size || i + 1 == chunks.size()));
+		offset += chunks[i].size;
+	}
+
+	REQUIRE(offset == data.size());
+
+	SECTION("Streaming in pieces gives the same chunks")
+	{
+		xxh::cdc_chunker chunker(options);
+		std::vector<xxh::cdc_chunk> streamed;
+		auto const collect = [&streamed](const xxh::cdc_chunk& chunk) { streamed.push_back(chunk); };
+
+		for (size_t done = 0; done < data.size();)
+		{
+			size_t const n = std::min(data.size() - done, static_cast<size_t>((dist(rng) % 4 == 0) ? 20000 : dist(rng)));
+			chunker.update(data.data() + done, n, collect);
+			done += n;
+		}
+
+		chunker.finish(collect);
+
+		REQUIRE(streamed.size() == chunks.size());
+
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			REQUIRE(streamed[i].offset == chunks[i].offset);
+			REQUIRE(streamed[i].fingerprint == chunks[i].fingerprint);
+		}
+	}
+
+	SECTION("An insertion only changes the chunks around it")
+	{
+		std::vector<uint8_t> edited = data;
+		edited.insert(edited.begin() + static_cast<std::ptrdiff_t>(data.size() / 2), { 1, 2, 3 });
+
+		std::vector<xxh::cdc_chunk> const after = xxh::cdc_chunks(edited.data(), edited.size(), options);
+		std::vector<xxh::hash128_t> before_prints, after_prints;
+
+		for (const auto& chunk : chunks)
+		{
+			before_prints.push_back(chunk.fingerprint);
+		}
+
+		size_t shared = 0;
+
+		for (const auto& chunk : after)
+		{
+			shared += std::count(before_prints.begin(), before_prints.end(), chunk.fingerprint) != 0;
+		}
+
+		REQUIRE(shared + 3 >= chunks.size());
+	}
+}
+
+TEST_CASE("Streaming xxhash3 over several updates ending on a buffer boundary", "[hash3]")
+{
+	std::vector<uint8_t> data(2048);
+	std::iota(data.begin(), data.end(), static_cast<uint8_t>(7));
+
+	/* 80 + 110 + 322 = 512: the second update used to drain the internal buffer, and digest() accumulated the last stripe twice */
+	xxh::hash3_state128_t state128(211);
+	state128.update(data.data(), 80);
+	state128.update(data.data() + 80, 110);
+	state128.update(data.data() + 190, 322);
+	REQUIRE(state128.digest() == xxh::xxhash3<128>(data.data(), 512, 211));
+
+	xxh::hash3_state64_t state64;
+	state64.update(data.data(), 1000);
+	state64.update(data.data() + 1000, 1048);
+	REQUIRE(state64.digest() == xxh::xxhash3<64>(data.data(), 2048));
+}
+
+TEST_CASE("Deltas rebuild the target and only carry changed bytes", "[delta]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 255);
+
+	std::vector<uint8_t> basis(500000 + dist(rng) * 31);
+	std::generate(basis.begin(), basis.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	xxh::delta_options options;
+	options.block_size = 1024 + 8 * dist(rng);
+	options.seed = dist(rng);
+
+	xxh::thread_pool pool(3);
+	xxh::delta_signature const sig = xxh::make_signature(basis.data(), basis.size(), options);
+
+	REQUIRE(sig.block_count() == (basis.size() + options.block_size - 1) / options.block_size);
+	REQUIRE(sig.strong[3] == xxh::xxhash3<64>(basis.data() + 3 * options.block_size, options.block_size, options.seed));
+	REQUIRE(sig.strong.back() == xxh::xxhash3<64>(basis.data() + options.block_size * (sig.block_count() - 1), basis.size() - options.block_size * (sig.block_count() - 1), options.seed));
+	REQUIRE(xxh::make_signature(basis.data(), basis.size(), pool, options).strong == sig.strong);
+	REQUIRE(xxh::make_signature(basis.data(), basis.size(), pool, options).weak == sig.weak);
+
+	auto const round_trip = [&](const std::vector<uint8_t>& target) {
+		xxh::delta const d = xxh::make_delta(sig, target.data(), target.size());
+		std::vector<uint8_t> rebuilt;
+
+		REQUIRE(xxh::apply_delta(basis.data(), basis.size(), d, rebuilt));
+		REQUIRE(rebuilt == target);
+
+		std::vector<uint8_t> const bytes = xxh::serialize_delta(d);
+		xxh::delta parsed;
+		REQUIRE(xxh::parse_delta(bytes.data(), bytes.size(), parsed));
+		REQUIRE(xxh::apply_delta(basis.data(), basis.size(), parsed, rebuilt));
+		REQUIRE(rebuilt == target);
+		return d;
+	};
+
+	SECTION("Unchanged data is a single copy")
+	{
+		xxh::delta const d = round_trip(basis);
+		REQUIRE(d.ops.size() == 1);
+		REQUIRE(d.literal_bytes() == 0);
+	}
+
+	SECTION("Edits cost about a block each")
+	{
+		std::vector<uint8_t> target = basis;
+		size_t const edits = 5;
+
+		for (size_t i = 0; i < edits; i++)
+		{
+			size_t const at = (i + 1) * target.size() / (edits + 2) + dist(rng);
+
+			switch (i % 3)
+			{
+			case 0: target.insert(target.begin() + static_cast<std::ptrdiff_t>(at), 100, static_cast<uint8_t>(i)); break;
+			case 1: target.erase(target.begin() + static_cast<std::ptrdiff_t>(at), target.begin() + static_cast<std::ptrdiff_t>(at + 77)); break;
+			default: target[at] ^= 0xFF; break;
+			}
+		}
+
+		xxh::delta const d = round_trip(target);
+		REQUIRE(d.literal_bytes() <= edits * (2 * options.block_size + 100));
+	}
+
+	SECTION("Unrelated, empty and short targets")
+	{
+		std::vector<uint8_t> other(5000);
+		std::generate(other.begin(), other.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		REQUIRE(round_trip(other).literal_bytes() == other.size());
+		REQUIRE(round_trip(std::vector<uint8_t>()).ops.empty());
+
+		/* the short last basis block matches at the end of the target */
+		size_t const tail = basis.size() % options.block_size;
+		std::vector<uint8_t> ending(basis.end() - static_cast<std::ptrdiff_t>(tail + 3 * options.block_size), basis.end());
+		ending.insert(ending.begin(), 17, 1);
+		REQUIRE(round_trip(ending).literal_bytes() == 17);
+	}
+
+	SECTION("Signatures serialize and bad inputs are rejected")
+	{
+		std::vector<uint8_t> bytes = xxh::serialize_signature(sig);
+		xxh::delta_signature parsed;
+
+		REQUIRE(xxh::parse_signature(bytes.data(), bytes.size(), parsed));
+		REQUIRE(parsed.strong == sig.strong);
+		REQUIRE(parsed.weak == sig.weak);
+		REQUIRE(parsed.length == sig.length);
+
+		bytes[40] ^= 1;
+		REQUIRE_FALSE(xxh::parse_signature(bytes.data(), bytes.size(), parsed));
+
+		xxh::delta d = xxh::make_delta(sig, basis.data(), basis.size());
+		d.ops[0].length += 1;
+		std::vector<uint8_t> rebuilt;
+		REQUIRE_FALSE(xxh::apply_delta(basis.data(), basis.size(), d, rebuilt));
+	}
+}
+
+TEST_CASE("Merkle trees rehash changed paths and locate differences", "[merkle]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 1000000);
+
+	std::map<std::string, std::string> records;
+
+	for (size_t i = 0; i < 5000; i++)
+	{
+		records["key" + std::to_string(dist(rng))] = std::string(dist(rng) % 300, static_cast<char>('a' + i % 26));
+	}
+
+	uint32_t const depth = 8;
+	uint64_t const seed = dist(rng);
+	xxh::merkle_tree a(depth, seed);
+	xxh::merkle_tree b(depth, seed);
+
+	a.assign(records.begin(), records.end());
+
+	for (auto it = records.rbegin(); it != records.rend(); ++it)
+	{
+		b.insert(it->first, it->second);
+	}
+
+	REQUIRE(a.size() == records.size());
+	REQUIRE(b.rehash() == b.leaf_count() - 1);
+	REQUIRE(a.root() == b.root());
+	REQUIRE(xxh::merkle_diff(a, b).empty());
+
+	/* the leaf sum, and the definition of internal nodes */
+	auto const& first = *records.begin();
+	std::string encoded(8, '\0');
+	xxh::mem_ops::writeLE<64>(&encoded[0], first.first.size());
+	encoded += first.first + first.second;
+	REQUIRE(a.leaf_of(first.first) == (xxh::xxhash3<64>(first.first, seed) >> (64 - depth)));
+
+	xxh::merkle_tree single(depth, seed);
+	single.insert(first.first, first.second);
+	REQUIRE(single.leaf(single.leaf_of(first.first)) == xxh::xxhash3<128>(encoded, seed));
+
+	std::array<uint8_t, 32> children;
+	memcpy(children.data(), xxh::canonical128_t(a.node(2)).digest.data(), 16);
+	memcpy(children.data() + 16, xxh::canonical128_t(a.node(3)).digest.data(), 16);
+	REQUIRE(a.root() == xxh::xxhash3<128>(children, seed));
+
+	SECTION("Single updates rehash one path, and differences are found")
+	{
+		auto it = records.begin();
+		std::advance(it, dist(rng) % records.size());
+
+		b.update(it->first, it->second, "changed");
+		REQUIRE(b.rehash() == depth);
+		REQUIRE(a.root() != b.root());
+
+		std::vector<xxh::merkle_range> const diff = xxh::merkle_diff(a, b);
+		uint64_t const token = a.token(it->first);
+
+		REQUIRE(diff.size() == 1);
+		REQUIRE(diff[0].first_leaf == a.leaf_of(it->first));
+		REQUIRE(diff[0].last_leaf == diff[0].first_leaf + 1);
+		REQUIRE(token >= diff[0].first_token);
+		REQUIRE(token <= diff[0].last_token);
+
+		b.update(it->first, "changed", it->second);
+		REQUIRE(a.root() == b.root());
+
+		b.insert("extra", "record");
+		b.erase("extra", "record");
+		REQUIRE(a.root() == b.root());
+		REQUIRE(b.size() == a.size());
+	}
+
+	SECTION("Batches rehash the union of their paths, and match a full rebuild")
+	{
+		std::map<std::string, std::string> changed = records;
+		std::vector<size_t> leaves;
+
+		for (size_t i = 0; i < 20; i++)
+		{
+			std::string const key = "new" + std::to_string(i);
+			changed[key] = "value";
+			b.insert(key, "value");
+			leaves.push_back(b.leaf_of(key));
+		}
+
+		std::sort(leaves.begin(), leaves.end());
+		leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+
+		size_t const hashed = b.rehash();
+		REQUIRE(hashed < 20 * depth);
+		REQUIRE(hashed >= depth + leaves.size() - 1);
+
+		xxh::merkle_tree rebuilt(depth, seed);
+		rebuilt.assign(changed.begin(), changed.end());
+		REQUIRE(rebuilt.root() == b.root());
+
+		size_t covered = 0;
+
+		for (const xxh::merkle_range& range : xxh::merkle_diff(a, b))
+		{
+			covered += range.last_leaf - range.first_leaf;
+		}
+
+		REQUIRE(covered == leaves.size());
+	}
+
+	SECTION("Serialization round trips and corruption is detected")
+	{
+		std::vector<uint8_t> bytes = xxh::serialize_merkle_tree(a);
+		xxh::merkle_tree parsed;
+
+		REQUIRE(bytes.size() == 48 + 16 * a.leaf_count());
+		REQUIRE(xxh::parse_merkle_tree(bytes.data(), bytes.size(), parsed));
+		REQUIRE(parsed.depth() == depth);
+		REQUIRE(parsed.seed() == seed);
+		REQUIRE(parsed.size() == a.size());
+		REQUIRE(parsed.root() == a.root());
+		REQUIRE(xxh::merkle_diff(parsed, a).empty());
+
+		bytes[100] ^= 1;
+		REQUIRE_FALSE(xxh::parse_merkle_tree(bytes.data(), bytes.size(), parsed));
+		REQUIRE_FALSE(xxh::parse_merkle_tree(bytes.data(), bytes.size() - 16, parsed));
+		REQUIRE(parsed.root() == a.root());
+
+		xxh::merkle_tree other(depth + 1, seed);
+		std::vector<xxh::merkle_range> const all = xxh::merkle_diff(a, other);
+		REQUIRE(all.size() == 1);
+		REQUIRE(all[0].first_token == 0);
+		REQUIRE(all[0].last_token == ~0ULL);
+	}
+}
+
+namespace
+{
+	/* counts its calls, to check that growing the table does not rehash keys */
+	struct counting_hash
+	{
+		size_t* calls;
+
+		uint64_t operator()(uint64_t key) const
+		{
+			++*calls;
+			return xxh::xxhash3<64>(&key, sizeof(key));
+		}
+	};
+}
+
+TEST_CASE("Flat map agrees with std::map under random operations", "[flat_map]")
+{
+	std::minstd_rand rng(static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+	std::uniform_int_distribution<uint32_t> dist(0, 4000);
+
+	SECTION("Integer keys, inserts, erases and lookups")
+	{
+		xxh::flat_map<uint64_t, std::string> map;
+		std::map<uint64_t, std::string> reference;
+
+		for (size_t i = 0; i < 50000; i++)
+		{
+			uint64_t const key = dist(rng);
+
+			switch (dist(rng) % 4)
+			{
+			case 0:
+			case 1:
+				REQUIRE(map.try_emplace(key, std::to_string(i)).second == reference.emplace(key, std::to_string(i)).second);
+				break;
+			case 2:
+				REQUIRE(map.erase(key) == reference.erase(key));
+				break;
+			default:
+				REQUIRE(map.contains(key) == (reference.count(key) != 0));
+				break;
+			}
+		}
+
+		REQUIRE(map.size() == reference.size());
+		REQUIRE(static_cast<size_t>(std::distance(map.begin(), map.end())) == reference.size());
+
+		for (const auto& [key, value] : reference)
+		{
+			auto const it = map.find(key);
+			REQUIRE(it != map.end());
+			REQUIRE(it->second == value);
+		}
+
+		/* erasing while iterating visits every element once */
+		size_t visited = 0;
+
+		for (auto it = map.begin(); it != map.end();)
+		{
+			visited++;
+			it = (it->first % 2 == 0) ? map.erase(it) : std::next(it);
+		}
+
+		REQUIRE(visited == reference.size());
+		REQUIRE(map.size() == static_cast<size_t>(std::count_if(reference.begin(), reference.end(), [](const auto& kv) { return kv.first % 2 != 0; })));
+
+		xxh::flat_map<uint64_t, std::string> copy = map;
+		xxh::flat_map<uint64_t, std::string> moved = std::move(map);
+		REQUIRE(copy.size() == moved.size());
+
+		for (const auto& [key, value] : copy)
+		{
+			REQUIRE(moved.find(key)->second == value);
+		}
+
+		copy.clear();
+		REQUIRE(copy.empty());
+		REQUIRE(copy.begin() == copy.end());
+		REQUIRE_FALSE(copy.contains(1));
+	}
+
+	SECTION("String keys with heterogeneous and batched lookups")
+	{
+		xxh::flat_map<std::string, size_t> map = { { "alpha", 1 }, { "beta", 2 } };
+
+		for (size_t i = 0; i < 1000; i++)
+		{
+			map["key" + std::to_string(i)] = i;
+		}
+
+		map.insert_or_assign("alpha", size_t(10));
+		REQUIRE(map.size() == 1002);
+		REQUIRE(map.find(std::string_view("alpha"))->second == 10);
+		REQUIRE(map.find("beta")->second == 2);
+		REQUIRE(map.count("gamma") == 0);
+		REQUIRE(map.erase(std::string_view("beta")) == 1);
+
+		std::vector<std::string_view> keys = { "key0", "missing", "key999", "alpha", "beta" };
+		std::vector<xxh::flat_map<std::string, size_t>::const_iterator> found(keys.size());
+		static_cast<const xxh::flat_map<std::string, size_t>&>(map).find_many(keys.data(), keys.size(), found.data());
+
+		REQUIRE(found[0]->second == 0);
+		REQUIRE(found[1] == map.end());
+		REQUIRE(found[2]->second == 999);
+		REQUIRE(found[3]->second == 10);
+		REQUIRE(found[4] == map.end());
+	}
+
+	SECTION("Growth reuses the stored hashes")
+	{
+		size_t calls = 0;
+		xxh::flat_map<uint64_t, uint64_t, counting_hash> map(0, counting_hash{ &calls });
+
+		for (uint64_t i = 0; i < 10000; i++)
+		{
+			map.try_emplace(i, i);
+		}
+
+		REQUIRE(calls == 10000);
+		REQUIRE(map.capacity() >= 10000);
+
+		std::vector<uint64_t> keys(20000);
+		std::iota(keys.begin(), keys.end(), uint64_t(0));
+		std::vector<xxh::flat_map<uint64_t, uint64_t, counting_hash>::iterator> found(keys.size());
+		map.find_many(keys.data(), keys.size(), found.data());
+
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			REQUIRE((found[i] == map.end()) == (i >= 10000));
+		}
+	}
+}
+
+TEST_CASE("Concurrent map counts exactly under concurrent inserts and growth", "[concurrent_map]")
+{
+	uint32_t const base_seed = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
+	size_t const threads = 8;
+	size_t const per_thread = 40000;
+	size_t const distinct = 20000;
+
+	/* two segments starting from the smallest tables: every segment grows many times while the threads run */
+	xxh::concurrent_map<std::string, std::atomic<uint64_t>> map(0, 2);
+	std::vector<std::thread> workers;
+
+	for (size_t t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&map, t, base_seed]() {
+			std::minstd_rand rng(base_seed + static_cast<uint32_t>(t));
+
+			for (size_t i = 0; i < per_thread; i++)
+			{
+				std::string const key = "metric." + std::to_string(rng() % distinct);
+
+				if (i % 4 == 0)
+				{
+					if (std::atomic<uint64_t>* const v = map.find(key))
+					{
+						v->fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+				}
+
+				map.try_emplace(key, 0).first->fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+
+	for (std::thread& w : workers)
+	{
+		w.join();
+	}
+
+	uint64_t total = 0;
+	size_t visited = 0;
+
+	map.for_each([&](const std::string& key, std::atomic<uint64_t>& value) {
+		REQUIRE(map.find(std::string_view(key)) == &value);
+		total += value.load();
+		visited++;
+	});
+
+	REQUIRE(total == threads * per_thread);
+	REQUIRE(visited == map.size());
+	REQUIRE(map.size() <= distinct);
+	REQUIRE(map.size() > distinct / 2);
+	REQUIRE(map.find("metric.missing") == nullptr);
+
+	auto const inserted = map.try_emplace("metric.new", 5);
+	REQUIRE(inserted.second);
+	REQUIRE_FALSE(map.try_emplace(std::string("metric.new"), 7).second);
+	REQUIRE(map.find("metric.new")->load() == 5);
+
+	map.clear();
+	REQUIRE(map.empty());
+	REQUIRE_FALSE(map.contains("metric.new"));
+	REQUIRE(map.try_emplace("metric.new", 1).second);
+}
+
+TEST_CASE("Interned strings are unique, stable and shared between threads", "[interner]")
+{
+	xxh::interner pool(42);
+	std::vector<std::string> words;
+
+	for (size_t i = 0; i < 5000; i++)
+	{
+		words.push_back("identifier_" + std::to_string(i * 7919 % 5000));
+	}
+
+	words.push_back("");
+	words.push_back(std::string(100000, 'x'));
+
+	std::vector<std::string_view> first;
+
+	for (const std::string& w : words)
+	{
+		first.push_back(pool.intern(w));
+	}
+
+	REQUIRE(pool.size() == words.size());
+	REQUIRE(pool.find("identifier_17") != xxh::interner::npos);
+	REQUIRE(pool.find("identifier_5000") == xxh::interner::npos);
+
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		std::string const copy = words[i];
+		xxh::interner::id_type const id = pool.intern_id(copy);
+
+		REQUIRE(first[i] == words[i]);
+		REQUIRE(first[i].data() != words[i].data());
+		REQUIRE(pool.intern(copy).data() == first[i].data());
+		REQUIRE(pool.view(id).data() == first[i].data());
+		REQUIRE(id == i);
+		REQUIRE(pool.hash(id) == xxh::xxhash3<64>(words[i], 42));
+	}
+
+	/* batches, with duplicates inside a batch and some new strings */
+	std::vector<std::string> more = words;
+	more.insert(more.end(), { "fresh_a", "fresh_b", "fresh_a" });
+	std::vector<std::string_view> tokens(more.begin(), more.end());
+	std::vector<std::string_view> views(tokens.size());
+	std::vector<xxh::interner::id_type> ids(tokens.size());
+
+	pool.intern_many(tokens.data(), tokens.size(), views.data());
+	pool.intern_many(tokens.data(), tokens.size(), ids.data());
+
+	REQUIRE(pool.size() == words.size() + 2);
+	REQUIRE(views.back().data() == views[views.size() - 3].data());
+
+	for (size_t i = 0; i < tokens.size(); i++)
+	{
+		REQUIRE(views[i] == tokens[i]);
+		REQUIRE(pool.view(ids[i]).data() == views[i].data());
+	}
+
+	/* threads interning overlapping strings agree on every id */
+	xxh::interner shared;
+	std::vector<std::vector<xxh::interner::id_type>> seen(4, std::vector<xxh::interner::id_type>(tokens.size()));
+	std::vector<std::thread> workers;
+
+	for (size_t t = 0; t < seen.size(); t++)
+	{
+		workers.emplace_back([&, t]() {
+			for (size_t i = 0; i < tokens.size(); i++)
+			{
+				size_t const k = (i + t * 1000) % tokens.size();
+				seen[t][k] = (t % 2 == 0) ? shared.intern_id(tokens[k]) : xxh::interner::npos;
+			}
+
+			if (t % 2 == 1)
+			{
+				shared.intern_many(tokens.data(), tokens.size(), seen[t].data());
+			}
+		});
+	}
+
+	for (std::thread& w : workers)
+	{
+		w.join();
+	}
+
+	REQUIRE(shared.size() == pool.size());
+
+	for (size_t t = 1; t < seen.size(); t++)
+	{
+		REQUIRE(seen[t] == seen[0]);
+	}
+
+	/* a new pool at the same address does not reuse the front cache of the old one */
+	pool.clear();
+	REQUIRE(pool.size() == 0);
+	REQUIRE(pool.find("identifier_17") == xxh::interner::npos);
+	REQUIRE(pool.intern_id("identifier_17") == 0);
+}
+
+
+namespace
+{
+	/* over 240 bytes, so that the compile time version goes through the stripes of the long path */
+	constexpr char long_literal[] = "A literal long enough for the long path of xxhash3, so that the compile time version goes through stripes and "
+		"the accumulators as the run time version does: it has to be over 240 bytes, so this sentence keeps going for a while longer "
+		"than anybody would like to read, until it is finally long enough, which should be about now.";
+
+	constexpr xxh::hashed_string_view compile_time_key("user_id");
+	constexpr xxh::hashed_string_view compile_time_long(long_literal);
+
+	static_assert(compile_time_key.size() == 7, "hashed_string_view of a literal leaves out the terminator");
+	static_assert(compile_time_key.hash() != xxh::hashed_string_view("user_ic").hash(), "hashed_string_view is hashed at compile time");
+}
+
+TEST_CASE("Hashed strings carry the xxhash3 of their bytes and are not hashed again", "[hashed_string]")
+{
+	using namespace xxh::literals;
+
+	/* the compile time version agrees with xxhash3<64> on every path */
+	std::vector<char> bytes(3000);
+	std::mt19937_64 rng(5);
+
+	for (char& c : bytes)
+	{
+		c = static_cast<char>(rng());
+	}
+
+	for (size_t len = 0; len < bytes.size(); len += (len < 300) ? 1 : 61)
+	{
+		REQUIRE(xxh::detail_hashed::xxhash3_64(bytes.data(), len) == xxh::xxhash3<64>(bytes.data(), len));
+	}
+
+	REQUIRE(sizeof(long_literal) > 241);
+	REQUIRE(compile_time_long.hash() == xxh::xxhash3<64>(long_literal, sizeof(long_literal) - 1));
+	REQUIRE(compile_time_key.hash() == xxh::xxhash3<64>(std::string("user_id")));
+
+	constexpr xxh::hashed_string_view from_literal = "session"_xxh;
+	xxh::hashed_string const owned("session");
+	xxh::hashed_string const copied(from_literal);
+
+	REQUIRE(from_literal.hash() == xxh::xxhash3<64>(std::string("session")));
+	REQUIRE(owned.hash() == from_literal.hash());
+	REQUIRE(copied.str() == "session");
+	REQUIRE(xxh::hashed_string().hash() == xxh::xxhash3<64>(nullptr, 0));
+	REQUIRE(xxh::hashed_string_view().hash() == xxh::xxhash3<64>(nullptr, 0));
+
+	REQUIRE(owned == from_literal);
+	REQUIRE(owned == copied);
+	REQUIRE(owned != compile_time_key);
+	REQUIRE(owned == std::string("session"));
+	REQUIRE(std::string_view("session") == from_literal);
+	REQUIRE(from_literal != "sessions");
+
+	/* the same bytes with a wrong stored hash compare unequal: the hashes are compared first */
+	REQUIRE(xxh::hashed_string_view(owned.data(), owned.size(), owned.hash() + 1) != owned);
+
+	xxh::hashed_string moved("a string long enough to live on the heap rather than inside the object");
+	uint64_t const moved_hash = moved.hash();
+	std::string const released = moved.release();
+
+	REQUIRE(xxh::xxhash3<64>(released) == moved_hash);
+	REQUIRE(moved.empty());
+	REQUIRE(moved == xxh::hashed_string_view());
+
+	/* hashers take the stored hash with seed 0, and hash the bytes again with any other seed */
+	xxh::flat_hash<xxh::hashed_string> hasher;
+	xxh::flat_hash<std::string> string_hasher;
+
+	REQUIRE(hasher(owned) == owned.hash());
+	REQUIRE(string_hasher(from_literal) == owned.hash());
+	REQUIRE(string_hasher(std::string_view("session")) == owned.hash());
+
+	hasher.seed = 9;
+	REQUIRE(hasher(owned) == xxh::xxhash3<64>(std::string("session"), 9));
+
+	/* a stored hash that does not match the bytes shows the maps use it as is */
+	xxh::hashed_string_view const lying("session", 7, 12345);
+	xxh::flat_map<xxh::hashed_string, int> map;
+	xxh::flat_map<std::string, int> strings;
+
+	map[owned] = 1;
+	strings["session"] = 2;
+
+	REQUIRE(xxh::flat_hash<xxh::hashed_string>()(lying) == 12345);
+	REQUIRE(map.find(lying) == map.end());
+	REQUIRE(map.find(from_literal) != map.end());
+	REQUIRE(map.contains(std::string_view("session")));
+	REQUIRE(map.count("session"_xxh) == 1);
+	REQUIRE(strings.find(from_literal)->second == 2);
+	REQUIRE(strings.find("session") != strings.end());
+
+	xxh::concurrent_map<xxh::hashed_string, int> shared;
+
+	shared.try_emplace(owned, 3);
+	REQUIRE(*shared.find(from_literal) == 3);
+	REQUIRE(shared.find(lying) == nullptr);
+
+	xxh::interner pool;
+	xxh::interner seeded(42);
+	xxh::interner::id_type const id = pool.intern_id(from_literal);
+
+	REQUIRE(pool.find("session") == id);
+	REQUIRE(pool.find(owned) == id);
+	REQUIRE(pool.find(lying) == xxh::interner::npos);
+	REQUIRE(pool.hash(id) == from_literal.hash());
+	REQUIRE(seeded.intern(owned) == "session");
+	REQUIRE(seeded.find(lying) == seeded.find("session"));
+}
+
+TEST_CASE("Blocked Bloom filters have no false negatives and survive serialization", "[bloom]")
+{
+	size_t const n = 20000;
+	std::vector<std::string> keys;
+	std::vector<std::string> others;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		keys.push_back("present:" + std::to_string(i));
+		others.push_back("absent:" + std::to_string(i));
+	}
+
+	std::vector<std::string_view> key_views(keys.begin(), keys.end());
+	std::vector<std::string_view> other_views(others.begin(), others.end());
+
+	xxh::blocked_bloom one_by_one(n, 12.0, 7);
+	xxh::blocked_bloom batched(n, 12.0, 7);
+
+	for (const std::string& k : keys)
+	{
+		one_by_one.insert(k);
+	}
+
+	batched.insert_many(key_views.data(), key_views.size());
+
+	REQUIRE(memcmp(one_by_one.data(), batched.data(), batched.size_bytes()) == 0);
+	REQUIRE(one_by_one.size_bytes() >= n * 12 / 8);
+
+	std::vector<char> found(n);
+	batched.contains_many(key_views.data(), n, reinterpret_cast<bool*>(found.data()));
+
+	size_t false_positives = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		REQUIRE(batched.contains(keys[i]));
+		REQUIRE(found[i]);
+		false_positives += batched.contains(others[i]) ? 1 : 0;
+	}
+
+	/* about 0.5% expected at 12 bits per key */
+	REQUIRE(false_positives < n / 50);
+	REQUIRE(batched.fill_ratio() > 0.3);
+	REQUIRE(batched.fill_ratio() < 0.7);
+
+	/* every word of the block gets exactly one bit of a key */
+	xxh::blocked_bloom single(1);
+	single.insert("only");
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		uint64_t const word = xxh::mem_ops::readLE<64>(single.data() + 8 * i);
+		REQUIRE(word != 0);
+		REQUIRE((word & (word - 1)) == 0);
+	}
+
+	/* vector and word by word versions set and test the same bits */
+	std::mt19937_64 rng(3);
+	xxh::detail_bloom::block vector_block{};
+	xxh::detail_bloom::block scalar_block{};
+
+	for (size_t i = 0; i < 1000; i++)
+	{
+		xxh::hash128_t const h = { rng(), rng() };
+
+		xxh::detail_bloom::set_bits<xxh::detail_bloom::lane_bits>(vector_block.bytes, h);
+		xxh::detail_bloom::set_bits<64>(scalar_block.bytes, h);
+		REQUIRE(memcmp(vector_block.bytes, scalar_block.bytes, sizeof(scalar_block.bytes)) == 0);
+
+		xxh::hash128_t const q = { rng(), rng() };
+		REQUIRE(xxh::detail_bloom::test_bits<xxh::detail_bloom::lane_bits>(vector_block.bytes, q) == xxh::detail_bloom::test_bits<64>(scalar_block.bytes, q));
+
+		if (i % 100 == 99)
+		{
+			vector_block = scalar_block = xxh::detail_bloom::block{};
+		}
+	}
+
+	/* a serialized filter answers in place, and parses back into a filter */
+	std::vector<uint8_t> bytes = xxh::serialize_blocked_bloom(batched);
+	xxh::blocked_bloom_view view;
+	xxh::blocked_bloom copy;
+
+	REQUIRE(bytes.size() == 64 + batched.size_bytes());
+	REQUIRE(xxh::parse_blocked_bloom(bytes.data(), bytes.size(), view));
+	REQUIRE(xxh::parse_blocked_bloom(bytes.data(), bytes.size(), copy));
+	REQUIRE(view.block_count() == batched.block_count());
+	REQUIRE(copy.seed() == 7);
+
+	for (size_t i = 0; i < n; i += 7)
+	{
+		REQUIRE(view.contains(keys[i]));
+		REQUIRE(copy.contains(keys[i]));
+		REQUIRE(view.contains(others[i]) == batched.contains(others[i]));
+	}
+
+	std::vector<char> view_found(n);
+	view.contains_many(other_views.data(), n, reinterpret_cast<bool*>(view_found.data()));
+	REQUIRE(static_cast<size_t>(std::count(view_found.begin(), view_found.end(), 1)) == false_positives);
+
+	REQUIRE_FALSE(xxh::parse_blocked_bloom(bytes.data(), bytes.size() - 1, view));
+	bytes[0] = 'Y';
+	REQUIRE_FALSE(xxh::parse_blocked_bloom(bytes.data(), bytes.size(), view));
+	REQUIRE(view.block_count() == batched.block_count());
+
+	/* merging adds the keys of filters of the same shape only */
+	xxh::blocked_bloom left(n, 12.0, 7);
+	xxh::blocked_bloom right(n, 12.0, 7);
+
+	left.insert("left");
+	right.insert("right");
+	REQUIRE(left.merge(right));
+	REQUIRE(left.contains("left"));
+	REQUIRE(left.contains("right"));
+	REQUIRE_FALSE(left.merge(xxh::blocked_bloom(n, 12.0, 8)));
+	REQUIRE_FALSE(left.merge(xxh::blocked_bloom(2 * n, 12.0, 7)));
+
+	left.clear();
+	REQUIRE_FALSE(left.contains("left"));
+	REQUIRE(left.fill_ratio() == 0.0);
+}
+
+namespace
+{
+	template <size_t Bits>
+	void check_cuckoo_filter(double max_false_positives)
+	{
+		size_t const n = 30000;
+		xxh::cuckoo_filter<Bits> filter(n, 5);
+		std::vector<std::string> keys;
+		std::vector<std::string_view> views;
+
+		for (size_t i = 0; i < 2 * n; i++)
+		{
+			keys.push_back("key:" + std::to_string(i));
+		}
+
+		views.assign(keys.begin(), keys.end());
+
+		for (size_t i = 0; i < n; i++)
+		{
+			REQUIRE(filter.insert(keys[i]));
+		}
+
+		REQUIRE(filter.size() == n);
+		REQUIRE(filter.load_factor() > 0.4);
+
+		std::vector<char> found(2 * n);
+		filter.contains_many(views.data(), views.size(), reinterpret_cast<bool*>(found.data()));
+
+		size_t false_positives = 0;
+
+		for (size_t i = 0; i < 2 * n; i++)
+		{
+			REQUIRE(static_cast<bool>(found[i]) == filter.contains(keys[i]));
+
+			if (i < n)
+			{
+				REQUIRE(found[i]);
+			}
+			else
+			{
+				false_positives += found[i] ? 1 : 0;
+			}
+		}
+
+		REQUIRE(static_cast<double>(false_positives) < max_false_positives * n);
+
+		/* removing the even keys keeps the odd ones */
+		for (size_t i = 0; i < n; i += 2)
+		{
+			REQUIRE(filter.remove(keys[i]));
+		}
+
+		size_t still_found = 0;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (i % 2 == 1)
+			{
+				REQUIRE(filter.contains(keys[i]));
+			}
+			else
+			{
+				still_found += filter.contains(keys[i]) ? 1 : 0;
+			}
+		}
+
+		REQUIRE(static_cast<double>(still_found) < max_false_positives * n);
+		REQUIRE(filter.size() == n / 2);
+
+		/* filled until an insert fails, every key that went in is still found, the one kept aside included */
+		xxh::cuckoo_filter<Bits> full(1000);
+		size_t inserted = 0;
+
+		while (inserted < keys.size() && full.insert(keys[inserted]))
+		{
+			inserted++;
+		}
+
+		REQUIRE(inserted < keys.size());
+		REQUIRE(full.load_factor() > 0.85);
+
+		for (size_t i = 0; i < inserted; i++)
+		{
+			REQUIRE(full.contains(keys[i]));
+		}
+
+		REQUIRE(full.remove(keys[0]));
+		REQUIRE(full.insert(keys[inserted]));
+
+		for (size_t i = 1; i <= inserted; i++)
+		{
+			REQUIRE(full.contains(keys[i]));
+		}
+
+		full.clear();
+		REQUIRE(full.size() == 0);
+		REQUIRE_FALSE(full.contains(keys[1]));
+		REQUIRE(full.insert(keys[1]));
+	}
+}
+
+TEST_CASE("Cuckoo filters find what was inserted until it is removed", "[cuckoo]")
+{
+	check_cuckoo_filter<8>(0.06);
+	check_cuckoo_filter<16>(0.001);
+
+	/* the SSE2 and word versions of the bucket comparison agree */
+	std::mt19937_64 rng(17);
+	uint8_t buckets[16];
+
+	for (size_t i = 0; i < 10000; i++)
+	{
+		uint64_t const words[2] = { rng() & rng(), rng() | rng() };
+		uint64_t const fp = (i % 3 == 0) ? ((words[i % 2] >> (16 * (i % 4))) & 0xFFFF) : (rng() & 0xFFFF);
+
+		xxh::mem_ops::writeLE<64>(buckets, words[0]);
+		xxh::mem_ops::writeLE<64>(buckets + 8, words[1]);
+
+		bool const expected = [&]() {
+			for (size_t s = 0; s < 8; s++)
+			{
+				if (((words[s / 4] >> (16 * (s % 4))) & 0xFFFF) == fp)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}();
+
+		REQUIRE(xxh::detail_cuckoo::match2<xxh::detail_cuckoo::lane_bits, 16>(buckets, buckets + 8, fp) == expected);
+		REQUIRE(xxh::detail_cuckoo::match2<64, 16>(buckets, buckets + 8, fp) == expected);
+	}
+}
+
+namespace
+{
+	template <size_t Bits>
+	void check_fuse_filter(double max_false_positives)
+	{
+		size_t const n = 100000;
+		std::vector<uint64_t> ids(n);
+		std::mt19937_64 rng(Bits);
+
+		for (uint64_t& id : ids)
+		{
+			id = rng();
+		}
+
+		xxh::fuse_filter<Bits> filter;
+		REQUIRE(filter.build(ids.data(), ids.size()));
+		REQUIRE(filter.bits_per_key(n) < 1.3 * Bits);
+
+		std::vector<uint64_t> probes(n);
+
+		for (uint64_t& p : probes)
+		{
+			p = rng();
+		}
+
+		std::vector<char> found(n);
+		std::vector<char> others(n);
+		filter.contains_many(ids.data(), n, reinterpret_cast<bool*>(found.data()));
+		filter.contains_many(probes.data(), n, reinterpret_cast<bool*>(others.data()));
+
+		size_t false_positives = 0;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			REQUIRE(filter.contains(ids[i]));
+			REQUIRE(found[i]);
+			REQUIRE(static_cast<bool>(others[i]) == filter.contains(probes[i]));
+			false_positives += others[i] ? 1 : 0;
+		}
+
+		REQUIRE(static_cast<double>(false_positives) < max_false_positives * n);
+
+		/* string keys, with duplicates, and every small size */
+		std::vector<std::string> words;
+
+		for (size_t i = 0; i < 3000; i++)
+		{
+			words.push_back("blocked:" + std::to_string(i % 2500));
+		}
+
+		for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(17), size_t(100), size_t(2500), size_t(3000) })
+		{
+			std::vector<std::string_view> views(words.begin(), words.begin() + count);
+			xxh::fuse_filter<Bits> small;
+
+			REQUIRE(small.build(views.data(), views.size()));
+
+			for (std::string_view w : views)
+			{
+				REQUIRE(small.contains(w));
+			}
+
+			std::vector<char> small_found(count);
+			small.contains_many(views.data(), count, reinterpret_cast<bool*>(small_found.data()));
+			REQUIRE(static_cast<size_t>(std::count(small_found.begin(), small_found.end(), 1)) == count);
+		}
+
+		/* nothing but copies of one key */
+		std::vector<uint64_t> same(1000, 42);
+		xxh::fuse_filter<Bits> copies;
+
+		REQUIRE(copies.build(same.data(), same.size()));
+		REQUIRE(copies.contains(uint64_t(42)));
+	}
+}
+
+TEST_CASE("Binary fuse filters contain their keys and few others", "[fuse]")
+{
+	check_fuse_filter<8>(0.008);
+	check_fuse_filter<16>(0.0002);
+
+	xxh::fuse_filter8 empty;
+	REQUIRE_FALSE(empty.contains("anything"));
+}
+
+TEST_CASE("Minimal perfect hash functions give every key its own index", "[mphf]")
+{
+	auto is_permutation = [](const std::vector<uint64_t>& indices) {
+		std::vector<char> seen(indices.size(), 0);
+
+		for (uint64_t i : indices)
+		{
+			if (i >= indices.size() || seen[i])
+			{
+				return false;
+			}
+
+			seen[i] = 1;
+		}
+
+		return true;
+	};
+
+	/* several partitions, built on a pool */
+	size_t const n = 300000;
+	std::vector<uint64_t> ids(n);
+	std::mt19937_64 rng(31);
+
+	for (uint64_t& id : ids)
+	{
+		id = rng();
+	}
+
+	xxh::mphf_params params;
+	params.partition_keys = 50000;
+
+	xxh::thread_pool pool(4);
+	xxh::mphf f;
+	REQUIRE(f.build(ids.data(), n, pool, 7, params));
+	REQUIRE(f.size() == n);
+	REQUIRE(f.bits_per_key() < 5.0);
+
+	std::vector<uint64_t> indices(n);
+	f.lookup_many(ids.data(), n, indices.data());
+	REQUIRE(is_permutation(indices));
+
+	for (size_t i = 0; i < n; i += 97)
+	{
+		REQUIRE(f.lookup(ids[i]) == indices[i]);
+	}
+
+	/* the serialized form is queried in place, and copies answer the same */
+	std::vector<uint8_t> const bytes = xxh::serialize_mphf(f);
+	xxh::mphf_view view;
+	REQUIRE(xxh::parse_mphf(bytes.data(), bytes.size(), view));
+
+	xxh::mphf copy;
+	REQUIRE(xxh::parse_mphf(bytes.data(), bytes.size(), copy));
+	xxh::mphf moved = std::move(copy);
+
+	for (size_t i = 0; i < n; i += 13)
+	{
+		REQUIRE(view.lookup(ids[i]) == indices[i]);
+		REQUIRE(moved.lookup(ids[i]) == indices[i]);
+	}
+
+	std::vector<uint8_t> broken = bytes;
+	broken[4] ^= 1;
+	REQUIRE_FALSE(xxh::parse_mphf(broken.data(), broken.size(), view));
+	REQUIRE_FALSE(xxh::parse_mphf(bytes.data(), bytes.size() - 1, view));
+	REQUIRE(view.size() == n);
+
+	/* string keys of every small count */
+	std::vector<std::string> words;
+
+	for (size_t i = 0; i < 3000; i++)
+	{
+		words.push_back("perfect:" + std::to_string(i));
+	}
+
+	for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(17), size_t(100), size_t(3000) })
+	{
+		std::vector<std::string_view> views(words.begin(), words.begin() + count);
+		xxh::mphf small;
+
+		REQUIRE(small.build(views.data(), count));
+
+		std::vector<uint64_t> small_indices(count);
+		small.lookup_many(views.data(), count, small_indices.data());
+		REQUIRE(is_permutation(small_indices));
+
+		for (size_t i = 0; i < count; i++)
+		{
+			REQUIRE(small.lookup(views[i]) == small_indices[i]);
+		}
+
+		REQUIRE(small.lookup("not a key") < std::max<size_t>(count, 1));
+	}
+
+	/* duplicate keys have no minimal perfect hash */
+	std::vector<uint64_t> same(100, 42);
+	xxh::mphf none;
+	REQUIRE_FALSE(none.build(same.data(), same.size()));
+	REQUIRE(none.size() == 0);
+	REQUIRE(none.lookup(uint64_t(42)) == 0);
+}
+
+TEST_CASE("HyperLogLog sketches estimate distinct counts", "[hyperloglog]")
+{
+	std::vector<std::string> keys;
+
+	for (size_t i = 0; i < 200000; i++)
+	{
+		keys.push_back("visitor:" + std::to_string(i));
+	}
+
+	/* sparse: small sets are counted almost exactly, duplicates change nothing */
+	xxh::hyperloglog<14> small;
+
+	for (size_t i = 0; i < 3000; i++)
+	{
+		small.insert(keys[i % 1000]);
+	}
+
+	REQUIRE(small.is_sparse());
+	REQUIRE(std::abs(small.estimate() - 1000.0) < 2.0);
+
+	/* dense: within 4 standard errors */
+	xxh::hyperloglog<14> forward, backward;
+	std::vector<std::string_view> views(keys.begin(), keys.end());
+
+	for (const std::string& k : keys)
+	{
+		forward.insert(k);
+	}
+
+	backward.insert_many(std::vector<std::string_view>(views.rbegin(), views.rend()).data(), views.size());
+	REQUIRE_FALSE(forward.is_sparse());
+	REQUIRE(std::abs(forward.estimate() / 200000.0 - 1.0) < 4 * 1.04 / 128);
+
+	/* the registers do not depend on insertion order, on when the sketch turned dense, or on how it was split and merged */
+	std::vector<uint8_t> const bytes = xxh::serialize_hyperloglog(forward);
+	REQUIRE(xxh::serialize_hyperloglog(backward) == bytes);
+	REQUIRE(bytes.size() == 24 + (size_t(1) << 14) / 4 * 3);
+
+	xxh::hyperloglog<14> merged;
+
+	for (size_t first = 0; first < keys.size(); first += 500)
+	{
+		xxh::hyperloglog<14> part;
+		part.insert_many(views.data() + first, 500);
+		REQUIRE(part.is_sparse());
+		REQUIRE(merged.merge(part));
+	}
+
+	REQUIRE(xxh::serialize_hyperloglog(merged) == bytes);
+	REQUIRE_FALSE(merged.merge(xxh::hyperloglog<14>(1)));
+
+	/* dense into sparse, and the estimate of the union */
+	xxh::hyperloglog<14> tail;
+
+	for (size_t i = 150000; i < keys.size(); i++)
+	{
+		tail.insert(keys[i]);
+	}
+
+	xxh::hyperloglog<14> head;
+	head.insert_many(views.data(), 150000);
+	REQUIRE(tail.merge(head));
+	REQUIRE(xxh::serialize_hyperloglog(tail) == bytes);
+
+	/* serialized forms round trip */
+	xxh::hyperloglog<14> parsed;
+	REQUIRE(xxh::parse_hyperloglog(bytes.data(), bytes.size(), parsed));
+	REQUIRE(parsed.estimate() == forward.estimate());
+
+	std::vector<uint8_t> const sparse_bytes = xxh::serialize_hyperloglog(small);
+	REQUIRE(sparse_bytes.size() < 24 + 4 * 1000);
+	REQUIRE(xxh::parse_hyperloglog(sparse_bytes.data(), sparse_bytes.size(), parsed));
+	REQUIRE(parsed.is_sparse());
+	REQUIRE(parsed.estimate() == small.estimate());
+	REQUIRE(xxh::serialize_hyperloglog(parsed) == sparse_bytes);
+
+	xxh::hyperloglog<12> other_precision;
+	REQUIRE_FALSE(xxh::parse_hyperloglog(bytes.data(), bytes.size(), other_precision));
+	REQUIRE_FALSE(xxh::parse_hyperloglog(sparse_bytes.data(), sparse_bytes.size() - 1, parsed));
+	REQUIRE(parsed.estimate() == small.estimate());
+
+	parsed.clear();
+	REQUIRE(parsed.estimate() == 0.0);
+
+	/* vector register merge and sums match the scalar ones */
+	std::vector<uint8_t> a(4096 + 7), b(4096 + 7);
+	std::mt19937 rng(5);
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		a[i] = static_cast<uint8_t>(rng() % 3 == 0 ? 0 : rng() % 20);
+		b[i] = static_cast<uint8_t>(rng() % 20);
+	}
+
+	std::vector<uint8_t> scalar_max = a, vector_max = a;
+	xxh::detail_hll::max_registers<64>(scalar_max.data(), b.data(), b.size());
+	xxh::detail_hll::max_registers<xxh::detail_hll::lane_bits>(vector_max.data(), b.data(), b.size());
+	REQUIRE(scalar_max == vector_max);
+
+	auto const scalar_sums = xxh::detail_hll::sum_registers<64>(a.data(), a.size());
+	auto const vector_sums = xxh::detail_hll::sum_registers<xxh::detail_hll::lane_bits>(a.data(), a.size());
+	REQUIRE(scalar_sums.zeros == vector_sums.zeros);
+	REQUIRE(std::abs(scalar_sums.harmonic - vector_sums.harmonic) < 1e-6 * scalar_sums.harmonic);
+}
+
+TEST_CASE("Count-Min sketches never underestimate counts", "[count_min]")
+{
+	/* a skewed stream: key i appears about 1 / (i + 1) as often as key 0 */
+	std::vector<std::string> keys;
+
+	for (size_t i = 0; i < 5000; i++)
+	{
+		keys.push_back("/api/v1/resource/" + std::to_string(i));
+	}
+
+	std::vector<std::string_view> stream;
+	std::vector<uint32_t> truth(keys.size(), 0);
+	std::mt19937_64 rng(17);
+
+	for (size_t i = 0; i < 200000; i++)
+	{
+		size_t const k = static_cast<size_t>(std::exp(std::uniform_real_distribution<double>(0.0, std::log(5000.0))(rng))) - 1;
+		stream.push_back(keys[k]);
+		truth[k]++;
+	}
+
+	xxh::count_min<4096, 4> plain(3, false);
+	xxh::count_min<4096, 4> conservative(3);
+	xxh::count_min<4096, 4> batched(3);
+
+	for (std::string_view k : stream)
+	{
+		plain.add(k);
+		conservative.add(k);
+	}
+
+	batched.add_many(stream.data(), stream.size());
+	REQUIRE(plain.total() == stream.size());
+	REQUIRE(batched.total() == stream.size());
+
+	std::vector<uint32_t> many(keys.size());
+	std::vector<std::string_view> views(keys.begin(), keys.end());
+	conservative.estimate_many(views.data(), views.size(), many.data());
+
+	double plain_error = 0.0, conservative_error = 0.0;
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		REQUIRE(plain.estimate(keys[i]) >= truth[i]);
+		REQUIRE(conservative.estimate(keys[i]) >= truth[i]);
+		REQUIRE(conservative.estimate(keys[i]) <= plain.estimate(keys[i]));
+		REQUIRE(batched.estimate(keys[i]) == conservative.estimate(keys[i]));
+		REQUIRE(many[i] == conservative.estimate(keys[i]));
+		plain_error += plain.estimate(keys[i]) - truth[i];
+		conservative_error += conservative.estimate(keys[i]) - truth[i];
+	}
+
+	/* about N / W per row before the minimum */
+	REQUIRE(plain_error / static_cast<double>(keys.size()) < 200000.0 / 4096);
+	REQUIRE(conservative_error < 0.75 * plain_error);
+
+	/* per thread sketches add up to the sketch of the whole stream */
+	std::vector<xxh::count_min<4096, 4>> parts(4, xxh::count_min<4096, 4>(3, false));
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < parts.size(); t++)
+	{
+		threads.emplace_back([&, t]() {
+			size_t const first = stream.size() * t / parts.size();
+			size_t const last = stream.size() * (t + 1) / parts.size();
+
+			for (size_t i = first; i < last; i++)
+			{
+				parts[t].add(stream[i]);
+			}
+		});
+	}
+
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+
+	xxh::count_min<4096, 4> merged(3, false);
+
+	for (const auto& part : parts)
+	{
+		REQUIRE(merged.merge(part));
+	}
+
+	REQUIRE(merged.total() == stream.size());
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		REQUIRE(merged.estimate(keys[i]) == plain.estimate(keys[i]));
+	}
+
+	REQUIRE_FALSE(merged.merge(xxh::count_min<4096, 4>(4)));
+
+	/* other shapes, weighted adds, and counters saturate instead of wrapping */
+	xxh::count_min<64, 16> deep;
+	xxh::count_min<256, 1> shallow(0, false);
+	deep.add("heavy", 0xFFFFFFF0u);
+	deep.add("heavy", 0x100u);
+	shallow.add("light", 5);
+	REQUIRE(deep.estimate("heavy") == 0xFFFFFFFFu);
+	REQUIRE(shallow.estimate("light") >= 5);
+	REQUIRE(shallow.size_bytes() == 256 * 4);
+
+	deep.clear();
+	REQUIRE(deep.estimate("heavy") == 0);
+	REQUIRE(deep.total() == 0);
+}